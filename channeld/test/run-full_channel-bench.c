@@ -0,0 +1,230 @@
+/* Build commitment transactions for a channel full of HTLCs.
+ * Run with --bench to time it too. */
+#include "config.h"
+#include "../../common/blockheight_states.c"
+#include "../../common/channel_id.c"
+/* Normally fee_states does not allow feerate < 253 */
+#define TEST_ALLOW_ZERO_FEERATE 1
+#include "../../common/fee_states.c"
+#include "../../common/initial_channel.c"
+#include "../../common/keyset.c"
+#include "../full_channel.c"
+#include "../commit_tx.c"
+#include <ccan/str/str.h>
+#include <ccan/time/time.h>
+#include <common/setup.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* AUTOGENERATED MOCKS START */
+/* Generated stub for fromwire_bigsize */
+bigsize_t fromwire_bigsize(const u8 **cursor UNNEEDED, size_t *max UNNEEDED)
+{ fprintf(stderr, "fromwire_bigsize called!\n"); abort(); }
+/* Generated stub for fromwire_node_id */
+void fromwire_node_id(const u8 **cursor UNNEEDED, size_t *max UNNEEDED, struct node_id *id UNNEEDED)
+{ fprintf(stderr, "fromwire_node_id called!\n"); abort(); }
+/* Generated stub for memleak_add_helper_ */
+void memleak_add_helper_(const tal_t *p UNNEEDED, void (*cb)(struct htable *memtable UNNEEDED,
+						    const tal_t *)){ }
+/* Generated stub for memleak_scan_htable */
+void memleak_scan_htable(struct htable *memtable UNNEEDED, const struct htable *ht UNNEEDED)
+{ fprintf(stderr, "memleak_scan_htable called!\n"); abort(); }
+/* Generated stub for pubkey_from_node_id */
+bool pubkey_from_node_id(struct pubkey *key UNNEEDED, const struct node_id *id UNNEEDED)
+{ fprintf(stderr, "pubkey_from_node_id called!\n"); abort(); }
+/* Generated stub for send_backtrace */
+void send_backtrace(const char *why UNNEEDED)
+{ fprintf(stderr, "send_backtrace called!\n"); abort(); }
+/* Generated stub for status_failed */
+void status_failed(enum status_failreason code UNNEEDED,
+		   const char *fmt UNNEEDED, ...)
+{ fprintf(stderr, "status_failed called!\n"); abort(); }
+/* Generated stub for towire_bigsize */
+void towire_bigsize(u8 **pptr UNNEEDED, const bigsize_t val UNNEEDED)
+{ fprintf(stderr, "towire_bigsize called!\n"); abort(); }
+/* Generated stub for towire_node_id */
+void towire_node_id(u8 **pptr UNNEEDED, const struct node_id *id UNNEEDED)
+{ fprintf(stderr, "towire_node_id called!\n"); abort(); }
+/* AUTOGENERATED MOCKS END */
+
+void status_fmt(enum log_level level UNUSED,
+		const struct node_id *node_id,
+		const char *fmt, ...)
+{
+}
+
+/* BOLT #2:
+ *
+ * - if `max_accepted_htlcs` is greater than 483:
+ *   - MUST consider the `open_channel` as invalid.
+ */
+#define BENCH_HTLCS_PER_SIDE 483
+#define BENCH_RUNS 10
+
+static struct pubkey make_pubkey(u8 seed)
+{
+	struct secret secret;
+	struct pubkey pubkey;
+
+	memset(&secret, seed, sizeof(secret));
+	if (!pubkey_from_secret(&secret, &pubkey))
+		abort();
+	return pubkey;
+}
+
+/* Fill both directions, with a mix of amounts and shared payment hashes
+ * so the sort has to look at scripts and cltvs too. */
+static void add_htlcs(struct channel *channel)
+{
+	const struct htlc **changed_htlcs;
+	u8 *dummy_routing = tal_arr(tmpctx, u8,
+				    TOTAL_PACKET_SIZE(ROUTING_INFO_SIZE));
+	bool ret;
+
+	for (size_t i = 0; i < 2 * BENCH_HTLCS_PER_SIDE; i++) {
+		struct preimage preimage;
+		struct sha256 hash;
+		enum channel_add_err e;
+		enum side sender = i % 2 ? REMOTE : LOCAL;
+
+		memset(&preimage, i % 50, sizeof(preimage));
+		sha256(&hash, &preimage, sizeof(preimage));
+		e = channel_add_htlc(channel, sender, i / 2,
+				     amount_msat(1000000 + (i % 100) * 1000),
+				     500 + i % 7, &hash,
+				     dummy_routing, NULL, NULL, NULL, true);
+		assert(e == CHANNEL_ERR_ADD_OK);
+	}
+
+	/* Now make HTLCs fully committed. */
+	changed_htlcs = tal_arr(tmpctx, const struct htlc *, 0);
+	ret = channel_sending_commit(channel, &changed_htlcs);
+	assert(ret);
+	ret = channel_rcvd_revoke_and_ack(channel, &changed_htlcs);
+	assert(ret);
+	ret = channel_rcvd_commit(channel, &changed_htlcs);
+	assert(ret);
+	ret = channel_sending_revoke_and_ack(channel);
+	assert(ret);
+	ret = channel_sending_commit(channel, &changed_htlcs);
+	assert(ret);
+	ret = channel_rcvd_revoke_and_ack(channel, &changed_htlcs);
+	assert(!ret);
+}
+
+int main(int argc, const char *argv[])
+{
+	common_setup(argv[0]);
+
+	const tal_t *ctx;
+	struct bitcoin_outpoint funding;
+	struct channel *channel;
+	struct channel_id cid;
+	struct amount_sat funding_amount = AMOUNT_SAT(100000000);
+	u32 feerate_per_kw = 0, blockheight = 0;
+	struct pubkey local_funding_pubkey, remote_funding_pubkey;
+	struct pubkey per_commitment_point;
+	struct basepoints localbase, remotebase;
+	struct channel_config *local_config, *remote_config;
+	struct bitcoin_tx **txs;
+	const struct htlc **htlc_map;
+	const u8 *funding_wscript;
+	int local_anchor;
+	struct timemono start;
+	u64 commit_nsec, permute_nsec;
+
+	chainparams = chainparams_for_network("bitcoin");
+
+	/* We clean tmpctx between runs, so these can't live there. */
+	ctx = tal(NULL, char);
+	memset(&funding, 1, sizeof(funding));
+	funding.n = 0;
+	local_config = tal(ctx, struct channel_config);
+	remote_config = tal(ctx, struct channel_config);
+	local_config->to_self_delay = remote_config->to_self_delay = 144;
+	local_config->dust_limit = remote_config->dust_limit = AMOUNT_SAT(546);
+	local_config->max_htlc_value_in_flight = AMOUNT_MSAT(-1ULL);
+	remote_config->max_htlc_value_in_flight = AMOUNT_MSAT(-1ULL);
+	local_config->max_dust_htlc_exposure_msat = AMOUNT_MSAT(-1ULL);
+	remote_config->max_dust_htlc_exposure_msat = AMOUNT_MSAT(-1ULL);
+	local_config->channel_reserve = remote_config->channel_reserve = AMOUNT_SAT(0);
+	local_config->htlc_minimum = remote_config->htlc_minimum = AMOUNT_MSAT(0);
+	local_config->max_accepted_htlcs = BENCH_HTLCS_PER_SIDE;
+	remote_config->max_accepted_htlcs = BENCH_HTLCS_PER_SIDE;
+
+	localbase.revocation = make_pubkey(1);
+	localbase.payment = make_pubkey(2);
+	localbase.htlc = make_pubkey(3);
+	localbase.delayed_payment = make_pubkey(4);
+	remotebase.revocation = make_pubkey(5);
+	remotebase.payment = make_pubkey(6);
+	remotebase.htlc = make_pubkey(7);
+	remotebase.delayed_payment = make_pubkey(8);
+	local_funding_pubkey = make_pubkey(9);
+	remote_funding_pubkey = make_pubkey(10);
+	per_commitment_point = make_pubkey(11);
+
+	derive_channel_id(&cid, &funding);
+	channel = new_full_channel(ctx, &cid,
+				   &funding, 0,
+				   take(new_height_states(NULL, LOCAL, &blockheight)),
+				   0, /* No channel lease */
+				   funding_amount, AMOUNT_MSAT(50000000000),
+				   take(new_fee_states(NULL, LOCAL,
+						       &feerate_per_kw)),
+				   local_config,
+				   remote_config,
+				   &localbase, &remotebase,
+				   &local_funding_pubkey,
+				   &remote_funding_pubkey,
+				   take(channel_type_static_remotekey(NULL)),
+				   false, LOCAL);
+	add_htlcs(channel);
+
+	txs = channel_txs(ctx, &funding, funding_amount,
+			  &htlc_map, NULL, &funding_wscript,
+			  channel, &per_commitment_point, 42, LOCAL, 0, 0,
+			  &local_anchor, NULL);
+	/* Commitment tx, plus one tx for each HTLC. */
+	assert(tal_count(txs) == 1 + 2 * BENCH_HTLCS_PER_SIDE);
+	assert(txs[0]->wtx->num_outputs == 2 + 2 * BENCH_HTLCS_PER_SIDE);
+
+	/* Outputs must be in order, and the map must follow them. */
+	for (size_t i = 1; i < txs[0]->wtx->num_outputs; i++) {
+		assert(txs[0]->wtx->outputs[i-1].satoshi
+		       <= txs[0]->wtx->outputs[i].satoshi);
+		if (htlc_map[i])
+			assert(htlc_map[i]->amount.millisatoshis / 1000 /* Raw: test */
+			       == txs[0]->wtx->outputs[i].satoshi);
+	}
+
+	/* Timing is too slow (and noisy) for make check. */
+	if (!argv[1] || !streq(argv[1], "--bench"))
+		goto out;
+
+	start = time_mono();
+	for (size_t i = 0; i < BENCH_RUNS; i++) {
+		const struct htlc **map;
+
+		channel_txs(tmpctx, &funding, funding_amount,
+			    &map, NULL, &funding_wscript,
+			    channel, &per_commitment_point, 42, LOCAL, 0, 0,
+			    &local_anchor, NULL);
+		clean_tmpctx();
+	}
+	commit_nsec = time_to_nsec(timemono_since(start)) / BENCH_RUNS;
+
+	start = time_mono();
+	for (size_t i = 0; i < BENCH_RUNS; i++)
+		permute_outputs(txs[0], NULL, (const void **)htlc_map);
+	permute_nsec = time_to_nsec(timemono_since(start)) / BENCH_RUNS;
+
+	printf("%u HTLCs each way\n", BENCH_HTLCS_PER_SIDE);
+	printf("channel_txs: %"PRIu64" usec\n", commit_nsec / 1000);
+	printf("permute_outputs: %"PRIu64" usec\n", permute_nsec / 1000);
+
+out:
+	tal_free(ctx);
+	common_shutdown();
+	return 0;
+}
@@ -131,8 +131,6 @@ bool unblind_onion(const struct pubkey *path_key,
 		   struct pubkey *onion_key,
 		   struct secret *ss)
 {
-	struct secret hmac;
-
 	/* BOLT #4:
 	 * A reader:
 	 *...
@@ -144,6 +142,13 @@ bool unblind_onion(const struct pubkey *path_key,
 	 *      - Tweak its own `node_privkey` below by multiplying by $`HMAC256(\text{"blinded\_node\_id"}, blinding\_ss)`$.
 	 */
 	ecdh(path_key, ss);
+	return unblind_onion_key(ss, onion_key);
+}
+
+bool unblind_onion_key(const struct secret *ss, struct pubkey *onion_key)
+{
+	struct secret hmac;
+
 	subkey_from_hmac("blinded_node_id", ss, &hmac);
 
 	/* We tweak the *ephemeral* key from the onion and use
@@ -49,6 +49,14 @@ bool unblind_onion(const struct pubkey *path_key,
 		   struct secret *ss)
 	NO_NULL_ARGS;
 
+/**
+ * unblind_onion_key - unblind_onion, for when you've done the ECDH yourself.
+ * @ss: the shared secret ECDH(@path_key, our node privkey).
+ * @onion_key: (in, out) the onionpacket->ephemeralkey to tweak.
+ */
+bool unblind_onion_key(const struct secret *ss, struct pubkey *onion_key)
+	NO_NULL_ARGS;
+
 /**
  * blindedpath_get_alias - tweak our id to see alias they used.
  * @ss: the shared secret from unblind_onion
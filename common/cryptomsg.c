@@ -83,12 +83,12 @@ static void le64_nonce(unsigned char *npub, u64 nonce)
 	memcpy(npub + zerolen, &le_nonce, sizeof(le_nonce));
 }
 
-u8 *cryptomsg_decrypt_body(const tal_t *ctx,
-			   struct crypto_state *cs, const u8 *in)
+u8 *cryptomsg_decrypt_body_len(const tal_t *ctx,
+			       struct crypto_state *cs,
+			       const u8 *in, size_t inlen)
 {
 	unsigned char npub[crypto_aead_chacha20poly1305_ietf_NPUBBYTES];
 	unsigned long long mlen;
-	size_t inlen = tal_count(in);
 	u8 *decrypted;
 
 	if (inlen < 16)
@@ -118,6 +118,12 @@ u8 *cryptomsg_decrypt_body(const tal_t *ctx,
 	return decrypted;
 }
 
+u8 *cryptomsg_decrypt_body(const tal_t *ctx,
+			   struct crypto_state *cs, const u8 *in)
+{
+	return cryptomsg_decrypt_body_len(ctx, cs, in, tal_count(in));
+}
+
 bool cryptomsg_decrypt_header(struct crypto_state *cs, const u8 hdr[18],
 			      u16 *lenp)
 {
@@ -149,17 +155,19 @@ bool cryptomsg_decrypt_header(struct crypto_state *cs, const u8 hdr[18],
 	return true;
 }
 
-u8 *cryptomsg_encrypt_msg(const tal_t *ctx,
-			  struct crypto_state *cs,
-			  const u8 *msg TAKES)
+void cryptomsg_encrypt_msg_append(struct crypto_state *cs,
+				  u8 **outp,
+				  const u8 *msg TAKES)
 {
 	unsigned char npub[crypto_aead_chacha20poly1305_ietf_NPUBBYTES];
 	unsigned long long clen, mlen = tal_count(msg);
+	size_t off = tal_count(*outp);
 	be16 l;
 	int ret;
 	u8 *out;
 
-	out = tal_arr(ctx, u8, sizeof(l) + 16 + mlen + 16);
+	tal_resize(outp, off + sizeof(l) + 16 + mlen + 16);
+	out = *outp + off;
 
 	/* BOLT #8:
 	 *
@@ -233,5 +241,14 @@ u8 *cryptomsg_encrypt_msg(const tal_t *ctx,
 
 	if (taken(msg))
 		tal_free(msg);
+}
+
+u8 *cryptomsg_encrypt_msg(const tal_t *ctx,
+			  struct crypto_state *cs,
+			  const u8 *msg TAKES)
+{
+	u8 *out = tal_arr(ctx, u8, 0);
+
+	cryptomsg_encrypt_msg_append(cs, &out, msg);
 	return out;
 }
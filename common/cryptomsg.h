@@ -25,8 +25,16 @@
 u8 *cryptomsg_encrypt_msg(const tal_t *ctx,
 			  struct crypto_state *cs,
 			  const u8 *msg);
+/* Same, but appends to the tal array *outp (so you can batch writes) */
+void cryptomsg_encrypt_msg_append(struct crypto_state *cs,
+				  u8 **outp,
+				  const u8 *msg);
 bool cryptomsg_decrypt_header(struct crypto_state *cs, const u8 hdr[18],
 			      u16 *lenp);
 u8 *cryptomsg_decrypt_body(const tal_t *ctx,
 			   struct crypto_state *cs, const u8 *in);
+/* Same, but in needn't be a tal array (so you can batch reads) */
+u8 *cryptomsg_decrypt_body_len(const tal_t *ctx,
+			       struct crypto_state *cs,
+			       const u8 *in, size_t inlen);
 #endif /* LIGHTNING_COMMON_CRYPTOMSG_H */
@@ -142,6 +142,8 @@ dijkstra_(const tal_t *ctx,
 	const struct gossmap_node **heap;
 	size_t heapsize;
 	struct gheap_ctx gheap_ctx;
+	/* Much more cache-friendly than looking in each gossmap_chan */
+	const struct half_chan *halves = gossmap_half_chans(map);
 
 	/* There doesn't seem to be much difference with fanout 2-4. */
 	gheap_ctx.fanout = 2;
@@ -203,6 +205,7 @@ dijkstra_(const tal_t *ctx,
 	while (heapsize != 0) {
 		struct dijkstra *cur_d;
 		const struct gossmap_node *cur = heap[0];
+		u32 cur_idx;
 
 		cur_d = get_dijkstra(dij, map, cur);
 		assert(cur_d->heapptr == heap);
@@ -211,35 +214,39 @@ dijkstra_(const tal_t *ctx,
 		if (cur_d->distance == UINT_MAX)
 			break;
 
+		cur_idx = gossmap_node_idx(map, cur);
 		for (size_t i = 0; i < cur->num_chans; i++) {
-			struct gossmap_node *neighbor;
+			const struct half_chan *h;
 			int which_half;
 			struct gossmap_chan *c;
 			struct dijkstra *d;
 			struct amount_msat fee, risk;
 			u64 score;
 
-			c = gossmap_nth_chan(map, cur, i, &which_half);
-			neighbor = gossmap_nth_node(map, c, !which_half);
+			h = halves + cur->chan_idxs[i] * 2;
+			which_half = (h[0].nodeidx != cur_idx);
 
-			d = get_dijkstra(dij, map, neighbor);
+			/* We're going from neighbor to c, hence !which_half */
+			d = dij + h[!which_half].nodeidx;
 			/* Ignore if already visited. */
 			if (!d->heapptr)
 				continue;
 
-			/* We're going from neighbor to c, hence !which_half */
+			/* Doesn't touch *c: only channel_ok and channel_score
+			 * look inside it, if they need to. */
+			c = gossmap_nth_chan(map, cur, i, NULL);
 			if (!channel_ok(map, c, !which_half, cur_d->amount, arg))
 				continue;
 
 			if (!amount_msat_fee(&fee, cur_d->amount,
-					     c->half[!which_half].base_fee,
-					     c->half[!which_half].proportional_fee)) {
+					     h[!which_half].base_fee,
+					     h[!which_half].proportional_fee)) {
 				/* Shouldn't happen! */
 				continue;
 			}
 
 			/* cltv_delay can't overflow: only 20 bits per hop. */
-			risk = risk_price(cur_d->amount, riskfactor, c->half[!which_half].delay);
+			risk = risk_price(cur_d->amount, riskfactor, h[!which_half].delay);
 			score = channel_score(fee, risk, cur_d->amount, !which_half, c);
 
 			/* That score is on top of current score */
@@ -1,6 +1,8 @@
 #ifndef LIGHTNING_COMMON_ECDH_H
 #define LIGHTNING_COMMON_ECDH_H
 #include "config.h"
+#include <ccan/tal/tal.h>
+#include <ccan/typesafe_cb/typesafe_cb.h>
 
 struct pubkey;
 struct secret;
@@ -10,4 +12,18 @@ struct secret;
  * its HSM interface, and tools can implement this directly. */
 void ecdh(const struct pubkey *point, struct secret *ss);
 
+/* The non-blocking version, for daemons which can have many requests in
+ * flight (connectd): @cb is called with the result, possibly before this
+ * returns.  If @ctx is freed first, @cb is not called at all. */
+#define ecdh_async(ctx, point, cb, arg)					\
+	ecdh_async_((ctx), (point),					\
+		    typesafe_cb_preargs(void, void *, (cb), (arg),	\
+					const struct secret *),		\
+		    (arg))
+
+void ecdh_async_(const tal_t *ctx,
+		 const struct pubkey *point,
+		 void (*cb)(const struct secret *ss, void *arg),
+		 void *arg);
+
 #endif /* LIGHTNING_COMMON_ECDH_H */
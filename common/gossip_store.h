@@ -60,10 +60,8 @@ struct gossip_hdr {
  * @type (out): if non-NULL, set to the msg type.
  *
  * Returns false if there are no more gossip msgs.  If you
- * want to read the message, use gossip_store_next, if you
  * want to skip, simply add sizeof(gossip_hdr) + *len to *off.
- * Note: it's possible that entire record isn't there yet,
- * so gossip_store_next can fail.
+ * Note: it's possible that entire record isn't there yet.
  */
 bool gossip_store_readhdr(int gossip_store_fd, size_t off,
 			  size_t *len,
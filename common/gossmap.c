@@ -11,6 +11,7 @@
 #include <common/gossmap.h>
 #include <common/pseudorand.h>
 #include <common/sciddir_or_pubkey.h>
+#include <common/utils.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <gossipd/gossip_store_wiregen.h>
@@ -54,6 +55,9 @@ HTABLE_DEFINE_NODUPS_TYPE(ptrint_t, nodeidx_id, nodeid_hash, nodeidx_eq_id,
 struct gossmap {
 	/* We updated this every time we reopen, so we know to update iterators! */
 	u64 generation;
+	/* On last reopen: where the old store ended, and the equivalent
+	 * offset in the new one (so caught-up iterators can carry on). */
+	u64 prev_store_end, prev_store_equiv;
 
 	/* The file descriptor and filename to monitor */
 	int fd;
@@ -80,9 +84,19 @@ struct gossmap {
 	/* This is tal_count(chan_arr), which we call very often in assert() */
 	size_t num_chan_arr;
 
+	/* Copy of chan_arr[].half[], packed (2 per chan) for route finders */
+	struct half_chan *half_arr;
+
 	/* Linked list of freed ones, if any. */
 	u32 freed_nodes, freed_chans;
 
+	/* Indexes removed during the last refresh: not reused until the
+	 * next refresh, so callers can see what went away. */
+	u32 *tombstoned_nodes, *tombstoned_chans;
+
+	/* If non-NULL, we're inside gossmap_refresh_changes() */
+	struct gossmap_changes *changes;
+
 	/* local channel_announce messages, if any. */
 	const u8 *local_announces;
 	/* local channel_update messages, if any. */
@@ -221,6 +235,26 @@ struct gossmap_chan *gossmap_chan_byidx(const struct gossmap *map, u32 idx)
 	return &map->chan_arr[idx];
 }
 
+const struct half_chan *gossmap_half_chans(const struct gossmap *map)
+{
+	return map->half_arr;
+}
+
+const struct half_chan *gossmap_chan_half(const struct gossmap *map,
+					  const struct gossmap_chan *chan,
+					  int dir)
+{
+	return map->half_arr + gossmap_chan_idx(map, chan) * 2 + dir;
+}
+
+/* Call whenever chan->half[] is altered */
+static void sync_half_arr(struct gossmap *map, const struct gossmap_chan *chan)
+{
+	u32 chanidx = gossmap_chan_idx(map, chan);
+	map->half_arr[chanidx * 2] = chan->half[0];
+	map->half_arr[chanidx * 2 + 1] = chan->half[1];
+}
+
 /* htable can't handle NULL or 1 values, so we add 2 */
 static struct gossmap_chan *ptrint2chan(const ptrint_t *pidx)
 {
@@ -311,6 +345,9 @@ static u32 new_node(struct gossmap *map)
 	node->nann_off = 0;
 	node->num_chans = 0;
 
+	if (map->changes)
+		tal_arr_expand(&map->changes->nodes_added,
+			       gossmap_node_idx(map, node));
 	return gossmap_node_idx(map, node);
 }
 
@@ -319,11 +356,18 @@ static void remove_node(struct gossmap *map, struct gossmap_node *node)
 	u32 nodeidx = gossmap_node_idx(map, node);
 	if (!nodeidx_htable_del(map->nodes, node2ptrint(node)))
 		abort();
-	node->nann_off = map->freed_nodes;
 	free(node->chan_idxs);
 	node->chan_idxs = NULL;
 	node->num_chans = 0;
-	map->freed_nodes = nodeidx;
+	if (map->changes) {
+		/* Leave it empty until next refresh */
+		node->nann_off = 0;
+		tal_arr_expand(&map->tombstoned_nodes, nodeidx);
+		tal_arr_expand(&map->changes->nodes_removed, nodeidx);
+	} else {
+		node->nann_off = map->freed_nodes;
+		map->freed_nodes = nodeidx;
+	}
 }
 
 static void node_add_channel(struct gossmap_node *node, u32 chanidx)
@@ -356,6 +400,7 @@ static struct gossmap_chan *next_free_chan(struct gossmap *map)
 		size_t n = tal_count(map->chan_arr);
 		map->num_chan_arr *= 2;
 		tal_resize(&map->chan_arr, n * 2);
+		tal_resize(&map->half_arr, n * 2 * 2);
 		map->freed_chans = init_chan_arr(map->chan_arr, n);
 	}
 
@@ -377,10 +422,14 @@ static struct gossmap_chan *new_channel(struct gossmap *map,
 	memset(chan->half, 0, sizeof(chan->half));
 	chan->half[0].nodeidx = n1idx;
 	chan->half[1].nodeidx = n2idx;
+	sync_half_arr(map, chan);
 	node_add_channel(map->node_arr + n1idx, gossmap_chan_idx(map, chan));
 	node_add_channel(map->node_arr + n2idx, gossmap_chan_idx(map, chan));
 	chanidx_htable_add(map->channels, chan2ptrint(chan));
 
+	if (map->changes)
+		tal_arr_expand(&map->changes->chans_added,
+			       gossmap_chan_idx(map, chan));
 	return chan;
 }
 
@@ -410,9 +459,16 @@ void gossmap_remove_chan(struct gossmap *map, struct gossmap_chan *chan)
 		abort();
 	remove_chan_from_node(map, gossmap_nth_node(map, chan, 0), chanidx);
 	remove_chan_from_node(map, gossmap_nth_node(map, chan, 1), chanidx);
-	chan->cann_off = map->freed_chans;
 	chan->plus_scid_off = 0;
-	map->freed_chans = chanidx;
+	if (map->changes) {
+		/* Leave it empty until next refresh */
+		chan->cann_off = 0;
+		tal_arr_expand(&map->tombstoned_chans, chanidx);
+		tal_arr_expand(&map->changes->chans_removed, chanidx);
+	} else {
+		chan->cann_off = map->freed_chans;
+		map->freed_chans = chanidx;
+	}
 }
 
 void gossmap_remove_node(struct gossmap *map, struct gossmap_node *node)
@@ -591,6 +647,11 @@ static void update_channel(struct gossmap *map, u64 cupdate_off)
 	hc.nodeidx = chan->half[scidd.dir].nodeidx;
 	chan->half[scidd.dir] = hc;
 	chan->cupdate_off[scidd.dir] = cupdate_off;
+	sync_half_arr(map, chan);
+
+	if (map->changes)
+		tal_arr_expand(&map->changes->chans_updated,
+			       gossmap_chan_idx(map, chan));
 }
 
 static void remove_channel_by_deletemsg(struct gossmap *map, u64 del_off)
@@ -644,21 +705,182 @@ static void node_announcement(struct gossmap *map, u64 nann_off)
 		n->nann_off = nann_off;
 }
 
+static bool refresh_map(struct gossmap *map);
+
+static u64 buf_be64(const u8 *p)
+{
+	be64 be64;
+	memcpy(&be64, p, sizeof(be64));
+	return be64_to_cpu(be64);
+}
+
+/* gossipd compacted the store: up to @equiv_off, the new one holds
+ * exactly the live records of the old one, in the same order (though
+ * some may have been deleted since, which is fine: we still point at
+ * them until we see the delete).  Find where each of ours went, so chan
+ * and node indexes don't change.  We do the lookups while the old store
+ * is still mapped, since they read scids and node_ids through the old
+ * offsets. */
+static void remap_offsets(struct gossmap *map, int fd, u64 equiv_off)
+{
+	u64 *cann_off = tal_arrz(tmpctx, u64, map->num_chan_arr);
+	u64 *cupdate_off = tal_arrz(tmpctx, u64, map->num_chan_arr * 2);
+	u64 *nann_off = tal_arrz(tmpctx, u64, map->num_node_arr);
+	u8 *msg = tal_arr(tmpctx, u8, 65535);
+	u64 off = 1;
+
+	while (off + sizeof(struct gossip_hdr) <= equiv_off) {
+		struct gossip_hdr ghdr;
+		struct short_channel_id scid;
+		struct node_id id;
+		struct gossmap_chan *chan;
+		struct gossmap_node *node;
+		size_t flen;
+		u16 msglen;
+
+		if (pread(fd, &ghdr, sizeof(ghdr), off) != sizeof(ghdr))
+			break;
+		msglen = be16_to_cpu(ghdr.len);
+		off += sizeof(ghdr);
+		if (pread(fd, msg, msglen, off) != msglen)
+			break;
+		off += msglen;
+
+		if (msglen < sizeof(be16))
+			continue;
+
+		/* Offsets below are the same as add_channel, update_channel
+		 * and node_announcement use. */
+		switch (((u16)msg[0] << 8) | msg[1]) {
+		case WIRE_CHANNEL_ANNOUNCEMENT:
+			if (msglen < 2 + 256 + 2)
+				continue;
+			flen = ((size_t)msg[258] << 8) | msg[259];
+			if (msglen < 2 + 256 + 2 + flen + 32 + 8)
+				continue;
+			scid.u64 = buf_be64(msg + 2 + 256 + 2 + flen + 32);
+			chan = gossmap_find_chan(map, &scid);
+			if (chan)
+				cann_off[gossmap_chan_idx(map, chan)]
+					= off - msglen;
+			break;
+		case WIRE_CHANNEL_UPDATE:
+			if (msglen < 2 + 64 + 32 + 8 + 4 + 2)
+				continue;
+			scid.u64 = buf_be64(msg + 2 + 64 + 32);
+			chan = gossmap_find_chan(map, &scid);
+			if (chan) {
+				int dir = msg[2 + 64 + 32 + 8 + 4 + 1]
+					& ROUTING_FLAGS_DIRECTION;
+				cupdate_off[gossmap_chan_idx(map, chan) * 2 + dir]
+					= off - msglen;
+			}
+			break;
+		case WIRE_NODE_ANNOUNCEMENT:
+			if (msglen < 2 + 64 + 2)
+				continue;
+			flen = ((size_t)msg[66] << 8) | msg[67];
+			if (msglen < 2 + 64 + 2 + flen + 4 + sizeof(id))
+				continue;
+			memcpy(&id, msg + 2 + 64 + 2 + flen + 4, sizeof(id));
+			node = gossmap_find_node(map, &id);
+			if (node)
+				nann_off[gossmap_node_idx(map, node)]
+					= off - msglen;
+			break;
+		}
+	}
+
+	/* This should not happen, but don't leave a dangling offset. */
+	for (size_t i = 0; i < map->num_chan_arr; i++) {
+		struct gossmap_chan *chan = gossmap_chan_byidx(map, i);
+		if (chan && !cann_off[i]) {
+			map->logcb(map->cbarg, LOG_BROKEN,
+				   "gossmap: %s missing from compacted store",
+				   fmt_short_channel_id(tmpctx,
+							gossmap_chan_scid(map, chan)));
+			gossmap_remove_chan(map, chan);
+		}
+	}
+
+	for (size_t i = 0; i < map->num_chan_arr; i++) {
+		struct gossmap_chan *chan = gossmap_chan_byidx(map, i);
+		if (!chan)
+			continue;
+		chan->cann_off = cann_off[i];
+		chan->cupdate_off[0] = cupdate_off[i * 2];
+		chan->cupdate_off[1] = cupdate_off[i * 2 + 1];
+	}
+	for (size_t i = 0; i < map->num_node_arr; i++) {
+		struct gossmap_node *node = gossmap_node_byidx(map, i);
+		if (node)
+			node->nann_off = nann_off[i];
+	}
+}
+
+/* Is the store in @fd the one the ended record at @ended_off refers to?
+ * If gossipd compacted again before we got here, it's a later one. */
+static bool store_uuid_matches(const struct gossmap *map, int fd, u64 ended_off)
+{
+	struct gossip_hdr ghdr;
+	u8 ended_uuid[32], msg[2 + sizeof(ended_uuid)];
+
+	/* Older gossipd didn't put a uuid in the ended record. */
+	map_copy(map, ended_off - sizeof(ghdr), &ghdr, sizeof(ghdr));
+	if (be16_to_cpu(ghdr.len) < 2 + 8 + sizeof(ended_uuid))
+		return false;
+	map_copy(map, ended_off + 2 + 8, ended_uuid, sizeof(ended_uuid));
+
+	/* The uuid record is always first. */
+	if (pread(fd, &ghdr, sizeof(ghdr), 1) != sizeof(ghdr)
+	    || be16_to_cpu(ghdr.len) < sizeof(msg)
+	    || pread(fd, msg, sizeof(msg), 1 + sizeof(ghdr)) != sizeof(msg))
+		return false;
+
+	return (((u16)msg[0] << 8) | msg[1]) == WIRE_GOSSIP_STORE_UUID
+		&& memcmp(msg + 2, ended_uuid, sizeof(ended_uuid)) == 0;
+}
+
 static bool reopen_store(struct gossmap *map, u64 ended_off)
 {
 	int fd;
+	u64 equiv_off;
 
 	fd = open(map->fname, O_RDONLY);
 	if (fd < 0)
 		err(1, "Failed to reopen %s", map->fname);
 
 	/* This tells us the equivalent offset in new map */
-	map->map_end = map_be64(map, ended_off + 2);
+	equiv_off = map_be64(map, ended_off + 2);
+	if (store_uuid_matches(map, fd, ended_off)) {
+		remap_offsets(map, fd, equiv_off);
+		map->prev_store_end = ended_off - sizeof(struct gossip_hdr);
+	} else {
+		/* Our offsets mean nothing in this store: start again. */
+		map->logcb(map->cbarg, LOG_UNUSUAL,
+			   "gossmap: %s is not the store we expected,"
+			   " reloading", map->fname);
+		for (size_t i = 0; i < map->num_chan_arr; i++) {
+			struct gossmap_chan *chan = gossmap_chan_byidx(map, i);
+			if (chan)
+				gossmap_remove_chan(map, chan);
+		}
+		equiv_off = 1;
+		/* No iterator can carry on, either. */
+		map->prev_store_end = UINT64_MAX;
+	}
 
 	close(map->fd);
 	map->fd = fd;
+	/* Make refresh_map map the new file, even if it's the same size */
+	if (map->mmap)
+		munmap(map->mmap, map->map_size);
+	map->mmap = NULL;
+	map->map_size = 0;
+	map->map_end = equiv_off;
+	map->prev_store_equiv = equiv_off;
 	map->generation++;
-	return gossmap_refresh(map);
+	return refresh_map(map);
 }
 
 /* Extra sanity check (if it's cheap): does crc match? */
@@ -756,6 +978,9 @@ static bool map_catchup(struct gossmap *map, bool must_be_clean, bool *changed)
 		} else if (type == WIRE_GOSSIP_STORE_CHAN_DYING) {
 			/* We don't really care until it's deleted */
 			continue;
+		} else if (type == WIRE_GOSSIP_STORE_UUID) {
+			/* Only reopen_store() cares about this */
+			continue;
 		} else {
 			map->logcb(map->cbarg, LOG_BROKEN,
 				   "Unknown record %u@%u (size %zu) in gossmap: ignoring",
@@ -807,10 +1032,13 @@ static bool load_gossip_store(struct gossmap *map, bool must_be_clean)
 
 	map->num_chan_arr = map->map_size / 750 / 2 + 1;
 	map->chan_arr = tal_arr(map, struct gossmap_chan, map->num_chan_arr);
+	map->half_arr = tal_arr(map, struct half_chan, map->num_chan_arr * 2);
 	map->freed_chans = init_chan_arr(map->chan_arr, 0);
 	map->num_node_arr = map->map_size / 2500 / 2 + 1;
 	map->node_arr = tal_arr(map, struct gossmap_node, map->num_node_arr);
 	map->freed_nodes = init_node_arr(map->node_arr, 0);
+	map->tombstoned_chans = tal_arr(map, u32, 0);
+	map->tombstoned_nodes = tal_arr(map, u32, 0);
 
 	map->map_end = 1;
 	return map_catchup(map, must_be_clean, &updated);
@@ -1165,6 +1393,7 @@ void gossmap_apply_localmods(struct gossmap *map,
 			memcpy(map->local_updates + off, cupdatemsg, tal_bytelen(cupdatemsg));
 			chan->cupdate_off[h] = map->map_size + tal_bytelen(map->local_announces) + off;
 			fill_from_update(map, &scidd, &chan->half[h], chan->cupdate_off[h], NULL, NULL);
+			sync_half_arr(map, chan);
 
 			/* We wrote the right update, correct? */
 			assert(short_channel_id_eq(scidd.scid, mod->scid));
@@ -1180,8 +1409,10 @@ void gossmap_remove_localmods(struct gossmap *map,
 
 	assert(map->local_announces == localmods->local_announces);
 
-	for (size_t i = 0; i < n; i++) {
-		const struct localmod *mod = &localmods->mods[i];
+	/* In reverse, so freed indexes go back the way they came, and
+	 * applying the same localmods again gives the same indexes. */
+	for (size_t i = n; i > 0; i--) {
+		const struct localmod *mod = &localmods->mods[i-1];
 		struct gossmap_chan *chan = gossmap_find_chan(map, &mod->scid);
 
 		/* If there was no channel, ignore */
@@ -1197,20 +1428,36 @@ void gossmap_remove_localmods(struct gossmap *map,
 				chan->half[h] = mod->orig[h];
 				chan->cupdate_off[h] = mod->orig_cupdate_off[h];
 			}
+			sync_half_arr(map, chan);
 		}
 	}
 	map->local_announces = NULL;
 	map->local_updates = tal_free(map->local_updates);
 }
 
-bool gossmap_refresh(struct gossmap *map)
+/* Callers have seen the last refresh's removals: we can reuse them now. */
+static void release_tombstones(struct gossmap *map)
+{
+	for (size_t i = 0; i < tal_count(map->tombstoned_chans); i++) {
+		u32 chanidx = map->tombstoned_chans[i];
+		map->chan_arr[chanidx].cann_off = map->freed_chans;
+		map->freed_chans = chanidx;
+	}
+	tal_resize(&map->tombstoned_chans, 0);
+
+	for (size_t i = 0; i < tal_count(map->tombstoned_nodes); i++) {
+		u32 nodeidx = map->tombstoned_nodes[i];
+		map->node_arr[nodeidx].nann_off = map->freed_nodes;
+		map->freed_nodes = nodeidx;
+	}
+	tal_resize(&map->tombstoned_nodes, 0);
+}
+
+static bool refresh_map(struct gossmap *map)
 {
 	off_t len;
 	bool changed;
 
-	/* You must remove local modifications before this. */
-	assert(!map->local_announces);
-
 	/* If file has gotten larger, try rereading */
 	len = lseek(map->fd, 0, SEEK_END);
 	if (len == map->map_size)
@@ -1230,6 +1477,42 @@ bool gossmap_refresh(struct gossmap *map)
 	return changed;
 }
 
+bool gossmap_refresh(struct gossmap *map)
+{
+	/* You must remove local modifications before this. */
+	assert(!map->local_announces);
+
+	release_tombstones(map);
+	return refresh_map(map);
+}
+
+bool gossmap_refresh_changes(struct gossmap *map,
+			     const tal_t *ctx,
+			     struct gossmap_changes **changes)
+{
+	bool changed;
+
+	/* You must remove local modifications before this. */
+	assert(!map->local_announces);
+
+	release_tombstones(map);
+
+	map->changes = tal(ctx, struct gossmap_changes);
+	map->changes->chans_added = tal_arr(map->changes, u32, 0);
+	map->changes->chans_updated = tal_arr(map->changes, u32, 0);
+	map->changes->chans_removed = tal_arr(map->changes, u32, 0);
+	map->changes->nodes_added = tal_arr(map->changes, u32, 0);
+	map->changes->nodes_removed = tal_arr(map->changes, u32, 0);
+
+	changed = refresh_map(map);
+	*changes = map->changes;
+	map->changes = NULL;
+
+	if (!changed)
+		*changes = tal_free(*changes);
+	return changed;
+}
+
 static void log_stderr(void *cb_arg,
 		       enum log_level level,
 		       const char *fmt,
@@ -1257,6 +1540,8 @@ struct gossmap *gossmap_load_(const tal_t *ctx,
 {
 	map = tal(ctx, struct gossmap);
 	map->generation = 0;
+	map->prev_store_end = map->prev_store_equiv = 0;
+	map->changes = NULL;
 	map->fname = tal_strdup(map, filename);
 	map->fd = open(map->fname, O_RDONLY);
  	if (map->fd < 0)
@@ -1300,6 +1585,14 @@ bool gossmap_chan_is_localmod(const struct gossmap *map,
 	return c->cann_off >= map->map_size;
 }
 
+bool gossmap_chan_has_localmods(const struct gossmap *map,
+				const struct gossmap_chan *c)
+{
+	return gossmap_chan_is_localmod(map, c)
+		|| c->cupdate_off[0] >= map->map_size
+		|| c->cupdate_off[1] >= map->map_size;
+}
+
 bool gossmap_chan_is_dying(const struct gossmap *map,
 			   const struct gossmap_chan *c)
 {
@@ -1441,10 +1734,16 @@ bool gossmap_chan_has_capacity(const struct gossmap_chan *chan,
 			       int direction,
 			       struct amount_msat amount)
 {
-	if (amount_msat_less_fp16(amount, chan->half[direction].htlc_min))
+	return gossmap_half_has_capacity(&chan->half[direction], amount);
+}
+
+bool gossmap_half_has_capacity(const struct half_chan *half,
+			       struct amount_msat amount)
+{
+	if (amount_msat_less_fp16(amount, half->htlc_min))
 		return false;
 
-	if (amount_msat_greater_fp16(amount, chan->half[direction].htlc_max))
+	if (amount_msat_greater_fp16(amount, half->htlc_max))
 		return false;
 
 	return true;
@@ -1690,6 +1989,22 @@ struct gossmap_iter {
 	u64 offset;
 };
 
+/* If we have reopened, iterators which had caught up can
+ * carry on from the same point in the new store: others start again. */
+static void iter_sync(const struct gossmap *map, struct gossmap_iter *iter)
+{
+	if (iter->generation == map->generation)
+		return;
+
+	if (iter->generation + 1 == map->generation
+	    && iter->offset >= map->prev_store_end)
+		iter->offset = map->prev_store_equiv;
+	else
+		/* Skip version byte */
+		iter->offset = 1;
+	iter->generation = map->generation;
+}
+
 /* For iterating the gossmap: returns iterator at start. */
 struct gossmap_iter *gossmap_iter_new(const tal_t *ctx,
 				      const struct gossmap *map)
@@ -1714,7 +2029,7 @@ struct gossmap_iter *gossmap_iter_dup(const tal_t *ctx,
 const void *gossmap_stream_next(const tal_t *ctx,
 				const struct gossmap *map,
 				struct gossmap_iter *iter,
-				u32 *timestamp)
+				u32 timestamp_min, u32 timestamp_max)
 {
 	/* We grab hdr and type together.  Beware alignment! */
 	struct hdr {
@@ -1728,16 +2043,12 @@ const void *gossmap_stream_next(const tal_t *ctx,
 	};
 	struct hdr h;
 
-	/* If we have reopened (unlikely!), we need to restart iteration */
-	if (iter->generation != map->generation) {
-		iter->generation = map->generation;
-		/* Skip version byte */
-		iter->offset = 1;
-	}
+	iter_sync(map, iter);
 
 	while (iter->offset + sizeof(h.u.type) <= map->map_size) {
 		void *ret;
 		u64 len;
+		u32 timestamp;
 
 		map_copy(map, iter->offset, &h, sizeof(h.u.type));
 
@@ -1760,10 +2071,16 @@ const void *gossmap_stream_next(const tal_t *ctx,
 		case WIRE_CHANNEL_ANNOUNCEMENT:
 		case WIRE_CHANNEL_UPDATE:
 		case WIRE_NODE_ANNOUNCEMENT:
+			/* Filter before copying: every peer streams the same
+			 * mmap, and most records fall outside their range.
+			 * (Zero for channel_announcement with no update yet!) */
+			timestamp = be32_to_cpu(h.u.ghdr.timestamp);
+			if (timestamp
+			    && (timestamp < timestamp_min
+				|| timestamp > timestamp_max))
+				continue;
 			ret = tal_arr(ctx, u8, len);
 			map_copy(map, iter->offset - len, ret, len);
-			if (timestamp)
-				*timestamp = be32_to_cpu(h.u.ghdr.timestamp);
 			return ret;
 
 		case WIRE_INIT:
@@ -1824,11 +2141,7 @@ void gossmap_iter_fast_forward(const struct gossmap *map,
 			       struct gossmap_iter *iter,
 			       u64 timestamp)
 {
-	/* If we have reopened (unlikely!), we need to restart iteration */
-	if (iter->generation != map->generation) {
-		iter->generation = map->generation;
-		iter->offset = 1;
-	}
+	iter_sync(map, iter);
 
 	while (iter->offset + sizeof(struct gossip_hdr) <= map->map_size) {
 		struct gossip_hdr ghdr;
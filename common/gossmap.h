@@ -74,6 +74,29 @@ struct gossmap *gossmap_load_(const tal_t *ctx,
  * was updated. Note: this can scramble node and chan indexes! */
 bool gossmap_refresh(struct gossmap *map);
 
+/* What changed in a gossmap_refresh_changes() call (indexes, in order). */
+struct gossmap_changes {
+	u32 *chans_added;
+	/* May contain duplicates, or indexes also in chans_removed. */
+	u32 *chans_updated;
+	u32 *chans_removed;
+	u32 *nodes_added;
+	u32 *nodes_removed;
+};
+
+/* Like gossmap_refresh, but existing node and chan indexes are
+ * preserved: new records are only appended, and removed ones are left
+ * as empty slots (gossmap_chan_byidx/gossmap_node_byidx return NULL)
+ * until the next refresh.  So an index is never reused within one
+ * refresh, and callers can patch per-index arrays (applying added, then
+ * updated, then removed) instead of rebuilding them.  Note that
+ * gossmap_max_chan_idx/gossmap_max_node_idx can grow!
+ *
+ * If it returns true, *changes is allocated off @ctx, otherwise NULL. */
+bool gossmap_refresh_changes(struct gossmap *map,
+			     const tal_t *ctx,
+			     struct gossmap_changes **changes);
+
 /* Local modifications. */
 struct gossmap_localmods *gossmap_localmods_new(const tal_t *ctx);
 
@@ -125,6 +148,10 @@ void gossmap_remove_localmods(struct gossmap *map,
 bool gossmap_chan_is_localmod(const struct gossmap *map,
 			      const struct gossmap_chan *c);
 
+/* Was this channel added, or either side updated, by localmods? */
+bool gossmap_chan_has_localmods(const struct gossmap *map,
+				const struct gossmap_chan *c);
+
 /* Is this channel dying? */
 bool gossmap_chan_is_dying(const struct gossmap *map,
 			   const struct gossmap_chan *c);
@@ -136,6 +163,16 @@ u32 gossmap_chan_idx(const struct gossmap *map, const struct gossmap_chan *chan)
 struct gossmap_node *gossmap_node_byidx(const struct gossmap *map, u32 idx);
 struct gossmap_chan *gossmap_chan_byidx(const struct gossmap *map, u32 idx);
 
+/* Packed copy of each chan->half[dir], at [chan_idx * 2 + dir].  Route
+ * finders walk this instead of chan_arr, since it's half the size.
+ * Entries for unused chan indexes are garbage.  Valid until next change. */
+const struct half_chan *gossmap_half_chans(const struct gossmap *map);
+
+/* The packed copy of chan->half[dir], from the above. */
+const struct half_chan *gossmap_chan_half(const struct gossmap *map,
+					  const struct gossmap_chan *chan,
+					  int dir);
+
 /* Every node_idx/chan_idx will be < these.
  * These values can change across calls to gossmap_check. */
 u32 gossmap_max_node_idx(const struct gossmap *map);
@@ -243,6 +280,10 @@ bool gossmap_chan_has_capacity(const struct gossmap_chan *chan,
 			       int direction,
 			       struct amount_msat amount);
 
+/* Same, given the half_chan (e.g. from gossmap_chan_half()). */
+bool gossmap_half_has_capacity(const struct half_chan *half,
+			       struct amount_msat amount);
+
 /* Convenience routines to get htlc min/max as amount_msat */
 static inline struct amount_msat
 gossmap_chan_htlc_max(const struct gossmap_chan *chan, const int dir)
@@ -287,11 +328,12 @@ struct gossmap_iter *gossmap_iter_new(const tal_t *ctx,
 struct gossmap_iter *gossmap_iter_dup(const tal_t *ctx,
 				      const struct gossmap_iter *iter);
 
-/* Get next message, and optional timestamp */
+/* Get next public message with timestamp in [timestamp_min, timestamp_max]
+ * (or zero, for a channel_announcement with no update yet) */
 const void *gossmap_stream_next(const tal_t *ctx,
 				const struct gossmap *map,
 				struct gossmap_iter *iter,
-				u32 *timestamp);
+				u32 timestamp_min, u32 timestamp_max);
 /* For fast-forwarding to the given timestamp */
 void gossmap_iter_fast_forward(const struct gossmap *map,
 			       struct gossmap_iter *iter,
@@ -82,7 +82,24 @@ static bool decrypt_forwarding_onionmsg(const struct pubkey *path_key,
 	return true;
 }
 
-/* Returns false on failure */
+const char *onion_message_parse_packet(const tal_t *ctx,
+				       const u8 *onion_message_packet,
+				       struct onionpacket **op)
+{
+	enum onion_wire badreason;
+
+	/* We unwrap the onion now. */
+	*op = parse_onionpacket(ctx,
+				onion_message_packet,
+				tal_bytelen(onion_message_packet),
+				&badreason);
+	if (!*op) {
+		return tal_fmt(ctx, "onion_message_parse: can't parse onionpacket: %s",
+			       onion_wire_name(badreason));
+	}
+	return NULL;
+}
+
 const char *onion_message_parse(const tal_t *ctx,
 				const u8 *onion_message_packet,
 				const struct pubkey *path_key,
@@ -93,24 +110,14 @@ const char *onion_message_parse(const tal_t *ctx,
 				struct pubkey *final_alias,
 				struct secret **final_path_id)
 {
-	enum onion_wire badreason;
 	struct onionpacket *op;
 	struct pubkey ephemeral;
-	struct route_step *rs;
-	struct tlv_onionmsg_tlv *om;
 	struct secret ss, onion_ss;
-	const u8 *cursor;
-	size_t max, maxlen;
+	const char *err;
 
-	/* We unwrap the onion now. */
-	op = parse_onionpacket(tmpctx,
-			       onion_message_packet,
-			       tal_bytelen(onion_message_packet),
-			       &badreason);
-	if (!op) {
-		return tal_fmt(ctx, "onion_message_parse: can't parse onionpacket: %s",
-			       onion_wire_name(badreason));
-	}
+	err = onion_message_parse_packet(tmpctx, onion_message_packet, &op);
+	if (err)
+		return tal_steal(ctx, err);
 
 	ephemeral = op->ephemeralkey;
 	if (!unblind_onion(path_key, ecdh, &ephemeral, &ss)) {
@@ -119,10 +126,32 @@ const char *onion_message_parse(const tal_t *ctx,
 
 	/* Now get onion shared secret and parse it. */
 	ecdh(&ephemeral, &onion_ss);
-	rs = process_onionpacket(tmpctx, op, &onion_ss, NULL, 0);
+	return onion_message_parse_ss(ctx, op, path_key, me, &ss, &onion_ss,
+				      next_onion_msg, next_node,
+				      final_om, final_alias, final_path_id);
+}
+
+const char *onion_message_parse_ss(const tal_t *ctx,
+				   const struct onionpacket *op,
+				   const struct pubkey *path_key,
+				   const struct pubkey *me,
+				   const struct secret *path_ss,
+				   const struct secret *onion_ss,
+				   u8 **next_onion_msg,
+				   struct sciddir_or_pubkey *next_node,
+				   struct tlv_onionmsg_tlv **final_om,
+				   struct pubkey *final_alias,
+				   struct secret **final_path_id)
+{
+	struct route_step *rs;
+	struct tlv_onionmsg_tlv *om;
+	const u8 *cursor;
+	size_t max, maxlen;
+
+	rs = process_onionpacket(tmpctx, op, onion_ss, NULL, 0);
 	if (!rs) {
 		return tal_fmt(ctx, "onion_message_parse: can't process onionpacket ss=%s",
-			       fmt_secret(tmpctx, &onion_ss));
+			       fmt_secret(tmpctx, onion_ss));
 	}
 
 	/* The raw payload is prepended with length in the modern onion. */
@@ -150,7 +179,7 @@ const char *onion_message_parse(const tal_t *ctx,
 		if (!om->encrypted_recipient_data) {
 			*final_alias = *me;
 			*final_path_id = NULL;
-		} else if (!decrypt_final_onionmsg(ctx, &ss,
+		} else if (!decrypt_final_onionmsg(ctx, path_ss,
 						   om->encrypted_recipient_data, me,
 						   final_alias,
 						   final_path_id)) {
@@ -173,7 +202,7 @@ const char *onion_message_parse(const tal_t *ctx,
 		}
 
 		/* This fails as expected if no enctlv. */
-		if (!decrypt_forwarding_onionmsg(path_key, &ss, om->encrypted_recipient_data, next_node,
+		if (!decrypt_forwarding_onionmsg(path_key, path_ss, om->encrypted_recipient_data, next_node,
 						 &next_path_key)) {
 			return tal_fmt(ctx,
 				       "onion_message_parse: invalid encrypted_recipient_data %s",
@@ -4,6 +4,7 @@
 #include <bitcoin/privkey.h>
 #include <common/amount.h>
 
+struct onionpacket;
 struct tlv_onionmsg_tlv;
 struct sciddir_or_pubkey;
 struct pubkey;
@@ -32,4 +33,44 @@ const char *onion_message_parse(const tal_t *ctx,
 				struct pubkey *final_alias,
 				struct secret **final_path_id);
 
+/* onion_message_parse() needs two ECDH operations, the second depending on
+ * the first.  Callers which want to do those asynchronously use
+ * onion_message_parse_packet(), unblind_onion_key() and onion_message_parse_ss()
+ * instead. */
+
+/**
+ * onion_message_parse_packet: parse the onion, before any ECDH.
+ * @ctx: context to allocate *@op or the error string off
+ * @onion_message_packet: Sphinx-encrypted onion
+ * @op (out): the parsed onion: unblind (*@op)->ephemeralkey for the ECDH.
+ *
+ * Returns NULL if it was valid, otherwise an error string.
+ */
+const char *onion_message_parse_packet(const tal_t *ctx,
+				       const u8 *onion_message_packet,
+				       struct onionpacket **op);
+
+/**
+ * onion_message_parse_ss: onion_message_parse, once the ECDHs are done.
+ * @ctx: context to allocate @next_onion_msg or @final_om/@path_id off
+ * @op: the onion from onion_message_parse_packet()
+ * @path_key: Path_Key we were given for @op
+ * @me: my pubkey
+ * @path_ss: ECDH(@path_key, my privkey)
+ * @onion_ss: ECDH(unblinded @op->ephemeralkey, my privkey)
+ *
+ * The other arguments, and the return, are as for onion_message_parse().
+ */
+const char *onion_message_parse_ss(const tal_t *ctx,
+				   const struct onionpacket *op,
+				   const struct pubkey *path_key,
+				   const struct pubkey *me,
+				   const struct secret *path_ss,
+				   const struct secret *onion_ss,
+				   u8 **next_onion_msg,
+				   struct sciddir_or_pubkey *next_node,
+				   struct tlv_onionmsg_tlv **final_om,
+				   struct pubkey *final_alias,
+				   struct secret **final_path_id);
+
 #endif /* LIGHTNING_COMMON_ONION_MESSAGE_PARSE_H */
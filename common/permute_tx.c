@@ -1,47 +1,29 @@
 #include "config.h"
+#include <ccan/asort/asort.h>
 #include <common/permute_tx.h>
+#include <common/utils.h>
 #include <wally_psbt.h>
 
-static void swap_wally_outputs(struct wally_tx_output *outputs,
-			       struct wally_psbt_output *psbt_outs,
-			       const void **map, u32 *cltvs,
-			       size_t i1, size_t i2)
-{
-	struct wally_tx_output tmpoutput;
-	struct wally_psbt_output tmppsbtout;
-
-	if (i1 == i2)
-		return;
-
-	tmpoutput = outputs[i1];
-	outputs[i1] = outputs[i2];
-	outputs[i2] = tmpoutput;
-
-	tmppsbtout = psbt_outs[i1];
-	psbt_outs[i1] = psbt_outs[i2];
-	psbt_outs[i2] = tmppsbtout;
-
-	if (map) {
-		const void *tmp = map[i1];
-		map[i1] = map[i2];
-		map[i2] = tmp;
-	}
+struct permute_ctx {
+	const struct wally_tx_output *outputs;
+	const u32 *cltvs;
+};
 
-	if (cltvs) {
-		u32 tmp = cltvs[i1];
-		cltvs[i1] = cltvs[i2];
-		cltvs[i2] = tmp;
-	}
+static u32 cltv_of(const u32 *cltvs, size_t idx)
+{
+	if (!cltvs)
+		return 0;
+	return cltvs[idx];
 }
 
-static bool output_better(const struct wally_tx_output *a, u32 cltv_a,
-			  const struct wally_tx_output *b, u32 cltv_b)
+static int output_cmp(const struct wally_tx_output *a, u32 cltv_a,
+		      const struct wally_tx_output *b, u32 cltv_b)
 {
 	size_t len, lena, lenb;
 	int ret;
 
 	if (a->satoshi != b->satoshi)
-		return a->satoshi < b->satoshi;
+		return a->satoshi < b->satoshi ? -1 : 1;
 
 	/* Lexicographical sort. */
 	lena = a->script_len;
@@ -53,53 +35,70 @@ static bool output_better(const struct wally_tx_output *a, u32 cltv_a,
 
 	ret = memcmp(a->script, b->script, len);
 	if (ret != 0)
-		return ret < 0;
+		return ret;
 
 	if (lena != lenb)
-		return lena < lenb;
+		return lena < lenb ? -1 : 1;
 
-	return cltv_a < cltv_b;
+	if (cltv_a != cltv_b)
+		return cltv_a < cltv_b ? -1 : 1;
+	return 0;
 }
 
-static u32 cltv_of(const u32 *cltvs, size_t idx)
+static int cmp_output_idx(const size_t *a, const size_t *b,
+			  const struct permute_ctx *pctx)
 {
-	if (!cltvs)
-		return 0;
-	return cltvs[idx];
-}
-
-static size_t find_best_out(struct wally_tx_output *outputs, const u32 *cltvs,
-			    size_t num)
-{
-	size_t i, best = 0;
+	int ret = output_cmp(&pctx->outputs[*a], cltv_of(pctx->cltvs, *a),
+			     &pctx->outputs[*b], cltv_of(pctx->cltvs, *b));
+	if (ret != 0)
+		return ret;
 
-	for (i = 1; i < num; i++) {
-		if (output_better(&outputs[i], cltv_of(cltvs, i),
-				  &outputs[best], cltv_of(cltvs, best)))
-			best = i;
-	}
-	return best;
+	/* Identical outputs: keep them in their original order. */
+	if (*a < *b)
+		return -1;
+	return *a > *b;
 }
 
 void permute_outputs(struct bitcoin_tx *tx, u32 *cltvs, const void **map)
 {
-	size_t i, best_pos;
 	struct wally_tx_output *outputs = tx->wtx->outputs;
+	struct wally_psbt_output *psbt_outs = tx->psbt->outputs;
 	size_t num_outputs = tx->wtx->num_outputs;
+	struct wally_tx_output *old_outputs;
+	struct wally_psbt_output *old_psbt_outs;
+	const void **old_map;
+	u32 *old_cltvs;
+	size_t *order;
+	struct permute_ctx pctx;
 
 	/* We can't permute nothing! */
 	if (num_outputs == 0)
 		return;
 
-	/* Now do a dumb sort (num_outputs is small). */
-	for (i = 0; i < num_outputs - 1; i++) {
-		best_pos =
-		    i + find_best_out(outputs + i, cltvs ? cltvs + i : NULL,
-				      num_outputs - i);
-
-		/* Swap best into first place. */
-		swap_wally_outputs(tx->wtx->outputs,
-				   tx->psbt->outputs,
-				   map, cltvs, i, best_pos);
+	/* Sort the indices, then move everything into place: with
+	 * hundreds of HTLCs, a selection sort gets expensive. */
+	order = tal_arr(tmpctx, size_t, num_outputs);
+	for (size_t i = 0; i < num_outputs; i++)
+		order[i] = i;
+	pctx.outputs = outputs;
+	pctx.cltvs = cltvs;
+	asort(order, num_outputs, cmp_output_idx, &pctx);
+
+	old_outputs = tal_dup_arr(tmpctx, struct wally_tx_output,
+				  outputs, num_outputs, 0);
+	old_psbt_outs = tal_dup_arr(tmpctx, struct wally_psbt_output,
+				    psbt_outs, num_outputs, 0);
+	old_map = map ? tal_dup_arr(tmpctx, const void *, map, num_outputs, 0)
+		: NULL;
+	old_cltvs = cltvs ? tal_dup_arr(tmpctx, u32, cltvs, num_outputs, 0)
+		: NULL;
+
+	for (size_t i = 0; i < num_outputs; i++) {
+		outputs[i] = old_outputs[order[i]];
+		psbt_outs[i] = old_psbt_outs[order[i]];
+		if (map)
+			map[i] = old_map[order[i]];
+		if (cltvs)
+			cltvs[i] = old_cltvs[order[i]];
 	}
 }
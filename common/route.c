@@ -27,9 +27,18 @@ bool route_can_carry(const struct gossmap *map,
 		       struct amount_msat amount,
 		       void *arg)
 {
-	if (!c->half[dir].enabled)
+	/* The packed copy, so dijkstra() doesn't pull in all of c */
+	const struct half_chan *h = gossmap_chan_half(map, c, dir);
+
+	/* Only a half with a channel_update can be enabled, so this
+	 * covers gossmap_chan_set() too. */
+	if (!h->enabled)
 		return false;
-	return route_can_carry_even_disabled(map, c, dir, amount, arg);
+	/* Amount 0 is a special "ignore min" probe case */
+	if (!amount_msat_is_zero(amount)
+	    && !gossmap_half_has_capacity(h, amount))
+		return false;
+	return true;
 }
 
 /* Squeeze total costs into a u32 */
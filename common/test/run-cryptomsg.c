@@ -129,9 +129,10 @@ static void check_result(const u8 *msg, const char *hex)
 
 int main(int argc, char *argv[])
 {
-	struct crypto_state cs_out, cs_in;
+	struct crypto_state cs_out, cs_in, cs_start;
 	struct secret sk, rk, ck;
 	const void *msg;
+	u8 *stream, *batch;
 	size_t i;
 
 	common_setup(argv[0]);
@@ -156,12 +157,15 @@ int main(int argc, char *argv[])
 	cs_out.sk = cs_in.rk = sk;
 	cs_out.rk = cs_in.sk = rk;
 	cs_out.s_ck = cs_out.r_ck = cs_in.s_ck = cs_in.r_ck = ck;
+	cs_start = cs_out;
+	stream = tal_arr(tmpctx, u8, 0);
 
 	for (i = 0; i < 1002; i++) {
 		u8 *dec, *enc;
 		u16 len;
 
 		enc = cryptomsg_encrypt_msg(tmpctx, &cs_out, msg);
+		tal_expand(&stream, enc, tal_count(enc));
 
 		/* BOLT #8:
 		 *
@@ -207,6 +211,14 @@ int main(int argc, char *argv[])
 		dec = cryptomsg_decrypt_body(enc, &cs_in, enc);
 		assert(tal_arr_eq(dec, (u8 *)msg));
 	}
+
+	/* Appending them all gives the same stream (across key rotation) */
+	cs_out = cs_start;
+	batch = tal_arr(tmpctx, u8, 0);
+	for (i = 0; i < 1002; i++)
+		cryptomsg_encrypt_msg_append(&cs_out, &batch, msg);
+	assert(tal_arr_eq(batch, stream));
+
 	common_shutdown();
 	return 0;
 }
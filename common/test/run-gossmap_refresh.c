@@ -0,0 +1,345 @@
+/* Test that gossmap_refresh_changes preserves indexes */
+#include "config.h"
+#include <assert.h>
+#include <ccan/crc32c/crc32c.h>
+#include <common/gossip_store.h>
+#include <common/gossmap.h>
+#include <common/setup.h>
+#include <common/utils.h>
+#include <bitcoin/chainparams.h>
+#include <gossipd/gossip_store_wiregen.h>
+#include <stdio.h>
+#include <wire/peer_wiregen.h>
+#include <unistd.h>
+
+/* AUTOGENERATED MOCKS START */
+/* Generated stub for fromwire_bigsize */
+bigsize_t fromwire_bigsize(const u8 **cursor UNNEEDED, size_t *max UNNEEDED)
+{ fprintf(stderr, "fromwire_bigsize called!\n"); abort(); }
+/* Generated stub for fromwire_channel_id */
+bool fromwire_channel_id(const u8 **cursor UNNEEDED, size_t *max UNNEEDED,
+			 struct channel_id *channel_id UNNEEDED)
+{ fprintf(stderr, "fromwire_channel_id called!\n"); abort(); }
+/* Generated stub for fromwire_tlv */
+bool fromwire_tlv(const u8 **cursor UNNEEDED, size_t *max UNNEEDED,
+		  const struct tlv_record_type *types UNNEEDED, size_t num_types UNNEEDED,
+		  void *record UNNEEDED, struct tlv_field **fields UNNEEDED,
+		  const u64 *extra_types UNNEEDED, size_t *err_off UNNEEDED, u64 *err_type UNNEEDED)
+{ fprintf(stderr, "fromwire_tlv called!\n"); abort(); }
+/* Generated stub for sciddir_or_pubkey_from_node_id */
+bool sciddir_or_pubkey_from_node_id(struct sciddir_or_pubkey *sciddpk UNNEEDED,
+				    const struct node_id *node_id UNNEEDED)
+{ fprintf(stderr, "sciddir_or_pubkey_from_node_id called!\n"); abort(); }
+/* Generated stub for towire_bigsize */
+void towire_bigsize(u8 **pptr UNNEEDED, const bigsize_t val UNNEEDED)
+{ fprintf(stderr, "towire_bigsize called!\n"); abort(); }
+/* Generated stub for towire_channel_id */
+void towire_channel_id(u8 **pptr UNNEEDED, const struct channel_id *channel_id UNNEEDED)
+{ fprintf(stderr, "towire_channel_id called!\n"); abort(); }
+/* Generated stub for towire_tlv */
+void towire_tlv(u8 **pptr UNNEEDED,
+		const struct tlv_record_type *types UNNEEDED, size_t num_types UNNEEDED,
+		const void *record UNNEEDED)
+{ fprintf(stderr, "towire_tlv called!\n"); abort(); }
+/* AUTOGENERATED MOCKS END */
+
+static void write_to_store(int store_fd, const u8 *msg)
+{
+	struct gossip_hdr hdr;
+
+	hdr.flags = cpu_to_be16(0);
+	hdr.len = cpu_to_be16(tal_count(msg));
+	hdr.timestamp = 0;
+	hdr.crc = cpu_to_be32(crc32c(be32_to_cpu(hdr.timestamp), msg, tal_count(msg)));
+	assert(write(store_fd, &hdr, sizeof(hdr)) == sizeof(hdr));
+	assert(write(store_fd, msg, tal_count(msg)) == tal_count(msg));
+}
+
+/* gossipd does this after copying, if the record goes away. */
+static void mark_deleted(int store_fd, off_t off)
+{
+	be16 flags = cpu_to_be16(GOSSIP_STORE_DELETED_BIT);
+
+	assert(pwrite(store_fd, &flags, sizeof(flags), off) == sizeof(flags));
+}
+
+/* A fresh store, as gossipd's compaction makes: returns fd */
+static int new_store(char **filename, u8 uuid_byte)
+{
+	char gossip_version = 10;
+	u8 uuid[32];
+	int fd;
+
+	fd = tmpdir_mkstemp(tmpctx, "run-gossmap_refresh.XXXXXX", filename);
+	assert(write(fd, &gossip_version, sizeof(gossip_version))
+	       == sizeof(gossip_version));
+	memset(uuid, uuid_byte, sizeof(uuid));
+	write_to_store(fd, towire_gossip_store_uuid(tmpctx, uuid));
+	return fd;
+}
+
+/* gossipd renames the new store in, then ends the old one. */
+static void end_store(int old_fd, int new_fd,
+		      const char *newfilename, const char *filename,
+		      u8 uuid_byte)
+{
+	u8 uuid[32];
+
+	memset(uuid, uuid_byte, sizeof(uuid));
+	assert(rename(newfilename, filename) == 0);
+	write_to_store(old_fd,
+		       towire_gossip_store_ended(tmpctx,
+						 lseek(new_fd, 0, SEEK_END),
+						 uuid));
+}
+
+/* Nothing here should upset gossmap */
+static void test_log(void *unused,
+		     enum log_level level,
+		     const char *fmt,
+		     ...)
+{
+	assert(level != LOG_BROKEN);
+}
+
+static struct short_channel_id make_scid(const struct node_id *from,
+					 const struct node_id *to)
+{
+	struct short_channel_id scid;
+
+	/* Make a unique scid. */
+	memcpy(&scid, from, sizeof(scid) / 2);
+	memcpy((char *)&scid + sizeof(scid) / 2, to, sizeof(scid) / 2);
+	return scid;
+}
+
+static void update_connection(int store_fd,
+			      const struct node_id *from,
+			      const struct node_id *to,
+			      u32 base_fee)
+{
+	secp256k1_ecdsa_signature dummy_sig;
+	u8 *msg;
+
+	/* So valgrind doesn't complain */
+	memset(&dummy_sig, 0, sizeof(dummy_sig));
+
+	msg = towire_channel_update(tmpctx,
+				    &dummy_sig,
+				    &chainparams->genesis_blockhash,
+				    make_scid(from, to), 0,
+				    ROUTING_OPT_HTLC_MAX_MSAT,
+				    node_id_idx(from, to),
+				    6,
+				    AMOUNT_MSAT(0),
+				    base_fee,
+				    1,
+				    AMOUNT_MSAT(100000 * 1000));
+	write_to_store(store_fd, msg);
+}
+
+static void add_connection(int store_fd,
+			   const struct node_id *from,
+			   const struct node_id *to)
+{
+	secp256k1_ecdsa_signature dummy_sig;
+	struct secret not_a_secret;
+	struct pubkey dummy_key;
+	u8 *msg;
+	const struct node_id *ids[2];
+
+	/* So valgrind doesn't complain */
+	memset(&dummy_sig, 0, sizeof(dummy_sig));
+	memset(&not_a_secret, 1, sizeof(not_a_secret));
+	pubkey_from_secret(&not_a_secret, &dummy_key);
+
+	if (node_id_cmp(from, to) > 0) {
+		ids[0] = to;
+		ids[1] = from;
+	} else {
+		ids[0] = from;
+		ids[1] = to;
+	}
+	msg = towire_channel_announcement(tmpctx, &dummy_sig, &dummy_sig,
+					  &dummy_sig, &dummy_sig,
+					  /* features */ NULL,
+					  &chainparams->genesis_blockhash,
+					  make_scid(from, to),
+					  ids[0], ids[1],
+					  &dummy_key, &dummy_key);
+	write_to_store(store_fd, msg);
+
+	msg = towire_gossip_store_channel_amount(tmpctx, AMOUNT_SAT(100000));
+	write_to_store(store_fd, msg);
+	update_connection(store_fd, from, to, 1);
+}
+
+static void delete_connection(int store_fd,
+			      const struct node_id *from,
+			      const struct node_id *to)
+{
+	write_to_store(store_fd,
+		       towire_gossip_store_delete_chan(tmpctx,
+						       make_scid(from, to)));
+}
+
+static void node_id_from_privkey(const struct privkey *p, struct node_id *id)
+{
+	struct pubkey k;
+	pubkey_from_privkey(p, &k);
+	node_id_from_pubkey(id, &k);
+}
+
+static u32 chan_idx(const struct gossmap *gossmap,
+		    const struct node_id *from,
+		    const struct node_id *to)
+{
+	struct short_channel_id scid = make_scid(from, to);
+	struct gossmap_chan *c = gossmap_find_chan(gossmap, &scid);
+
+	assert(c);
+	return gossmap_chan_idx(gossmap, c);
+}
+
+static bool idx_in(const u32 *arr, u32 idx)
+{
+	for (size_t i = 0; i < tal_count(arr); i++)
+		if (arr[i] == idx)
+			return true;
+	return false;
+}
+
+int main(int argc, char *argv[])
+{
+	struct node_id a, b, c, d;
+	struct privkey tmp;
+	int store_fd, new_fd, fd3, fd4;
+	struct gossmap *gossmap;
+	struct gossmap_changes *changes;
+	char gossip_version = 10;
+	char *gossipfilename;
+	char *newfilename, *filename3, *filename4;
+	off_t bd_off;
+	u32 ab, bc, cd;
+
+	common_setup(argv[0]);
+	chainparams = chainparams_for_network("regtest");
+
+	store_fd = tmpdir_mkstemp(tmpctx, "run-gossmap_refresh.XXXXXX", &gossipfilename);
+	assert(write(store_fd, &gossip_version, sizeof(gossip_version))
+	       == sizeof(gossip_version));
+	gossmap = gossmap_load(tmpctx, gossipfilename, test_log, NULL);
+
+	memset(&tmp, 'a', sizeof(tmp));
+	node_id_from_privkey(&tmp, &a);
+	memset(&tmp, 'b', sizeof(tmp));
+	node_id_from_privkey(&tmp, &b);
+	memset(&tmp, 'c', sizeof(tmp));
+	node_id_from_privkey(&tmp, &c);
+	memset(&tmp, 'd', sizeof(tmp));
+	node_id_from_privkey(&tmp, &d);
+
+	assert(!gossmap_refresh_changes(gossmap, tmpctx, &changes));
+	assert(!changes);
+
+	/* A<->B, B<->C */
+	add_connection(store_fd, &a, &b);
+	add_connection(store_fd, &b, &c);
+	assert(gossmap_refresh_changes(gossmap, tmpctx, &changes));
+	ab = chan_idx(gossmap, &a, &b);
+	bc = chan_idx(gossmap, &b, &c);
+	assert(tal_count(changes->chans_added) == 2);
+	assert(idx_in(changes->chans_added, ab));
+	assert(idx_in(changes->chans_added, bc));
+	assert(tal_count(changes->chans_removed) == 0);
+	assert(tal_count(changes->nodes_added) == 3);
+
+	/* Update A<->B, add C<->D, delete B<->C. */
+	update_connection(store_fd, &a, &b, 2);
+	add_connection(store_fd, &c, &d);
+	delete_connection(store_fd, &b, &c);
+	assert(gossmap_refresh_changes(gossmap, tmpctx, &changes));
+
+	/* Existing index unchanged, removed one left empty and not reused */
+	assert(chan_idx(gossmap, &a, &b) == ab);
+	assert(idx_in(changes->chans_updated, ab));
+	assert(gossmap_chan_byidx(gossmap, ab)->half[node_id_idx(&a, &b)].base_fee == 2);
+	assert(tal_count(changes->chans_removed) == 1);
+	assert(changes->chans_removed[0] == bc);
+	assert(!gossmap_chan_byidx(gossmap, bc));
+	cd = chan_idx(gossmap, &c, &d);
+	assert(cd != bc);
+	assert(tal_count(changes->chans_added) == 1);
+	assert(changes->chans_added[0] == cd);
+
+	/* B is only on A<->B now, C is only on C<->D: nobody went away. */
+	assert(tal_count(changes->nodes_removed) == 0);
+	assert(tal_count(changes->nodes_added) == 1);
+
+	/* Now the tombstone can be reused. */
+	add_connection(store_fd, &b, &d);
+	assert(gossmap_refresh_changes(gossmap, tmpctx, &changes));
+	assert(tal_count(changes->chans_added) == 1);
+	assert(changes->chans_added[0] == chan_idx(gossmap, &b, &d));
+	assert(changes->chans_added[0] == bc);
+
+	/* Now "compact": same live records, in order, in a new file. */
+	new_fd = new_store(&newfilename, 2);
+	add_connection(new_fd, &a, &b);
+	update_connection(new_fd, &a, &b, 2);
+	add_connection(new_fd, &c, &d);
+	bd_off = lseek(new_fd, 0, SEEK_CUR);
+	add_connection(new_fd, &b, &d);
+	/* B<->D goes away after it was copied: its tombstone comes later */
+	mark_deleted(new_fd, bd_off);
+	end_store(store_fd, new_fd, newfilename, gossipfilename, 2);
+
+	/* Indexes survive the switch, and lookups work in the new file. */
+	assert(!gossmap_refresh_changes(gossmap, tmpctx, &changes));
+	assert(chan_idx(gossmap, &a, &b) == ab);
+	assert(chan_idx(gossmap, &c, &d) == cd);
+	assert(chan_idx(gossmap, &b, &d) == bc);
+	assert(gossmap_chan_byidx(gossmap, ab)->half[node_id_idx(&a, &b)].base_fee == 2);
+
+	/* And we carry on reading the new file. */
+	update_connection(new_fd, &c, &d, 3);
+	assert(gossmap_refresh_changes(gossmap, tmpctx, &changes));
+	assert(tal_count(changes->chans_updated) == 1);
+	assert(changes->chans_updated[0] == cd);
+	assert(gossmap_chan_byidx(gossmap, cd)->half[node_id_idx(&c, &d)].base_fee == 3);
+
+	/* Deleted record was still remapped, so the tombstone finds it. */
+	delete_connection(new_fd, &b, &d);
+	assert(gossmap_refresh_changes(gossmap, tmpctx, &changes));
+	assert(tal_count(changes->chans_removed) == 1);
+	assert(changes->chans_removed[0] == bc);
+
+	/* Compact twice before gossmap looks: the first ended record
+	 * refers to a store which has already been replaced. */
+	fd3 = new_store(&filename3, 3);
+	add_connection(fd3, &a, &b);
+	update_connection(fd3, &a, &b, 2);
+	add_connection(fd3, &c, &d);
+	update_connection(fd3, &c, &d, 3);
+	end_store(new_fd, fd3, filename3, gossipfilename, 3);
+
+	fd4 = new_store(&filename4, 4);
+	add_connection(fd4, &c, &d);
+	update_connection(fd4, &c, &d, 3);
+	add_connection(fd4, &a, &b);
+	update_connection(fd4, &a, &b, 4);
+	end_store(fd3, fd4, filename4, gossipfilename, 4);
+
+	/* We can't use our offsets in that, so it's all reloaded. */
+	assert(gossmap_refresh_changes(gossmap, tmpctx, &changes));
+	assert(tal_count(changes->chans_removed) == 2);
+	assert(idx_in(changes->chans_removed, ab));
+	assert(idx_in(changes->chans_removed, cd));
+	assert(tal_count(changes->chans_added) == 2);
+	assert(gossmap_chan_byidx(gossmap, chan_idx(gossmap, &a, &b))
+	       ->half[node_id_idx(&a, &b)].base_fee == 4);
+	assert(gossmap_chan_byidx(gossmap, chan_idx(gossmap, &c, &d))
+	       ->half[node_id_idx(&c, &d)].base_fee == 3);
+
+	common_shutdown();
+}
@@ -33,6 +33,7 @@
 #include <connectd/connectd.h>
 #include <connectd/connectd_gossipd_wiregen.h>
 #include <connectd/connectd_wiregen.h>
+#include <connectd/ecdh_async.h>
 #include <connectd/multiplex.h>
 #include <connectd/netaddress.h>
 #include <connectd/onion_message.h>
@@ -144,6 +145,8 @@ static struct peer *new_peer(struct daemon *daemon,
 	peer->cs = *cs;
 	peer->subds = tal_arr(peer, struct subd *, 0);
 	peer->peer_in = NULL;
+	peer->peer_in_off = peer->peer_in_used = 0;
+	peer->peer_in_bodylen = 0;
 	peer->sent_to_peer = NULL;
 	peer->urgent = false;
 	peer->draining = false;
@@ -1502,6 +1505,9 @@ setup_listeners(const tal_t *ctx,
 				struct sha256 sha;
 				struct secret ss;
 
+				/* connect_init hasn't called
+				 * ecdh_async_setup() yet, so the hsm fd is
+				 * still ours to use synchronously. */
 				ecdh(&pb, &ss);
 				/* let's sha, that will clear ctx of hsm data */
 				sha256(&sha, &ss, 32);
@@ -1624,6 +1630,12 @@ static void connect_init(struct daemon *daemon, const u8 *msg)
 					     &announceable,
 					     &errstr);
 
+	/* From now on, handshakes and onion messages use ecdh_async(), so
+	 * they don't wait for hsmd (and each other).  This takes over the
+	 * hsm fd (making it non-blocking), so setup_listeners() must be
+	 * the last to use ecdh(). */
+	ecdh_async_setup(daemon, HSM_FD);
+
 	/* Free up old allocations */
 	tal_free(proposed_wireaddr);
 	tal_free(proposed_listen_announce);
@@ -2464,6 +2476,7 @@ int main(int argc, char *argv[])
 	daemon->gossip_stream_limit = 1000000;
 	daemon->scid_htable = tal(daemon, struct scid_htable);
 	scid_htable_init(daemon->scid_htable);
+	list_head_init(&daemon->onion_injections);
 
 	/* stdin == control */
 	daemon->master = daemon_conn_new(daemon, STDIN_FILENO, recv_req, NULL,
@@ -5,6 +5,7 @@
 #include <bitcoin/short_channel_id.h>
 #include <ccan/crypto/siphash24/siphash24.h>
 #include <ccan/htable/htable_type.h>
+#include <ccan/list/list.h>
 #include <ccan/timer/timer.h>
 #include <common/bigsize.h>
 #include <common/channel_id.h>
@@ -75,8 +76,15 @@ struct peer {
 	/* When socket has Nagle overridden */
 	bool urgent;
 
-	/* Input buffer. */
+	/* Input buffer: bytes read from peer, not yet decrypted. */
 	u8 *peer_in;
+	/* Offset of next message in peer_in, and end of what we've read. */
+	size_t peer_in_off, peer_in_used;
+	/* How much the last io_read_partial() got */
+	size_t peer_in_len_read;
+	/* Length (incl. MAC) of the next message body, once we've
+	 * decrypted its header; otherwise 0. */
+	size_t peer_in_bodylen;
 
 	/* Output buffer. */
 	struct msg_queue *peer_outq;
@@ -277,6 +285,10 @@ struct daemon {
 	/* Map of short_channel_ids to peers */
 	struct scid_htable *scid_htable;
 
+	/* Onion messages lightningd injected, oldest first: it wants the
+	 * replies in order. */
+	struct list_head onion_injections;
+
 	/* Any listening sockets we have. */
 	struct io_listener **listeners;
 
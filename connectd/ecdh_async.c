@@ -0,0 +1,114 @@
+/*~ Every incoming connection and every onion message needs an ECDH with our
+ * node key, which only hsmd has.  Waiting for each answer in turn would
+ * stall all our peers behind hsmd, so instead we send requests as they
+ * arise, and match up the answers as they come back: hsmd handles each
+ * client's requests in order, so the answers come back in order too. */
+#include "config.h"
+#include <bitcoin/privkey.h>
+#include <ccan/list/list.h>
+#include <common/daemon_conn.h>
+#include <common/memleak.h>
+#include <common/status.h>
+#include <common/utils.h>
+#include <connectd/ecdh_async.h>
+#include <hsmd/hsmd_wiregen.h>
+
+struct ecdh_async {
+	struct daemon_conn *hsmd;
+	/* Requests we've sent, oldest first. */
+	struct list_head pending;
+};
+
+/* One for each request sent to hsmd. */
+struct ecdh_pending {
+	/* In ecdh_async->pending */
+	struct list_node list;
+	/* NULL if the caller's ctx was freed: we still need to eat the reply. */
+	struct ecdh_req *req;
+};
+
+/* Allocated off the caller's ctx. */
+struct ecdh_req {
+	struct ecdh_pending *pending;
+	void (*cb)(const struct secret *ss, void *arg);
+	void *arg;
+};
+
+static struct ecdh_async *ecdh_async;
+
+static void destroy_ecdh_req(struct ecdh_req *req)
+{
+	req->pending->req = NULL;
+}
+
+static struct io_plan *ecdh_reply(struct io_conn *conn,
+				  const u8 *msg,
+				  struct ecdh_async *ea)
+{
+	struct ecdh_pending *pending;
+	struct secret ss;
+
+	pending = list_pop(&ea->pending, struct ecdh_pending, list);
+	if (!pending)
+		status_failed(STATUS_FAIL_HSM_IO,
+			      "Unexpected hsmd message %s",
+			      tal_hex(tmpctx, msg));
+
+	if (!fromwire_hsmd_ecdh_resp(msg, &ss))
+		status_failed(STATUS_FAIL_HSM_IO,
+			      "Invalid hsmd ECDH response %s",
+			      tal_hex(tmpctx, msg));
+
+	if (pending->req) {
+		struct ecdh_req *req = pending->req;
+		void (*cb)(const struct secret *, void *) = req->cb;
+		void *arg = req->arg;
+
+		/* The callback may well free req's parent! */
+		tal_del_destructor(req, destroy_ecdh_req);
+		tal_free(req);
+		cb(&ss, arg);
+	}
+	tal_free(pending);
+
+	return daemon_conn_read_next(conn, ea->hsmd);
+}
+
+void ecdh_async_(const tal_t *ctx,
+		 const struct pubkey *point,
+		 void (*cb)(const struct secret *ss, void *arg),
+		 void *arg)
+{
+	struct ecdh_pending *pending;
+
+	if (!ecdh_async)
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "ecdh_async before ecdh_async_setup");
+
+	pending = tal(ecdh_async, struct ecdh_pending);
+
+	pending->req = tal(ctx, struct ecdh_req);
+	pending->req->pending = pending;
+	pending->req->cb = cb;
+	pending->req->arg = arg;
+	tal_add_destructor(pending->req, destroy_ecdh_req);
+	list_add_tail(&ecdh_async->pending, &pending->list);
+
+	daemon_conn_send(ecdh_async->hsmd,
+			 take(towire_hsmd_ecdh_req(NULL, point)));
+}
+
+static void hsmd_gone(struct daemon_conn *hsmd)
+{
+	status_failed(STATUS_FAIL_HSM_IO, "hsmd connection closed");
+}
+
+void ecdh_async_setup(const tal_t *ctx, int hsm_fd)
+{
+	/* Only reachable via this static, so tell memleak it's OK. */
+	ecdh_async = notleak(tal(ctx, struct ecdh_async));
+	list_head_init(&ecdh_async->pending);
+	ecdh_async->hsmd = daemon_conn_new(ecdh_async, hsm_fd,
+					   ecdh_reply, NULL, ecdh_async);
+	tal_add_destructor(ecdh_async->hsmd, hsmd_gone);
+}
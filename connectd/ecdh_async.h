@@ -0,0 +1,11 @@
+#ifndef LIGHTNING_CONNECTD_ECDH_ASYNC_H
+#define LIGHTNING_CONNECTD_ECDH_ASYNC_H
+#include "config.h"
+#include <common/ecdh.h>
+
+/* The via-the-hsmd implementation of ecdh_async(). */
+
+/* You must call this before calling ecdh_async().  It takes over the fd, so
+ * the synchronous ecdh() cannot be used after this. */
+void ecdh_async_setup(const tal_t *ctx, int hsm_fd);
+#endif /* LIGHTNING_CONNECTD_ECDH_ASYNC_H */
@@ -154,6 +154,8 @@ struct handshake {
 	struct sha256 h;
 	struct keypair e;
 	struct secret *ss;
+	/* Has the ecdh_async() into ss finished? */
+	bool ss_ready;
 
 	/* Used between the Acts */
 	struct pubkey re;
@@ -406,6 +408,8 @@ static struct handshake *new_handshake(const tal_t *ctx,
 {
 	struct handshake *handshake = tal(ctx, struct handshake);
 
+	handshake->ss = NULL;
+
 	/* BOLT #8:
 	 *
 	 * Before the start of Act One, both sides initialize their
@@ -453,41 +457,34 @@ static struct handshake *new_handshake(const tal_t *ctx,
 	return handshake;
 }
 
-static struct io_plan *act_three_initiator(struct io_conn *conn,
-					   struct handshake *h)
+static void handshake_ecdh_done(const struct secret *ss, struct handshake *h)
 {
-	u8 spub[PUBKEY_CMPR_LEN];
-	size_t len = sizeof(spub);
-
-	SUPERVERBOSE("Initiator: Act 3");
-
-	/* BOLT #8:
-	 * 1. `c = encryptWithAD(temp_k2, 1, h, s.pub.serializeCompressed())`
-	 *     * where `s` is the static public key of the initiator
-	 */
-	secp256k1_ec_pubkey_serialize(secp256k1_ctx, spub, &len,
-				      &h->my_id.pubkey,
-				      SECP256K1_EC_COMPRESSED);
-	encrypt_ad(&h->temp_k, 1, &h->h, sizeof(h->h), spub, sizeof(spub),
-		   h->act3.ciphertext, sizeof(h->act3.ciphertext));
-	SUPERVERBOSE("# c=0x%s",
-		     tal_hexstr(tmpctx,
-				h->act3.ciphertext, sizeof(h->act3.ciphertext)));
-
-	/* BOLT #8:
-	 * 2. `h = SHA-256(h || c)`
-	 */
-	sha_mix_in(&h->h, h->act3.ciphertext, sizeof(h->act3.ciphertext));
-	SUPERVERBOSE("# h=0x%s", tal_hexstr(tmpctx, &h->h, sizeof(h->h)));
+	*h->ss = *ss;
+	h->ss_ready = true;
+	io_wake(h->ss);
+}
 
-	/* BOLT #8:
-	 *
-	 * 3. `se = ECDH(s.priv, re)`
-	 *     * where `re` is the ephemeral public key of the responder
-	 */
+/* hsmd does ECDH(s.priv, re) for us: lots of other connections may be asking
+ * too, so we don't block on it. */
+static struct io_plan *handshake_ecdh(struct io_conn *conn,
+				      struct handshake *h,
+				      struct io_plan *(*next)(struct io_conn *,
+							      struct handshake *))
+{
 	tal_free(h->ss);
 	h->ss = tal(h, struct secret);
-	ecdh(&h->re, h->ss);
+	h->ss_ready = false;
+	ecdh_async(h, &h->re, handshake_ecdh_done, h);
+
+	/* It might have answered immediately (e.g. in tests) */
+	if (h->ss_ready)
+		return next(conn, h);
+	return io_wait(conn, h->ss, next, h);
+}
+
+static struct io_plan *act_three_initiator2(struct io_conn *conn,
+					    struct handshake *h)
+{
 	SUPERVERBOSE("# ss=0x%s", tal_hexstr(tmpctx, h->ss, sizeof(*h->ss)));
 
 	/* BOLT #8:
@@ -522,6 +519,41 @@ static struct io_plan *act_three_initiator(struct io_conn *conn,
 	return io_write(conn, &h->act3, ACT_THREE_SIZE, handshake_succeeded, h);
 }
 
+static struct io_plan *act_three_initiator(struct io_conn *conn,
+					   struct handshake *h)
+{
+	u8 spub[PUBKEY_CMPR_LEN];
+	size_t len = sizeof(spub);
+
+	SUPERVERBOSE("Initiator: Act 3");
+
+	/* BOLT #8:
+	 * 1. `c = encryptWithAD(temp_k2, 1, h, s.pub.serializeCompressed())`
+	 *     * where `s` is the static public key of the initiator
+	 */
+	secp256k1_ec_pubkey_serialize(secp256k1_ctx, spub, &len,
+				      &h->my_id.pubkey,
+				      SECP256K1_EC_COMPRESSED);
+	encrypt_ad(&h->temp_k, 1, &h->h, sizeof(h->h), spub, sizeof(spub),
+		   h->act3.ciphertext, sizeof(h->act3.ciphertext));
+	SUPERVERBOSE("# c=0x%s",
+		     tal_hexstr(tmpctx,
+				h->act3.ciphertext, sizeof(h->act3.ciphertext)));
+
+	/* BOLT #8:
+	 * 2. `h = SHA-256(h || c)`
+	 */
+	sha_mix_in(&h->h, h->act3.ciphertext, sizeof(h->act3.ciphertext));
+	SUPERVERBOSE("# h=0x%s", tal_hexstr(tmpctx, &h->h, sizeof(h->h)));
+
+	/* BOLT #8:
+	 *
+	 * 3. `se = ECDH(s.priv, re)`
+	 *     * where `re` is the ephemeral public key of the responder
+	 */
+	return handshake_ecdh(conn, h, act_three_initiator2);
+}
+
 static struct io_plan *act_two_initiator2(struct io_conn *conn,
 					 struct handshake *h)
 {
@@ -876,6 +908,47 @@ static struct io_plan *act_two_responder(struct io_conn *conn,
 	return io_write(conn, &h->act2, ACT_TWO_SIZE, act_three_responder, h);
 }
 
+static struct io_plan *act_one_responder3(struct io_conn *conn,
+					  struct handshake *h)
+{
+	SUPERVERBOSE("# ss=0x%s", tal_hexstr(tmpctx, h->ss, sizeof(*h->ss)));
+
+	/* BOLT #8:
+	 *
+	 * 6. `ck, temp_k1 = HKDF(ck, es)`
+	 *     * A new temporary encryption key is generated, which will
+	 *       shortly be used to check the authenticating MAC.
+	 */
+	hkdf_two_keys(&h->ck, &h->temp_k, &h->ck, h->ss, sizeof(*h->ss));
+	SUPERVERBOSE("# ck,temp_k1=0x%s,0x%s",
+		     tal_hexstr(tmpctx, &h->ck, sizeof(h->ck)),
+		     tal_hexstr(tmpctx, &h->temp_k, sizeof(h->temp_k)));
+
+	/* BOLT #8:
+	 *
+	 * 7. `p = decryptWithAD(temp_k1, 0, h, c)`
+	 *     * If the MAC check in this operation fails, then the initiator
+	 *       does _not_ know the responder's static public key. If this
+	 *       is the case, then the responder MUST terminate the connection
+	 *       without any further messages.
+	 */
+	if (!decrypt(&h->temp_k, 0, &h->h, sizeof(h->h),
+		     h->act1.tag, sizeof(h->act1.tag), NULL, 0))
+		return handshake_failed(conn, h);
+
+	/* BOLT #8:
+	 *
+	 * 8. `h = SHA-256(h || c)`
+	 *     * The received ciphertext is mixed into the handshake digest.
+	 *       This step serves to ensure the payload wasn't modified by a
+	 *       MITM.
+	 */
+	sha_mix_in(&h->h, h->act1.tag, sizeof(h->act1.tag));
+	SUPERVERBOSE("# h=0x%s", tal_hexstr(tmpctx, &h->h, sizeof(h->h)));
+
+	return act_two_responder(conn, h);
+}
+
 static struct io_plan *act_one_responder2(struct io_conn *conn,
 					 struct handshake *h)
 {
@@ -915,44 +988,7 @@ static struct io_plan *act_one_responder2(struct io_conn *conn,
 	 *    * The responder performs an ECDH between its static private key and
 	 *      the initiator's ephemeral public key.
 	 */
-	h->ss = tal(h, struct secret);
-	ecdh(&h->re, h->ss);
-	SUPERVERBOSE("# ss=0x%s", tal_hexstr(tmpctx, h->ss, sizeof(*h->ss)));
-
-	/* BOLT #8:
-	 *
-	 * 6. `ck, temp_k1 = HKDF(ck, es)`
-	 *     * A new temporary encryption key is generated, which will
-	 *       shortly be used to check the authenticating MAC.
-	 */
-	hkdf_two_keys(&h->ck, &h->temp_k, &h->ck, h->ss, sizeof(*h->ss));
-	SUPERVERBOSE("# ck,temp_k1=0x%s,0x%s",
-		     tal_hexstr(tmpctx, &h->ck, sizeof(h->ck)),
-		     tal_hexstr(tmpctx, &h->temp_k, sizeof(h->temp_k)));
-
-	/* BOLT #8:
-	 *
-	 * 7. `p = decryptWithAD(temp_k1, 0, h, c)`
-	 *     * If the MAC check in this operation fails, then the initiator
-	 *       does _not_ know the responder's static public key. If this
-	 *       is the case, then the responder MUST terminate the connection
-	 *       without any further messages.
-	 */
-	if (!decrypt(&h->temp_k, 0, &h->h, sizeof(h->h),
-		     h->act1.tag, sizeof(h->act1.tag), NULL, 0))
-		return handshake_failed(conn, h);
-
-	/* BOLT #8:
-	 *
-	 * 8. `h = SHA-256(h || c)`
-	 *     * The received ciphertext is mixed into the handshake digest.
-	 *       This step serves to ensure the payload wasn't modified by a
-	 *       MITM.
-	 */
-	sha_mix_in(&h->h, h->act1.tag, sizeof(h->act1.tag));
-	SUPERVERBOSE("# h=0x%s", tal_hexstr(tmpctx, &h->h, sizeof(h->h)));
-
-	return act_two_responder(conn, h);
+	return handshake_ecdh(conn, h, act_one_responder3);
 }
 
 static struct io_plan *act_one_responder(struct io_conn *conn,
@@ -23,7 +23,6 @@
 #include <connectd/connectd_gossipd_wiregen.h>
 #include <connectd/connectd_wiregen.h>
 #include <connectd/gossip_rcvd_filter.h>
-#include <connectd/gossip_store.h>
 #include <connectd/multiplex.h>
 #include <connectd/onion_message.h>
 #include <connectd/queries.h>
@@ -397,6 +396,16 @@ static struct io_plan *io_sock_shutdown_cb(struct io_conn *conn, struct peer *un
 	return io_sock_shutdown(conn);
 }
 
+/* Once a write reaches this size, we stop adding more messages to it:
+ * anything urgent which turns up has to wait behind it. */
+#define MAX_WRITE_BATCH 16384
+
+/* How much we try to read from a peer at once (we grow the buffer
+ * temporarily for larger messages). */
+#define PEER_READ_SIZE 4096
+
+static bool append_queued_msgs(struct peer *peer, u8 **buf);
+
 static struct io_plan *encrypt_and_send(struct peer *peer,
 					const u8 *msg TAKES,
 					struct io_plan *(*next)
@@ -404,6 +413,8 @@ static struct io_plan *encrypt_and_send(struct peer *peer,
 					 struct peer *peer))
 {
 	int type = fromwire_peektype(msg);
+	bool urgent = is_urgent(type);
+	u8 *buf;
 
 	switch (dev_disconnect_out(&peer->id, type)) {
 	case DEV_DISCONNECT_OUT_BEFORE:
@@ -438,10 +449,20 @@ static struct io_plan *encrypt_and_send(struct peer *peer,
 		break;
 	}
 
-	set_urgent_flag(peer, is_urgent(type));
+	buf = cryptomsg_encrypt_msg(peer, &peer->cs, msg);
+
+	/* Rather than one write per message, put whatever else is queued
+	 * into the same write.  Not if dev_disconnect wants to see each
+	 * packet, though, and an urgent message goes out immediately. */
+	if (!urgent
+	    && peer->daemon->dev_disconnect_fd == -1
+	    && !peer->dev_writes_enabled)
+		urgent = append_queued_msgs(peer, &buf);
 
-	/* We free this and the encrypted version in next write_to_peer */
-	peer->sent_to_peer = cryptomsg_encrypt_msg(peer, &peer->cs, msg);
+	set_urgent_flag(peer, urgent);
+
+	/* We free this in next write_to_peer */
+	peer->sent_to_peer = buf;
 	return io_write(peer->to_peer,
 			peer->sent_to_peer,
 			tal_bytelen(peer->sent_to_peer),
@@ -477,7 +498,6 @@ static const u8 *maybe_gossip_msg(const tal_t *ctx, struct peer *peer)
 	const u8 *msg;
 	struct timemono now;
 	struct gossmap *gossmap;
-	u32 timestamp;
 	const u8 **msgs;
 
 	/* If it's been over a second, make a fresh start. */
@@ -529,20 +549,15 @@ static const u8 *maybe_gossip_msg(const tal_t *ctx, struct peer *peer)
 	assert(peer->gs.gossip_timer);
 
 again:
-	msg = gossmap_stream_next(ctx, gossmap, peer->gs.iter, &timestamp);
+	msg = gossmap_stream_next(ctx, gossmap, peer->gs.iter,
+				  peer->gs.timestamp_min,
+				  peer->gs.timestamp_max);
 	if (msg) {
 		/* Don't send back gossip they sent to us! */
 		if (gossip_rcvd_filter_del(peer->gs.grf, msg)) {
 			msg = tal_free(msg);
 			goto again;
 		}
-		/* Check timestamp (zero for channel_announcement with
-		 * no update yet!):  FIXME: we could ignore this! */
-		if (timestamp
-		    && (timestamp < peer->gs.timestamp_min || timestamp > peer->gs.timestamp_max)) {
-			msg = tal_free(msg);
-			goto again;
-		}
 		peer->gs.bytes_this_second += tal_bytelen(msg);
 		status_peer_io(LOG_IO_OUT, &peer->id, msg);
 		return msg;
@@ -988,6 +1003,27 @@ static void maybe_update_channelid(struct subd *subd, const u8 *msg)
 	}
 }
 
+/* Encrypt more queued messages onto buf, until it's big enough, or we
+ * hit an urgent one.  Returns true if we added an urgent one. */
+static bool append_queued_msgs(struct peer *peer, u8 **buf)
+{
+	while (tal_bytelen(*buf) < MAX_WRITE_BATCH) {
+		const u8 *msg = msg_dequeue(peer->peer_outq);
+		bool urgent;
+
+		if (!msg && !peer->draining)
+			msg = maybe_gossip_msg(NULL, peer);
+		if (!msg)
+			return false;
+
+		urgent = is_urgent(fromwire_peektype(msg));
+		cryptomsg_encrypt_msg_append(&peer->cs, buf, take(msg));
+		if (urgent)
+			return true;
+	}
+	return false;
+}
+
 static struct io_plan *write_to_peer(struct io_conn *peer_conn,
 				     struct peer *peer)
 {
@@ -1133,32 +1169,23 @@ static struct io_plan *close_peer_dev_disconnect(struct io_conn *peer_conn,
 	return io_close_cb(peer_conn, peer);
 }
 
-static struct io_plan *read_hdr_from_peer(struct io_conn *peer_conn,
-					  struct peer *peer);
-static struct io_plan *read_body_from_peer_done(struct io_conn *peer_conn,
-						struct peer *peer)
+static struct io_plan *read_from_peer(struct io_conn *peer_conn,
+				      struct peer *peer);
+static struct io_plan *handle_peer_msg(struct io_conn *peer_conn,
+				       struct peer *peer,
+				       u8 *decrypted)
 {
-       u8 *decrypted;
        struct channel_id channel_id;
        struct subd *subd;
        enum peer_wire type;
        struct io_plan *(*next_read)(struct io_conn *peer_conn,
-				    struct peer *peer) = read_hdr_from_peer;
-
-       decrypted = cryptomsg_decrypt_body(tmpctx, &peer->cs,
-					  peer->peer_in);
-       if (!decrypted) {
-	       status_peer_debug(&peer->id, "Bad encrypted packet len %zu",
-				 tal_bytelen(peer->peer_in));
-               return io_close(peer_conn);
-       }
-       tal_free(peer->peer_in);
+				    struct peer *peer) = read_from_peer;
 
        type = fromwire_peektype(decrypted);
 
        /* dev_disconnect can disable read */
        if (!peer->dev_read_enabled)
-	       return read_hdr_from_peer(peer_conn, peer);
+	       return read_from_peer(peer_conn, peer);
 
        switch (dev_disconnect_in(&peer->id, type)) {
        case DEV_DISCONNECT_IN_NORMAL:
@@ -1246,24 +1273,53 @@ static struct io_plan *read_body_from_peer_done(struct io_conn *peer_conn,
        return io_wait(peer_conn, &peer->peer_in, next_read, peer);
 }
 
-static struct io_plan *read_body_from_peer(struct io_conn *peer_conn,
+static struct io_plan *read_from_peer_done(struct io_conn *peer_conn,
 					   struct peer *peer)
 {
-       u16 len;
-
-       if (!cryptomsg_decrypt_header(&peer->cs, peer->peer_in, &len))
-               return io_close(peer_conn);
+	peer->peer_in_used += peer->peer_in_len_read;
+	return read_from_peer(peer_conn, peer);
+}
 
-       tal_resize(&peer->peer_in, (u32)len + CRYPTOMSG_BODY_OVERHEAD);
-       return io_read(peer_conn, peer->peer_in, tal_count(peer->peer_in),
-		      read_body_from_peer_done, peer);
+/* Read at least until peer_in holds @needed bytes from peer_in_off. */
+static struct io_plan *read_more_from_peer(struct io_conn *peer_conn,
+					   struct peer *peer,
+					   size_t needed)
+{
+	/* Move any partial message to the front. */
+	memmove(peer->peer_in, peer->peer_in + peer->peer_in_off,
+		peer->peer_in_used - peer->peer_in_off);
+	peer->peer_in_used -= peer->peer_in_off;
+	peer->peer_in_off = 0;
+
+	/* Grow for a large message, shrink back once it's gone. */
+	if (needed > PEER_READ_SIZE)
+		tal_resize(&peer->peer_in, needed);
+	else if (tal_count(peer->peer_in) != PEER_READ_SIZE)
+		tal_resize(&peer->peer_in, PEER_READ_SIZE);
+
+	return io_read_partial(peer_conn,
+			       peer->peer_in + peer->peer_in_used,
+			       tal_count(peer->peer_in) - peer->peer_in_used,
+			       &peer->peer_in_len_read,
+			       read_from_peer_done, peer);
 }
 
-static struct io_plan *read_hdr_from_peer(struct io_conn *peer_conn,
-					  struct peer *peer)
+/*~ Rather than one read() for each header and another for each body, we
+ * read whatever the peer has sent (up to PEER_READ_SIZE) and decrypt
+ * every complete message in it before reading again.  With many peers,
+ * the syscalls were a good part of connectd's time. */
+static struct io_plan *read_from_peer(struct io_conn *peer_conn,
+				      struct peer *peer)
 {
+	const u8 *in;
+	size_t avail;
+	u8 *decrypted;
+
 	assert(peer->to_peer == peer_conn);
 
+	in = peer->peer_in + peer->peer_in_off;
+	avail = peer->peer_in_used - peer->peer_in_off;
+
 	/* BOLT #8:
 	 *
 	 * ### Receiving and Decrypting Messages
@@ -1273,9 +1329,34 @@ static struct io_plan *read_hdr_from_peer(struct io_conn *peer_conn,
 	 *
 	 *  1. Read _exactly_ 18 bytes from the network buffer.
 	 */
-	peer->peer_in = tal_arr(peer, u8, CRYPTOMSG_HDR_SIZE);
-	return io_read(peer_conn, peer->peer_in, CRYPTOMSG_HDR_SIZE,
-		       read_body_from_peer, peer);
+	if (!peer->peer_in_bodylen) {
+		u16 len;
+
+		if (avail < CRYPTOMSG_HDR_SIZE)
+			return read_more_from_peer(peer_conn, peer,
+						   CRYPTOMSG_HDR_SIZE);
+		if (!cryptomsg_decrypt_header(&peer->cs, in, &len))
+			return io_close(peer_conn);
+		peer->peer_in_bodylen = (size_t)len + CRYPTOMSG_BODY_OVERHEAD;
+	}
+
+	if (avail < CRYPTOMSG_HDR_SIZE + peer->peer_in_bodylen)
+		return read_more_from_peer(peer_conn, peer,
+					   CRYPTOMSG_HDR_SIZE
+					   + peer->peer_in_bodylen);
+
+	decrypted = cryptomsg_decrypt_body_len(tmpctx, &peer->cs,
+					       in + CRYPTOMSG_HDR_SIZE,
+					       peer->peer_in_bodylen);
+	if (!decrypted) {
+		status_peer_debug(&peer->id, "Bad encrypted packet len %zu",
+				  peer->peer_in_bodylen);
+		return io_close(peer_conn);
+	}
+	peer->peer_in_off += CRYPTOMSG_HDR_SIZE + peer->peer_in_bodylen;
+	peer->peer_in_bodylen = 0;
+
+	return handle_peer_msg(peer_conn, peer, decrypted);
 }
 
 static struct io_plan *subd_conn_init(struct io_conn *subd_conn,
@@ -1311,6 +1392,8 @@ struct io_plan *multiplex_peer_setup(struct io_conn *peer_conn,
 	 * lightningd to tell us to close with the peer */
 	tal_add_destructor2(peer_conn, destroy_peer_conn, peer);
 
+	peer->peer_in = tal_arr(peer, u8, PEER_READ_SIZE);
+
 	/* Start keepalives */
 	peer->expecting_pong = PONG_UNEXPECTED;
 	set_ping_timer(peer);
@@ -1319,7 +1402,7 @@ struct io_plan *multiplex_peer_setup(struct io_conn *peer_conn,
 	status_peer_debug(&peer->id, "Handed peer, entering loop");
 
 	return io_duplex(peer_conn,
-			 read_hdr_from_peer(peer_conn, peer),
+			 read_from_peer(peer_conn, peer),
 			 write_to_peer(peer_conn, peer));
 }
 
@@ -5,7 +5,7 @@
 #include <common/blindedpath.h>
 #include <common/blinding.h>
 #include <common/daemon_conn.h>
-#include <common/ecdh_hsmd.h>
+#include <common/ecdh.h>
 #include <common/features.h>
 #include <common/onion_message_parse.h>
 #include <common/sphinx.h>
@@ -36,37 +36,69 @@ void onionmsg_req(struct daemon *daemon, const u8 *msg)
 	}
 }
 
+/* Unwrapping an onion message takes two ECDHs with hsmd, the second
+ * depending on the first: this is what we keep while we wait. */
+struct onion_in_progress {
+	struct daemon *daemon;
+	/* NULL if we're injecting, otherwise who sent it to us. */
+	struct node_id *source;
+	/* If injecting: in daemon->onion_injections */
+	struct list_node list;
+	/* If injecting: our reply, once we're done. */
+	const char *reply;
+	struct pubkey path_key;
+	const u8 *onion;
+	struct onionpacket *op;
+	struct secret path_ss;
+};
+
+static void onion_done(struct onion_in_progress *oip, const char *err)
+{
+	struct daemon *daemon = oip->daemon;
+
+	if (oip->source) {
+		tal_free(oip);
+		return;
+	}
+
+	/* lightningd is waiting to hear how its injections went, in order:
+	 * but a bad one can finish before hsmd answers for earlier ones. */
+	oip->reply = tal_strdup(oip, err ? err : "");
+	while ((oip = list_top(&daemon->onion_injections,
+			       struct onion_in_progress, list)) != NULL
+	       && oip->reply) {
+		daemon_conn_send(daemon->master,
+				 take(towire_connectd_inject_onionmsg_reply(NULL, oip->reply)));
+		list_del_from(&daemon->onion_injections, &oip->list);
+		tal_free(oip);
+	}
+}
+
+static void onion_parse_failed(struct onion_in_progress *oip, const char *err)
+{
+	if (oip->source) {
+		daemon_conn_send(oip->daemon->master,
+				 take(towire_connectd_onionmsg_forward_fail(NULL,
+									    oip->source,
+									    oip->onion,
+									    &oip->path_key,
+									    NULL,
+									    NULL)));
+	}
+	onion_done(oip, err);
+}
+
 /* Source is NULL if we're injecting, otherwise it's a forward */
 static const char *handle_onion(const tal_t *ctx,
 				struct daemon *daemon,
 				const struct node_id *source,
 				const struct pubkey *path_key,
-				const u8 *onion)
+				const u8 *onion,
+				u8 *next_onion_msg,
+				const struct sciddir_or_pubkey *next_node,
+				const struct tlv_onionmsg_tlv *final_om,
+				const struct secret *final_path_id)
 {
-	u8 *next_onion_msg;
-	struct sciddir_or_pubkey next_node;
-	struct tlv_onionmsg_tlv *final_om;
-	struct pubkey final_alias;
-	struct secret *final_path_id;
-	const char *err;
-
-	err = onion_message_parse(tmpctx, onion, path_key,
-				  &daemon->mykey,
-				  &next_onion_msg, &next_node,
-				  &final_om, &final_alias, &final_path_id);
-	if (err) {
-		if (source) {
-			daemon_conn_send(daemon->master,
-					 take(towire_connectd_onionmsg_forward_fail(NULL,
-										    source,
-										    onion,
-										    path_key,
-										    NULL,
-										    NULL)));
-		}
-		return tal_steal(ctx, err);
-	}
-
 	if (final_om) {
 		u8 *omsg;
 
@@ -96,10 +128,10 @@ static const char *handle_onion(const tal_t *ctx,
 		 *   - SHOULD forward the message using `onion_message` to the *next peer*.
 		 */
 		/* Since an alias is legal here, we can't simply lookup in gossmap. */
-		if (!next_node.is_pubkey) {
+		if (!next_node->is_pubkey) {
 			struct scid_to_node_id *scid_to_node_id;
 
-			scid_to_node_id = scid_htable_get(daemon->scid_htable, next_node.scidd.scid);
+			scid_to_node_id = scid_htable_get(daemon->scid_htable, next_node->scidd.scid);
 			if (!scid_to_node_id) {
 				if (source) {
 					daemon_conn_send(daemon->master,
@@ -108,14 +140,14 @@ static const char *handle_onion(const tal_t *ctx,
 												    onion,
 												    path_key,
 												    next_onion_msg,
-												    &next_node)));
+												    next_node)));
 				}
 				return tal_fmt(ctx, "onion msg: unknown next scid %s",
-					       fmt_short_channel_id(tmpctx, next_node.scidd.scid));
+					       fmt_short_channel_id(tmpctx, next_node->scidd.scid));
 			}
 			next_node_id = scid_to_node_id->node_id;
 		} else {
-			node_id_from_pubkey(&next_node_id, &next_node.pubkey);
+			node_id_from_pubkey(&next_node_id, &next_node->pubkey);
 		}
 
 		next_peer = peer_htable_get(daemon->peers, &next_node_id);
@@ -127,16 +159,83 @@ static const char *handle_onion(const tal_t *ctx,
 											    onion,
 											    path_key,
 											    next_onion_msg,
-											    &next_node)));
+											    next_node)));
 			}
 			return tal_fmt(ctx, "onion msg: unknown next peer %s",
-				       fmt_sciddir_or_pubkey(tmpctx, &next_node));
+				       fmt_sciddir_or_pubkey(tmpctx, next_node));
 		}
 		inject_peer_msg(next_peer, take(next_onion_msg));
 	}
 	return NULL;
 }
 
+static void got_onion_ss(const struct secret *onion_ss,
+			 struct onion_in_progress *oip)
+{
+	u8 *next_onion_msg;
+	struct sciddir_or_pubkey next_node;
+	struct tlv_onionmsg_tlv *final_om;
+	struct pubkey final_alias;
+	struct secret *final_path_id;
+	const char *err;
+
+	err = onion_message_parse_ss(tmpctx, oip->op, &oip->path_key,
+				     &oip->daemon->mykey,
+				     &oip->path_ss, onion_ss,
+				     &next_onion_msg, &next_node,
+				     &final_om, &final_alias, &final_path_id);
+	if (err) {
+		onion_parse_failed(oip, err);
+		return;
+	}
+
+	err = handle_onion(tmpctx, oip->daemon, oip->source, &oip->path_key,
+			   oip->onion, next_onion_msg, &next_node,
+			   final_om, final_path_id);
+	onion_done(oip, err);
+}
+
+static void got_path_ss(const struct secret *path_ss,
+			struct onion_in_progress *oip)
+{
+	struct pubkey ephemeral = oip->op->ephemeralkey;
+
+	oip->path_ss = *path_ss;
+	if (!unblind_onion_key(&oip->path_ss, &ephemeral)) {
+		onion_parse_failed(oip, "onion_message_parse: can't unblind onionpacket");
+		return;
+	}
+
+	/* Now get onion shared secret and parse it. */
+	ecdh_async(oip, &ephemeral, got_onion_ss, oip);
+}
+
+static void start_onion(struct daemon *daemon,
+			const struct node_id *source,
+			const struct pubkey *path_key,
+			const u8 *onion)
+{
+	struct onion_in_progress *oip = tal(daemon, struct onion_in_progress);
+	const char *err;
+
+	oip->daemon = daemon;
+	oip->source = tal_dup_or_null(oip, struct node_id, source);
+	oip->path_key = *path_key;
+	oip->onion = tal_dup_talarr(oip, u8, onion);
+	if (!source) {
+		oip->reply = NULL;
+		list_add_tail(&daemon->onion_injections, &oip->list);
+	}
+
+	/* Don't bother hsmd if it's not even an onion */
+	err = onion_message_parse_packet(oip, onion, &oip->op);
+	if (err) {
+		onion_parse_failed(oip, err);
+		return;
+	}
+
+	ecdh_async(oip, &oip->path_key, got_path_ss, oip);
+}
 
 /* Peer sends an onion msg. */
 void handle_onion_message(struct daemon *daemon,
@@ -180,21 +279,19 @@ void handle_onion_message(struct daemon *daemon,
 		return;
 	}
 
-	handle_onion(tmpctx, daemon, &peer->id, &path_key, onion);
+	start_onion(daemon, &peer->id, &path_key, onion);
 }
 
 void inject_onionmsg_req(struct daemon *daemon, const u8 *msg)
 {
 	u8 *onionmsg;
 	struct pubkey path_key;
-	const char *err;
 
 	if (!fromwire_connectd_inject_onionmsg(msg, msg, &path_key, &onionmsg))
 		master_badmsg(WIRE_CONNECTD_INJECT_ONIONMSG, msg);
 
-	err = handle_onion(tmpctx, daemon, NULL, &path_key, onionmsg);
-	daemon_conn_send(daemon->master,
-			 take(towire_connectd_inject_onionmsg_reply(NULL, err ? err : "")));
+	/* This replies once it's done. */
+	start_onion(daemon, NULL, &path_key, onionmsg);
 }
 
 
@@ -0,0 +1,166 @@
+#include "config.h"
+#include "../ecdh_async.c"
+#include <assert.h>
+#include <bitcoin/privkey.h>
+#include <bitcoin/pubkey.h>
+#include <ccan/mem/mem.h>
+#include <common/setup.h>
+#include <stdio.h>
+
+/* AUTOGENERATED MOCKS START */
+/* Generated stub for status_failed */
+void status_failed(enum status_failreason code UNNEEDED,
+		   const char *fmt UNNEEDED, ...)
+{ fprintf(stderr, "status_failed called!\n"); abort(); }
+/* AUTOGENERATED MOCKS END */
+
+/* Our fake hsmd: requests are just the point, replies just the secret. */
+static struct io_plan *(*hsmd_recv)(struct io_conn *, const u8 *, void *);
+static void *hsmd_arg;
+static const u8 **hsmd_reqs;
+
+/* We don't have memleak here. */
+void *notleak_(void *ptr, bool plus_children)
+{
+	return ptr;
+}
+
+struct daemon_conn *daemon_conn_new_(const tal_t *ctx, int fd,
+				     struct io_plan *(*recv)(struct io_conn *,
+							     const u8 *,
+							     void *),
+				     void (*outq_empty)(void *),
+				     void *arg)
+{
+	hsmd_recv = recv;
+	hsmd_arg = arg;
+	return (struct daemon_conn *)tal(ctx, char);
+}
+
+void daemon_conn_send(struct daemon_conn *dc, const u8 *msg)
+{
+	tal_arr_expand(&hsmd_reqs, tal_dup_talarr(hsmd_reqs, u8, msg));
+}
+
+struct io_plan *daemon_conn_read_next(struct io_conn *conn,
+				      struct daemon_conn *dc)
+{
+	return NULL;
+}
+
+u8 *towire_hsmd_ecdh_req(const tal_t *ctx, const struct pubkey *point)
+{
+	return tal_dup_arr(ctx, u8, (const u8 *)point, sizeof(*point), 0);
+}
+
+bool fromwire_hsmd_ecdh_resp(const void *p, struct secret *ss)
+{
+	if (tal_bytelen(p) != sizeof(*ss))
+		return false;
+	memcpy(ss, p, sizeof(*ss));
+	return true;
+}
+
+/* hsmd answers with a secret full of @v. */
+static void hsmd_reply(u8 v)
+{
+	u8 *msg = tal_arr(tmpctx, u8, sizeof(struct secret));
+
+	memset(msg, v, tal_bytelen(msg));
+	hsmd_recv(NULL, msg, hsmd_arg);
+}
+
+struct caller {
+	struct secret ss;
+	int called;
+	/* Free ourselves from the callback? */
+	bool free_me;
+};
+
+static void got_ss(const struct secret *ss, struct caller *caller)
+{
+	caller->ss = *ss;
+	caller->called++;
+	if (caller->free_me)
+		tal_free(caller);
+}
+
+static struct caller *new_caller(u8 v, bool free_me)
+{
+	struct caller *caller = tal(tmpctx, struct caller);
+	struct pubkey point;
+
+	memset(&point, v, sizeof(point));
+	caller->called = 0;
+	caller->free_me = free_me;
+	ecdh_async(caller, &point, got_ss, caller);
+
+	/* Request went straight out, without waiting for earlier ones. */
+	assert(tal_count(hsmd_reqs) != 0);
+	assert(memeq(hsmd_reqs[tal_count(hsmd_reqs) - 1],
+		     tal_bytelen(hsmd_reqs[tal_count(hsmd_reqs) - 1]),
+		     &point, sizeof(point)));
+	return caller;
+}
+
+static bool secret_is(const struct secret *ss, u8 v)
+{
+	for (size_t i = 0; i < sizeof(ss->data); i++)
+		if (ss->data[i] != v)
+			return false;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	struct caller *a, *b, *d;
+	const tal_t *ctx;
+
+	common_setup(argv[0]);
+
+	ctx = tal(NULL, char);
+	hsmd_reqs = tal_arr(ctx, const u8 *, 0);
+	ecdh_async_setup(ctx, -1);
+
+	/* Four requests in flight at once. */
+	a = new_caller(1, false);
+	b = new_caller(2, false);
+	new_caller(3, true);
+	d = new_caller(4, false);
+	assert(tal_count(hsmd_reqs) == 4);
+
+	/* b goes away before its answer arrives. */
+	tal_free(b);
+
+	/* Replies are matched in order. */
+	hsmd_reply(1);
+	assert(a->called == 1);
+	assert(secret_is(&a->ss, 1));
+	assert(d->called == 0);
+
+	/* b's reply is eaten, and not given to c. */
+	hsmd_reply(2);
+	assert(a->called == 1);
+	assert(d->called == 0);
+
+	/* c frees itself in the callback: that's fine. */
+	hsmd_reply(3);
+	assert(d->called == 0);
+
+	hsmd_reply(4);
+	assert(a->called == 1);
+	assert(d->called == 1);
+	assert(secret_is(&d->ss, 4));
+	assert(list_empty(&ecdh_async->pending));
+
+	/* New requests after draining still work. */
+	a = new_caller(5, false);
+	hsmd_reply(5);
+	assert(a->called == 1);
+	assert(secret_is(&a->ss, 5));
+
+	/* Otherwise it thinks hsmd died! */
+	tal_del_destructor(ecdh_async->hsmd, hsmd_gone);
+	tal_free(ctx);
+	common_shutdown();
+}
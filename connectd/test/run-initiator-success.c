@@ -302,6 +302,17 @@ void ecdh(const struct pubkey *point, struct secret *ss)
 		abort();
 }
 
+void ecdh_async_(const tal_t *ctx,
+		 const struct pubkey *point,
+		 void (*cb)(const struct secret *ss, void *arg),
+		 void *arg)
+{
+	struct secret ss;
+
+	ecdh(point, &ss);
+	cb(&ss, arg);
+}
+
 int main(int argc, char *argv[])
 {
 	struct wireaddr_internal dummy;
@@ -57,7 +57,8 @@ void db_bind_talarr(struct db_stmt *stmt, const u8 *arr);
 
 /* Modern variants: get columns by name from SELECT */
 /* Bridge function to get column number from SELECT
-   (must exist) */
+   (must exist).  colname must be a string literal (or otherwise never
+   change while the program runs): lookups are memoized by address. */
 size_t db_query_colnum(const struct db_stmt *stmt, const char *colname);
 
 int db_col_is_null(struct db_stmt *stmt, const char *colname);
@@ -67,6 +67,10 @@ struct db {
 
 	/* Fatal if we try to write to db */
 	bool readonly;
+
+	/* How often the driver could reuse a compiled statement, and
+	 * how often it had to compile one (if it caches at all). */
+	u64 stmt_cache_hits, stmt_cache_misses;
 };
 
 struct db_query {
@@ -84,6 +88,10 @@ struct db_query {
 	/* If this is a select statement, what column names */
 	const struct sqlname_map *colnames;
 	size_t num_colnames;
+
+	/* Same size as colnames: remembers which column each colname
+	 * *pointer* resolved to, so repeated lookups skip the hashing. */
+	struct sqlname_map *colname_memo;
 };
 
 enum db_binding_type {
@@ -202,7 +210,8 @@ AUTODATA_TYPE(db_backends, struct db_config);
 /* Provide a way for DB query sets to register themselves */
 AUTODATA_TYPE(db_queries, struct db_query_set);
 
-/* devtools/sql-rewrite.py generates this simple htable */
+/* devtools/sql-rewrite.py generates this simple htable (and an empty
+ * one of the same size for db_query.colname_memo) */
 struct sqlname_map {
 	const char *sqlname;
 	int val;
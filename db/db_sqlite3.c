@@ -14,6 +14,11 @@ struct db_sqlite3 {
 	sqlite3 *conn;
 	/* A replica db connection, if requested, or NULL otherwise.  */
 	sqlite3 *backup_conn;
+	/* Compiled statements, indexed like db->queries->query_table.
+	 * A slot is NULL while its statement is in use (or never
+	 * prepared), so nested uses of the same query simply prepare a
+	 * fresh one. */
+	sqlite3_stmt **stmt_cache;
 };
 
 /**
@@ -108,6 +113,19 @@ static void trace_sqlite3(void *stmtv, const char *stmt)
 }
 #endif
 
+/* Only queries from the static query table are cached: the ones from
+ * db_prepare_untranslated() are transient, and so is their address. */
+static bool stmt_cache_index(const struct db_stmt *stmt, size_t *idx)
+{
+	const struct db_query_set *queries = stmt->db->queries;
+
+	if (stmt->query < queries->query_table
+	    || stmt->query >= queries->query_table + queries->query_table_size)
+		return false;
+	*idx = stmt->query - queries->query_table;
+	return true;
+}
+
 static const char *db_sqlite3_fmt_error(struct db_stmt *stmt)
 {
 	return tal_fmt(stmt, "%s: %s: %s", stmt->location, stmt->query->query,
@@ -139,6 +157,8 @@ static bool db_sqlite3_setup(struct db *db)
 	}
 
 	wrapper = tal(db, struct db_sqlite3);
+	wrapper->stmt_cache = tal_arrz(wrapper, sqlite3_stmt *,
+				       db->queries->query_table_size);
 	db->conn = wrapper;
 
 	err = sqlite3_open_v2(filename, &sql, flags, NULL);
@@ -220,11 +240,23 @@ static bool db_sqlite3_setup(struct db *db)
 
 static bool db_sqlite3_query(struct db_stmt *stmt)
 {
-	sqlite3_stmt *s;
-	sqlite3 *conn = conn2sql(stmt->db->conn);
+	sqlite3_stmt *s = NULL;
+	struct db_sqlite3 *wrapper = (struct db_sqlite3 *) stmt->db->conn;
+	size_t idx;
 	int err;
 
-	err = sqlite3_prepare_v2(conn, stmt->query->query, -1, &s, NULL);
+	/* Statements are reset and their bindings cleared before they go
+	 * back into the cache, so we can use them as is. */
+	if (stmt_cache_index(stmt, &idx) && wrapper->stmt_cache[idx]) {
+		s = wrapper->stmt_cache[idx];
+		wrapper->stmt_cache[idx] = NULL;
+		stmt->db->stmt_cache_hits++;
+		err = SQLITE_OK;
+	} else {
+		err = sqlite3_prepare_v2(wrapper->conn, stmt->query->query,
+					 -1, &s, NULL);
+		stmt->db->stmt_cache_misses++;
+	}
 
 	for (size_t i=0; i<stmt->query->placeholders; i++) {
 		struct db_binding *b = &stmt->bindings[i];
@@ -392,9 +424,22 @@ static const unsigned char *db_sqlite3_column_text(struct db_stmt *stmt, int col
 
 static void db_sqlite3_stmt_free(struct db_stmt *stmt)
 {
-	if (stmt->inner_stmt)
-		sqlite3_finalize(stmt->inner_stmt);
+	struct db_sqlite3 *wrapper = (struct db_sqlite3 *) stmt->db->conn;
+	sqlite3_stmt *s = stmt->inner_stmt;
+	size_t idx;
+
+	if (!s)
+		return;
 	stmt->inner_stmt = NULL;
+
+	/* Keep it for next time, unless someone else already did. */
+	if (stmt_cache_index(stmt, &idx) && !wrapper->stmt_cache[idx]) {
+		sqlite3_reset(s);
+		sqlite3_clear_bindings(s);
+		wrapper->stmt_cache[idx] = s;
+		return;
+	}
+	sqlite3_finalize(s);
 }
 
 static size_t db_sqlite3_count_changes(struct db_stmt *stmt)
@@ -407,6 +452,10 @@ static void db_sqlite3_close(struct db *db)
 {
 	struct db_sqlite3 *wrapper = (struct db_sqlite3 *) db->conn;
 
+	/* sqlite3_close() refuses to close with unfinalized statements */
+	for (size_t i = 0; i < tal_count(wrapper->stmt_cache); i++)
+		sqlite3_finalize(wrapper->stmt_cache[i]);
+
 	if (wrapper->backup_conn)
 		sqlite3_close(wrapper->backup_conn);
 	sqlite3_close(wrapper->conn);
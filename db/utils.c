@@ -14,13 +14,11 @@ static u32 hash_djb2(const char *str)
 	return hash;
 }
 
-size_t db_query_colnum(const struct db_stmt *stmt,
-		       const char *colname)
+static size_t db_query_colnum_slow(const struct db_stmt *stmt,
+				   const char *colname)
 {
 	u32 col;
 
-	assert(stmt->query->colnames != NULL);
-
 	col = hash_djb2(colname) % stmt->query->num_colnames;
 	for (;;) {
 		const char *n = stmt->query->colnames[col].sqlname;
@@ -31,11 +29,35 @@ size_t db_query_colnum(const struct db_stmt *stmt,
 			break;
 		col = (col + 1) % stmt->query->num_colnames;
 	}
+	return stmt->query->colnames[col].val;
+}
+
+size_t db_query_colnum(const struct db_stmt *stmt,
+		       const char *colname)
+{
+	struct sqlname_map *memo;
+	int val;
+
+	assert(stmt->query->colnames != NULL);
+
+	/* Callers hand us string literals, so the same pointer always
+	 * means the same column: a hit is a single load. */
+	memo = &stmt->query->colname_memo[(uintptr_t)colname
+					  % stmt->query->num_colnames];
+	if (memo->sqlname == colname) {
+		val = memo->val;
+		if (stmt->db->developer)
+			assert(val == db_query_colnum_slow(stmt, colname));
+	} else {
+		val = db_query_colnum_slow(stmt, colname);
+		memo->sqlname = colname;
+		memo->val = val;
+	}
 
 	if (stmt->db->developer)
 		strset_add(stmt->cols_used, colname);
 
-	return stmt->query->colnames[col].val;
+	return val;
 }
 
 static void db_stmt_free(struct db_stmt *stmt)
@@ -129,6 +151,7 @@ struct db_stmt *db_prepare_untranslated(struct db *db, const char *query)
 	/* Use raw accessors! */
 	db_query->colnames = NULL;
 	db_query->num_colnames = 0;
+	db_query->colname_memo = NULL;
 
 	stmt = db_prepare_core(db, "db_prepare_untranslated", db_query);
 	tal_steal(stmt, db_query);
@@ -345,6 +368,7 @@ struct db *db_open_(const tal_t *ctx, const char *filename,
 	db->errorfn = errorfn;
 	db->errorfn_arg = arg;
 	db->readonly = false;
+	db->stmt_cache_hits = db->stmt_cache_misses = 0;
 	list_head_init(&db->pending_statements);
 	if (!strstr(db->filename, "://"))
 		db_fatal(db, "Could not extract driver name from \"%s\"", db->filename);
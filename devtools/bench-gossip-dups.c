@@ -0,0 +1,367 @@
+/* Offline benchmark for gossipd's handling of gossip it already has.
+ *
+ * When syncing from several peers, most channel_announcements and
+ * channel_updates we get are duplicates.  gossmap_manage now spots those
+ * with a gossmap lookup before checking signatures: this compares the cost
+ * of that lookup with the signature checks it saves.  We make up signed
+ * gossip, so we need neither bitcoind nor a real network dump. */
+#include "config.h"
+#include <bitcoin/privkey.h>
+#include <bitcoin/pubkey.h>
+#include <bitcoin/signature.h>
+#include <ccan/crc32c/crc32c.h>
+#include <ccan/err/err.h>
+#include <ccan/mem/mem.h>
+#include <ccan/opt/opt.h>
+#include <ccan/read_write_all/read_write_all.h>
+#include <ccan/tal/str/str.h>
+#include <ccan/time/time.h>
+#include <common/gossip_store.h>
+#include <common/gossmap.h>
+#include <common/node_id.h>
+#include <common/setup.h>
+#include <common/utils.h>
+#include <fcntl.h>
+#include <gossipd/gossip_store_wiregen.h>
+#include <gossipd/sigcheck.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <wire/peer_wiregen.h>
+
+#define GOSSIP_STORE_VER ((0 << 5) | 14)
+
+struct fakenode {
+	struct privkey privkey;
+	struct pubkey pubkey;
+	struct node_id id;
+};
+
+static struct fakenode *make_nodes(const tal_t *ctx, size_t num_nodes)
+{
+	struct fakenode *nodes = tal_arr(ctx, struct fakenode, num_nodes);
+
+	for (size_t i = 0; i < num_nodes; i++) {
+		u64 idx = i;
+
+		memset(&nodes[i].privkey, 1, sizeof(nodes[i].privkey));
+		memcpy(&nodes[i].privkey, &idx, sizeof(idx));
+		if (!pubkey_from_privkey(&nodes[i].privkey, &nodes[i].pubkey))
+			abort();
+		node_id_from_pubkey(&nodes[i].id, &nodes[i].pubkey);
+	}
+	return nodes;
+}
+
+static void write_msg_to_gstore(int outfd, const u8 *msg, u32 timestamp)
+{
+	struct gossip_hdr hdr;
+
+	hdr.flags = 0;
+	hdr.len = cpu_to_be16(tal_bytelen(msg));
+	hdr.timestamp = cpu_to_be32(timestamp);
+	hdr.crc = cpu_to_be32(crc32c(timestamp, msg, tal_bytelen(msg)));
+
+	if (!write_all(outfd, &hdr, sizeof(hdr))
+	    || !write_all(outfd, msg, tal_bytelen(msg))) {
+		err(1, "Writing gossip_store");
+	}
+}
+
+/* Everything after the first @offset bytes gets signed. */
+static void sign_msg(const u8 *msg, size_t offset,
+		     const struct privkey *privkey,
+		     secp256k1_ecdsa_signature *sig)
+{
+	struct sha256_double hash;
+
+	sha256_double(&hash, msg + offset, tal_bytelen(msg) - offset);
+	sign_hash(privkey, &hash, sig);
+}
+
+/* Node keys double as bitcoin keys: it's the same work to check. */
+static u8 *make_cannounce(const tal_t *ctx,
+			  const struct bitcoin_blkid *chain_hash,
+			  struct short_channel_id scid,
+			  const struct fakenode *n1,
+			  const struct fakenode *n2)
+{
+	secp256k1_ecdsa_signature sig1, sig2;
+	u8 *msg;
+
+	if (node_id_cmp(&n1->id, &n2->id) > 0) {
+		const struct fakenode *tmp = n1;
+		n1 = n2;
+		n2 = tmp;
+	}
+
+	memset(&sig1, 0, sizeof(sig1));
+	msg = towire_channel_announcement(tmpctx, &sig1, &sig1, &sig1, &sig1,
+					  NULL, chain_hash, scid,
+					  &n1->id, &n2->id,
+					  &n1->pubkey, &n2->pubkey);
+	/* 2 byte msg type + 256 byte signatures */
+	sign_msg(msg, 258, &n1->privkey, &sig1);
+	sign_msg(msg, 258, &n2->privkey, &sig2);
+	return towire_channel_announcement(ctx, &sig1, &sig2, &sig1, &sig2,
+					   NULL, chain_hash, scid,
+					   &n1->id, &n2->id,
+					   &n1->pubkey, &n2->pubkey);
+}
+
+static u8 *make_cupdate(const tal_t *ctx,
+			const struct bitcoin_blkid *chain_hash,
+			struct short_channel_id scid,
+			const struct fakenode *from,
+			const struct fakenode *to,
+			u32 timestamp)
+{
+	secp256k1_ecdsa_signature sig;
+	int dir = node_id_idx(&from->id, &to->id);
+	u8 *msg;
+
+	memset(&sig, 0, sizeof(sig));
+	msg = towire_channel_update(tmpctx, &sig, chain_hash, scid,
+				    timestamp, ROUTING_OPT_HTLC_MAX_MSAT, dir,
+				    6, AMOUNT_MSAT(1000), 1000, 10,
+				    AMOUNT_MSAT(100000000));
+	/* 2 byte msg type + 64 byte signature */
+	sign_msg(msg, 66, &from->privkey, &sig);
+	return towire_channel_update(ctx, &sig, chain_hash, scid,
+				     timestamp, ROUTING_OPT_HTLC_MAX_MSAT, dir,
+				     6, AMOUNT_MSAT(1000), 1000, 10,
+				     AMOUNT_MSAT(100000000));
+}
+
+static void report(const char *what, struct timerel elapsed, size_t ops)
+{
+	printf("%-36s %12"PRIu64" ns/op (%zu ops)\n",
+	       what, time_to_nsec(elapsed) / (ops ? ops : 1), ops);
+}
+
+/* What gossmap_manage_channel_announcement() does for a known one. */
+static bool cannounce_known(struct gossmap *map, const u8 *msg)
+{
+	secp256k1_ecdsa_signature sigs[4];
+	u8 *features;
+	struct bitcoin_blkid chain_hash;
+	struct short_channel_id scid;
+	struct node_id ids[2];
+	struct pubkey keys[2];
+
+	if (!fromwire_channel_announcement(tmpctx, msg,
+					   &sigs[0], &sigs[1],
+					   &sigs[2], &sigs[3],
+					   &features, &chain_hash, &scid,
+					   &ids[0], &ids[1],
+					   &keys[0], &keys[1]))
+		abort();
+	return gossmap_find_chan(map, &scid) != NULL;
+}
+
+static const char *cannounce_sigcheck(const u8 *msg)
+{
+	secp256k1_ecdsa_signature sigs[4];
+	u8 *features;
+	struct bitcoin_blkid chain_hash;
+	struct short_channel_id scid;
+	struct node_id ids[2];
+	struct pubkey keys[2];
+
+	if (!fromwire_channel_announcement(tmpctx, msg,
+					   &sigs[0], &sigs[1],
+					   &sigs[2], &sigs[3],
+					   &features, &chain_hash, &scid,
+					   &ids[0], &ids[1],
+					   &keys[0], &keys[1]))
+		abort();
+	return sigcheck_channel_announcement(tmpctx, &ids[0], &ids[1],
+					     &keys[0], &keys[1],
+					     &sigs[0], &sigs[1],
+					     &sigs[2], &sigs[3],
+					     msg);
+}
+
+/* What process_channel_update() does for one we have. */
+static bool cupdate_known(struct gossmap *map, const u8 *msg)
+{
+	secp256k1_ecdsa_signature sig;
+	struct bitcoin_blkid chain_hash;
+	struct short_channel_id scid;
+	u32 timestamp, fee_base, fee_ppm;
+	u8 message_flags, channel_flags;
+	u16 cltv_delta;
+	struct amount_msat htlc_min, htlc_max;
+	struct gossmap_chan *chan;
+	int dir;
+
+	if (!fromwire_channel_update(msg, &sig, &chain_hash, &scid,
+				     &timestamp, &message_flags,
+				     &channel_flags, &cltv_delta,
+				     &htlc_min, &fee_base, &fee_ppm,
+				     &htlc_max))
+		abort();
+	chan = gossmap_find_chan(map, &scid);
+	if (!chan)
+		return false;
+	dir = channel_flags & ROUTING_FLAGS_DIRECTION;
+	return gossmap_chan_set(chan, dir)
+		&& tal_arr_eq(msg, gossmap_chan_get_update(tmpctx, map,
+							   chan, dir));
+}
+
+static const char *cupdate_sigcheck(const struct node_id *id, const u8 *msg)
+{
+	secp256k1_ecdsa_signature sig;
+	struct bitcoin_blkid chain_hash;
+	struct short_channel_id scid;
+	u32 timestamp, fee_base, fee_ppm;
+	u8 message_flags, channel_flags;
+	u16 cltv_delta;
+	struct amount_msat htlc_min, htlc_max;
+
+	if (!fromwire_channel_update(msg, &sig, &chain_hash, &scid,
+				     &timestamp, &message_flags,
+				     &channel_flags, &cltv_delta,
+				     &htlc_min, &fee_base, &fee_ppm,
+				     &htlc_max))
+		abort();
+	return sigcheck_channel_update(tmpctx, id, &sig, msg);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int num_nodes = 1000, num_chans = 10000;
+	unsigned int iterations = 5;
+	char *filename = NULL;
+	const u8 version = GOSSIP_STORE_VER;
+	struct bitcoin_blkid chain_hash;
+	struct fakenode *nodes;
+	const u8 **anns, **upds;
+	const struct node_id **upd_ids;
+	struct gossmap *map;
+	struct timemono start;
+	struct timerel known_time, check_time;
+	int fd;
+
+	common_setup(argv[0]);
+
+	opt_register_arg("--nodes", opt_set_uintval, opt_show_uintval,
+			 &num_nodes, "Number of nodes to create");
+	opt_register_arg("--channels", opt_set_uintval, opt_show_uintval,
+			 &num_chans, "Number of channels to create");
+	opt_register_arg("--iterations", opt_set_uintval, opt_show_uintval,
+			 &iterations, "How many times to re-feed each message");
+	opt_register_noarg("--help|-h", opt_usage_and_exit,
+			   "\n"
+			   "Benchmark gossipd's duplicate gossip checks",
+			   "Print this message.");
+	opt_parse(&argc, argv, opt_log_stderr_exit);
+	if (argc != 1)
+		opt_usage_exit_fail("No arguments expected");
+	if (num_nodes < 2)
+		opt_usage_exit_fail("Need at least 2 nodes");
+
+	filename = tal_strdup(tmpctx, "/tmp/bench-gossip-dups.XXXXXX");
+	fd = mkstemp(filename);
+	if (fd < 0)
+		err(1, "Creating %s", filename);
+
+	start = time_mono();
+	memset(&chain_hash, 0, sizeof(chain_hash));
+	nodes = make_nodes(tmpctx, num_nodes);
+	anns = tal_arr(tmpctx, const u8 *, num_chans);
+	upds = tal_arr(tmpctx, const u8 *, num_chans);
+	upd_ids = tal_arr(tmpctx, const struct node_id *, num_chans);
+	if (!write_all(fd, &version, sizeof(version)))
+		err(1, "Writing version");
+	for (size_t i = 0; i < num_chans; i++) {
+		/* Never a channel to itself */
+		size_t skip = 1 + (i / num_nodes) % (num_nodes - 1);
+		const struct fakenode *n1 = &nodes[i % num_nodes];
+		const struct fakenode *n2 = &nodes[(i + skip) % num_nodes];
+		struct short_channel_id scid;
+
+		if (!mk_short_channel_id(&scid, 100000 + i / 1000,
+					 i % 1000, 0))
+			abort();
+
+		anns[i] = make_cannounce(anns, &chain_hash, scid, n1, n2);
+		write_msg_to_gstore(fd, anns[i], 0);
+		write_msg_to_gstore(fd,
+				    towire_gossip_store_channel_amount(tmpctx,
+								       AMOUNT_SAT(100000)),
+				    0);
+		upds[i] = make_cupdate(upds, &chain_hash, scid, n1, n2, 1000);
+		upd_ids[i] = &n1->id;
+		write_msg_to_gstore(fd, upds[i], 1000);
+		clean_tmpctx();
+	}
+	printf("Created %u signed channels in %s (%"PRIu64" msec)\n",
+	       num_chans, filename, time_to_msec(timemono_since(start)));
+
+	map = gossmap_load(tmpctx, filename, NULL, NULL);
+	if (!map)
+		err(1, "Loading %s", filename);
+
+	/* channel_announcements */
+	start = time_mono();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < num_chans; i++) {
+			if (!cannounce_known(map, anns[i]))
+				errx(1, "channel_announcement %zu not found", i);
+		}
+		clean_tmpctx();
+	}
+	known_time = timemono_since(start);
+	report("channel_announcement lookup", known_time,
+	       iterations * num_chans);
+
+	start = time_mono();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < num_chans; i++) {
+			if (cannounce_sigcheck(anns[i]))
+				errx(1, "channel_announcement %zu bad sig", i);
+		}
+		clean_tmpctx();
+	}
+	check_time = timemono_since(start);
+	report("channel_announcement sigcheck", check_time,
+	       iterations * num_chans);
+	printf("  => %.1fx cheaper to skip\n",
+	       (double)time_to_nsec(check_time)
+	       / (time_to_nsec(known_time) ? time_to_nsec(known_time) : 1));
+
+	/* channel_updates */
+	start = time_mono();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < num_chans; i++) {
+			if (!cupdate_known(map, upds[i]))
+				errx(1, "channel_update %zu not found", i);
+		}
+		clean_tmpctx();
+	}
+	known_time = timemono_since(start);
+	report("channel_update lookup", known_time,
+	       iterations * num_chans);
+
+	start = time_mono();
+	for (size_t it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < num_chans; i++) {
+			if (cupdate_sigcheck(upd_ids[i], upds[i]))
+				errx(1, "channel_update %zu bad sig", i);
+		}
+		clean_tmpctx();
+	}
+	check_time = timemono_since(start);
+	report("channel_update sigcheck", check_time,
+	       iterations * num_chans);
+	printf("  => %.1fx cheaper to skip\n",
+	       (double)time_to_nsec(check_time)
+	       / (time_to_nsec(known_time) ? time_to_nsec(known_time) : 1));
+
+	close(fd);
+	unlink(filename);
+	common_shutdown();
+	return 0;
+}
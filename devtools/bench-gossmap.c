@@ -0,0 +1,360 @@
+/* Offline benchmark for common/gossmap.c on a large synthetic gossip_store.
+ *
+ * Every daemon and plugin which routes mmaps the gossip_store through
+ * gossmap, so this is where a slowdown hurts everyone.  We don't need
+ * bitcoind or a real network dump: we make up a graph which looks roughly
+ * like the real one (a few big hubs, a long tail of small nodes), write it
+ * out in gossip_store format, and time the operations users hit. */
+#include "config.h"
+#include <bitcoin/privkey.h>
+#include <bitcoin/pubkey.h>
+#include <ccan/crc32c/crc32c.h>
+#include <ccan/err/err.h>
+#include <ccan/opt/opt.h>
+#include <ccan/read_write_all/read_write_all.h>
+#include <ccan/tal/str/str.h>
+#include <ccan/time/time.h>
+#include <common/gossip_store.h>
+#include <common/gossmap.h>
+#include <common/node_id.h>
+#include <common/setup.h>
+#include <common/utils.h>
+#include <fcntl.h>
+#include <gossipd/gossip_store_wiregen.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <wire/peer_wiregen.h>
+
+#define GOSSIP_STORE_VER ((0 << 5) | 14)
+
+struct fakenode {
+	struct pubkey pubkey;
+	struct node_id id;
+};
+
+/* Deterministic, so runs are comparable. */
+static u64 prng_state = 0x5eed5eed5eed5eedULL;
+static u64 prng(void)
+{
+	/* xorshift64* */
+	prng_state ^= prng_state >> 12;
+	prng_state ^= prng_state << 25;
+	prng_state ^= prng_state >> 27;
+	return prng_state * 2685821657736338717ULL;
+}
+
+static struct fakenode *make_nodes(const tal_t *ctx, size_t num_nodes)
+{
+	struct fakenode *nodes = tal_arr(ctx, struct fakenode, num_nodes);
+
+	for (size_t i = 0; i < num_nodes; i++) {
+		struct secret seckey;
+		u64 idx = i;
+
+		memset(&seckey, 1, sizeof(seckey));
+		memcpy(&seckey, &idx, sizeof(idx));
+		if (!pubkey_from_secret(&seckey, &nodes[i].pubkey))
+			abort();
+		node_id_from_pubkey(&nodes[i].id, &nodes[i].pubkey);
+	}
+	return nodes;
+}
+
+static void write_msg_to_gstore(int outfd, const u8 *msg TAKES)
+{
+	struct gossip_hdr hdr;
+
+	hdr.flags = 0;
+	hdr.len = cpu_to_be16(tal_bytelen(msg));
+	hdr.timestamp = 0;
+	hdr.crc = cpu_to_be32(crc32c(0, msg, tal_bytelen(msg)));
+
+	if (!write_all(outfd, &hdr, sizeof(hdr))
+	    || !write_all(outfd, msg, tal_bytelen(msg))) {
+		err(1, "Writing gossip_store");
+	}
+	if (taken(msg))
+		tal_free(msg);
+}
+
+/* Preferential attachment, roughly: half the time we pick an endpoint of an
+ * existing channel, so well-connected nodes get more connected. */
+static size_t pick_node(const size_t *endpoints, size_t num_endpoints,
+			size_t num_nodes)
+{
+	if (num_endpoints && prng() % 2)
+		return endpoints[prng() % num_endpoints];
+	return prng() % num_nodes;
+}
+
+static void write_channel(int outfd,
+			  const struct fakenode *nodes,
+			  size_t n1, size_t n2, size_t chanidx)
+{
+	secp256k1_ecdsa_signature sig;
+	struct bitcoin_blkid chain_hash;
+	struct short_channel_id scid;
+	const struct fakenode *lesser, *greater;
+	struct amount_sat capacity;
+	u8 *msg;
+
+	memset(&sig, 0, sizeof(sig));
+	memset(&chain_hash, 0, sizeof(chain_hash));
+
+	/* chanidx makes it unique, even for parallel channels */
+	if (!mk_short_channel_id(&scid, 100000 + chanidx / 1000,
+				 chanidx % 1000, 0))
+		abort();
+
+	if (pubkey_cmp(&nodes[n1].pubkey, &nodes[n2].pubkey) < 0) {
+		lesser = &nodes[n1];
+		greater = &nodes[n2];
+	} else {
+		lesser = &nodes[n2];
+		greater = &nodes[n1];
+	}
+
+	msg = towire_channel_announcement(NULL, &sig, &sig, &sig, &sig,
+					  NULL, &chain_hash, scid,
+					  &lesser->id, &greater->id,
+					  &lesser->pubkey, &greater->pubkey);
+	write_msg_to_gstore(outfd, take(msg));
+
+	capacity = amount_sat(100000 + prng() % 100000000);
+	write_msg_to_gstore(outfd,
+			    take(towire_gossip_store_channel_amount(NULL,
+								    capacity)));
+
+	for (int dir = 0; dir < 2; dir++) {
+		struct amount_msat htlc_max;
+
+		if (!amount_sat_to_msat(&htlc_max, capacity))
+			abort();
+		/* A few are disabled, like real life. */
+		msg = towire_channel_update(NULL, &sig, &chain_hash, scid,
+					    1, 1,
+					    dir | ((prng() % 20 == 0) ? 2 : 0),
+					    6 + prng() % 144,
+					    AMOUNT_MSAT(1000),
+					    prng() % 2000,
+					    prng() % 2000,
+					    htlc_max);
+		write_msg_to_gstore(outfd, take(msg));
+	}
+}
+
+static void write_channels(int outfd,
+			   const struct fakenode *nodes,
+			   size_t num_nodes,
+			   size_t **endpoints,
+			   size_t start, size_t num)
+{
+	for (size_t i = start; i < start + num; i++) {
+		size_t n1, n2;
+
+		n1 = pick_node(*endpoints, tal_count(*endpoints), num_nodes);
+		do {
+			n2 = pick_node(*endpoints, tal_count(*endpoints),
+				       num_nodes);
+		} while (n2 == n1);
+
+		write_channel(outfd, nodes, n1, n2, i);
+		tal_arr_expand(endpoints, n1);
+		tal_arr_expand(endpoints, n2);
+	}
+}
+
+static void report(const char *what, struct timerel elapsed, size_t ops)
+{
+	printf("%-28s %12"PRIu64" ns/op (%zu ops)\n",
+	       what, time_to_nsec(elapsed) / (ops ? ops : 1), ops);
+}
+
+static long peak_rss_kb(void)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) != 0)
+		err(1, "getrusage");
+	return ru.ru_maxrss;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int num_nodes = 20000, num_chans = 100000;
+	unsigned int iterations = 5, num_localmods = 1000;
+	unsigned int refresh_chans = 1000;
+	char *filename = NULL;
+	bool keep = false;
+	const u8 version = GOSSIP_STORE_VER;
+	struct fakenode *nodes;
+	size_t *endpoints;
+	struct gossmap *map;
+	struct gossmap_localmods *mods;
+	struct timemono start;
+	struct timerel refresh_time;
+	size_t count;
+	int fd;
+
+	common_setup(argv[0]);
+
+	opt_register_arg("--nodes", opt_set_uintval, opt_show_uintval,
+			 &num_nodes, "Number of nodes to create");
+	opt_register_arg("--channels", opt_set_uintval, opt_show_uintval,
+			 &num_chans, "Number of channels to create");
+	opt_register_arg("--iterations", opt_set_uintval, opt_show_uintval,
+			 &iterations, "How many times to repeat each test");
+	opt_register_arg("--localmods", opt_set_uintval, opt_show_uintval,
+			 &num_localmods, "Number of channel_updates in localmods");
+	opt_register_arg("--refresh-channels", opt_set_uintval, opt_show_uintval,
+			 &refresh_chans, "Channels appended before each refresh");
+	opt_register_arg("--file", opt_set_charp, NULL, &filename,
+			 "gossip_store to write (default: temporary file)");
+	opt_register_noarg("--keep", opt_set_bool, &keep,
+			   "Don't delete the gossip_store afterwards");
+	opt_register_noarg("--help|-h", opt_usage_and_exit,
+			   "\n"
+			   "Benchmark gossmap on a synthetic gossip_store",
+			   "Print this message.");
+	opt_parse(&argc, argv, opt_log_stderr_exit);
+	if (argc != 1)
+		opt_usage_exit_fail("No arguments expected");
+	if (num_nodes < 2)
+		opt_usage_exit_fail("Need at least 2 nodes");
+
+	if (filename)
+		fd = open(filename, O_RDWR|O_CREAT|O_TRUNC, 0600);
+	else {
+		filename = tal_strdup(tmpctx, "/tmp/bench-gossmap.XXXXXX");
+		fd = mkstemp(filename);
+	}
+	if (fd < 0)
+		err(1, "Creating %s", filename);
+
+	start = time_mono();
+	nodes = make_nodes(tmpctx, num_nodes);
+	endpoints = tal_arr(tmpctx, size_t, 0);
+	if (!write_all(fd, &version, sizeof(version)))
+		err(1, "Writing version");
+	write_channels(fd, nodes, num_nodes, &endpoints, 0, num_chans);
+	printf("Created %u nodes, %u channels in %s (%"PRIu64" msec)\n",
+	       num_nodes, num_chans, filename,
+	       time_to_msec(timemono_since(start)));
+
+	/* Load from scratch. */
+	start = time_mono();
+	for (size_t i = 0; i < iterations; i++)
+		tal_free(gossmap_load(NULL, filename, NULL, NULL));
+	report("gossmap_load", timemono_since(start), iterations);
+
+	map = gossmap_load(tmpctx, filename, NULL, NULL);
+	if (!map)
+		err(1, "Loading %s", filename);
+	printf("Loaded %zu nodes, %zu channels\n",
+	       gossmap_num_nodes(map), gossmap_num_chans(map));
+
+	/* Iteration. */
+	start = time_mono();
+	count = 0;
+	for (size_t i = 0; i < iterations; i++) {
+		for (struct gossmap_node *n = gossmap_first_node(map);
+		     n;
+		     n = gossmap_next_node(map, n))
+			count += n->num_chans;
+	}
+	report("node iteration", timemono_since(start),
+	       iterations * gossmap_num_nodes(map));
+
+	start = time_mono();
+	for (size_t i = 0; i < iterations; i++) {
+		for (struct gossmap_chan *c = gossmap_first_chan(map);
+		     c;
+		     c = gossmap_next_chan(map, c))
+			count += c->half[0].enabled + c->half[1].enabled;
+	}
+	report("channel iteration", timemono_since(start),
+	       iterations * gossmap_num_chans(map));
+
+	start = time_mono();
+	for (size_t i = 0; i < iterations; i++) {
+		for (struct gossmap_node *n = gossmap_first_node(map);
+		     n;
+		     n = gossmap_next_node(map, n)) {
+			for (size_t j = 0; j < n->num_chans; j++) {
+				int dir;
+				struct gossmap_chan *c;
+				c = gossmap_nth_chan(map, n, j, &dir);
+				count += gossmap_chan_idx(map, c)
+					+ gossmap_node_idx(map,
+							   gossmap_nth_node(map, c, !dir));
+			}
+		}
+	}
+	report("neighbour walk (per edge)", timemono_since(start),
+	       iterations * gossmap_num_chans(map) * 2);
+
+	start = time_mono();
+	for (size_t i = 0; i < iterations * 1000; i++) {
+		struct node_id *id = &nodes[prng() % num_nodes].id;
+		count += gossmap_find_node(map, id) != NULL;
+	}
+	report("gossmap_find_node", timemono_since(start), iterations * 1000);
+
+	/* Localmods: a handful of local channels, plus updates to real ones. */
+	mods = gossmap_localmods_new(tmpctx);
+	for (size_t i = 0; i < num_localmods; i++) {
+		struct short_channel_id_dir scidd;
+		struct amount_msat fee = AMOUNT_MSAT(1);
+		bool enabled = true;
+
+		if (i % 10 == 0) {
+			if (!mk_short_channel_id(&scidd.scid, 1, i, 0))
+				abort();
+			gossmap_local_addchan(mods,
+					      &nodes[i % num_nodes].id,
+					      &nodes[(i + 1) % num_nodes].id,
+					      scidd.scid, AMOUNT_MSAT(1000000000),
+					      NULL);
+		} else {
+			size_t chanidx = prng() % num_chans;
+			if (!mk_short_channel_id(&scidd.scid,
+						 100000 + chanidx / 1000,
+						 chanidx % 1000, 0))
+				abort();
+		}
+		scidd.dir = i % 2;
+		gossmap_local_updatechan(mods, &scidd, &enabled,
+					 NULL, NULL, &fee, NULL, NULL);
+	}
+	start = time_mono();
+	for (size_t i = 0; i < iterations; i++) {
+		gossmap_apply_localmods(map, mods);
+		gossmap_remove_localmods(map, mods);
+	}
+	report("apply+remove localmods", timemono_since(start), iterations);
+
+	/* Refresh: gossipd appends while we're running. */
+	refresh_time = time_from_nsec(0);
+	for (size_t i = 0; i < iterations; i++) {
+		write_channels(fd, nodes, num_nodes, &endpoints,
+			       num_chans + i * refresh_chans, refresh_chans);
+		start = time_mono();
+		if (!gossmap_refresh(map))
+			errx(1, "gossmap_refresh saw no change?");
+		refresh_time = timerel_add(refresh_time, timemono_since(start));
+	}
+	report("gossmap_refresh", refresh_time, iterations);
+
+	printf("Peak RSS: %ld kB\n", peak_rss_kb());
+
+	/* Stop the compiler from eliding our loops. */
+	if (count == 0)
+		printf("Empty graph?\n");
+
+	close(fd);
+	if (!keep)
+		unlink(filename);
+	common_shutdown();
+	return 0;
+}
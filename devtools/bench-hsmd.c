@@ -0,0 +1,188 @@
+/* Offline benchmark for hsmd/libhsmd.c signing throughput.
+ *
+ * On a busy node nearly everything hsmd does is for channeld: a
+ * per-commitment point, a signature on the peer's new commitment
+ * transaction, and one for each HTLC transaction hanging off it.  We
+ * replay that mix against many channels, round-robin as the requests
+ * would arrive, straight into hsmd_handle_client_message(). */
+#include "config.h"
+#include <bitcoin/chainparams.h>
+#include <bitcoin/script.h>
+#include <bitcoin/tx.h>
+#include <ccan/err/err.h>
+#include <ccan/opt/opt.h>
+#include <ccan/time/time.h>
+#include <common/hsm_version.h>
+#include <common/setup.h>
+#include <common/utils.h>
+#include <hsmd/libhsmd.h>
+#include <hsmd/permissions.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* We don't want libhsmd's debug chatter in the timings. */
+u8 *hsmd_status_bad_request(struct hsmd_client *client, const u8 *msg,
+			    const char *error)
+{
+	errx(1, "Bad request: %s", error);
+}
+
+void hsmd_status_fmt(enum log_level level, const struct node_id *peer,
+		     const char *fmt, ...)
+{
+}
+
+void hsmd_status_failed(enum status_failreason reason, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	verrx(1, fmt, ap);
+	va_end(ap);
+}
+
+static void make_pubkey(u8 seed, struct pubkey *pubkey)
+{
+	struct secret secret;
+
+	memset(&secret, seed, sizeof(secret));
+	if (!pubkey_from_secret(&secret, pubkey))
+		abort();
+}
+
+/* Looks enough like a commitment tx: one funding input, some outputs. */
+static struct bitcoin_tx *make_tx(const tal_t *ctx,
+				  const struct pubkey *a,
+				  const struct pubkey *b,
+				  size_t num_outputs)
+{
+	struct bitcoin_tx *tx;
+	struct bitcoin_outpoint outpoint;
+	const u8 *wscript = bitcoin_redeem_2of2(tmpctx, a, b);
+
+	tx = bitcoin_tx(ctx, chainparams, 1, num_outputs, 0);
+	memset(&outpoint, 7, sizeof(outpoint));
+	outpoint.n = 0;
+	bitcoin_tx_add_input(tx, &outpoint, 0xFFFFFFFF, NULL,
+			     AMOUNT_SAT(1000000), NULL, wscript);
+	for (size_t i = 0; i < num_outputs; i++)
+		bitcoin_tx_add_output(tx, scriptpubkey_p2wsh(tmpctx, wscript),
+				      NULL, AMOUNT_SAT(400000));
+	bitcoin_tx_finalize(tx);
+	return tx;
+}
+
+/* What channeld asks for on each commitment update. */
+static const u8 **make_requests(const tal_t *ctx, unsigned int htlcs)
+{
+	const u8 **reqs = tal_arr(ctx, const u8 *, 0);
+	struct pubkey remote_funding, remote_per_commit;
+	struct bitcoin_tx *tx;
+	const u8 *htlc_wscript;
+
+	make_pubkey(2, &remote_funding);
+	make_pubkey(3, &remote_per_commit);
+	htlc_wscript = bitcoin_redeem_2of2(tmpctx,
+					   &remote_funding, &remote_per_commit);
+
+	tal_arr_expand(&reqs, towire_hsmd_get_per_commitment_point(reqs, 1));
+
+	tx = make_tx(tmpctx, &remote_funding, &remote_per_commit, 2 + htlcs);
+	tal_arr_expand(&reqs,
+		       towire_hsmd_sign_remote_commitment_tx(reqs, tx,
+							     &remote_funding,
+							     &remote_per_commit,
+							     true, 1, NULL,
+							     253));
+
+	tx = make_tx(tmpctx, &remote_funding, &remote_per_commit, 1);
+	for (size_t i = 0; i < htlcs; i++) {
+		tal_arr_expand(&reqs,
+			       towire_hsmd_sign_remote_htlc_tx(reqs, tx,
+							       htlc_wscript,
+							       &remote_per_commit,
+							       true));
+	}
+	return reqs;
+}
+
+static u64 replay(struct hsmd_client **clients, const u8 **reqs,
+		  unsigned int rounds)
+{
+	struct timemono start = time_mono();
+	u64 n = 0;
+
+	for (size_t r = 0; r < rounds; r++) {
+		for (size_t i = 0; i < tal_count(clients); i++) {
+			for (size_t j = 0; j < tal_count(reqs); j++) {
+				if (!hsmd_handle_client_message(tmpctx,
+								clients[i],
+								reqs[j]))
+					errx(1, "Request %zu failed", j);
+				n++;
+			}
+			clean_tmpctx();
+		}
+	}
+	return time_to_nsec(timemono_since(start)) / n;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int num_channels = 500, rounds = 10, htlcs = 4;
+	const tal_t *ctx;
+	struct secret hsm_secret;
+	struct hsmd_client **clients;
+	const u8 **reqs;
+	struct node_id peer_id;
+	struct pubkey peer_key;
+
+	common_setup(argv[0]);
+
+	opt_register_arg("--channels", opt_set_uintval, opt_show_uintval,
+			 &num_channels, "Number of channels to sign for");
+	opt_register_arg("--rounds", opt_set_uintval, opt_show_uintval,
+			 &rounds, "Commitment updates per channel");
+	opt_register_arg("--htlcs", opt_set_uintval, opt_show_uintval,
+			 &htlcs, "HTLCs on each commitment");
+	opt_register_noarg("--help|-h", opt_usage_and_exit,
+			   "\n"
+			   "Replay channeld signing requests through libhsmd",
+			   "Print this message.");
+	opt_parse(&argc, argv, opt_log_stderr_exit);
+	if (argc != 1)
+		opt_usage_exit_fail("Unexpected arguments");
+
+	chainparams = chainparams_for_network("regtest");
+	memset(&hsm_secret, 1, sizeof(hsm_secret));
+	hsmd_mutual_version = HSM_MAX_VERSION;
+	/* Reply is take()n, so this frees it. */
+	tal_free(hsmd_init(hsm_secret, hsmd_mutual_version,
+			   chainparams->bip32_key_version));
+
+	make_pubkey(4, &peer_key);
+	node_id_from_pubkey(&peer_id, &peer_key);
+	/* replay() cleans tmpctx, so these can't live there. */
+	ctx = tal(NULL, char);
+	clients = tal_arr(ctx, struct hsmd_client *, num_channels);
+	for (size_t i = 0; i < num_channels; i++) {
+		clients[i] = hsmd_client_new_peer(clients,
+						  HSM_PERM_COMMITMENT_POINT
+						  | HSM_PERM_SIGN_REMOTE_TX,
+						  i + 1, &peer_id, NULL);
+		clients[i]->chainparams = chainparams;
+	}
+	reqs = make_requests(ctx, htlcs);
+
+	printf("%u channels, %u htlcs, %zu requests per update\n",
+	       num_channels, htlcs, tal_count(reqs));
+	/* First pass includes deriving each channel's keys. */
+	printf("%-16s %10"PRIu64" ns/request\n", "first update",
+	       replay(clients, reqs, 1));
+	printf("%-16s %10"PRIu64" ns/request\n", "later updates",
+	       replay(clients, reqs, rounds));
+
+	tal_free(ctx);
+	common_shutdown();
+	return 0;
+}
@@ -5,6 +5,7 @@
 #include <common/gossip_store.h>
 #include <fcntl.h>
 #include <gossipd/gossip_store_wiregen.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <wire/peer_wire.h>
@@ -69,6 +70,8 @@ int main(int argc, char *argv[])
 		u8 *msg, *inner;
 		bool deleted, push, dying;
 		u32 blockheight;
+		u64 equiv_off;
+		u8 uuid[32];
 
 		deleted = (flags & GOSSIP_STORE_DELETED_BIT);
 		push = (flags & GOSSIP_STORE_PUSH_BIT);
@@ -122,6 +125,11 @@ int main(int argc, char *argv[])
 			printf("dying channel: %s (deadline %u)\n",
 			       fmt_short_channel_id(tmpctx, scid),
 			       blockheight);
+		} else if (fromwire_gossip_store_uuid(msg, uuid)) {
+			printf("uuid: %s\n", tal_hexstr(tmpctx, uuid, sizeof(uuid)));
+		} else if (fromwire_gossip_store_ended(msg, &equiv_off, uuid)) {
+			printf("ended: equivalent offset %"PRIu64" in uuid %s\n",
+			       equiv_off, tal_hexstr(tmpctx, uuid, sizeof(uuid)));
 		} else {
 			printf("Unknown message %u: %s\n",
 			       fromwire_peektype(msg), tal_hex(msg, msg));
@@ -98,6 +98,17 @@ void ecdh(const struct pubkey *point, struct secret *ss)
 		abort();
 }
 
+void ecdh_async_(const tal_t *ctx,
+		 const struct pubkey *point,
+		 void (*cb)(const struct secret *ss, void *arg),
+		 void *arg)
+{
+	struct secret ss;
+
+	ecdh(point, &ss);
+	cb(&ss, arg);
+}
+
 /* We don't want to discard *any* messages. */
 bool is_unknown_msg_discardable(const u8 *cursor)
 {
@@ -139,6 +139,7 @@ static const struct sqlname_map ${colname}[] = {
     { ${t[0]}, ${t[1]} },
 % endfor
 };
+static struct sqlname_map ${colname}_memo[ARRAY_SIZE(${colname})];
 
 % endfor
 
@@ -154,6 +155,7 @@ const struct db_query db_${f}_queries[] = {
 % if elem['colnames'] is not None:
          .colnames = ${elem['colnames']},
          .num_colnames = ARRAY_SIZE(${elem['colnames']}),
+         .colname_memo = ${elem['colnames']}_memo,
 % endif
 % endif
     },
@@ -6,6 +6,7 @@
 #include <ccan/tal/str/str.h>
 #include <common/gossip_store.h>
 #include <common/status.h>
+#include <common/timeout.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <gossipd/gossip_store.h>
@@ -13,6 +14,7 @@
 #include <gossipd/gossipd.h>
 #include <gossipd/gossmap_manage.h>
 #include <inttypes.h>
+#include <sodium/randombytes.h>
 #include <sys/stat.h>
 #include <sys/uio.h>
 #include <unistd.h>
@@ -25,6 +27,36 @@
 /* We write it as major version 0, minor version 14 */
 #define GOSSIP_STORE_VER ((0 << 5) | 14)
 
+/* We compact once more than half the store is dead, if it's this big. */
+#define GOSSIP_STORE_COMPACT_MIN_LEN (1024 * 1024)
+/* How much of the old store we copy each time the compaction timer fires */
+#define GOSSIP_STORE_COMPACT_CHUNK (1024 * 1024)
+#define GOSSIP_STORE_COMPACT_INTERVAL_MSEC 10
+
+/* Online compaction: we copy live records to a new store a chunk at a
+ * time, then switch over. */
+struct compaction {
+	struct gossip_store *gs;
+
+	/* The new store, its length and its uuid */
+	int fd;
+	u64 len;
+	u8 uuid[32];
+
+	/* How far through the current store we've copied */
+	u64 off;
+
+	/* Records we copied which have been deleted since */
+	u64 dead_len;
+
+	/* Where each record we copied went (gossmap-style offsets),
+	 * in increasing order. */
+	u64 *old_offs, *new_offs;
+
+	struct oneshot *timer;
+	struct timemono start;
+};
+
 struct gossip_store {
 	/* Back pointer. */
 	struct daemon *daemon;
@@ -35,6 +67,12 @@ struct gossip_store {
 	/* Offset of current EOF */
 	u64 len;
 
+	/* Bytes in deleted records and tombstones, which compaction drops */
+	u64 dead_len;
+
+	/* Non-NULL while we're compacting. */
+	struct compaction *compaction;
+
 	/* Timestamp of store when we opened it (0 if we created it) */
 	u32 timestamp;
 };
@@ -44,6 +82,11 @@ static void gossip_store_destroy(struct gossip_store *gs)
 	close(gs->fd);
 }
 
+static void compaction_destroy(struct compaction *c)
+{
+	close(c->fd);
+}
+
 #if HAVE_PWRITEV
 /* One fewer syscall for the win! */
 static ssize_t gossip_pwritev(int fd, const struct iovec *iov, int iovcnt,
@@ -187,44 +230,65 @@ static bool upgrade_field(u8 oldversion,
 	return true;
 }
 
-/* Read gossip store entries, copy non-deleted ones.  Check basic
- * validity, but this code is written as simply and robustly as
+/* Create a new, empty store at GOSSIP_STORE_TEMP_FILENAME, with a fresh
+ * uuid record first. */
+static int new_store(u64 *len, u8 uuid[32])
+{
+	int fd;
+	u8 version = GOSSIP_STORE_VER;
+
+	fd = open(GOSSIP_STORE_TEMP_FILENAME, O_RDWR|O_TRUNC|O_CREAT, 0600);
+	if (fd < 0) {
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "Opening new gossip_store file: %s",
+			      strerror(errno));
+	}
+
+	if (!write_all(fd, &version, sizeof(version))) {
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "Writing new gossip_store file: %s",
+			      strerror(errno));
+	}
+	*len = sizeof(version);
+
+	randombytes_buf(uuid, 32);
+	if (!append_msg(fd, towire_gossip_store_uuid(tmpctx, uuid), 0, len)) {
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "Writing new gossip_store uuid: %s",
+			      strerror(errno));
+	}
+	return fd;
+}
+
+/* Read gossip store entries and check basic validity.  If the store is
+ * the current version we use it in place (online compaction gets rid of
+ * deleted records), otherwise we copy non-deleted ones to a new store,
+ * upgrading them.  This code is written as simply and robustly as
  * possible!
  *
- * Returns fd of new store, or -1 if it was grossly invalid.
+ * Returns fd of store, or -1 if it was grossly invalid.
  */
-static int gossip_store_compact(struct daemon *daemon,
-				u64 *total_len,
-				bool *populated,
-				struct chan_dying **dying)
+static int gossip_store_load(struct daemon *daemon,
+			     u64 *total_len,
+			     u64 *dead_len,
+			     bool *populated,
+			     struct chan_dying **dying)
 {
 	size_t cannounces = 0, cupdates = 0, nannounces = 0, deleted = 0;
-	int old_fd, new_fd;
+	int old_fd, new_fd = -1;
 	u64 old_len, cur_off;
 	struct gossip_hdr hdr;
 	u8 oldversion, version = GOSSIP_STORE_VER;
+	u8 uuid[32];
 	struct stat st;
 	struct timeabs start = time_now();
 	const char *bad;
 
 	*populated = false;
+	*dead_len = 0;
 	old_len = 0;
 
-	new_fd = open(GOSSIP_STORE_TEMP_FILENAME, O_RDWR|O_TRUNC|O_CREAT, 0600);
-	if (new_fd < 0) {
-		status_failed(STATUS_FAIL_INTERNAL_ERROR,
-			      "Opening new gossip_store file: %s",
-			      strerror(errno));
-	}
-
-	if (!write_all(new_fd, &version, sizeof(version))) {
-		status_failed(STATUS_FAIL_INTERNAL_ERROR,
-			      "Writing new gossip_store file: %s",
-			      strerror(errno));
-	}
-	*total_len = sizeof(version);
-
-	/* RDWR since we add closed marker at end! */
+	/* RDWR since we add closed marker at end, or append to it! */
 	old_fd = open(GOSSIP_STORE_FILENAME, O_RDWR);
 	if (old_fd == -1) {
 		if (errno == ENOENT)
@@ -243,14 +307,18 @@ static int gossip_store_compact(struct daemon *daemon,
 
 	if (!read_all(old_fd, &oldversion, sizeof(oldversion))
 	    || (oldversion != version && !can_upgrade(oldversion))) {
-		status_broken("gossip_store_compact: bad version");
+		status_broken("gossip_store_load: bad version");
 		goto rename_new;
 	}
 
 	cur_off = old_len = sizeof(oldversion);
+	if (oldversion == version)
+		*total_len = old_len;
+	else
+		new_fd = new_store(total_len, uuid);
 
-	/* Read everything, write non-deleted ones to new_fd.  If something goes wrong,
-	 * we end up with truncated store. */
+	/* Read everything, write non-deleted ones to new_fd if upgrading.
+	 * If something goes wrong, we end up with truncated store. */
 	while (read_all(old_fd, &hdr, sizeof(hdr))) {
 		size_t msglen;
 		u8 *msg;
@@ -259,10 +327,10 @@ static int gossip_store_compact(struct daemon *daemon,
 		msglen = be16_to_cpu(hdr.len);
 		msg = tal_arr(NULL, u8, msglen);
 		if (!read_all(old_fd, msg, msglen)) {
-			status_unusual("gossip_store_compact: store ends early at %"PRIu64,
+			status_unusual("gossip_store_load: store ends early at %"PRIu64,
 				       old_len);
 			tal_free(msg);
-			goto rename_new;
+			break;
 		}
 
 		cur_off = old_len;
@@ -271,7 +339,7 @@ static int gossip_store_compact(struct daemon *daemon,
 		if (be16_to_cpu(hdr.flags) & GOSSIP_STORE_DELETED_BIT) {
 			deleted++;
 			tal_free(msg);
-			continue;
+			goto dead;
 		}
 
 		/* Check checksum (upgrade would overwrite, so do it now) */
@@ -307,6 +375,13 @@ static int gossip_store_compact(struct daemon *daemon,
 		/* Don't write out old tombstones */
 		if (fromwire_peektype(msg) == WIRE_GOSSIP_STORE_DELETE_CHAN) {
 			deleted++;
+			tal_free(msg);
+			goto dead;
+		}
+
+		/* The new store has its own uuid */
+		if (new_fd != -1
+		    && fromwire_peektype(msg) == WIRE_GOSSIP_STORE_UUID) {
 			tal_free(msg);
 			continue;
 		}
@@ -325,7 +400,10 @@ static int gossip_store_compact(struct daemon *daemon,
 				goto badmsg;
 			}
 			/* By convention, these offsets are *after* header */
-			cd.gossmap_offset = *total_len + sizeof(hdr);
+			if (new_fd != -1)
+				cd.gossmap_offset = *total_len + sizeof(hdr);
+			else
+				cd.gossmap_offset = cur_off + sizeof(hdr);
 			tal_arr_expand(dying, cd);
 			break;
 		}
@@ -337,51 +415,87 @@ static int gossip_store_compact(struct daemon *daemon,
 			break;
 		}
 
+		if (new_fd == -1) {
+			tal_free(msg);
+			*total_len = old_len;
+			continue;
+		}
+
 		if (!write_all(new_fd, &hdr, sizeof(hdr))
 		    || !write_all(new_fd, msg, msglen)) {
 			status_failed(STATUS_FAIL_INTERNAL_ERROR,
-				      "gossip_store_compact: writing msg len %zu to new store: %s",
+				      "gossip_store_load: writing msg len %zu to new store: %s",
 				      msglen, strerror(errno));
 		}
 		tal_free(msg);
 		*total_len += sizeof(hdr) + msglen;
-	}
+		continue;
 
-	assert(*total_len == lseek(new_fd, 0, SEEK_END));
+	dead:
+		/* In place, these stay until we compact. */
+		if (new_fd == -1) {
+			*dead_len += old_len - cur_off;
+			*total_len = old_len;
+		}
+	}
 
-	/* If we have any contents, and the file is less than 1 hour
-	 * old, say "seems good" */
-	if (st.st_mtime > time_now().ts.tv_sec - 3600 && *total_len > 1) {
+	/* If we have any gossip (not just a uuid), and the file is less
+	 * than 1 hour old, say "seems good" */
+	if (st.st_mtime > time_now().ts.tv_sec - 3600
+	    && cannounces + cupdates + nannounces != 0) {
 		*populated = true;
 	}
 
+	if (new_fd == -1) {
+		/* Drop any partial record at the end. */
+		if (*total_len != st.st_size
+		    && ftruncate(old_fd, *total_len) != 0) {
+			status_failed(STATUS_FAIL_INTERNAL_ERROR,
+				      "gossip_store_load: truncating to %"PRIu64": %s",
+				      *total_len, strerror(errno));
+		}
+		assert(*total_len == lseek(old_fd, 0, SEEK_END));
+		status_debug("Store load time: %"PRIu64" msec",
+			     time_to_msec(time_between(time_now(), start)));
+		goto out;
+	}
+
+	assert(*total_len == lseek(new_fd, 0, SEEK_END));
+
 rename_new:
+	if (new_fd == -1)
+		new_fd = new_store(total_len, uuid);
+
 	if (rename(GOSSIP_STORE_TEMP_FILENAME, GOSSIP_STORE_FILENAME) != 0) {
 		status_failed(STATUS_FAIL_INTERNAL_ERROR,
-			      "gossip_store_compact: rename failed: %s",
+			      "gossip_store_load: rename failed: %s",
 			      strerror(errno));
 	}
 
 	/* Create end marker now new file exists. */
 	if (old_fd != -1) {
-		append_msg(old_fd, towire_gossip_store_ended(tmpctx, *total_len),
+		append_msg(old_fd,
+			   towire_gossip_store_ended(tmpctx, *total_len, uuid),
 			   0, &old_len);
 		close(old_fd);
 	}
+	old_fd = new_fd;
 
 	status_debug("Store compact time: %"PRIu64" msec",
 		     time_to_msec(time_between(time_now(), start)));
+out:
 	status_debug("gossip_store: Read %zu/%zu/%zu/%zu cannounce/cupdate/nannounce/delete from store in %"PRIu64" bytes, now %"PRIu64" bytes (populated=%s)",
 		     cannounces, cupdates, nannounces, deleted,
 		     old_len, *total_len,
 		     *populated ? "true": "false");
-	return new_fd;
+	return old_fd;
 
 badmsg:
 	/* Caller will presumably try gossip_store_reset. */
 	status_broken("gossip_store: %s (offset %"PRIu64").", bad, cur_off);
 	close(old_fd);
-	close(new_fd);
+	if (new_fd != -1)
+		close(new_fd);
 	return -1;
 }
 
@@ -400,14 +514,213 @@ struct gossip_store *gossip_store_new(const tal_t *ctx,
 	struct gossip_store *gs = tal(ctx, struct gossip_store);
 
 	gs->daemon = daemon;
+	gs->compaction = NULL;
 	*dying = tal_arr(ctx, struct chan_dying, 0);
-	gs->fd = gossip_store_compact(daemon, &gs->len, populated, dying);
+	gs->fd = gossip_store_load(daemon, &gs->len, &gs->dead_len,
+				   populated, dying);
 	if (gs->fd < 0)
 		return tal_free(gs);
 	tal_add_destructor(gs, gossip_store_destroy);
 	return gs;
 }
 
+/* Copy the record at c->off to the new store, unless it's dead. */
+static void compaction_copy(struct compaction *c)
+{
+	struct gossip_store *gs = c->gs;
+	struct gossip_hdr hdr;
+	struct iovec iov[2];
+	u16 msglen;
+	u8 *msg;
+
+	if (pread(gs->fd, &hdr, sizeof(hdr), c->off) != sizeof(hdr))
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "gossip_store: compaction can't read hdr offset %"PRIu64
+			      "/%"PRIu64": %s",
+			      c->off, gs->len, strerror(errno));
+
+	msglen = be16_to_cpu(hdr.len);
+	msg = tal_arr(tmpctx, u8, msglen);
+	if (pread(gs->fd, msg, msglen, c->off + sizeof(hdr)) != msglen)
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "gossip_store: compaction can't read len %u offset %"PRIu64
+			      "/%"PRIu64, msglen, c->off, gs->len);
+	c->off += sizeof(hdr) + msglen;
+
+	/* Skip dead records, and the old uuid: the new store has its own. */
+	if ((be16_to_cpu(hdr.flags) & GOSSIP_STORE_DELETED_BIT)
+	    || fromwire_peektype(msg) == WIRE_GOSSIP_STORE_DELETE_CHAN
+	    || fromwire_peektype(msg) == WIRE_GOSSIP_STORE_UUID)
+		goto out;
+
+	/* Header is unchanged: same flags, timestamp and crc. */
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = msg;
+	iov[1].iov_len = msglen;
+	if (gossip_pwritev(c->fd, iov, ARRAY_SIZE(iov), c->len) != sizeof(hdr) + msglen)
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "gossip_store: compaction writing msg len %u: %s",
+			      msglen, strerror(errno));
+
+	/* By gossmap convention, offsets are *after* hdr */
+	tal_arr_expand(&c->old_offs, c->off - msglen);
+	tal_arr_expand(&c->new_offs, c->len + sizeof(hdr));
+	c->len += sizeof(hdr) + msglen;
+
+out:
+	tal_free(msg);
+}
+
+/* Everything is copied: swap the new store in. */
+static void compaction_done(struct compaction *c)
+{
+	struct gossip_store *gs = c->gs;
+	u64 old_len = gs->len;
+
+	if (rename(GOSSIP_STORE_TEMP_FILENAME, GOSSIP_STORE_FILENAME) != 0)
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "gossip_store: compaction rename failed: %s",
+			      strerror(errno));
+
+	/* Readers of the old store switch over when they see this: the
+	 * uuid lets them check they opened this store, not a later one. */
+	if (!append_msg(gs->fd,
+			towire_gossip_store_ended(tmpctx, c->len, c->uuid),
+			0, &old_len))
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "gossip_store: writing end marker: %s",
+			      strerror(errno));
+
+	status_debug("gossip_store: compacted %"PRIu64" bytes to %"PRIu64
+		     " in %"PRIu64" msec",
+		     gs->len, c->len,
+		     time_to_msec(timemono_since(c->start)));
+
+	close(gs->fd);
+	gs->fd = c->fd;
+	gs->len = c->len;
+	gs->dead_len = c->dead_len;
+	tal_del_destructor(c, compaction_destroy);
+
+	/* This uses gossip_store_compacted_offset(), so c must still exist */
+	gossmap_manage_store_compacted(gs->daemon->gm);
+	gs->compaction = tal_free(c);
+}
+
+static void compaction_step(struct compaction *c)
+{
+	u64 end = c->off + GOSSIP_STORE_COMPACT_CHUNK;
+
+	c->timer = NULL;
+	while (c->off < c->gs->len && c->off < end)
+		compaction_copy(c);
+
+	if (c->off == c->gs->len) {
+		compaction_done(c);
+		return;
+	}
+
+	c->timer = new_reltimer(&c->gs->daemon->timers, c,
+				time_from_msec(GOSSIP_STORE_COMPACT_INTERVAL_MSEC),
+				compaction_step, c);
+}
+
+static struct compaction *compaction_start(struct gossip_store *gs)
+{
+	struct compaction *c = tal(gs, struct compaction);
+
+	c->gs = gs;
+	c->fd = new_store(&c->len, c->uuid);
+	tal_add_destructor(c, compaction_destroy);
+	c->off = sizeof(u8);
+	c->dead_len = 0;
+	c->old_offs = tal_arr(c, u64, 0);
+	c->new_offs = tal_arr(c, u64, 0);
+	c->timer = NULL;
+	c->start = time_mono();
+
+	status_debug("gossip_store: compacting %"PRIu64" bytes (%"PRIu64" dead)",
+		     gs->len, gs->dead_len);
+	gs->compaction = c;
+	return c;
+}
+
+/* We're called in the middle of changing the store, so we only start
+ * from a timer: our caller's offsets must stay valid! */
+static void maybe_compact(struct gossip_store *gs)
+{
+	struct compaction *c;
+
+	if (gs->compaction
+	    || gs->len < GOSSIP_STORE_COMPACT_MIN_LEN
+	    || gs->dead_len < gs->len / 2)
+		return;
+
+	c = compaction_start(gs);
+	c->timer = new_reltimer(&gs->daemon->timers, c,
+				time_from_msec(GOSSIP_STORE_COMPACT_INTERVAL_MSEC),
+				compaction_step, c);
+}
+
+void gossip_store_compact(struct gossip_store *gs)
+{
+	struct compaction *c = gs->compaction;
+
+	if (!c)
+		c = compaction_start(gs);
+	c->timer = tal_free(c->timer);
+	while (c->off < gs->len)
+		compaction_copy(c);
+	compaction_done(c);
+}
+
+/* Where did the record at this (gossmap-style) offset go?  0 if not copied. */
+static u64 compacted_offset(const struct compaction *c, u64 offset)
+{
+	size_t lo = 0, hi = tal_count(c->old_offs);
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+
+		if (c->old_offs[mid] < offset)
+			lo = mid + 1;
+		else if (c->old_offs[mid] > offset)
+			hi = mid;
+		else
+			return c->new_offs[mid];
+	}
+	return 0;
+}
+
+u64 gossip_store_compacted_offset(const struct gossip_store *gs, u64 offset)
+{
+	assert(gs->compaction);
+	return compacted_offset(gs->compaction, offset);
+}
+
+/* If we've already copied this record, its copy needs the new header
+ * too.  Returns true if there was a copy. */
+static bool update_copied_hdr(struct gossip_store *gs, u64 offset,
+			      const struct gossip_hdr *hdr)
+{
+	u64 new_off;
+
+	if (!gs->compaction || offset > gs->compaction->off)
+		return false;
+
+	new_off = compacted_offset(gs->compaction, offset);
+	if (!new_off)
+		return false;
+
+	if (pwrite(gs->compaction->fd, hdr, sizeof(*hdr),
+		   new_off - sizeof(*hdr)) != sizeof(*hdr))
+		status_failed(STATUS_FAIL_INTERNAL_ERROR,
+			      "Failed writing compacted header @%"PRIu64": %s",
+			      new_off, strerror(errno));
+	return true;
+}
+
 void gossip_store_fsync(const struct gossip_store *gs)
 {
 	if (fsync(gs->fd) != 0)
@@ -441,6 +754,10 @@ u64 gossip_store_add(struct gossip_store *gs, const u8 *gossip_msg, u32 timestam
 			      strerror(errno));
 	}
 
+	/* Compaction drops tombstones */
+	if (fromwire_peektype(gossip_msg) == WIRE_GOSSIP_STORE_DELETE_CHAN)
+		gs->dead_len += gs->len - off;
+
 	/* By gossmap convention, offset is *after* hdr */
 	return off + sizeof(struct gossip_hdr);
 }
@@ -508,6 +825,8 @@ u64 gossip_store_set_flag(struct gossip_store *gs,
 			  u64 offset, u16 flag, int type)
 {
 	struct gossip_hdr hdr;
+	u64 reclen;
+	bool copied;
 
 	if (!check_msg_type(gs, offset, flag, type, &hdr))
 		return offset;
@@ -524,7 +843,16 @@ u64 gossip_store_set_flag(struct gossip_store *gs,
 			      "Failed writing set flags @%"PRIu64": %s",
 			      offset, strerror(errno));
 
-	return offset + be16_to_cpu(hdr.len) + sizeof(struct gossip_hdr);
+	reclen = be16_to_cpu(hdr.len) + sizeof(struct gossip_hdr);
+	copied = update_copied_hdr(gs, offset, &hdr);
+	if (flag == GOSSIP_STORE_DELETED_BIT) {
+		gs->dead_len += reclen;
+		if (copied)
+			gs->compaction->dead_len += reclen;
+		maybe_compact(gs);
+	}
+
+	return offset + reclen;
 }
 
 u16 gossip_store_get_flags(struct gossip_store *gs,
@@ -552,6 +880,7 @@ void gossip_store_clear_flag(struct gossip_store *gs,
 		status_failed(STATUS_FAIL_INTERNAL_ERROR,
 			      "Failed writing clear flags @%"PRIu64": %s",
 			      offset, strerror(errno));
+	update_copied_hdr(gs, offset, &hdr);
 }
 
 void gossip_store_del(struct gossip_store *gs,
@@ -602,6 +931,7 @@ void gossip_store_set_timestamp(struct gossip_store *gs, u64 offset, u32 timesta
 		status_failed(STATUS_FAIL_INTERNAL_ERROR,
 			      "Failed writing header to re-timestamp @%"PRIu64": %s",
 			      offset, strerror(errno));
+	update_copied_hdr(gs, offset, &hdr);
 }
 
 u64 gossip_store_len_written(const struct gossip_store *gs)
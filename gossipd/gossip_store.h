@@ -106,6 +106,22 @@ u32 gossip_store_get_timestamp(struct gossip_store *gs, u64 offset);
  */
 void gossip_store_set_timestamp(struct gossip_store *gs, u64 offset, u32 timestamp);
 
+/**
+ * Compact the gossip_store now, rather than waiting for enough of it to
+ * be dead.
+ *
+ * Normally this happens a piece at a time, in the background.
+ */
+void gossip_store_compact(struct gossip_store *gs);
+
+/**
+ * Where did the record at this offset go in the compacted store?
+ *
+ * Only valid inside gossmap_manage_store_compacted().  Offsets are
+ * gossmap-style, *after* the header.  Returns 0 if it was deleted.
+ */
+u64 gossip_store_compacted_offset(const struct gossip_store *gs, u64 offset);
+
 /**
  * For debugging.
  */
@@ -499,6 +499,16 @@ static void dev_gossip_set_time(struct daemon *daemon, const u8 *msg)
 	daemon->dev_gossip_time->ts.tv_nsec = 0;
 }
 
+static void dev_gossip_compact_store(struct daemon *daemon, const u8 *msg)
+{
+	if (!fromwire_gossipd_dev_compact_store(msg))
+		master_badmsg(WIRE_GOSSIPD_DEV_COMPACT_STORE, msg);
+
+	gossmap_manage_compact_store(daemon->gm);
+	daemon_conn_send(daemon->master,
+			 take(towire_gossipd_dev_compact_store_reply(NULL)));
+}
+
 /*~ lightningd tells us when about a gossip message directly, when told to by
  * the addgossip RPC call.  That's usually used when a plugin gets an update
  * returned in an payment error. */
@@ -596,6 +606,12 @@ static struct io_plan *recv_req(struct io_conn *conn,
 			goto done;
 		}
 		/* fall thru */
+	case WIRE_GOSSIPD_DEV_COMPACT_STORE:
+		if (daemon->developer) {
+			dev_gossip_compact_store(daemon, msg);
+			goto done;
+		}
+		/* fall thru */
 
 	/* We send these, we don't receive them */
 	case WIRE_GOSSIPD_INIT_CUPDATE:
@@ -603,6 +619,7 @@ static struct io_plan *recv_req(struct io_conn *conn,
 	case WIRE_GOSSIPD_INIT_REPLY:
 	case WIRE_GOSSIPD_GET_TXOUT:
 	case WIRE_GOSSIPD_DEV_MEMLEAK_REPLY:
+	case WIRE_GOSSIPD_DEV_COMPACT_STORE_REPLY:
 	case WIRE_GOSSIPD_ADDGOSSIP_REPLY:
 	case WIRE_GOSSIPD_NEW_BLOCKHEIGHT_REPLY:
 	case WIRE_GOSSIPD_REMOTE_CHANNEL_UPDATE:
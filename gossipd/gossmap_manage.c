@@ -588,6 +588,13 @@ const char *gossmap_manage_channel_announcement(const tal_t *ctx,
 		return NULL;
 	}
 
+	/* Already known, or already asking lightningd about it?  We'd
+	 * ignore it below anyway, so don't spend four signature checks on
+	 * it: when syncing from several peers, most are duplicates. */
+	if (gossmap_find_chan(gossmap, &scid)
+	    || map_get(&gm->pending_ann_map, scid))
+		return NULL;
+
 	warn = sigcheck_channel_announcement(ctx, &node_id_1, &node_id_2,
 					     &bitcoin_key_1, &bitcoin_key_2,
 					     &node_signature_1, &node_signature_2,
@@ -596,10 +603,6 @@ const char *gossmap_manage_channel_announcement(const tal_t *ctx,
 	if (warn)
 		return warn;
 
-	/* Already known? */
-	if (gossmap_find_chan(gossmap, &scid))
-		return NULL;
-
 	pca = tal(gm, struct pending_cannounce);
 	pca->scriptpubkey = scriptpubkey_p2wsh(pca,
 					       bitcoin_redeem_2of2(tmpctx,
@@ -792,6 +795,7 @@ static const char *process_channel_update(const tal_t *ctx,
 	int dir = (channel_flags & ROUTING_FLAGS_DIRECTION);
 	struct gossmap *gossmap = gossmap_manage_get_gossmap(gm);
 	u64 offset;
+	u32 prev_timestamp = 0;
 
 	chan = gossmap_find_chan(gossmap, &scid);
 	if (!chan) {
@@ -817,6 +821,25 @@ static const char *process_channel_update(const tal_t *ctx,
 			    gossmap_nth_node(gossmap, chan, dir),
 			    &node_id);
 
+	/* Older than what we have, or the very same update again?  We
+	 * ignore those before checking the signature: when syncing from
+	 * several peers, most updates are ones we already have. */
+	if (gossmap_chan_set(chan, dir)) {
+		prev_timestamp
+			= gossip_store_get_timestamp(gm->gs, chan->cupdate_off[dir]);
+		if (prev_timestamp > timestamp) {
+			status_trace("Too-old update for %s",
+				     fmt_short_channel_id(tmpctx, scid));
+			return NULL;
+		}
+		/* Don't spam the logs for duplicates! */
+		if (prev_timestamp == timestamp
+		    && tal_arr_eq(update,
+				  gossmap_chan_get_update(tmpctx, gossmap,
+							  chan, dir)))
+			return NULL;
+	}
+
 	err = sigcheck_channel_update(ctx, &node_id, signature, update);
 	if (err)
 		return err;
@@ -827,18 +850,10 @@ static const char *process_channel_update(const tal_t *ctx,
 			       fmt_short_channel_id(tmpctx, scid));
 	}
 
-	/* Do we have same or earlier update? */
 	if (gossmap_chan_set(chan, dir)) {
-		u32 prev_timestamp
-			= gossip_store_get_timestamp(gm->gs, chan->cupdate_off[dir]);
-		if (prev_timestamp >= timestamp) {
-			/* Don't spam the logs for duplicates! */
-			if (timestamp < prev_timestamp)
-				status_trace("Too-old update for %s",
-					     fmt_short_channel_id(tmpctx, scid));
-			/* Too old / redundant, ignore */
+		/* Same timestamp, redundant: ignore */
+		if (prev_timestamp == timestamp)
 			return NULL;
-		}
 	} else {
 		/* Is this the first update in either direction?  If so,
 		 * rewrite channel_announcement so timestamp is correct. */
@@ -1085,12 +1100,27 @@ const char *gossmap_manage_node_announcement(const tal_t *ctx,
 			       tal_hex(tmpctx, nannounce));
 	}
 
+	node = gossmap_find_node(gossmap, &node_id);
+
+	/* Don't bother checking the signature if we have a later one, or
+	 * this very one (process_node_announcement would ignore it). */
+	if (node && gossmap_node_announced(node)) {
+		u32 prev_timestamp
+			= gossip_store_get_timestamp(gm->gs, node->nann_off);
+		if (prev_timestamp > timestamp)
+			return NULL;
+		if (prev_timestamp == timestamp
+		    && tal_arr_eq(nannounce,
+				  gossmap_node_get_announce(tmpctx, gossmap,
+							    node)))
+			return NULL;
+	}
+
 	err = sigcheck_node_announcement(ctx, &node_id, &signature,
 					 nannounce);
 	if (err)
 		return err;
 
-	node = gossmap_find_node(gossmap, &node_id);
 	if (!node) {
 		/* Still waiting for some channel_announcement? */
 		if (!map_empty(&gm->pending_ann_map)
@@ -1387,6 +1417,25 @@ void gossmap_manage_channel_spent(struct gossmap_manage *gm,
 	}
 }
 
+void gossmap_manage_compact_store(struct gossmap_manage *gm)
+{
+	gossip_store_compact(gm->gs);
+}
+
+void gossmap_manage_store_compacted(struct gossmap_manage *gm)
+{
+	for (size_t i = 0; i < tal_count(gm->dying_channels); i++) {
+		struct chan_dying *cd = &gm->dying_channels[i];
+
+		cd->gossmap_offset = gossip_store_compacted_offset(gm->gs,
+								   cd->gossmap_offset);
+		assert(cd->gossmap_offset);
+	}
+
+	/* Switch our gossmap over now, so its offsets match the store. */
+	gossmap_manage_get_gossmap(gm);
+}
+
 /* Fetch the part of the gossmap we didn't process via read() */
 static const u8 *fetch_tail_fd(const tal_t *ctx,
 			       int gossmap_fd,
@@ -93,6 +93,22 @@ void gossmap_manage_channel_spent(struct gossmap_manage *gm,
  */
 struct gossmap *gossmap_manage_get_gossmap(struct gossmap_manage *gm);
 
+/**
+ * gossmap_manage_compact_store: compact the gossip_store now
+ * @gm: the gossmap_manage context
+ *
+ * Usually this happens in the background, once enough of it is deleted.
+ */
+void gossmap_manage_compact_store(struct gossmap_manage *gm);
+
+/**
+ * gossmap_manage_store_compacted: the gossip_store has been compacted
+ * @gm: the gossmap_manage context
+ *
+ * Offsets into the old store are no longer valid: this moves ours over.
+ */
+void gossmap_manage_store_compacted(struct gossmap_manage *gm);
+
 /**
  * gossmap_manage_tell_lightningd_locals: tell lightningd our latest updates.
  * @daemon: the gossip daemon
@@ -0,0 +1,378 @@
+/* Test that gossip we already have doesn't get its signatures checked. */
+#include "config.h"
+#include "../gossmap_manage.c"
+#include <bitcoin/chainparams.h>
+#include <ccan/crc32c/crc32c.h>
+#include <common/setup.h>
+#include <common/utils.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* AUTOGENERATED MOCKS START */
+/* Generated stub for fromwire_gossipd_get_txout_reply */
+bool fromwire_gossipd_get_txout_reply(const tal_t *ctx UNNEEDED, const void *p UNNEEDED, struct short_channel_id *short_channel_id UNNEEDED, struct amount_sat *satoshis UNNEEDED, u8 **outscript UNNEEDED)
+{ fprintf(stderr, "fromwire_gossipd_get_txout_reply called!\n"); abort(); }
+/* Generated stub for gossip_store_add */
+u64 gossip_store_add(struct gossip_store *gs UNNEEDED,
+		     const u8 *gossip_msg UNNEEDED,
+		     u32 timestamp UNNEEDED)
+{ fprintf(stderr, "gossip_store_add called!\n"); abort(); }
+/* Generated stub for gossip_store_clear_flag */
+void gossip_store_clear_flag(struct gossip_store *gs UNNEEDED,
+			     u64 offset UNNEEDED, u16 flag UNNEEDED, int type UNNEEDED)
+{ fprintf(stderr, "gossip_store_clear_flag called!\n"); abort(); }
+/* Generated stub for gossip_store_compact */
+void gossip_store_compact(struct gossip_store *gs UNNEEDED)
+{ fprintf(stderr, "gossip_store_compact called!\n"); abort(); }
+/* Generated stub for gossip_store_compacted_offset */
+u64 gossip_store_compacted_offset(const struct gossip_store *gs UNNEEDED, u64 offset UNNEEDED)
+{ fprintf(stderr, "gossip_store_compacted_offset called!\n"); abort(); }
+/* Generated stub for gossip_store_corrupt */
+void gossip_store_corrupt(void)
+{ fprintf(stderr, "gossip_store_corrupt called!\n"); abort(); }
+/* Generated stub for gossip_store_del */
+void gossip_store_del(struct gossip_store *gs UNNEEDED,
+		      u64 offset UNNEEDED,
+		      int type UNNEEDED)
+{ fprintf(stderr, "gossip_store_del called!\n"); abort(); }
+/* Generated stub for gossip_store_fsync */
+void gossip_store_fsync(const struct gossip_store *gs UNNEEDED)
+{ fprintf(stderr, "gossip_store_fsync called!\n"); abort(); }
+/* Generated stub for gossip_store_get_flags */
+u16 gossip_store_get_flags(struct gossip_store *gs UNNEEDED,
+			   u64 offset UNNEEDED, int type UNNEEDED)
+{ fprintf(stderr, "gossip_store_get_flags called!\n"); abort(); }
+/* Generated stub for gossip_store_new */
+struct gossip_store *gossip_store_new(const tal_t *ctx UNNEEDED,
+				      struct daemon *daemon UNNEEDED,
+				      bool *populated UNNEEDED,
+				      struct chan_dying **dying UNNEEDED)
+{ fprintf(stderr, "gossip_store_new called!\n"); abort(); }
+/* Generated stub for gossip_store_set_flag */
+u64 gossip_store_set_flag(struct gossip_store *gs UNNEEDED,
+		       u64 offset UNNEEDED, u16 flag UNNEEDED, int type UNNEEDED)
+{ fprintf(stderr, "gossip_store_set_flag called!\n"); abort(); }
+/* Generated stub for gossip_store_set_timestamp */
+void gossip_store_set_timestamp(struct gossip_store *gs UNNEEDED, u64 offset UNNEEDED, u32 timestamp UNNEEDED)
+{ fprintf(stderr, "gossip_store_set_timestamp called!\n"); abort(); }
+/* Generated stub for gossip_time_now */
+struct timeabs gossip_time_now(const struct daemon *daemon UNNEEDED)
+{ fprintf(stderr, "gossip_time_now called!\n"); abort(); }
+/* Generated stub for master_badmsg */
+void master_badmsg(u32 type_expected UNNEEDED, const u8 *msg UNNEEDED)
+{ fprintf(stderr, "master_badmsg called!\n"); abort(); }
+/* Generated stub for memleak_scan_intmap_ */
+void memleak_scan_intmap_(struct htable *memtable UNNEEDED, const struct intmap *m UNNEEDED)
+{ fprintf(stderr, "memleak_scan_intmap_ called!\n"); abort(); }
+/* Generated stub for new_reltimer_ */
+struct oneshot *new_reltimer_(struct timers *timers UNNEEDED,
+			      const tal_t *ctx UNNEEDED,
+			      struct timerel expire UNNEEDED,
+			      void (*cb)(void *) UNNEEDED, void *arg UNNEEDED)
+{ fprintf(stderr, "new_reltimer_ called!\n"); abort(); }
+/* Generated stub for peer_supplied_good_gossip */
+void peer_supplied_good_gossip(struct daemon *daemon UNNEEDED,
+			       const struct node_id *source_peer UNNEEDED,
+			       size_t amount UNNEEDED)
+{ fprintf(stderr, "peer_supplied_good_gossip called!\n"); abort(); }
+/* Generated stub for query_unknown_channel */
+void query_unknown_channel(struct daemon *daemon UNNEEDED,
+			   const struct node_id *source_peer UNNEEDED,
+			   const struct short_channel_id unknown_scid UNNEEDED)
+{ fprintf(stderr, "query_unknown_channel called!\n"); abort(); }
+/* Generated stub for query_unknown_node */
+void query_unknown_node(struct daemon *daemon UNNEEDED,
+			const struct node_id *source_peer UNNEEDED,
+			const struct node_id *unknown_node UNNEEDED)
+{ fprintf(stderr, "query_unknown_node called!\n"); abort(); }
+/* Generated stub for queue_peer_msg */
+void queue_peer_msg(struct daemon *daemon UNNEEDED,
+		    const struct node_id *peer UNNEEDED,
+		    const u8 *msg TAKES UNNEEDED)
+{ fprintf(stderr, "queue_peer_msg called!\n"); abort(); }
+/* Generated stub for remove_unknown_scid */
+bool remove_unknown_scid(struct seeker *seeker UNNEEDED,
+			 const struct short_channel_id *scid UNNEEDED,
+			 bool found UNNEEDED)
+{ fprintf(stderr, "remove_unknown_scid called!\n"); abort(); }
+/* Generated stub for sciddir_or_pubkey_from_node_id */
+bool sciddir_or_pubkey_from_node_id(struct sciddir_or_pubkey *sciddpk UNNEEDED,
+				    const struct node_id *node_id UNNEEDED)
+{ fprintf(stderr, "sciddir_or_pubkey_from_node_id called!\n"); abort(); }
+/* Generated stub for sigcheck_node_announcement */
+const char *sigcheck_node_announcement(const tal_t *ctx UNNEEDED,
+				       const struct node_id *node_id UNNEEDED,
+				       const secp256k1_ecdsa_signature *node_sig UNNEEDED,
+				       const u8 *node_announcement UNNEEDED)
+{ fprintf(stderr, "sigcheck_node_announcement called!\n"); abort(); }
+/* Generated stub for status_failed */
+void status_failed(enum status_failreason code UNNEEDED,
+		   const char *fmt UNNEEDED, ...)
+{ fprintf(stderr, "status_failed called!\n"); abort(); }
+/* Generated stub for status_vfmt */
+void status_vfmt(enum log_level level UNNEEDED,
+		 const struct node_id *peer UNNEEDED,
+		 const char *fmt UNNEEDED, va_list ap UNNEEDED)
+{ fprintf(stderr, "status_vfmt called!\n"); abort(); }
+/* Generated stub for tell_lightningd_peer_update */
+void tell_lightningd_peer_update(struct daemon *daemon UNNEEDED,
+				 const struct node_id *source_peer UNNEEDED,
+				 struct short_channel_id scid UNNEEDED,
+				 u32 fee_base_msat UNNEEDED,
+				 u32 fee_ppm UNNEEDED,
+				 u16 cltv_delta UNNEEDED,
+				 struct amount_msat htlc_minimum UNNEEDED,
+				 struct amount_msat htlc_maximum UNNEEDED)
+{ fprintf(stderr, "tell_lightningd_peer_update called!\n"); abort(); }
+/* Generated stub for towire_gossipd_init_cupdate */
+u8 *towire_gossipd_init_cupdate(const tal_t *ctx UNNEEDED, struct short_channel_id scid UNNEEDED, const u8 *cupdate UNNEEDED)
+{ fprintf(stderr, "towire_gossipd_init_cupdate called!\n"); abort(); }
+/* Generated stub for towire_gossipd_init_nannounce */
+u8 *towire_gossipd_init_nannounce(const tal_t *ctx UNNEEDED, const u8 *nannounce UNNEEDED)
+{ fprintf(stderr, "towire_gossipd_init_nannounce called!\n"); abort(); }
+/* Generated stub for towire_gossipd_remote_channel_update */
+u8 *towire_gossipd_remote_channel_update(const tal_t *ctx UNNEEDED, const struct node_id *source_node UNNEEDED, const struct peer_update *peer_update UNNEEDED)
+{ fprintf(stderr, "towire_gossipd_remote_channel_update called!\n"); abort(); }
+/* Generated stub for towire_warningfmt */
+u8 *towire_warningfmt(const tal_t *ctx UNNEEDED,
+		      const struct channel_id *channel UNNEEDED,
+		      const char *fmt UNNEEDED, ...)
+
+{ fprintf(stderr, "towire_warningfmt called!\n"); abort(); }
+/* Generated stub for txout_failures_add */
+void txout_failures_add(struct txout_failures *txf UNNEEDED,
+			const struct short_channel_id scid UNNEEDED)
+{ fprintf(stderr, "txout_failures_add called!\n"); abort(); }
+/* Generated stub for txout_failures_new */
+struct txout_failures *txout_failures_new(const tal_t *ctx UNNEEDED, struct daemon *daemon UNNEEDED)
+{ fprintf(stderr, "txout_failures_new called!\n"); abort(); }
+/* AUTOGENERATED MOCKS END */
+
+/* Only what we need: the store file, read back by gossmap. */
+struct gossip_store {
+	int fd;
+};
+
+static size_t num_sigchecks;
+
+const char *sigcheck_channel_announcement(const tal_t *ctx,
+					  const struct node_id *node1_id,
+					  const struct node_id *node2_id,
+					  const struct pubkey *bitcoin1_key,
+					  const struct pubkey *bitcoin2_key,
+					  const secp256k1_ecdsa_signature *node1_sig,
+					  const secp256k1_ecdsa_signature *node2_sig,
+					  const secp256k1_ecdsa_signature *bitcoin1_sig,
+					  const secp256k1_ecdsa_signature *bitcoin2_sig,
+					  const u8 *announcement)
+{
+	num_sigchecks++;
+	return NULL;
+}
+
+const char *sigcheck_channel_update(const tal_t *ctx,
+				    const struct node_id *node_id,
+				    const secp256k1_ecdsa_signature *node_sig,
+				    const u8 *update)
+{
+	num_sigchecks++;
+	return NULL;
+}
+
+u32 gossip_store_get_timestamp(struct gossip_store *gs, u64 offset)
+{
+	struct gossip_hdr hdr;
+
+	assert(pread(gs->fd, &hdr, sizeof(hdr), offset - sizeof(hdr))
+	       == sizeof(hdr));
+	return be32_to_cpu(hdr.timestamp);
+}
+
+u64 gossip_store_len_written(const struct gossip_store *gs)
+{
+	return lseek(gs->fd, 0, SEEK_END);
+}
+
+bool in_txout_failures(struct txout_failures *txf,
+		       const struct short_channel_id scid)
+{
+	return false;
+}
+
+bool timestamp_reasonable(const struct daemon *daemon, u32 timestamp)
+{
+	return true;
+}
+
+void status_fmt(enum log_level level,
+		const struct node_id *peer,
+		const char *fmt, ...)
+{
+}
+
+static size_t num_txout_reqs;
+
+u8 *towire_gossipd_get_txout(const tal_t *ctx,
+			     struct short_channel_id short_channel_id)
+{
+	num_txout_reqs++;
+	return tal_arr(ctx, u8, 0);
+}
+
+void daemon_conn_send(struct daemon_conn *dc, const u8 *msg)
+{
+	if (taken(msg))
+		tal_free(msg);
+}
+
+static void write_to_store(int store_fd, const u8 *msg, u32 timestamp)
+{
+	struct gossip_hdr hdr;
+
+	hdr.flags = cpu_to_be16(0);
+	hdr.len = cpu_to_be16(tal_count(msg));
+	hdr.timestamp = cpu_to_be32(timestamp);
+	hdr.crc = cpu_to_be32(crc32c(timestamp, msg, tal_count(msg)));
+	assert(write(store_fd, &hdr, sizeof(hdr)) == sizeof(hdr));
+	assert(write(store_fd, msg, tal_count(msg)) == tal_count(msg));
+}
+
+static const u8 *cannounce(const struct node_id ids[2],
+			   struct short_channel_id scid)
+{
+	secp256k1_ecdsa_signature dummy_sig;
+	struct secret not_a_secret;
+	struct pubkey dummy_key;
+
+	/* So valgrind doesn't complain */
+	memset(&dummy_sig, 0, sizeof(dummy_sig));
+	memset(&not_a_secret, 1, sizeof(not_a_secret));
+	pubkey_from_secret(&not_a_secret, &dummy_key);
+
+	return towire_channel_announcement(tmpctx, &dummy_sig, &dummy_sig,
+					   &dummy_sig, &dummy_sig,
+					   /* features */ NULL,
+					   &chainparams->genesis_blockhash,
+					   scid, &ids[0], &ids[1],
+					   &dummy_key, &dummy_key);
+}
+
+static const u8 *cupdate(struct short_channel_id scid,
+			 u32 timestamp, u32 base_fee)
+{
+	secp256k1_ecdsa_signature dummy_sig;
+
+	memset(&dummy_sig, 0, sizeof(dummy_sig));
+	return towire_channel_update(tmpctx,
+				     &dummy_sig,
+				     &chainparams->genesis_blockhash,
+				     scid, timestamp,
+				     ROUTING_OPT_HTLC_MAX_MSAT,
+				     0,
+				     6,
+				     AMOUNT_MSAT(0),
+				     base_fee,
+				     1,
+				     AMOUNT_MSAT(100000 * 1000));
+}
+
+static void node_id_from_privkey(const struct privkey *p, struct node_id *id)
+{
+	struct pubkey k;
+	pubkey_from_privkey(p, &k);
+	node_id_from_pubkey(id, &k);
+}
+
+int main(int argc, char *argv[])
+{
+	struct gossmap_manage *gm;
+	struct privkey keys[2];
+	struct node_id ids[2];
+	struct short_channel_id scid, new_scid;
+	char *filename;
+	char gossip_version = 14;
+	const u8 *ann, *upd;
+
+	common_setup(argv[0]);
+	chainparams = chainparams_for_network("regtest");
+
+	memset(&keys[0], 1, sizeof(keys[0]));
+	memset(&keys[1], 2, sizeof(keys[1]));
+	node_id_from_privkey(&keys[0], &ids[0]);
+	node_id_from_privkey(&keys[1], &ids[1]);
+	if (node_id_cmp(&ids[0], &ids[1]) > 0) {
+		struct node_id tmp = ids[0];
+		ids[0] = ids[1];
+		ids[1] = tmp;
+	}
+	assert(mk_short_channel_id(&scid, 100, 1, 0));
+	assert(mk_short_channel_id(&new_scid, 101, 1, 0));
+
+	/* Like gossmap_manage_new, but with a store holding one channel
+	 * (with an update in one direction). */
+	gm = tal(tmpctx, struct gossmap_manage);
+	gm->daemon = tal(gm, struct daemon);
+	gm->daemon->current_blockheight = 1000;
+	gm->daemon->master = NULL;
+	gm->gs = tal(gm, struct gossip_store);
+	gm->gs->fd = tmpdir_mkstemp(tmpctx, "run-gossmap_manage-dups.XXXXXX",
+				    &filename);
+	assert(write(gm->gs->fd, &gossip_version, sizeof(gossip_version))
+	       == sizeof(gossip_version));
+	ann = cannounce(ids, scid);
+	write_to_store(gm->gs->fd, ann, 0);
+	write_to_store(gm->gs->fd,
+		       towire_gossip_store_channel_amount(tmpctx,
+							  AMOUNT_SAT(100000)),
+		       0);
+	upd = cupdate(scid, 1000, 1);
+	write_to_store(gm->gs->fd, upd, 1000);
+
+	gm->raw_gossmap = gossmap_load(gm, filename, NULL, NULL);
+	assert(gm->raw_gossmap);
+	map_init(&gm->pending_ann_map, "pending announcements");
+	gm->pending_cupdates = tal_arr(gm, struct pending_cupdate *, 0);
+	map_init(&gm->early_ann_map, "too-early announcements");
+	gm->early_cupdates = tal_arr(gm, struct pending_cupdate *, 0);
+	gm->pending_nannounces = tal_arr(gm, struct pending_nannounce *, 0);
+	gm->txf = NULL;
+
+	/* The same channel_announcement again: ignored, unchecked. */
+	assert(!gossmap_manage_channel_announcement(tmpctx, gm, ann,
+						    &ids[0], NULL));
+	assert(num_sigchecks == 0);
+	assert(num_txout_reqs == 0);
+
+	/* A new one is checked, and we ask lightningd about it... */
+	ann = cannounce(ids, new_scid);
+	assert(!gossmap_manage_channel_announcement(tmpctx, gm, ann,
+						    &ids[0], NULL));
+	assert(num_sigchecks == 1);
+	assert(num_txout_reqs == 1);
+
+	/* ... but not again while we wait for the answer. */
+	assert(!gossmap_manage_channel_announcement(tmpctx, gm, ann,
+						    &ids[1], NULL));
+	assert(num_sigchecks == 1);
+	assert(num_txout_reqs == 1);
+
+	/* The same channel_update again: ignored, unchecked. */
+	assert(!gossmap_manage_channel_update(tmpctx, gm, upd, &ids[0]));
+	assert(num_sigchecks == 1);
+
+	/* As is an older one. */
+	assert(!gossmap_manage_channel_update(tmpctx, gm,
+					      cupdate(scid, 999, 2),
+					      &ids[0]));
+	assert(num_sigchecks == 1);
+
+	/* A different one with the same timestamp is checked (a corrupt
+	 * copy would still get its warning), then ignored. */
+	assert(!gossmap_manage_channel_update(tmpctx, gm,
+					      cupdate(scid, 1000, 2),
+					      &ids[0]));
+	assert(num_sigchecks == 2);
+
+	unlink(filename);
+	common_shutdown();
+}
@@ -75,8 +75,9 @@ struct client {
  * the map is typesafe: the compiler won't let you put anything in but a
  * struct client pointer. */
 static UINTMAP(struct client *) clients;
-/*~ Plus the three zero-dbid clients: master, gossipd and connnectd. */
-static struct client *dbid_zero_clients[3];
+/*~ Plus the four zero-dbid clients: master, gossipd, connnectd and
+ * lightningd's second connection for async requests. */
+static struct client *dbid_zero_clients[4];
 static size_t num_dbid_zero_clients;
 
 /* Are we in developer mode */
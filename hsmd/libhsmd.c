@@ -49,6 +49,7 @@ struct hsmd_client *hsmd_client_new_main(const tal_t *ctx, u64 capabilities,
 	c->dbid = 0;
 	c->capabilities = capabilities;
 	c->extra = extra;
+	c->keys = NULL;
 	return c;
 }
 
@@ -64,6 +65,7 @@ struct hsmd_client *hsmd_client_new_peer(const tal_t *ctx, u64 capabilities,
 	c->capabilities = capabilities;
 	c->id = *peer_id;
 	c->extra = extra;
+	c->keys = NULL;
 	return c;
 }
 
@@ -337,6 +339,43 @@ static void get_channel_seed(const struct node_id *peer_id, u64 dbid,
 		    info, strlen(info));
 }
 
+/*~ channeld asks us to sign every commitment and HTLC transaction, and
+ * deriving the channel seed and basepoints costs an HKDF and five EC
+ * multiplications before we even start signing.  A peer client only ever
+ * talks about one channel, so we derive them once and keep them with the
+ * client (wiping them when it goes away). */
+struct channel_keys {
+	struct secrets secrets;
+	struct basepoints basepoints;
+	struct pubkey funding_pubkey;
+	struct sha256 shaseed;
+};
+
+static void destroy_channel_keys(struct channel_keys *keys)
+{
+	sodium_memzero(keys, sizeof(*keys));
+}
+
+static const struct channel_keys *client_channel_keys(struct hsmd_client *c)
+{
+	struct secret channel_seed;
+
+	if (c->keys)
+		return c->keys;
+
+	c->keys = tal(c, struct channel_keys);
+	tal_add_destructor(c->keys, destroy_channel_keys);
+	get_channel_seed(&c->id, c->dbid, &channel_seed);
+	if (!derive_basepoints(&channel_seed,
+			       &c->keys->funding_pubkey,
+			       &c->keys->basepoints,
+			       &c->keys->secrets,
+			       &c->keys->shaseed))
+		c->keys = tal_free(c->keys);
+	sodium_memzero(&channel_seed, sizeof(channel_seed));
+	return c->keys;
+}
+
 /* ~This stub implementation is overriden by fully validating signers
  * that need to manage per-channel state. */
 static u8 *handle_new_channel(struct hsmd_client *c, const u8 *msg_in)
@@ -1092,20 +1131,19 @@ static u8 *handle_ecdh(struct hsmd_client *c, const u8 *msg_in)
  * secrets.  We carefully check that this is true, here. */
 static u8 *handle_check_future_secret(struct hsmd_client *c, const u8 *msg_in)
 {
-	struct secret channel_seed;
-	struct sha256 shaseed;
+	const struct channel_keys *keys;
 	u64 n;
 	struct secret secret, suggested;
 
 	if (!fromwire_hsmd_check_future_secret(msg_in, &n, &suggested))
 		return hsmd_status_malformed_request(c, msg_in);
 
-	get_channel_seed(&c->id, c->dbid, &channel_seed);
-	if (!derive_shaseed(&channel_seed, &shaseed))
+	keys = client_channel_keys(c);
+	if (!keys)
 		return hsmd_status_bad_request_fmt(c, msg_in,
 						   "bad derive_shaseed");
 
-	if (!per_commit_secret(&shaseed, &secret, n))
+	if (!per_commit_secret(&keys->shaseed, &secret, n))
 		return hsmd_status_bad_request_fmt(
 		    c, msg_in, "bad commit secret #%" PRIu64, n);
 
@@ -1339,8 +1377,7 @@ static u8 *handle_channel_update_sig(struct hsmd_client *c, const u8 *msg_in)
  * the previous commitment transaction. */
 static u8 *handle_get_per_commitment_point(struct hsmd_client *c, const u8 *msg_in)
 {
-	struct secret channel_seed;
-	struct sha256 shaseed;
+	const struct channel_keys *keys;
 	struct pubkey per_commitment_point;
 	u64 n;
 	struct secret *old_secret;
@@ -1348,17 +1385,17 @@ static u8 *handle_get_per_commitment_point(struct hsmd_client *c, const u8 *msg_
 	if (!fromwire_hsmd_get_per_commitment_point(msg_in, &n))
 		return hsmd_status_malformed_request(c, msg_in);
 
-	get_channel_seed(&c->id, c->dbid, &channel_seed);
-	if (!derive_shaseed(&channel_seed, &shaseed))
+	keys = client_channel_keys(c);
+	if (!keys)
 		return hsmd_status_bad_request(c, msg_in, "bad derive_shaseed");
 
-	if (!per_commit_point(&shaseed, &per_commitment_point, n))
+	if (!per_commit_point(&keys->shaseed, &per_commitment_point, n))
 		return hsmd_status_bad_request_fmt(
 		    c, msg_in, "bad per_commit_point %" PRIu64, n);
 
 	if (hsmd_mutual_version < 6 && n >= 2) {
 		old_secret = tal(tmpctx, struct secret);
-		if (!per_commit_secret(&shaseed, old_secret, n - 2)) {
+		if (!per_commit_secret(&keys->shaseed, old_secret, n - 2)) {
 			return hsmd_status_bad_request_fmt(
 			    c, msg_in, "Cannot derive secret %" PRIu64, n - 2);
 		}
@@ -1391,11 +1428,10 @@ static u8 *handle_sign_withdrawal_tx(struct hsmd_client *c, const u8 *msg_in)
 /* This is used by closingd to sign off on a mutual close tx. */
 static u8 *handle_sign_mutual_close_tx(struct hsmd_client *c, const u8 *msg_in)
 {
-	struct secret channel_seed;
+	const struct channel_keys *keys;
 	struct bitcoin_tx *tx;
-	struct pubkey remote_funding_pubkey, local_funding_pubkey;
+	struct pubkey remote_funding_pubkey;
 	struct bitcoin_signature sig;
-	struct secrets secrets;
 	const u8 *funding_wscript;
 
 	if (!fromwire_hsmd_sign_mutual_close_tx(tmpctx, msg_in,
@@ -1407,16 +1443,17 @@ static u8 *handle_sign_mutual_close_tx(struct hsmd_client *c, const u8 *msg_in)
 	/* FIXME: We should know dust level, decent fee range and
 	 * balances, and final_keyindex, and thus be able to check tx
 	 * outputs! */
-	get_channel_seed(&c->id, c->dbid, &channel_seed);
-	derive_basepoints(&channel_seed,
-			  &local_funding_pubkey, NULL, &secrets, NULL);
+	keys = client_channel_keys(c);
+	if (!keys)
+		return hsmd_status_bad_request_fmt(c, msg_in,
+						   "Failed deriving channel keys");
 
 	funding_wscript = bitcoin_redeem_2of2(tmpctx,
-					      &local_funding_pubkey,
+					      &keys->funding_pubkey,
 					      &remote_funding_pubkey);
 	sign_tx_input(tx, 0, NULL, funding_wscript,
-		      &secrets.funding_privkey,
-		      &local_funding_pubkey,
+		      &keys->secrets.funding_privkey,
+		      &keys->funding_pubkey,
 		      SIGHASH_ALL, &sig);
 
 	return towire_hsmd_sign_tx_reply(NULL, &sig);
@@ -1425,11 +1462,10 @@ static u8 *handle_sign_mutual_close_tx(struct hsmd_client *c, const u8 *msg_in)
 /* This is used by channeld to sign the final splice tx. */
 static u8 *handle_sign_splice_tx(struct hsmd_client *c, const u8 *msg_in)
 {
-	struct secret channel_seed;
+	const struct channel_keys *keys;
 	struct bitcoin_tx *tx;
-	struct pubkey remote_funding_pubkey, local_funding_pubkey;
+	struct pubkey remote_funding_pubkey;
 	struct bitcoin_signature sig;
-	struct secrets secrets;
 	unsigned int input_index;
 	const u8 *funding_wscript;
 
@@ -1440,17 +1476,18 @@ static u8 *handle_sign_splice_tx(struct hsmd_client *c, const u8 *msg_in)
 		return hsmd_status_malformed_request(c, msg_in);
 
 	tx->chainparams = c->chainparams;
-	get_channel_seed(&c->id, c->dbid, &channel_seed);
-	derive_basepoints(&channel_seed,
-			  &local_funding_pubkey, NULL, &secrets, NULL);
+	keys = client_channel_keys(c);
+	if (!keys)
+		return hsmd_status_bad_request_fmt(c, msg_in,
+						   "Failed deriving channel keys");
 
 	funding_wscript = bitcoin_redeem_2of2(tmpctx,
-					      &local_funding_pubkey,
+					      &keys->funding_pubkey,
 					      &remote_funding_pubkey);
 
 	sign_tx_input(tx, input_index, NULL, funding_wscript,
-		      &secrets.funding_privkey,
-		      &local_funding_pubkey,
+		      &keys->secrets.funding_privkey,
+		      &keys->funding_pubkey,
 		      SIGHASH_ALL, &sig);
 
 	return towire_hsmd_sign_tx_reply(NULL, &sig);
@@ -1578,11 +1615,9 @@ static u8 *handle_sign_any_local_htlc_tx(struct hsmd_client *c, const u8 *msg_in
  * HTLC transactions. */
 static u8 *handle_sign_remote_htlc_tx(struct hsmd_client *c, const u8 *msg_in)
 {
-	struct secret channel_seed;
+	const struct channel_keys *keys;
 	struct bitcoin_tx *tx;
 	struct bitcoin_signature sig;
-	struct secrets secrets;
-	struct basepoints basepoints;
 	struct pubkey remote_per_commit_point;
 	u8 *wscript;
 	struct privkey htlc_privkey;
@@ -1596,17 +1631,19 @@ static u8 *handle_sign_remote_htlc_tx(struct hsmd_client *c, const u8 *msg_in)
 		return hsmd_status_malformed_request(c, msg_in);
 
 	tx->chainparams = c->chainparams;
-	get_channel_seed(&c->id, c->dbid, &channel_seed);
-	derive_basepoints(&channel_seed, NULL, &basepoints, &secrets, NULL);
+	keys = client_channel_keys(c);
+	if (!keys)
+		return hsmd_status_bad_request_fmt(c, msg_in,
+						   "Failed deriving channel keys");
 
-	if (!derive_simple_privkey(&secrets.htlc_basepoint_secret,
-				   &basepoints.htlc,
+	if (!derive_simple_privkey(&keys->secrets.htlc_basepoint_secret,
+				   &keys->basepoints.htlc,
 				   &remote_per_commit_point,
 				   &htlc_privkey))
 		return hsmd_status_bad_request_fmt(
 		    c, msg_in, "Failed deriving htlc privkey");
 
-	if (!derive_simple_key(&basepoints.htlc,
+	if (!derive_simple_key(&keys->basepoints.htlc,
 			       &remote_per_commit_point,
 			       &htlc_pubkey))
 		return hsmd_status_bad_request_fmt(
@@ -1636,11 +1673,10 @@ static u8 *handle_sign_remote_htlc_tx(struct hsmd_client *c, const u8 *msg_in)
 /* FIXME: make sure it meets some criteria? */
 static u8 *handle_sign_remote_commitment_tx(struct hsmd_client *c, const u8 *msg_in)
 {
-	struct pubkey remote_funding_pubkey, local_funding_pubkey;
-	struct secret channel_seed;
+	struct pubkey remote_funding_pubkey;
+	const struct channel_keys *keys;
 	struct bitcoin_tx *tx;
 	struct bitcoin_signature sig;
-	struct secrets secrets;
 	const u8 *funding_wscript;
 	struct pubkey remote_per_commit;
 	bool option_static_remotekey;
@@ -1667,16 +1703,17 @@ static u8 *handle_sign_remote_commitment_tx(struct hsmd_client *c, const u8 *msg
 		return hsmd_status_bad_request_fmt(c, msg_in,
 						   "tx must have > 0 outputs");
 
-	get_channel_seed(&c->id, c->dbid, &channel_seed);
-	derive_basepoints(&channel_seed,
-			  &local_funding_pubkey, NULL, &secrets, NULL);
+	keys = client_channel_keys(c);
+	if (!keys)
+		return hsmd_status_bad_request_fmt(c, msg_in,
+						   "Failed deriving channel keys");
 
 	funding_wscript = bitcoin_redeem_2of2(tmpctx,
-					      &local_funding_pubkey,
+					      &keys->funding_pubkey,
 					      &remote_funding_pubkey);
 	sign_tx_input(tx, 0, NULL, funding_wscript,
-		      &secrets.funding_privkey,
-		      &local_funding_pubkey,
+		      &keys->secrets.funding_privkey,
+		      &keys->funding_pubkey,
 		      SIGHASH_ALL,
 		      &sig);
 
@@ -1886,8 +1923,7 @@ static u8 *handle_validate_commitment_tx(struct hsmd_client *c, const u8 *msg_in
 	u32 feerate;
 	struct bitcoin_signature sig;
 	struct bitcoin_signature *htlc_sigs;
-	struct secret channel_seed;
-	struct sha256 shaseed;
+	const struct channel_keys *keys;
 	struct secret *old_secret;
 	struct pubkey next_per_commitment_point;
 
@@ -1904,11 +1940,11 @@ static u8 *handle_validate_commitment_tx(struct hsmd_client *c, const u8 *msg_in
 	 * old_secret and next_per_commitment_point are used.
 	 */
 
-	get_channel_seed(&c->id, c->dbid, &channel_seed);
-	if (!derive_shaseed(&channel_seed, &shaseed))
+	keys = client_channel_keys(c);
+	if (!keys)
 		return hsmd_status_bad_request(c, msg_in, "bad derive_shaseed");
 
-	if (!per_commit_point(&shaseed, &next_per_commitment_point, commit_num + 1))
+	if (!per_commit_point(&keys->shaseed, &next_per_commitment_point, commit_num + 1))
 		return hsmd_status_bad_request_fmt(
 		    c, msg_in, "bad per_commit_point %" PRIu64, commit_num + 1);
 
@@ -1931,8 +1967,7 @@ static u8 *handle_validate_commitment_tx(struct hsmd_client *c, const u8 *msg_in
 static u8 *handle_revoke_commitment_tx(struct hsmd_client *c, const u8 *msg_in)
 {
 	u64 commit_num;
-	struct secret channel_seed;
-	struct sha256 shaseed;
+	const struct channel_keys *keys;
 	struct secret *old_secret;
 	struct pubkey next_per_commitment_point;
 
@@ -1946,16 +1981,16 @@ static u8 *handle_revoke_commitment_tx(struct hsmd_client *c, const u8 *msg_in)
 	 * old_secret and next_per_commitment_point are used.
 	 */
 
-	get_channel_seed(&c->id, c->dbid, &channel_seed);
-	if (!derive_shaseed(&channel_seed, &shaseed))
+	keys = client_channel_keys(c);
+	if (!keys)
 		return hsmd_status_bad_request(c, msg_in, "bad derive_shaseed");
 
-	if (!per_commit_point(&shaseed, &next_per_commitment_point, commit_num + 2))
+	if (!per_commit_point(&keys->shaseed, &next_per_commitment_point, commit_num + 2))
 		return hsmd_status_bad_request_fmt(
 		    c, msg_in, "bad per_commit_point %" PRIu64, commit_num + 2);
 
 	old_secret = tal(tmpctx, struct secret);
-	if (!per_commit_secret(&shaseed, old_secret, commit_num)) {
+	if (!per_commit_secret(&keys->shaseed, old_secret, commit_num)) {
 		return hsmd_status_bad_request_fmt(
 		    c, msg_in, "Cannot derive secret %" PRIu64, commit_num);
 	}
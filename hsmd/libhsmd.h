@@ -29,6 +29,9 @@ struct hsmd_client {
 	/* Params to apply to all transactions for this client */
 	const struct chainparams *chainparams;
 
+	/* Keys for the channel (dbid != 0), derived on first use. */
+	struct channel_keys *keys;
+
 	/* A pointer to extra context that is to be passed around with
 	 * the request. Used in `hsmd` to determine which connection
 	 * originated the request. It is passed to the `hsmd_status_*`
@@ -536,7 +536,8 @@ void bitcoind_getrawblockbyheight_(const tal_t *ctx,
 
 	trace_span_start("plugin/bitcoind", call);
 	trace_span_tag(call, "method", "getrawblockbyheight");
-	trace_span_suspend(call);
+	/* Prefetches get discarded (freed) if we reorg while they are in flight */
+	trace_span_suspend_may_free(call);
 	req = jsonrpc_request_start(call, "getrawblockbyheight", NULL,
 				    bitcoind->log,
 				    NULL,  getrawblockbyheight_callback,
@@ -702,11 +703,25 @@ struct filteredblock_call {
 
 	struct filteredblock *result;
 	struct filteredblock_outpoint **outpoints;
-	size_t current_outpoint;
+	/* Which outpoints are unspent (same indices as outpoints) */
+	bool *unspent;
+	/* Next outpoint to ask about, and how many answers are outstanding */
+	size_t current_outpoint, num_pending;
 	struct timeabs start_time;
 	u32 height;
 };
 
+/* One getutxout call for a filteredblock_call */
+struct filteredblock_utxo {
+	struct filteredblock_call *call;
+	size_t idx;
+};
+
+/* A block can have thousands of P2WSH outputs: asking one at a time
+ * makes every unknown block cost thousands of round trips, but we don't
+ * want to crowd out other bitcoind requests either. */
+#define GETFILTEREDBLOCK_PARALLEL 8
+
 /* Declaration for recursion in process_getfilteredblock_step1 */
 static void
 process_getfiltered_block_final(struct bitcoind *bitcoind,
@@ -715,24 +730,48 @@ process_getfiltered_block_final(struct bitcoind *bitcoind,
 static void
 process_getfilteredblock_step2(struct bitcoind *bitcoind,
 			       const struct bitcoin_tx_output *output,
-			       void *arg)
+			       struct filteredblock_utxo *fu);
+
+static void getfilteredblock_next_utxo(struct bitcoind *bitcoind,
+				       struct filteredblock_call *call)
+{
+	struct filteredblock_utxo *fu = tal(call, struct filteredblock_utxo);
+
+	fu->call = call;
+	fu->idx = call->current_outpoint++;
+	call->num_pending++;
+	bitcoind_getutxout(call, bitcoind, &call->outpoints[fu->idx]->outpoint,
+			   process_getfilteredblock_step2, fu);
+}
+
+static void
+process_getfilteredblock_step2(struct bitcoind *bitcoind,
+			       const struct bitcoin_tx_output *output,
+			       struct filteredblock_utxo *fu)
 {
-	struct filteredblock_call *call = (struct filteredblock_call *)arg;
-	struct filteredblock_outpoint *o = call->outpoints[call->current_outpoint];
+	struct filteredblock_call *call = fu->call;
 
-	/* If this output is unspent, add it to the filteredblock result. */
-	if (output)
-		tal_arr_expand(&call->result->outpoints, tal_steal(call->result, o));
+	call->unspent[fu->idx] = (output != NULL);
+	tal_free(fu);
+	call->num_pending--;
 
-	call->current_outpoint++;
 	if (call->current_outpoint < tal_count(call->outpoints)) {
-		o = call->outpoints[call->current_outpoint];
-		bitcoind_getutxout(call, bitcoind, &o->outpoint,
-				   process_getfilteredblock_step2, call);
-	} else {
-		/* If there were no more outpoints to check, we call the callback. */
-		process_getfiltered_block_final(bitcoind, call);
+		getfilteredblock_next_utxo(bitcoind, call);
+		return;
 	}
+	if (call->num_pending != 0)
+		return;
+
+	/* Add the unspent ones to the filteredblock result, in block order. */
+	for (size_t i = 0; i < tal_count(call->outpoints); i++) {
+		if (call->unspent[i])
+			tal_arr_expand(&call->result->outpoints,
+				       tal_steal(call->result,
+						 call->outpoints[i]));
+	}
+
+	/* If there were no more outpoints to check, we call the callback. */
+	process_getfiltered_block_final(bitcoind, call);
 }
 
 static void process_getfilteredblock_step1(struct bitcoind *bitcoind,
@@ -795,12 +834,13 @@ static void process_getfilteredblock_step1(struct bitcoind *bitcoind,
 		process_getfiltered_block_final(bitcoind, call);
 	} else {
 
-		/* Otherwise we start iterating through call->outpoints and
-		 * store the one's that are unspent in
+		/* Otherwise we ask which of call->outpoints are unspent,
+		 * a few at a time, and store those in
 		 * call->result->outpoints. */
-		o = call->outpoints[call->current_outpoint];
-		bitcoind_getutxout(call, bitcoind, &o->outpoint,
-				   process_getfilteredblock_step2, call);
+		call->unspent = tal_arr(call, bool, tal_count(call->outpoints));
+		while (call->current_outpoint < tal_count(call->outpoints)
+		       && call->num_pending < GETFILTEREDBLOCK_PARALLEL)
+			getfilteredblock_next_utxo(bitcoind, call);
 	}
 }
 
@@ -860,7 +900,7 @@ void bitcoind_getfilteredblock_(const tal_t *ctx,
 	assert(call->cb != NULL);
 	call->start_time = time_now();
 	call->result = NULL;
-	call->current_outpoint = 0;
+	call->current_outpoint = call->num_pending = 0;
 
 	list_add_tail(&bitcoind->pending_getfilteredblock, &call->list);
 	tal_add_destructor(call, destroy_filteredblock_call);
@@ -27,6 +27,9 @@
 #include <math.h>
 #include <wallet/txfilter.h>
 
+/* How many blocks we request ahead of the tip while catching up. */
+#define MAX_BLOCK_PREFETCH 8
+
 /* Mutual recursion via timer. */
 static void try_extend_tip(struct chain_topology *topo);
 
@@ -1035,45 +1038,110 @@ static void remove_tip(struct chain_topology *topo)
 	tal_free(b);
 }
 
+/* A getrawblockbyheight request, possibly ahead of the tip. */
+struct block_fetch {
+	struct chain_topology *topo;
+	u32 height;
+	bool done;
+	/* NULL if there was no such block. */
+	struct bitcoin_block *blk;
+};
+
+static void fetch_blocks(struct chain_topology *topo);
+
+/* Forget about blocks we asked for: we don't want them any more. */
+static void discard_block_fetches(struct chain_topology *topo)
+{
+	for (size_t i = 0; i < tal_count(topo->block_fetches); i++)
+		tal_free(topo->block_fetches[i]);
+	tal_resize(&topo->block_fetches, 0);
+}
+
+/* Apply blocks to the tip in order, as long as we have them. */
+static void apply_fetched_blocks(struct chain_topology *topo)
+{
+	while (tal_count(topo->block_fetches) && topo->block_fetches[0]->done) {
+		struct block_fetch *f = topo->block_fetches[0];
+
+		assert(f->height == topo->tip->height + 1);
+		tal_arr_remove(&topo->block_fetches, 0);
+
+		if (!f->blk) {
+			/* No such block, we're done. */
+			tal_free(f);
+			discard_block_fetches(topo);
+			updates_complete(topo);
+			trace_span_end(topo);
+			return;
+		}
+
+		/* Unexpected predecessor?  Free predecessor, refetch it
+		 * (and everything after it). */
+		if (!bitcoin_blkid_eq(&topo->tip->blkid, &f->blk->hdr.prev_hash)) {
+			remove_tip(topo);
+			discard_block_fetches(topo);
+		} else {
+			add_tip(topo, new_block(topo, f->blk, f->height));
+
+			/* tell plugins a new block was processed */
+			notify_block_added(topo->ld, topo->tip);
+		}
+		tal_free(f);
+	}
+
+	/* Try for next ones. */
+	fetch_blocks(topo);
+}
+
 static void get_new_block(struct bitcoind *bitcoind,
 			  u32 height,
 			  struct bitcoin_blkid *blkid,
 			  struct bitcoin_block *blk,
-			  struct chain_topology *topo)
+			  struct block_fetch *f)
 {
-	if (!blkid && !blk) {
-		/* No such block, we're done. */
-		updates_complete(topo);
-		trace_span_end(topo);
-		return;
+	f->done = true;
+	if (blk) {
+		assert(blkid);
+		/* Annotate all transactions with the chainparams */
+		for (size_t i = 0; i < tal_count(blk->tx); i++)
+			blk->tx[i]->chainparams = chainparams;
+		/* blk is allocated off tmpctx, and we may keep it a while */
+		f->blk = tal_steal(f, blk);
 	}
-	assert(blkid && blk);
-
-	/* Annotate all transactions with the chainparams */
-	for (size_t i = 0; i < tal_count(blk->tx); i++)
-		blk->tx[i]->chainparams = chainparams;
 
-	/* Unexpected predecessor?  Free predecessor, refetch it. */
-	if (!bitcoin_blkid_eq(&topo->tip->blkid, &blk->hdr.prev_hash))
-		remove_tip(topo);
-	else {
-		add_tip(topo, new_block(topo, blk, height));
+	/* If it's not the next one, wait for those before it. */
+	if (f == f->topo->block_fetches[0])
+		apply_fetched_blocks(f->topo);
+}
 
-		/* tell plugins a new block was processed */
-		notify_block_added(topo->ld, topo->tip);
+/* If we're catching up, we keep up to MAX_BLOCK_PREFETCH requests in flight
+ * so bitcoind round trips overlap with us processing blocks; otherwise we
+ * only ask for the one after the tip.  Headers can be far ahead of the
+ * blocks bitcoind actually has, so we only prefetch up to blockcount. */
+static void fetch_blocks(struct chain_topology *topo)
+{
+	u32 next = topo->tip->height + 1 + tal_count(topo->block_fetches);
+
+	while (tal_count(topo->block_fetches) < MAX_BLOCK_PREFETCH
+	       && (tal_count(topo->block_fetches) == 0
+		   || next <= topo->blockcount)) {
+		struct block_fetch *f = tal(topo->request_ctx, struct block_fetch);
+
+		f->topo = topo;
+		f->height = next++;
+		f->done = false;
+		f->blk = NULL;
+		tal_arr_expand(&topo->block_fetches, f);
+		bitcoind_getrawblockbyheight(f, topo->bitcoind, f->height,
+					     get_new_block, f);
 	}
-
-	/* Try for next one. */
-	trace_span_end(topo);
-	try_extend_tip(topo);
 }
 
 static void try_extend_tip(struct chain_topology *topo)
 {
 	topo->extend_timer = NULL;
 	trace_span_start("extend_tip", topo);
-	bitcoind_getrawblockbyheight(topo->request_ctx, topo->bitcoind, topo->tip->height + 1,
-				     get_new_block, topo);
+	fetch_blocks(topo);
 }
 
 u32 get_block_height(const struct chain_topology *topo)
@@ -1216,6 +1284,7 @@ struct chain_topology *new_topology(struct lightningd *ld, struct logger *log)
 	topo->updatefee_timer = NULL;
 	topo->checkchain_timer = NULL;
 	topo->request_ctx = tal(topo, char);
+	topo->block_fetches = tal_arr(topo, struct block_fetch *, 0);
 	list_head_init(topo->sync_waiters);
 
 	return topo;
@@ -1226,6 +1295,7 @@ static bool check_sync(struct bitcoind *bitcoind,
 		       struct chain_topology *topo, bool first_call)
 {
 	topo->headercount = headercount;
+	topo->blockcount = blockcount;
 
 	if (ibd) {
 		if (first_call)
@@ -1411,6 +1481,7 @@ void setup_topology(struct chain_topology *topo)
 	}
 
 	topo->headercount = chaininfo->headercount;
+	topo->blockcount = chaininfo->blockcount;
 	if (!streq(chaininfo->chain, chainparams->bip70_name))
 		fatal("Wrong network! Our Bitcoin backend is running on '%s',"
 		      " but we expect '%s'.", chaininfo->chain, chainparams->bip70_name);
@@ -1504,4 +1575,5 @@ void stop_topology(struct chain_topology *topo)
 
 	/* Don't handle responses to any existing requests. */
 	tal_free(topo->request_ctx);
+	tal_resize(&topo->block_fetches, 0);
 }
@@ -8,6 +8,7 @@
 
 struct bitcoin_tx;
 struct bitcoind;
+struct block_fetch;
 struct command;
 struct lightningd;
 struct peer;
@@ -135,6 +136,9 @@ struct chain_topology {
 	/* Parent context for requests (to bcli plugin) we have outstanding. */
 	tal_t *request_ctx;
 
+	/* Blocks we've asked for, in height order starting at tip + 1. */
+	struct block_fetch **block_fetches;
+
 	/* Bitcoin transactions we're broadcasting */
 	struct outgoing_tx_map *outgoing_txs;
 
@@ -145,6 +149,10 @@ struct chain_topology {
 	/* The number of headers known to the bitcoin backend at startup. Not
 	 * updated after the initial check. */
 	u32 headercount;
+
+	/* The number of blocks the bitcoin backend had at the same time: it
+	 * can't give us any beyond this yet. */
+	u32 blockcount;
 };
 
 /* Information relevant to locating a TX in a blockchain. */
@@ -166,6 +166,54 @@ static void listforwardings_add_forwardings(struct json_stream *response,
 	json_array_end(response);
 }
 
+/* Without channel filters we can page through by index, a batch at a time */
+struct listforwards_batch {
+	enum forward_status status;
+	enum wait_index listindex;
+	/* Next index value to ask for */
+	u64 next;
+	/* NULL if unlimited */
+	u32 *remaining;
+};
+
+static bool listforwards_next_batch(struct command *cmd,
+				    struct json_stream *response,
+				    struct listforwards_batch *lb)
+{
+	struct wallet *wallet = cmd->ld->wallet;
+	struct db_stmt *stmt;
+	u32 limit = LIST_BATCH_ROWS;
+	size_t n = 0;
+
+	if (lb->remaining && *lb->remaining < limit)
+		limit = *lb->remaining;
+
+	stmt = forwarding_first(wallet, lb->status, NULL, NULL,
+				&lb->listindex, lb->next, &limit);
+	while (stmt) {
+		const struct forwarding *cur = forwarding_details(tmpctx, wallet, stmt);
+		json_object_start(response, NULL);
+		json_add_forwarding_fields(response, cur, NULL);
+		json_object_end(response);
+		if (lb->listindex == WAIT_INDEX_UPDATED)
+			lb->next = cur->updated_index + 1;
+		else
+			lb->next = cur->created_index + 1;
+		tal_free(cur);
+		n++;
+		stmt = forwarding_next(wallet, stmt);
+	}
+
+	if (lb->remaining)
+		*lb->remaining -= n;
+
+	if (n < limit || (lb->remaining && *lb->remaining == 0)) {
+		json_array_end(response);
+		return false;
+	}
+	return true;
+}
+
 static struct command_result *param_forward_status(struct command *cmd,
 						   const char *name,
 						   const char *buffer,
@@ -194,6 +242,7 @@ static struct command_result *json_listforwards(struct command *cmd,
 	enum wait_index *listindex;
 	u64 *liststart;
 	u32 *listlimit;
+	struct listforwards_batch *lb;
 
 	if (!param(cmd, buffer, params,
 		   p_opt_def("status", param_forward_status, &status,
@@ -221,9 +270,20 @@ static struct command_result *json_listforwards(struct command *cmd,
 	}
 
 	response = json_stream_success(cmd);
-	listforwardings_add_forwardings(response, cmd->ld->wallet, *status, chan_in, chan_out, listindex, *liststart, listlimit);
+	if (chan_in || chan_out) {
+		listforwardings_add_forwardings(response, cmd->ld->wallet, *status, chan_in, chan_out, listindex, *liststart, listlimit);
+		return command_success(cmd, response);
+	}
 
-	return command_success(cmd, response);
+	lb = tal(cmd, struct listforwards_batch);
+	lb->status = *status;
+	lb->listindex = listindex ? *listindex : WAIT_INDEX_CREATED;
+	lb->next = *liststart;
+	lb->remaining = listlimit;
+
+	json_array_start(response, "forwards");
+	return command_success_batched(cmd, response,
+				       listforwards_next_batch, lb);
 }
 
 static const struct json_command listforwards_command = {
@@ -2,6 +2,7 @@
 #include <ccan/err/err.h>
 #include <ccan/fdpass/fdpass.h>
 #include <common/bolt12_id.h>
+#include <common/daemon_conn.h>
 #include <common/ecdh.h>
 #include <common/errcode.h>
 #include <common/hsm_capable.h>
@@ -10,8 +11,10 @@
 #include <common/json_command.h>
 #include <common/json_param.h>
 #include <common/jsonrpc_errors.h>
+#include <db/exec.h>
 #include <errno.h>
 #include <hsmd/hsmd_wiregen.h>
+#include <hsmd/permissions.h>
 #include <lightningd/hsm_control.h>
 #include <lightningd/jsonrpc.h>
 #include <lightningd/lightningd.h>
@@ -74,6 +77,99 @@ static unsigned int hsm_msg(struct subd *hsmd,
 	return 0;
 }
 
+/* Our async connection to hsmd: it answers in order, so the first request
+ * is the one being answered. */
+struct hsm_conn {
+	struct lightningd *ld;
+	struct daemon_conn *dc;
+	struct list_head reqs;
+};
+
+struct hsm_req {
+	struct list_node list;
+	void (*cb)(struct lightningd *ld, const u8 *reply, void *arg);
+	void *arg;
+	/* If non-NULL, this is here to disable cb */
+	void *disabler;
+};
+
+/* Called when the callback is disabled because caller was freed. */
+static void disable_hsm_req(void *disabler UNUSED, struct hsm_req *req)
+{
+	req->cb = NULL;
+	req->disabler = NULL;
+}
+
+static struct io_plan *hsm_conn_recv(struct io_conn *conn,
+				     const u8 *msg,
+				     struct hsm_conn *hc)
+{
+	struct hsm_req *req = list_pop(&hc->reqs, struct hsm_req, list);
+
+	if (!req)
+		fatal("Unexpected reply from HSM: %s", tal_hex(tmpctx, msg));
+
+	if (req->disabler) {
+		tal_del_destructor2(req->disabler, disable_hsm_req, req);
+		tal_free(req->disabler);
+	}
+	/* Callbacks touch the db (e.g. invoices), just like subd replies */
+	if (req->cb) {
+		db_begin_transaction(hc->ld->wallet->db);
+		req->cb(hc->ld, msg, req->arg);
+		db_commit_transaction(hc->ld->wallet->db);
+	}
+	tal_free(req);
+
+	return daemon_conn_read_next(conn, hc->dc);
+}
+
+static void destroy_hsm_dc(struct daemon_conn *dc, struct hsm_conn *hc)
+{
+	if (hc->ld->state == LD_STATE_SHUTDOWN)
+		return;
+	fatal("Lost async connection to HSM");
+}
+
+/* We use a second connection (with the same permissions as our main one),
+ * so async requests don't get tangled with hsm_sync_req. */
+static struct hsm_conn *new_hsm_conn(struct lightningd *ld)
+{
+	struct hsm_conn *hc = tal(ld, struct hsm_conn);
+	int fd = hsm_get_global_fd(ld, HSM_PERM_MASTER
+				   | HSM_PERM_SIGN_GOSSIP
+				   | HSM_PERM_ECDH);
+
+	hc->ld = ld;
+	list_head_init(&hc->reqs);
+	hc->dc = daemon_conn_new(hc, fd, hsm_conn_recv, NULL, hc);
+	tal_add_destructor2(hc->dc, destroy_hsm_dc, hc);
+	return hc;
+}
+
+void hsm_req_(const tal_t *ctx,
+	      struct lightningd *ld,
+	      const u8 *msg TAKES,
+	      void (*cb)(struct lightningd *ld, const u8 *reply, void *arg),
+	      void *arg)
+{
+	struct hsm_req *req = tal(ld->hsm_conn, struct hsm_req);
+
+	req->cb = cb;
+	req->arg = arg;
+	/* We don't allocate req off ctx, because we still have to read the
+	 * reply if ctx is freed before it arrives. */
+	if (ctx) {
+		req->disabler = notleak(tal(ctx, char));
+		tal_add_destructor2(req->disabler, disable_hsm_req, req);
+	} else
+		req->disabler = NULL;
+
+	/* Keep in FIFO order: we sent in order, so replies will be too. */
+	list_add_tail(&ld->hsm_conn->reqs, &req->list);
+	daemon_conn_send(ld->hsm_conn->dc, msg);
+}
+
 /* Is this capability supported by the HSM? (So far, always a message
  * number) */
 bool hsm_capable(struct lightningd *ld, u32 msgtype)
@@ -206,6 +302,8 @@ struct ext_key *hsm_init(struct lightningd *ld)
 	if (!fromwire_hsmd_derive_secret_reply(msg, &ld->nodealias_base))
 		err(EXITCODE_HSM_GENERIC_ERROR, "Bad derive_secret_reply");
 
+	ld->hsm_conn = new_hsm_conn(ld);
+
 	return bip32_base;
 }
 
@@ -2,6 +2,7 @@
 #define LIGHTNING_LIGHTNINGD_HSM_CONTROL_H
 #include "config.h"
 #include <ccan/short_types/short_types.h>
+#include <ccan/typesafe_cb/typesafe_cb.h>
 
 struct lightningd;
 struct node_id;
@@ -27,6 +28,23 @@ const u8 *hsm_sync_req(const tal_t *ctx,
 		       struct lightningd *ld,
 		       const u8 *msg TAKES);
 
+/* Send request to hsmd, call cb with response (unless ctx is freed
+ * first).  Unlike hsm_sync_req, this doesn't block: requests are pipelined
+ * and answered in order, but may be answered before or after any
+ * hsm_sync_req. */
+#define hsm_req(ctx, ld, msg, cb, arg)					\
+	hsm_req_((ctx), (ld), (msg),					\
+		 typesafe_cb_preargs(void, void *, (cb), (arg),		\
+				     struct lightningd *,		\
+				     const u8 *),			\
+		 (arg))
+
+void hsm_req_(const tal_t *ctx,
+	      struct lightningd *ld,
+	      const u8 *msg TAKES,
+	      void (*cb)(struct lightningd *ld, const u8 *reply, void *arg),
+	      void *arg);
+
 /* Get (and check!) a bip32 derived pubkey */
 void bip32_pubkey(struct lightningd *ld, struct pubkey *pubkey, u32 index);
 
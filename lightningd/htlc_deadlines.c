@@ -0,0 +1,143 @@
+#include "config.h"
+#include <common/memleak.h>
+#include <common/utils.h>
+#include <lightningd/htlc_deadlines.h>
+#include <lightningd/htlc_end.h>
+#include <lightningd/lightningd.h>
+
+/* BOLT #2:
+ *
+ * 2. the deadline for offered HTLCs: the deadline after which the channel has
+ *    to be failed and timed out on-chain. This is `G` blocks after the HTLC's
+ *    `cltv_expiry`: 1 or 2 blocks is reasonable.
+ */
+static u32 htlc_out_deadline(const struct htlc_out *hout)
+{
+	return hout->cltv_expiry + 1;
+}
+
+/* BOLT #2:
+ *
+ * 3. the deadline for received HTLCs this node has fulfilled: the deadline
+ * after which the channel has to be failed and the HTLC fulfilled on-chain
+ * before its `cltv_expiry`. See steps 4-7 above, which imply a deadline of
+ * `2R+G+S` blocks before `cltv_expiry`: 18 blocks is reasonable.
+ */
+/* We approximate this, by using half the cltv_expiry_delta (3R+2G+2S),
+ * rounded up. */
+static u32 htlc_in_deadline(const struct lightningd *ld,
+			    const struct htlc_in *hin)
+{
+	return hin->cltv_expiry - (ld->config.cltv_expiry_delta + 1)/2;
+}
+
+static void destroy_htlc_deadlines(struct htlc_deadlines *hd)
+{
+	uintmap_clear(&hd->map);
+}
+
+struct htlc_deadlines *new_htlc_deadlines(const tal_t *ctx)
+{
+	struct htlc_deadlines *hd = tal(ctx, struct htlc_deadlines);
+	uintmap_init(&hd->map);
+	tal_add_destructor(hd, destroy_htlc_deadlines);
+	return hd;
+}
+
+void htlc_deadlines_memleak(struct htable *memtable,
+			    const struct htlc_deadlines *hd)
+{
+	memleak_scan_uintmap(memtable, &hd->map);
+}
+
+static struct htlc_deadline_bucket *deadline_bucket(struct htlc_deadlines *hd,
+						    u32 deadline)
+{
+	struct htlc_deadline_bucket *b = uintmap_get(&hd->map, deadline);
+
+	if (!b) {
+		b = tal(hd, struct htlc_deadline_bucket);
+		b->ins = tal_arr(b, struct htlc_in *, 0);
+		b->outs = tal_arr(b, struct htlc_out *, 0);
+		uintmap_add(&hd->map, deadline, b);
+	}
+	return b;
+}
+
+static void deadline_bucket_maybe_free(struct htlc_deadlines *hd,
+				       u32 deadline,
+				       struct htlc_deadline_bucket *b)
+{
+	if (tal_count(b->ins) == 0 && tal_count(b->outs) == 0) {
+		uintmap_del(&hd->map, deadline);
+		tal_free(b);
+	}
+}
+
+static void destroy_htlc_in_deadline(struct htlc_in *hin,
+				     struct lightningd *ld)
+{
+	u32 deadline = htlc_in_deadline(ld, hin);
+	struct htlc_deadline_bucket *b;
+
+	b = uintmap_get(&ld->htlc_deadlines->map, deadline);
+	for (size_t i = 0; i < tal_count(b->ins); i++) {
+		if (b->ins[i] == hin) {
+			tal_arr_remove(&b->ins, i);
+			break;
+		}
+	}
+	deadline_bucket_maybe_free(ld->htlc_deadlines, deadline, b);
+}
+
+static void destroy_htlc_out_deadline(struct htlc_out *hout,
+				      struct lightningd *ld)
+{
+	u32 deadline = htlc_out_deadline(hout);
+	struct htlc_deadline_bucket *b;
+
+	b = uintmap_get(&ld->htlc_deadlines->map, deadline);
+	for (size_t i = 0; i < tal_count(b->outs); i++) {
+		if (b->outs[i] == hout) {
+			tal_arr_remove(&b->outs, i);
+			break;
+		}
+	}
+	deadline_bucket_maybe_free(ld->htlc_deadlines, deadline, b);
+}
+
+void htlc_in_index_deadline(struct lightningd *ld, struct htlc_in *hin)
+{
+	struct htlc_deadline_bucket *b;
+
+	b = deadline_bucket(ld->htlc_deadlines, htlc_in_deadline(ld, hin));
+	tal_arr_expand(&b->ins, hin);
+	tal_add_destructor2(hin, destroy_htlc_in_deadline, ld);
+}
+
+void htlc_out_index_deadline(struct lightningd *ld, struct htlc_out *hout)
+{
+	struct htlc_deadline_bucket *b;
+
+	b = deadline_bucket(ld->htlc_deadlines, htlc_out_deadline(hout));
+	tal_arr_expand(&b->outs, hout);
+	tal_add_destructor2(hout, destroy_htlc_out_deadline, ld);
+}
+
+void htlcs_index_deadlines(struct lightningd *ld)
+{
+	struct htlc_in *hin;
+	struct htlc_in_map_iter ini;
+	struct htlc_out *hout;
+	struct htlc_out_map_iter outi;
+
+	for (hin = htlc_in_map_first(ld->htlcs_in, &ini);
+	     hin;
+	     hin = htlc_in_map_next(ld->htlcs_in, &ini))
+		htlc_in_index_deadline(ld, hin);
+
+	for (hout = htlc_out_map_first(ld->htlcs_out, &outi);
+	     hout;
+	     hout = htlc_out_map_next(ld->htlcs_out, &outi))
+		htlc_out_index_deadline(ld, hout);
+}
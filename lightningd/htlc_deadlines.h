@@ -0,0 +1,37 @@
+#ifndef LIGHTNING_LIGHTNINGD_HTLC_DEADLINES_H
+#define LIGHTNING_LIGHTNINGD_HTLC_DEADLINES_H
+#include "config.h"
+#include <ccan/intmap/intmap.h>
+#include <ccan/tal/tal.h>
+
+struct htable;
+struct htlc_in;
+struct htlc_out;
+struct lightningd;
+
+/*~ Every block we need to check HTLCs which have hit their deadline.  There
+ * can be tens of thousands of HTLCs in flight, and almost none of them will
+ * have expired, so we keep them bucketed by deadline and only look at the
+ * buckets at or below the current height. */
+struct htlc_deadline_bucket {
+	struct htlc_in **ins;
+	struct htlc_out **outs;
+};
+
+struct htlc_deadlines {
+	UINTMAP(struct htlc_deadline_bucket *) map;
+};
+
+/* Index of HTLCs by deadline, for htlcs_notify_new_block(). */
+struct htlc_deadlines *new_htlc_deadlines(const tal_t *ctx);
+void htlc_deadlines_memleak(struct htable *memtable,
+			    const struct htlc_deadlines *hd);
+
+/* Once an HTLC is in ld->htlcs_in/ld->htlcs_out, add it to the deadline
+ * index: it removes itself when freed. */
+void htlc_in_index_deadline(struct lightningd *ld, struct htlc_in *hin);
+void htlc_out_index_deadline(struct lightningd *ld, struct htlc_out *hout);
+
+/* Index everything in ld->htlcs_in/ld->htlcs_out (after loading from db) */
+void htlcs_index_deadlines(struct lightningd *ld);
+#endif /* LIGHTNING_LIGHTNINGD_HTLC_DEADLINES_H */
@@ -464,38 +464,103 @@ void invoice_try_pay(struct lightningd *ld,
 	plugin_hook_call_invoice_payment(ld, NULL, payload);
 }
 
-static bool hsm_sign_b11(const u5 *u5bytes,
-			 const u8 *hrpu8,
-			 secp256k1_ecdsa_recoverable_signature *rsig,
-			 struct lightningd *ld)
+/* bolt11_encode() wants to sign synchronously, so we encode once to find out
+ * what to sign, ask hsmd, and then encode again with the signature. */
+struct b11_signing {
+	struct command *cmd;
+	const struct bolt11 *b11;
+	bool n_field;
+	u5 *u5bytes;
+	u8 *hrpu8;
+	secp256k1_ecdsa_recoverable_signature rsig;
+	struct command_result *(*cb)(struct command *cmd,
+				     const char *b11enc,
+				     void *arg);
+	void *arg;
+};
+
+static bool b11_get_sigdata(const u5 *u5bytes,
+			    const u8 *hrpu8,
+			    secp256k1_ecdsa_recoverable_signature *rsig,
+			    struct b11_signing *bs)
 {
-	const u8 *msg;
+	bs->u5bytes = tal_dup_talarr(bs, u5, u5bytes);
+	bs->hrpu8 = tal_dup_talarr(bs, u8, hrpu8);
+	return false;
+}
+
+static bool b11_use_sig(const u5 *u5bytes,
+			const u8 *hrpu8,
+			secp256k1_ecdsa_recoverable_signature *rsig,
+			struct b11_signing *bs)
+{
+	*rsig = bs->rsig;
+	return true;
+}
+
+static void hsm_sign_b11_done(struct lightningd *ld,
+			      const u8 *msg,
+			      struct b11_signing *bs)
+{
+	const char *b11enc;
 
-	msg = hsm_sync_req(tmpctx, ld,
-			   take(towire_hsmd_sign_invoice(NULL, u5bytes, hrpu8)));
-        if (!fromwire_hsmd_sign_invoice_reply(msg, rsig))
+	if (!fromwire_hsmd_sign_invoice_reply(msg, &bs->rsig))
 		fatal("HSM gave bad sign_invoice_reply %s",
 		      tal_hex(msg, msg));
 
-	return true;
+	/* bs is freed along with cmd */
+	b11enc = bolt11_encode(bs->cmd, bs->b11, bs->n_field, b11_use_sig, bs);
+	was_pending(bs->cb(bs->cmd, b11enc, bs->arg));
+}
+
+#define hsm_sign_b11(cmd, b11, n_field, cb, arg)			\
+	hsm_sign_b11_((cmd), (b11), (n_field),				\
+		      typesafe_cb_preargs(struct command_result *, void *, \
+					  (cb), (arg),			\
+					  struct command *,		\
+					  const char *),		\
+		      (arg))
+
+/* Calls cb with the encoded, signed invoice (NULL if it can't be encoded) */
+static struct command_result *
+hsm_sign_b11_(struct command *cmd,
+	      const struct bolt11 *b11,
+	      bool n_field,
+	      struct command_result *(*cb)(struct command *cmd,
+					   const char *b11enc,
+					   void *arg),
+	      void *arg)
+{
+	struct b11_signing *bs = tal(cmd, struct b11_signing);
+
+	bs->cmd = cmd;
+	bs->b11 = b11;
+	bs->n_field = n_field;
+	bs->u5bytes = NULL;
+	bs->cb = cb;
+	bs->arg = arg;
+
+	/* This fails, once it has told us what to sign. */
+	bolt11_encode(tmpctx, b11, n_field, b11_get_sigdata, bs);
+	if (!bs->u5bytes) {
+		tal_free(bs);
+		return cb(cmd, NULL, arg);
+	}
+
+	hsm_req(cmd, cmd->ld,
+		take(towire_hsmd_sign_invoice(NULL, bs->u5bytes, bs->hrpu8)),
+		hsm_sign_b11_done, bs);
+	return command_still_pending(cmd);
 }
 
-static void hsm_sign_b12_invoice(struct lightningd *ld,
-				 struct tlv_invoice *invoice)
+static u8 *hsm_sign_b12_invoice_req(const struct tlv_invoice *invoice)
 {
 	struct sha256 merkle;
-	const u8 *msg;
 
 	assert(!invoice->signature);
 
  	merkle_tlv(invoice->fields, &merkle);
-	msg = towire_hsmd_sign_bolt12(NULL, "invoice", "signature", &merkle, NULL);
-
-	msg = hsm_sync_req(tmpctx, ld, take(msg));
-	invoice->signature = tal(invoice, struct bip340sig);
-        if (!fromwire_hsmd_sign_bolt12_reply(msg, invoice->signature))
-		fatal("HSM gave bad sign_invoice_reply %s",
-		      tal_hex(msg, msg));
+	return towire_hsmd_sign_bolt12(NULL, "invoice", "signature", &merkle, NULL);
 }
 
 static struct command_result *parse_fallback(struct command *cmd,
@@ -675,6 +740,14 @@ struct invoice_info {
 	struct json_escape *label;
 	struct chanhints *chanhints;
 	bool custom_fallbacks;
+
+	/* Warnings to add once the invoice is signed */
+	bool warning_no_listincoming;
+	bool warning_mpp;
+	bool warning_capacity;
+	bool warning_deadends;
+	bool warning_offline;
+	bool warning_private_unused;
 };
 
 /* Add routehints based on listincoming results: NULL means success. */
@@ -812,25 +885,16 @@ done:
 	return NULL;
 }
 
-static struct command_result *
-invoice_complete(struct invoice_info *info,
-		 bool warning_no_listincoming,
-		 bool warning_mpp,
-		 bool warning_capacity,
-		 bool warning_deadends,
-		 bool warning_offline,
-		 bool warning_private_unused)
+static struct command_result *invoice_signed(struct command *cmd,
+					     const char *b11enc,
+					     struct invoice_info *info)
 {
 	struct json_stream *response;
 	u64 inv_dbid;
-	char *b11enc;
 	const struct invoice_details *details;
 	struct secret payment_secret;
 	struct wallet *wallet = info->cmd->ld->wallet;
 
-	b11enc = bolt11_encode(info, info->b11, false,
-			       hsm_sign_b11, info->cmd->ld);
-
 	/* Check duplicate preimage (unlikely unless they specified it!) */
 	if (invoices_find_by_rhash(wallet->invoices,
 				   &inv_dbid, &info->b11->payment_hash)) {
@@ -876,25 +940,25 @@ invoice_complete(struct invoice_info *info,
 	notify_invoice_creation(info->cmd->ld, info->b11->msat,
 				&info->payment_preimage, info->label);
 
-	if (warning_no_listincoming)
+	if (info->warning_no_listincoming)
 		json_add_string(response, "warning_listincoming",
 				"No listincoming command available, cannot add routehints to invoice");
-	if (warning_mpp)
+	if (info->warning_mpp)
 		json_add_string(response, "warning_mpp",
 				"The invoice is only payable by MPP-capable payers.");
-	if (warning_capacity)
+	if (info->warning_capacity)
 		json_add_string(response, "warning_capacity",
 				"Insufficient incoming channel capacity to pay invoice");
 
-	if (warning_deadends)
+	if (info->warning_deadends)
 		json_add_string(response, "warning_deadends",
 				"Insufficient incoming capacity, once dead-end peers were excluded");
 
-	if (warning_offline)
+	if (info->warning_offline)
 		json_add_string(response, "warning_offline",
 				"Insufficient incoming capacity, once offline peers were excluded");
 
-	if (warning_private_unused)
+	if (info->warning_private_unused)
 		json_add_string(response, "warning_private_unused",
 				"Insufficient incoming capacity, once private channels were excluded (try exposeprivatechannels=true?)");
 
@@ -905,6 +969,25 @@ invoice_complete(struct invoice_info *info,
 	return command_success(info->cmd, response);
 }
 
+static struct command_result *
+invoice_complete(struct invoice_info *info,
+		 bool warning_no_listincoming,
+		 bool warning_mpp,
+		 bool warning_capacity,
+		 bool warning_deadends,
+		 bool warning_offline,
+		 bool warning_private_unused)
+{
+	info->warning_no_listincoming = warning_no_listincoming;
+	info->warning_mpp = warning_mpp;
+	info->warning_capacity = warning_capacity;
+	info->warning_deadends = warning_deadends;
+	info->warning_offline = warning_offline;
+	info->warning_private_unused = warning_private_unused;
+
+	return hsm_sign_b11(info->cmd, info->b11, false, invoice_signed, info);
+}
+
 /* Return from "listincoming". */
 static void listincoming_done(const char *buffer,
 			      const jsmntok_t *toks,
@@ -1247,49 +1330,82 @@ AUTODATA(json_command, &invoice_command);
 static void json_add_invoices(struct json_stream *response,
 			      struct wallet *wallet,
 			      const struct json_escape *label,
-			      const struct sha256 *payment_hash,
-			      const struct sha256 *local_offer_id,
-			      const enum wait_index *listindex,
-			      u64 liststart,
-			      const u32 *listlimit)
+			      const struct sha256 *payment_hash)
 {
 	const struct invoice_details *details;
 	u64 inv_dbid;
 
-	/* Don't iterate entire db if we're just after one. */
 	if (label) {
 		if (invoices_find_by_label(wallet->invoices, &inv_dbid, label)) {
 			details =
 			    invoices_get_details(tmpctx, wallet->invoices, inv_dbid);
 			json_add_invoice(response, NULL, details);
 		}
-	} else if (payment_hash != NULL) {
+	} else {
+		assert(payment_hash);
 		if (invoices_find_by_rhash(wallet->invoices, &inv_dbid,
 						 payment_hash)) {
 			details =
 			    invoices_get_details(tmpctx, wallet->invoices, inv_dbid);
 			json_add_invoice(response, NULL, details);
 		}
-	} else {
-		struct db_stmt *stmt;
-
-		for (stmt = invoices_first(wallet->invoices,
-					   listindex, liststart, listlimit,
-					   &inv_dbid);
-		     stmt;
-		     stmt = invoices_next(wallet->invoices, stmt, &inv_dbid)) {
-			details = invoices_get_details(tmpctx,
-						       wallet->invoices, inv_dbid);
-			/* FIXME: db can filter this better! */
-			if (local_offer_id) {
-				if (!details->local_offer_id
-				    || !sha256_eq(local_offer_id,
-						  details->local_offer_id))
-					continue;
-			}
-			json_add_invoice(response, NULL, details);
+	}
+}
+
+/* Iterating the entire db: we do it a batch at a time. */
+struct listinvoices_batch {
+	const struct sha256 *local_offer_id;
+	enum wait_index listindex;
+	/* Next index value to ask for */
+	u64 next;
+	/* NULL if unlimited */
+	u32 *remaining;
+};
+
+static bool listinvoices_next_batch(struct command *cmd,
+				    struct json_stream *response,
+				    struct listinvoices_batch *lb)
+{
+	struct wallet *wallet = cmd->ld->wallet;
+	const struct invoice_details *details;
+	struct db_stmt *stmt;
+	u64 inv_dbid;
+	u32 limit = LIST_BATCH_ROWS;
+	size_t n = 0;
+
+	if (lb->remaining && *lb->remaining < limit)
+		limit = *lb->remaining;
+
+	for (stmt = invoices_first(wallet->invoices,
+				   &lb->listindex, lb->next, &limit,
+				   &inv_dbid);
+	     stmt;
+	     stmt = invoices_next(wallet->invoices, stmt, &inv_dbid)) {
+		details = invoices_get_details(tmpctx,
+					       wallet->invoices, inv_dbid);
+		n++;
+		if (lb->listindex == WAIT_INDEX_UPDATED)
+			lb->next = details->updated_index + 1;
+		else
+			lb->next = details->created_index + 1;
+		/* FIXME: db can filter this better! */
+		if (lb->local_offer_id) {
+			if (!details->local_offer_id
+			    || !sha256_eq(lb->local_offer_id,
+					  details->local_offer_id))
+				continue;
 		}
+		json_add_invoice(response, NULL, details);
 	}
+
+	if (lb->remaining)
+		*lb->remaining -= n;
+
+	if (n < limit || (lb->remaining && *lb->remaining == 0)) {
+		json_array_end(response);
+		return false;
+	}
+	return true;
 }
 
 static struct command_result *json_listinvoices(struct command *cmd,
@@ -1306,6 +1422,7 @@ static struct command_result *json_listinvoices(struct command *cmd,
 	u64 *liststart;
 	u32 *listlimit;
 	char *fail;
+	struct listinvoices_batch *lb;
 
 	if (!param_check(cmd, buffer, params,
 			 p_opt("label", param_label, &label),
@@ -1360,10 +1477,21 @@ static struct command_result *json_listinvoices(struct command *cmd,
 
 	response = json_stream_success(cmd);
 	json_array_start(response, "invoices");
-	json_add_invoices(response, wallet, label, payment_hash, offer_id,
-			  listindex, *liststart, listlimit);
-	json_array_end(response);
-	return command_success(cmd, response);
+
+	/* Don't iterate entire db if we're just after one. */
+	if (label || payment_hash) {
+		json_add_invoices(response, wallet, label, payment_hash);
+		json_array_end(response);
+		return command_success(cmd, response);
+	}
+
+	lb = tal(cmd, struct listinvoices_batch);
+	lb->local_offer_id = offer_id;
+	lb->listindex = listindex ? *listindex : WAIT_INDEX_CREATED;
+	lb->next = *liststart;
+	lb->remaining = listlimit;
+	return command_success_batched(cmd, response,
+				       listinvoices_next_batch, lb);
 }
 
 static const struct json_command listinvoices_command = {
@@ -1666,17 +1794,99 @@ static void add_stub_blindedpath(const tal_t *ctx,
 	tlv_update_fields(inv, tlv_invoice, &inv->fields);
 }
 
+/* What createinvoice needs once the invoice is signed. */
+struct createinvoice_info {
+	struct command *cmd;
+	struct json_escape *label;
+	struct preimage *preimage;
+	struct sha256 payment_hash;
+
+	/* For bolt11 */
+	struct bolt11 *b11;
+
+	/* For bolt12 */
+	struct tlv_invoice *inv;
+	struct sha256 *local_offer_id;
+	struct amount_msat msat;
+	const char *desc;
+	u32 expiry;
+};
+
+static struct command_result *createinvoice_done(struct command *cmd,
+						 u64 inv_dbid)
+{
+	struct json_stream *response;
+
+	response = json_stream_success(cmd);
+	json_add_invoice_fields(response,
+				invoices_get_details(cmd, cmd->ld->wallet->invoices,
+						     inv_dbid));
+	return command_success(cmd, response);
+}
+
+static struct command_result *createinvoice_b11_signed(struct command *cmd,
+						       const char *b11enc,
+						       struct createinvoice_info *ci)
+{
+	u64 inv_dbid;
+
+	if (!invoices_create(cmd->ld->wallet->invoices,
+			     &inv_dbid,
+			     ci->b11->msat,
+			     ci->label,
+			     ci->b11->expiry,
+			     b11enc,
+			     ci->b11->description,
+			     ci->b11->features,
+			     ci->preimage,
+			     &ci->payment_hash,
+			     NULL))
+		return fail_exists(cmd, ci->label);
+
+	notify_invoice_creation(cmd->ld, ci->b11->msat, ci->preimage, ci->label);
+	return createinvoice_done(cmd, inv_dbid);
+}
+
+static void createinvoice_b12_signed(struct lightningd *ld,
+				     const u8 *msg,
+				     struct createinvoice_info *ci)
+{
+	struct command *cmd = ci->cmd;
+	char *b12enc;
+	u64 inv_dbid;
+
+	ci->inv->signature = tal(ci->inv, struct bip340sig);
+	if (!fromwire_hsmd_sign_bolt12_reply(msg, ci->inv->signature))
+		fatal("HSM gave bad sign_invoice_reply %s",
+		      tal_hex(msg, msg));
+	b12enc = invoice_encode(cmd, ci->inv);
+
+	if (!invoices_create(ld->wallet->invoices,
+			     &inv_dbid,
+			     &ci->msat,
+			     ci->label,
+			     ci->expiry,
+			     b12enc,
+			     ci->desc,
+			     ci->inv->invoice_features,
+			     ci->preimage,
+			     &ci->payment_hash,
+			     ci->local_offer_id)) {
+		was_pending(fail_exists(cmd, ci->label));
+		return;
+	}
+
+	notify_invoice_creation(ld, &ci->msat, ci->preimage, ci->label);
+	was_pending(createinvoice_done(cmd, inv_dbid));
+}
+
 static struct command_result *json_createinvoice(struct command *cmd,
 						 const char *buffer,
 						 const jsmntok_t *obj UNNEEDED,
 						 const jsmntok_t *params)
 {
 	const char *invstring;
-	struct json_escape *label;
-	struct preimage *preimage;
-	u64 inv_dbid;
-	struct sha256 payment_hash;
-	struct json_stream *response;
+	struct createinvoice_info *ci = tal(cmd, struct createinvoice_info);
 	struct bolt11 *b11;
 	struct sha256 hash;
 	const u5 *sig;
@@ -1685,20 +1895,17 @@ static struct command_result *json_createinvoice(struct command *cmd,
 
 	if (!param_check(cmd, buffer, params,
 			 p_req("invstring", param_invstring, &invstring),
-			 p_req("label", param_label, &label),
-			 p_req("preimage", param_preimage, &preimage),
+			 p_req("label", param_label, &ci->label),
+			 p_req("preimage", param_preimage, &ci->preimage),
 			 NULL))
 		return command_param_failed();
 
-	sha256(&payment_hash, preimage, sizeof(*preimage));
+	ci->cmd = cmd;
+	sha256(&ci->payment_hash, ci->preimage, sizeof(*ci->preimage));
 	b11 = bolt11_decode_nosig(cmd, invstring, cmd->ld->our_features,
 				  NULL, chainparams, &hash, &sig, &have_n,
 				  &fail);
 	if (b11) {
-		/* This adds the signature */
-		char *b11enc = bolt11_encode(cmd, b11, have_n,
-					     hsm_sign_b11, cmd->ld);
-
 		if (!b11->description)
 			return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
 					    "Missing description in invoice");
@@ -1707,34 +1914,20 @@ static struct command_result *json_createinvoice(struct command *cmd,
 			return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
 					    "Missing expiry in invoice");
 
-		if (!sha256_eq(&payment_hash, &b11->payment_hash))
+		if (!sha256_eq(&ci->payment_hash, &b11->payment_hash))
 			return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
 					    "Incorrect preimage");
 
 		if (command_check_only(cmd))
 			return command_check_done(cmd);
 
-		if (!invoices_create(cmd->ld->wallet->invoices,
-				     &inv_dbid,
-				     b11->msat,
-				     label,
-				     b11->expiry,
-				     b11enc,
-				     b11->description,
-				     b11->features,
-				     preimage,
-				     &payment_hash,
-				     NULL))
-			return fail_exists(cmd, label);
-
-		notify_invoice_creation(cmd->ld, b11->msat, preimage, label);
+		/* This adds the signature */
+		ci->b11 = b11;
+		return hsm_sign_b11(cmd, b11, have_n,
+				    createinvoice_b11_signed, ci);
 	} else {
 		struct tlv_invoice *inv;
-		struct sha256 offer_id, *local_offer_id;
-		char *b12enc;
-		struct amount_msat msat;
-		const char *desc;
-		u32 expiry;
+		struct sha256 offer_id;
 		enum offer_status status;
 
 		inv = invoice_decode_minimal(cmd, invstring, strlen(invstring),
@@ -1760,8 +1953,6 @@ static struct command_result *json_createinvoice(struct command *cmd,
 		if (inv->signature)
 			return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
 					    "invoice already signed");
-		hsm_sign_b12_invoice(cmd->ld, inv);
-		b12enc = invoice_encode(cmd, inv);
 
 		if (inv->offer_issuer_id || inv->offer_paths) {
 			invoice_offer_id(inv, &offer_id);
@@ -1771,11 +1962,12 @@ static struct command_result *json_createinvoice(struct command *cmd,
 					return command_fail(cmd,
 							    INVOICE_OFFER_INACTIVE,
 							    "offer not active");
-				local_offer_id = &offer_id;
+				ci->local_offer_id = tal_dup(ci, struct sha256,
+							     &offer_id);
 			} else
-				local_offer_id = NULL;
+				ci->local_offer_id = NULL;
 		} else
-			local_offer_id = NULL;
+			ci->local_offer_id = NULL;
 
 		/* BOLT #12:
 		 * A writer of an invoice:
@@ -1787,17 +1979,17 @@ static struct command_result *json_createinvoice(struct command *cmd,
 		if (!inv->invoice_amount)
 			return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
 					    "Missing invoice_amount in invoice");
-		msat = amount_msat(*inv->invoice_amount);
+		ci->msat = amount_msat(*inv->invoice_amount);
 
 		if (inv->invoice_relative_expiry)
-			expiry = *inv->invoice_relative_expiry;
+			ci->expiry = *inv->invoice_relative_expiry;
 		else
-			expiry = BOLT12_DEFAULT_REL_EXPIRY;
+			ci->expiry = BOLT12_DEFAULT_REL_EXPIRY;
 
 		if (!inv->invoice_payment_hash)
 			return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
 					    "Missing payment_hash in invoice");
-		if (!sha256_eq(&payment_hash, inv->invoice_payment_hash))
+		if (!sha256_eq(&ci->payment_hash, inv->invoice_payment_hash))
 			return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
 					    "Incorrect preimage");
 
@@ -1805,33 +1997,17 @@ static struct command_result *json_createinvoice(struct command *cmd,
 			return command_check_done(cmd);
 
 		if (inv->offer_description)
-			desc = tal_strndup(cmd,
-					   inv->offer_description,
-					   tal_bytelen(inv->offer_description));
+			ci->desc = tal_strndup(ci,
+					       inv->offer_description,
+					       tal_bytelen(inv->offer_description));
 		else
-			desc = NULL;
-
-		if (!invoices_create(cmd->ld->wallet->invoices,
-				     &inv_dbid,
-				     &msat,
-				     label,
-				     expiry,
-				     b12enc,
-				     desc,
-				     inv->invoice_features,
-				     preimage,
-				     &payment_hash,
-				     local_offer_id))
-			return fail_exists(cmd, label);
-
-		notify_invoice_creation(cmd->ld, &msat,	preimage, label);
-	}
+			ci->desc = NULL;
 
-	response = json_stream_success(cmd);
-	json_add_invoice_fields(response,
-				invoices_get_details(cmd, cmd->ld->wallet->invoices,
-						     inv_dbid));
-	return command_success(cmd, response);
+		ci->inv = inv;
+		hsm_req(cmd, cmd->ld, take(hsm_sign_b12_invoice_req(inv)),
+			createinvoice_b12_signed, ci);
+		return command_still_pending(cmd);
+	}
 }
 
 static const struct json_command createinvoice_command = {
@@ -1955,13 +2131,23 @@ static const struct json_command preapprovekeysend_command = {
 };
 AUTODATA(json_command, &preapprovekeysend_command);
 
+static struct command_result *signinvoice_done(struct command *cmd,
+					       const char *b11enc,
+					       void *unused UNUSED)
+{
+	struct json_stream *response;
+
+	response = json_stream_success(cmd);
+	json_add_invstring(response, b11enc);
+	return command_success(cmd, response);
+}
+
 static struct command_result *json_signinvoice(struct command *cmd,
 						 const char *buffer,
 						 const jsmntok_t *obj UNNEEDED,
 						 const jsmntok_t *params)
 {
 	const char *invstring;
-	struct json_stream *response;
 	struct bolt11 *b11;
 	struct sha256 hash;
 	const u5 *sig;
@@ -1982,10 +2168,6 @@ static struct command_result *json_signinvoice(struct command *cmd,
 				    "Unparsable invoice '%s': %s",
 				    invstring, fail);
 
-	/* This adds the signature */
-	char *b11enc = bolt11_encode(cmd, b11, have_n,
-				     hsm_sign_b11, cmd->ld);
-
         /* BOLT #11:
          * A writer:
          *...
@@ -1998,9 +2180,8 @@ static struct command_result *json_signinvoice(struct command *cmd,
 	if (command_check_only(cmd))
 		return command_check_done(cmd);
 
-	response = json_stream_success(cmd);
-	json_add_invstring(response, b11enc);
-	return command_success(cmd, response);
+	/* This adds the signature */
+	return hsm_sign_b11(cmd, b11, have_n, signinvoice_done, NULL);
 }
 
 static const struct json_command signinvoice_command = {
@@ -592,6 +592,67 @@ struct command_result *command_success(struct command *cmd,
 	return command_raw_complete(cmd, result);
 }
 
+struct batched_response {
+	struct command *cmd;
+	struct json_stream *response;
+	bool (*batch)(struct command *, struct json_stream *, void *);
+	void *arg;
+};
+
+/* Don't produce more while the client has this much unread. */
+#define BATCHED_RESPONSE_HIGHWATER (1024 * 1024)
+
+static void batched_response_next(struct batched_response *br)
+{
+	size_t unread;
+
+	/* If the client has gone, nobody will read the rest: don't bother
+	 * producing it.  This frees br too. */
+	if (!br->cmd->jcon) {
+		tal_free(br->cmd);
+		return;
+	}
+
+	json_out_contents(br->response->jout, &unread);
+	if (unread > BATCHED_RESPONSE_HIGHWATER) {
+		new_reltimer(br->cmd->ld->timers, br, time_from_msec(10),
+			     batched_response_next, br);
+		return;
+	}
+
+	if (!br->batch(br->cmd, br->response, br->arg)) {
+		was_pending(command_success(br->cmd, br->response));
+		return;
+	}
+
+	json_stream_flush(br->response);
+	/* Not zero: that would expire before we ever poll for io */
+	new_reltimer(br->cmd->ld->timers, br, time_from_msec(1),
+		     batched_response_next, br);
+}
+
+struct command_result *command_success_batched_(struct command *cmd,
+						struct json_stream *response,
+						bool (*batch)(struct command *,
+							      struct json_stream *,
+							      void *),
+						void *arg)
+{
+	struct batched_response *br;
+
+	if (!batch(cmd, response, arg))
+		return command_success(cmd, response);
+
+	br = tal(cmd, struct batched_response);
+	br->cmd = cmd;
+	br->response = response;
+	br->batch = batch;
+	br->arg = arg;
+	new_reltimer(cmd->ld->timers, br, time_from_msec(1),
+		     batched_response_next, br);
+	return command_still_pending(cmd);
+}
+
 struct command_result *command_failed(struct command *cmd,
 				      struct json_stream *result)
 {
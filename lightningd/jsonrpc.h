@@ -135,6 +135,41 @@ struct command_result *command_failed(struct command *cmd,
 				      struct json_stream *result)
 	 WARN_UNUSED_RESULT;
 
+/* How many rows the list commands emit before yielding to the io loop. */
+#define LIST_BATCH_ROWS 1000
+
+/**
+ * command_success_batched - stream a large result without blocking.
+ * @cmd: the command we're running.
+ * @response: the json_stream_success() for @cmd.
+ * @batch: adds the next rows to @response, returns false once finished.
+ * @arg: argument for @batch.
+ *
+ * @batch is called once immediately, then from a timer (so inside its
+ * own db transaction) until it returns false, when the command succeeds.
+ * Between calls we go back to the io loop, and wait for the client to
+ * read what we have already written, so memory stays bounded by the
+ * batch size.  @batch must not hold db statements across calls, and has
+ * to close any arrays it opened before returning false.  If the client
+ * disconnects, @batch is not called again and @cmd is simply freed, so
+ * @arg should be allocated off @cmd.
+ */
+#define command_success_batched(cmd, response, batch, arg)		\
+	command_success_batched_((cmd), (response),			\
+				 typesafe_cb_preargs(bool, void *,	\
+						     (batch), (arg),	\
+						     struct command *,	\
+						     struct json_stream *), \
+				 (arg))
+
+struct command_result *command_success_batched_(struct command *cmd,
+						struct json_stream *response,
+						bool (*batch)(struct command *,
+							      struct json_stream *,
+							      void *),
+						void *arg)
+	WARN_UNUSED_RESULT;
+
 /* Mainly for documentation, that we plan to close this later. */
 struct command_result *command_still_pending(struct command *cmd)
 	 WARN_UNUSED_RESULT;
@@ -72,6 +72,7 @@
 #include <lightningd/connect_control.h>
 #include <lightningd/gossip_control.h>
 #include <lightningd/hsm_control.h>
+#include <lightningd/htlc_deadlines.h>
 #include <lightningd/io_loop_with_timers.h>
 #include <lightningd/lightningd.h>
 #include <lightningd/onchain_control.h>
@@ -201,6 +202,10 @@ static struct lightningd *new_lightningd(const tal_t *ctx)
 	ld->htlcs_out = tal(ld, struct htlc_out_map);
 	htlc_out_map_init(ld->htlcs_out);
 
+	/*~ Every block we look for HTLCs which have hit their deadline, so
+	 * we keep them sorted by that, too. */
+	ld->htlc_deadlines = new_htlc_deadlines(ld);
+
 	/*~ This is the hash table of peers: converted from a
 	 *  linked-list as part of the 100k-peers project! */
 	ld->peers = tal(ld, struct peer_node_id_map);
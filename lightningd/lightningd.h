@@ -204,6 +204,8 @@ struct lightningd {
 	/* Bearer of all my secrets. */
 	int hsm_fd;
 	struct subd *hsm;
+	/* Second connection to hsmd, for hsm_req() */
+	struct hsm_conn *hsm_conn;
 
 	/* Daemon for routing */
  	struct subd *gossip;
@@ -228,6 +230,8 @@ struct lightningd {
 	/* HTLCs in flight. */
 	struct htlc_in_map *htlcs_in;
 	struct htlc_out_map *htlcs_out;
+	/* The same HTLCs, by the block we have to act on them. */
+	struct htlc_deadlines *htlc_deadlines;
 
 	/* Sets of HTLCs we are holding onto for MPP. */
 	struct htlc_set_map *htlc_sets;
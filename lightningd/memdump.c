@@ -13,6 +13,7 @@
 #include <lightningd/chaintopology.h>
 #include <lightningd/closed_channel.h>
 #include <lightningd/hsm_control.h>
+#include <lightningd/htlc_deadlines.h>
 #include <lightningd/jsonrpc.h>
 #include <lightningd/lightningd.h>
 #include <lightningd/memdump.h>
@@ -199,6 +200,7 @@ static bool lightningd_check_leaks(struct command *cmd)
 	memleak_scan_htable(memtable, &ld->topology->outgoing_txs->raw);
 	memleak_scan_htable(memtable, &ld->htlcs_in->raw);
 	memleak_scan_htable(memtable, &ld->htlcs_out->raw);
+	htlc_deadlines_memleak(memtable, ld->htlc_deadlines);
 	memleak_scan_htable(memtable, &ld->htlc_sets->raw);
 	memleak_scan_htable(memtable, &ld->peers->raw);
 	memleak_scan_htable(memtable, &ld->peers_by_dbid->raw);
@@ -2173,6 +2173,58 @@ static struct command_result *param_payment_status(struct command *cmd,
 				     "should be an invoice status");
 }
 
+/* Iterating the entire db: we do it a batch at a time. */
+struct listsendpays_batch {
+	/* NULL if any status */
+	const enum payment_status *status;
+	enum wait_index listindex;
+	/* Next index value to ask for */
+	u64 next;
+	/* NULL if unlimited */
+	u32 *remaining;
+};
+
+static bool listsendpays_next_batch(struct command *cmd,
+				    struct json_stream *response,
+				    struct listsendpays_batch *lb)
+{
+	struct wallet *wallet = cmd->ld->wallet;
+	struct db_stmt *stmt;
+	u32 limit = LIST_BATCH_ROWS;
+	size_t n = 0;
+
+	if (lb->remaining && *lb->remaining < limit)
+		limit = *lb->remaining;
+
+	if (lb->status)
+		stmt = payments_by_status(wallet, *lb->status,
+					  &lb->listindex, lb->next, &limit);
+	else
+		stmt = payments_first(wallet, &lb->listindex, lb->next, &limit);
+
+	for (; stmt; stmt = payments_next(wallet, stmt)) {
+		const struct wallet_payment *p
+			= payment_get_details(tmpctx, stmt);
+		json_object_start(response, NULL);
+		json_add_payment_fields(response, p);
+		json_object_end(response);
+		if (lb->listindex == WAIT_INDEX_UPDATED)
+			lb->next = p->updated_index + 1;
+		else
+			lb->next = p->id + 1;
+		n++;
+	}
+
+	if (lb->remaining)
+		*lb->remaining -= n;
+
+	if (n < limit || (lb->remaining && *lb->remaining == 0)) {
+		json_array_end(response);
+		return false;
+	}
+	return true;
+}
+
 static struct command_result *json_listsendpays(struct command *cmd,
 						const char *buffer,
 						const jsmntok_t *obj UNNEEDED,
@@ -2186,6 +2238,7 @@ static struct command_result *json_listsendpays(struct command *cmd,
 	enum wait_index *listindex;
 	u64 *liststart;
 	u32 *listlimit;
+	struct listsendpays_batch *lb;
 
 	if (!param_check(cmd, buffer, params,
 			 /* FIXME: parameter should be invstring now */
@@ -2246,23 +2299,25 @@ static struct command_result *json_listsendpays(struct command *cmd,
 	response = json_stream_success(cmd);
 
 	json_array_start(response, "payments");
-	if (rhash)
-		stmt = payments_by_hash(cmd->ld->wallet, rhash);
-	else if (status)
-		stmt = payments_by_status(cmd->ld->wallet, *status,
-					  listindex, *liststart, listlimit);
-	else
-		stmt = payments_first(cmd->ld->wallet,
-				      listindex, *liststart, listlimit);
-
-	for (; stmt; stmt = payments_next(cmd->ld->wallet, stmt)) {
-		json_object_start(response, NULL);
-		json_add_payment_fields(response, payment_get_details(tmpctx, stmt));
-		json_object_end(response);
+	if (rhash) {
+		for (stmt = payments_by_hash(cmd->ld->wallet, rhash);
+		     stmt;
+		     stmt = payments_next(cmd->ld->wallet, stmt)) {
+			json_object_start(response, NULL);
+			json_add_payment_fields(response, payment_get_details(tmpctx, stmt));
+			json_object_end(response);
+		}
+		json_array_end(response);
+		return command_success(cmd, response);
 	}
-	json_array_end(response);
 
-	return command_success(cmd, response);
+	lb = tal(cmd, struct listsendpays_batch);
+	lb->status = status;
+	lb->listindex = listindex ? *listindex : WAIT_INDEX_CREATED;
+	lb->next = *liststart;
+	lb->remaining = listlimit;
+	return command_success_batched(cmd, response,
+				       listsendpays_next_batch, lb);
 }
 
 static const struct json_command listsendpays_command = {
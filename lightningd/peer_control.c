@@ -50,6 +50,7 @@
 #include <lightningd/dual_open_control.h>
 #include <lightningd/gossip_control.h>
 #include <lightningd/hsm_control.h>
+#include <lightningd/htlc_deadlines.h>
 #include <lightningd/jsonrpc.h>
 #include <lightningd/lightningd.h>
 #include <lightningd/log.h>
@@ -2730,6 +2731,7 @@ struct htlc_in_map *load_channels_from_wallet(struct lightningd *ld,
 	fixup_htlcs_out(ld);
 #endif /* COMPAT_V061 */
 
+	htlcs_index_deadlines(ld);
 	return unconnected_htlcs_in;
 }
 
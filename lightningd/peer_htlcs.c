@@ -17,6 +17,7 @@
 #include <lightningd/chaintopology.h>
 #include <lightningd/channel.h>
 #include <lightningd/coin_mvts.h>
+#include <lightningd/htlc_deadlines.h>
 #include <lightningd/pay.h>
 #include <lightningd/peer_control.h>
 #include <lightningd/peer_htlcs.h>
@@ -664,6 +665,7 @@ static void rcvd_htlc_reply(struct subd *subd, const u8 *msg, const int *fds UNU
 
 	/* Add it to lookup table now we know id. */
 	connect_htlc_out(subd->ld->htlcs_out, hout);
+	htlc_out_index_deadline(subd->ld, hout);
 
 	/* When channeld includes it in commitment, we'll make it persistent. */
 }
@@ -2218,6 +2220,7 @@ static bool channel_added_their_htlc(struct channel *channel,
 
 	log_debug(channel->log, "Adding their HTLC %"PRIu64, added->id);
 	connect_htlc_in(channel->peer->ld->htlcs_in, hin);
+	htlc_in_index_deadline(channel->peer->ld, hin);
 	return true;
 }
 
@@ -2719,32 +2722,6 @@ void free_htlcs(struct lightningd *ld, const struct channel *channel)
 	} while (deleted);
 }
 
-/* BOLT #2:
- *
- * 2. the deadline for offered HTLCs: the deadline after which the channel has
- *    to be failed and timed out on-chain. This is `G` blocks after the HTLC's
- *    `cltv_expiry`: 1 or 2 blocks is reasonable.
- */
-static u32 htlc_out_deadline(const struct htlc_out *hout)
-{
-	return hout->cltv_expiry + 1;
-}
-
-/* BOLT #2:
- *
- * 3. the deadline for received HTLCs this node has fulfilled: the deadline
- * after which the channel has to be failed and the HTLC fulfilled on-chain
- * before its `cltv_expiry`. See steps 4-7 above, which imply a deadline of
- * `2R+G+S` blocks before `cltv_expiry`: 18 blocks is reasonable.
- */
-/* We approximate this, by using half the cltv_expiry_delta (3R+2G+2S),
- * rounded up. */
-static u32 htlc_in_deadline(const struct lightningd *ld,
-			    const struct htlc_in *hin)
-{
-	return hin->cltv_expiry - (ld->config.cltv_expiry_delta + 1)/2;
-}
-
 /* onchaind might fail to time out an HTLC: maybe fees spiked, or maybe
  * it decided it wasn't worthwhile.  This risks cascading failure if
  * it was routed: the incoming peer will get upset with us, too.
@@ -2786,10 +2763,63 @@ static void consider_failing_incoming(struct lightningd *ld,
 	local_fail_in_htlc(hout->in, take(towire_permanent_channel_failure(NULL)));
 }
 
+/* Returns true if we failed the channel (which may free HTLCs). */
+static bool htlc_out_hit_deadline(struct lightningd *ld, u32 height,
+				  struct htlc_out *hout)
+{
+	/* Channel dying already? */
+	if (!channel_state_can_add_htlc(hout->key.channel->state)) {
+		consider_failing_incoming(ld, height, hout);
+		return false;
+	}
+
+	/* Peer already failed, or we hit it? */
+	if (hout->key.channel->error)
+		return false;
+
+	channel_fail_permanent(hout->key.channel,
+			       REASON_PROTOCOL,
+			       "Offered HTLC %"PRIu64
+			       " %s cltv %u hit deadline",
+			       hout->key.id,
+			       htlc_state_name(hout->hstate),
+			       hout->cltv_expiry);
+	return true;
+}
+
+/* Returns true if we failed the channel (which may free HTLCs). */
+static bool htlc_in_hit_deadline(struct htlc_in *hin)
+{
+	struct channel *channel = hin->key.channel;
+
+	/* Not fulfilled?  If overdue, that's their problem... */
+	if (!hin->preimage)
+		return false;
+
+	/* Peer on chain already? */
+	if (channel_state_failing_onchain(channel->state))
+		return false;
+
+	/* Peer already failed, or we hit it? */
+	if (channel->error)
+		return false;
+
+	channel_fail_permanent(channel,
+			       REASON_PROTOCOL,
+			       "Fulfilled HTLC %"PRIu64
+			       " %s cltv %u hit deadline",
+			       hin->key.id,
+			       htlc_state_name(hin->hstate),
+			       hin->cltv_expiry);
+	return true;
+}
+
 void htlcs_notify_new_block(struct lightningd *ld)
 {
 	bool removed;
 	u32 height = get_block_height(ld->topology);
+	struct htlc_deadline_bucket *b;
+	u64 deadline;
 
 	/* BOLT #2:
 	 *
@@ -2798,43 +2828,23 @@ void htlcs_notify_new_block(struct lightningd *ld)
 	 *     - SHOULD send an `error` to the receiving peer (if connected).
 	 *     - MUST fail the channel.
 	 */
-	/* FIXME: use db to look this up in one go (earliest deadline per-peer) */
 	do {
-		struct htlc_out *hout;
-		struct htlc_out_map_iter outi;
-
 		removed = false;
 
-		for (hout = htlc_out_map_first(ld->htlcs_out, &outi);
-		     hout;
-		     hout = htlc_out_map_next(ld->htlcs_out, &outi)) {
-			/* Not timed out yet? */
-			if (height < htlc_out_deadline(hout))
-				continue;
-
-			/* Channel dying already? */
-			if (!channel_state_can_add_htlc(hout->key.channel->state)) {
-				consider_failing_incoming(ld, height, hout);
-				continue;
+		for (b = uintmap_first(&ld->htlc_deadlines->map, &deadline);
+		     b && deadline <= height && !removed;
+		     b = uintmap_after(&ld->htlc_deadlines->map, &deadline)) {
+			for (size_t i = 0; i < tal_count(b->outs); i++) {
+				if (htlc_out_hit_deadline(ld, height,
+							  b->outs[i])) {
+					removed = true;
+					break;
+				}
 			}
-
-			/* Peer already failed, or we hit it? */
-			if (hout->key.channel->error)
-				continue;
-
-			channel_fail_permanent(hout->key.channel,
-					       REASON_PROTOCOL,
-					       "Offered HTLC %"PRIu64
-					       " %s cltv %u hit deadline",
-					       hout->key.id,
-					       htlc_state_name(hout->hstate),
-					       hout->cltv_expiry);
-			removed = true;
 		}
-	/* Iteration while removing is safe, but can skip entries! */
+	/* Failing a channel can free HTLCs under us: start again. */
 	} while (removed);
 
-
 	/* BOLT #2:
 	 *
 	 *   - for each HTLC it is attempting to fulfill:
@@ -2846,42 +2856,19 @@ void htlcs_notify_new_block(struct lightningd *ld)
 	 *     - MUST fail the channel.
 	 */
 	do {
-		struct htlc_in *hin;
-		struct htlc_in_map_iter ini;
-
 		removed = false;
 
-		for (hin = htlc_in_map_first(ld->htlcs_in, &ini);
-		     hin;
-		     hin = htlc_in_map_next(ld->htlcs_in, &ini)) {
-			struct channel *channel = hin->key.channel;
-
-			/* Not fulfilled?  If overdue, that's their problem... */
-			if (!hin->preimage)
-				continue;
-
-			/* Not timed out yet? */
-			if (height < htlc_in_deadline(ld, hin))
-				continue;
-
-			/* Peer on chain already? */
-			if (channel_state_failing_onchain(channel->state))
-				continue;
-
-			/* Peer already failed, or we hit it? */
-			if (channel->error)
-				continue;
-
-			channel_fail_permanent(channel,
-					       REASON_PROTOCOL,
-					       "Fulfilled HTLC %"PRIu64
-					       " %s cltv %u hit deadline",
-					       hin->key.id,
-					       htlc_state_name(hin->hstate),
-					       hin->cltv_expiry);
-			removed = true;
+		for (b = uintmap_first(&ld->htlc_deadlines->map, &deadline);
+		     b && deadline <= height && !removed;
+		     b = uintmap_after(&ld->htlc_deadlines->map, &deadline)) {
+			for (size_t i = 0; i < tal_count(b->ins); i++) {
+				if (htlc_in_hit_deadline(b->ins[i])) {
+					removed = true;
+					break;
+				}
+			}
 		}
-	/* Iteration while removing is safe, but can skip entries! */
+	/* Failing a channel can free HTLCs under us: start again. */
 	} while (removed);
 }
 
@@ -7,6 +7,7 @@
 #include <ccan/mem/mem.h>
 #include <ccan/opt/opt.h>
 #include <ccan/pipecmd/pipecmd.h>
+#include <ccan/tal/link/link.h>
 #include <ccan/tal/path/path.h>
 #include <ccan/tal/str/str.h>
 #include <ccan/utf8/utf8.h>
@@ -371,7 +372,7 @@ struct plugin *plugin_register(struct plugins *plugins, const char* path TAKES,
 	p->can_check = false;
 
 	p->plugin_state = UNCONFIGURED;
-	p->js_arr = tal_arr(p, struct json_stream *, 0);
+	p->out_arr = tal_arr(p, struct plugin_out, 0);
 	p->used = 0;
 	p->notification_topics = tal_arr(p, const char *, 0);
 	p->subscriptions = NULL;
@@ -474,11 +475,37 @@ void plugin_kill(struct plugin *plugin, enum log_level loglevel,
  */
 static void plugin_send(struct plugin *plugin, struct json_stream *stream)
 {
-	tal_steal(plugin->js_arr, stream);
-	tal_arr_expand(&plugin->js_arr, stream);
+	struct plugin_out out;
+
+	out.js = tal_steal(plugin->out_arr, stream);
+	out.shared = NULL;
+	tal_arr_expand(&plugin->out_arr, out);
 	io_wake(plugin);
 }
 
+/**
+ * Send a finished notification to the plugin, without copying it.
+ */
+static void plugin_send_shared(struct plugin *plugin, const char *shared)
+{
+	struct plugin_out out;
+
+	out.js = NULL;
+	out.shared = tal_link(plugin, shared);
+	tal_arr_expand(&plugin->out_arr, out);
+	io_wake(plugin);
+}
+
+/* Notifications can go to many plugins: they all share one copy. */
+static const char *notification_shared(const struct jsonrpc_notification *n)
+{
+	const char *p;
+	size_t len;
+
+	p = json_out_contents(n->stream->jout, &len);
+	return tal_linkable(tal_dup_arr(NULL, char, p, len, 0));
+}
+
 /* Returns the error string, or NULL */
 static const char *plugin_log_handle(struct plugin *plugin,
 				     const jsmntok_t *paramstok)
@@ -880,9 +907,9 @@ static struct io_plan *plugin_write_json(struct io_conn *conn,
 
 static struct io_plan *plugin_stream_complete(struct io_conn *conn, struct json_stream *js, struct plugin *plugin)
 {
-	assert(tal_count(plugin->js_arr) > 0);
+	assert(tal_count(plugin->out_arr) > 0);
 	/* Remove js and shift all remainig over */
-	tal_arr_remove(&plugin->js_arr, 0);
+	tal_arr_remove(&plugin->out_arr, 0);
 
 	/* It got dropped off the queue, free it. */
 	tal_free(js);
@@ -890,11 +917,30 @@ static struct io_plan *plugin_stream_complete(struct io_conn *conn, struct json_
 	return plugin_write_json(conn, plugin);
 }
 
+static struct io_plan *plugin_shared_complete(struct io_conn *conn,
+					      struct plugin *plugin)
+{
+	assert(tal_count(plugin->out_arr) > 0);
+	/* Last one to write it frees it */
+	tal_delink(plugin, plugin->out_arr[0].shared);
+	tal_arr_remove(&plugin->out_arr, 0);
+
+	return plugin_write_json(conn, plugin);
+}
+
 static struct io_plan *plugin_write_json(struct io_conn *conn,
 					 struct plugin *plugin)
 {
-	if (tal_count(plugin->js_arr)) {
-		return json_stream_output(plugin->js_arr[0], plugin->stdin_conn, plugin_stream_complete, plugin);
+	if (tal_count(plugin->out_arr)) {
+		const char *shared = plugin->out_arr[0].shared;
+		if (shared) {
+			log_io(plugin->log, LOG_IO_OUT, NULL, "",
+			       shared, tal_bytelen(shared));
+			return io_write(plugin->stdin_conn,
+					shared, tal_bytelen(shared),
+					plugin_shared_complete, plugin);
+		}
+		return json_stream_output(plugin->out_arr[0].js, plugin->stdin_conn, plugin_stream_complete, plugin);
 	}
 
 	return io_out_wait(conn, plugin, plugin_write_json, plugin);
@@ -2507,7 +2553,7 @@ bool plugin_single_notify(struct plugin *p,
 
 	if (p->plugin_state == INIT_COMPLETE
 	    && plugin_subscriptions_contains(p, n->method)) {
-		plugin_send(p, json_stream_dup(p, n->stream, p->log));
+		plugin_send_shared(p, notification_shared(n));
 		interested = true;
 	} else
 		interested = false;
@@ -2522,6 +2568,7 @@ void plugins_notify(struct plugins *plugins,
 		    const struct jsonrpc_notification *n TAKES)
 {
 	struct plugin_subscription_htable_iter it;
+	const char *shared = NULL;
 
 	if (taken(n))
 		tal_steal(tmpctx, n);
@@ -2538,7 +2585,9 @@ void plugins_notify(struct plugins *plugins,
 						      n->method, &it)) {
 		if (sub->owner->plugin_state != INIT_COMPLETE)
 			continue;
-		plugin_send(sub->owner, json_stream_dup(sub->owner, n->stream, sub->owner->log));
+		if (!shared)
+			shared = notification_shared(n);
+		plugin_send_shared(sub->owner, shared);
 	}
 
 	/* "log" doesn't go to wildcards */
@@ -2551,7 +2600,9 @@ void plugins_notify(struct plugins *plugins,
 							      "*", &it)) {
 			if (sub->owner->plugin_state != INIT_COMPLETE)
 				continue;
-			plugin_send(sub->owner, json_stream_dup(sub->owner, n->stream, sub->owner->log));
+			if (!shared)
+				shared = notification_shared(n);
+			plugin_send_shared(sub->owner, shared);
 		}
 	}
 }
@@ -46,6 +46,15 @@ HTABLE_DEFINE_DUPS_TYPE(struct plugin_subscription,
 			plugin_subscription_eq_topic,
 			plugin_subscription_htable);
 
+/* Something queued for writing to a plugin */
+struct plugin_out {
+	/* A request, which may still be being written... */
+	struct json_stream *js;
+	/* ...or a finished notification, shared with other plugins
+	 * (a tal_link()ed copy). */
+	const char *shared;
+};
+
 /**
  * A plugin, exposed as a stub so we can pass it as an argument.
  */
@@ -81,10 +90,10 @@ struct plugin {
 	jsmn_parser parser;
 	jsmntok_t *toks;
 
-	/* Our json_streams. Since multiple streams could start
+	/* Our output queue. Since multiple streams could start
 	 * returning data at once, we always service these in order,
 	 * freeing once empty. */
-	struct json_stream **js_arr;
+	struct plugin_out *out_arr;
 
 	struct logger *log;
 
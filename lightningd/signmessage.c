@@ -57,34 +57,15 @@ static const u8 *from_zbase32(const tal_t *ctx, const char *msg)
 	return len == tal_bytelen(u8arr) ? u8arr : tal_free(u8arr);
 }
 
-static struct command_result *json_signmessage(struct command *cmd,
-					       const char *buffer,
-					       const jsmntok_t *obj UNNEEDED,
-					       const jsmntok_t *params)
+static void signmessage_done(struct lightningd *ld,
+			     const u8 *msg,
+			     struct command *cmd)
 {
-	const char *message;
 	secp256k1_ecdsa_recoverable_signature rsig;
 	struct json_stream *response;
 	u8 sig[65];
-	const u8 *msg;
 	int recid;
 
-	if (!param_check(cmd, buffer, params,
-			 p_req("message", param_string, &message),
-			 NULL))
-		return command_param_failed();
-
-	if (strlen(message) > 65535)
-		return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
-				    "Message must be < 64k");
-
-	if (command_check_only(cmd))
-		return command_check_done(cmd);
-
-	msg = towire_hsmd_sign_message(NULL,
-				      tal_dup_arr(tmpctx, u8, (u8 *)message,
-						  strlen(message), 0));
-	msg = hsm_sync_req(tmpctx, cmd->ld, take(msg));
 	if (!fromwire_hsmd_sign_message_reply(msg, &rsig))
 		fatal("HSM gave bad hsm_sign_message_reply %s",
 		      tal_hex(msg, msg));
@@ -106,7 +87,34 @@ static struct command_result *json_signmessage(struct command *cmd,
 	sig[0] += 31;
 	json_add_string(response, "zbase",
 			to_zbase32(response, sig, sizeof(sig)));
-	return command_success(cmd, response);
+	was_pending(command_success(cmd, response));
+}
+
+static struct command_result *json_signmessage(struct command *cmd,
+					       const char *buffer,
+					       const jsmntok_t *obj UNNEEDED,
+					       const jsmntok_t *params)
+{
+	const char *message;
+	const u8 *msg;
+
+	if (!param_check(cmd, buffer, params,
+			 p_req("message", param_string, &message),
+			 NULL))
+		return command_param_failed();
+
+	if (strlen(message) > 65535)
+		return command_fail(cmd, JSONRPC2_INVALID_PARAMS,
+				    "Message must be < 64k");
+
+	if (command_check_only(cmd))
+		return command_check_done(cmd);
+
+	msg = towire_hsmd_sign_message(NULL,
+				      tal_dup_arr(tmpctx, u8, (u8 *)message,
+						  strlen(message), 0));
+	hsm_req(cmd, cmd->ld, take(msg), signmessage_done, cmd);
+	return command_still_pending(cmd);
 }
 
 static const struct json_command json_signmessage_cmd = {
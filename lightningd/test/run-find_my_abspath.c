@@ -185,6 +185,9 @@ bool log_status_msg(struct logger *log UNNEEDED,
  		    const struct node_id *node_id UNNEEDED,
 		    const u8 *msg UNNEEDED)
 { fprintf(stderr, "log_status_msg called!\n"); abort(); }
+/* Generated stub for new_htlc_deadlines */
+struct htlc_deadlines *new_htlc_deadlines(const tal_t *ctx UNNEEDED)
+{ fprintf(stderr, "new_htlc_deadlines called!\n"); abort(); }
 /* Generated stub for new_log_book */
 struct log_book *new_log_book(struct lightningd *ld UNNEEDED, size_t max_mem UNNEEDED)
 { fprintf(stderr, "new_log_book called!\n"); abort(); }
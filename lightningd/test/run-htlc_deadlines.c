@@ -0,0 +1,162 @@
+#include "config.h"
+#include "../htlc_deadlines.c"
+#include <common/setup.h>
+#include <stdio.h>
+
+/* AUTOGENERATED MOCKS START */
+/* AUTOGENERATED MOCKS END */
+
+/* We only need something for the htables: ids are unique here. */
+size_t hash_htlc_key(const struct htlc_key *k)
+{
+	return k->id;
+}
+
+static u64 next_id;
+
+static struct htlc_in *add_in(struct lightningd *ld, u32 cltv_expiry)
+{
+	struct htlc_in *hin = tal(ld, struct htlc_in);
+
+	hin->key.channel = NULL;
+	hin->key.id = next_id++;
+	hin->cltv_expiry = cltv_expiry;
+	htlc_in_map_add(ld->htlcs_in, hin);
+	return hin;
+}
+
+static struct htlc_out *add_out(struct lightningd *ld, u32 cltv_expiry)
+{
+	struct htlc_out *hout = tal(ld, struct htlc_out);
+
+	hout->key.channel = NULL;
+	hout->key.id = next_id++;
+	hout->cltv_expiry = cltv_expiry;
+	htlc_out_map_add(ld->htlcs_out, hout);
+	return hout;
+}
+
+/* htlc_end.c's destructors would do this for us. */
+static void free_in(struct lightningd *ld, struct htlc_in *hin)
+{
+	htlc_in_map_del(ld->htlcs_in, hin);
+	tal_free(hin);
+}
+
+static void free_out(struct lightningd *ld, struct htlc_out *hout)
+{
+	htlc_out_map_del(ld->htlcs_out, hout);
+	tal_free(hout);
+}
+
+/* Same walk htlcs_notify_new_block() does: how many are due at @height? */
+static size_t num_due(const struct lightningd *ld, u32 height,
+		      size_t *num_ins)
+{
+	struct htlc_deadline_bucket *b;
+	u64 deadline;
+	size_t num_outs = 0;
+
+	*num_ins = 0;
+	for (b = uintmap_first(&ld->htlc_deadlines->map, &deadline);
+	     b && deadline <= height;
+	     b = uintmap_after(&ld->htlc_deadlines->map, &deadline)) {
+		num_outs += tal_count(b->outs);
+		*num_ins += tal_count(b->ins);
+	}
+	return num_outs;
+}
+
+static size_t num_buckets(const struct lightningd *ld)
+{
+	u64 deadline;
+	size_t n = 0;
+
+	for (struct htlc_deadline_bucket *b
+		     = uintmap_first(&ld->htlc_deadlines->map, &deadline);
+	     b;
+	     b = uintmap_after(&ld->htlc_deadlines->map, &deadline))
+		n++;
+	return n;
+}
+
+int main(int argc, char *argv[])
+{
+	struct lightningd *ld;
+	struct htlc_out *out100a, *out100b, *out105, *out200;
+	struct htlc_in *in118, *in300;
+	size_t num_ins;
+
+	common_setup(argv[0]);
+
+	ld = tal(tmpctx, struct lightningd);
+	/* So incoming deadline is cltv_expiry - 17 */
+	ld->config.cltv_expiry_delta = 34;
+	ld->htlcs_in = tal(ld, struct htlc_in_map);
+	htlc_in_map_init(ld->htlcs_in);
+	ld->htlcs_out = tal(ld, struct htlc_out_map);
+	htlc_out_map_init(ld->htlcs_out);
+	ld->htlc_deadlines = new_htlc_deadlines(ld);
+
+	/* Outgoing deadline is cltv_expiry + 1. */
+	out100a = add_out(ld, 100);
+	out100b = add_out(ld, 100);
+	out105 = add_out(ld, 105);
+	out200 = add_out(ld, 200);
+	in118 = add_in(ld, 118);
+	in300 = add_in(ld, 300);
+	htlc_out_index_deadline(ld, out100a);
+	htlc_out_index_deadline(ld, out100b);
+	htlc_out_index_deadline(ld, out105);
+	htlc_out_index_deadline(ld, out200);
+	htlc_in_index_deadline(ld, in118);
+	htlc_in_index_deadline(ld, in300);
+
+	/* 101 (2 outs, 1 in), 106, 201, 283 */
+	assert(num_buckets(ld) == 4);
+	assert(num_due(ld, 100, &num_ins) == 0 && num_ins == 0);
+	assert(num_due(ld, 101, &num_ins) == 2 && num_ins == 1);
+	assert(num_due(ld, 106, &num_ins) == 3 && num_ins == 1);
+	assert(num_due(ld, 282, &num_ins) == 4 && num_ins == 1);
+	assert(num_due(ld, 283, &num_ins) == 4 && num_ins == 2);
+
+	/* Freeing removes them, and empty buckets go away. */
+	free_out(ld, out100a);
+	assert(num_buckets(ld) == 4);
+	assert(num_due(ld, 101, &num_ins) == 1 && num_ins == 1);
+	free_out(ld, out105);
+	assert(num_buckets(ld) == 3);
+	assert(!uintmap_get(&ld->htlc_deadlines->map, 106));
+	assert(num_due(ld, 200, &num_ins) == 1 && num_ins == 1);
+	free_in(ld, in118);
+	free_out(ld, out100b);
+	assert(!uintmap_get(&ld->htlc_deadlines->map, 101));
+	assert(num_buckets(ld) == 2);
+	assert(num_due(ld, 1000, &num_ins) == 1 && num_ins == 1);
+
+	/* "Restart": new HTLCs are loaded from the db into the maps, and
+	 * indexed all at once. */
+	free_out(ld, out200);
+	free_in(ld, in300);
+	assert(num_buckets(ld) == 0);
+
+	out100a = add_out(ld, 100);
+	out200 = add_out(ld, 200);
+	in118 = add_in(ld, 118);
+	in300 = add_in(ld, 300);
+	htlcs_index_deadlines(ld);
+	assert(num_buckets(ld) == 3);
+	assert(num_due(ld, 101, &num_ins) == 1 && num_ins == 1);
+	assert(num_due(ld, 283, &num_ins) == 2 && num_ins == 2);
+
+	/* And they still clean up after themselves. */
+	free_out(ld, out100a);
+	free_in(ld, in118);
+	free_out(ld, out200);
+	free_in(ld, in300);
+	assert(num_buckets(ld) == 0);
+
+	htlc_in_map_clear(ld->htlcs_in);
+	htlc_out_map_clear(ld->htlcs_out);
+	common_shutdown();
+}
@@ -213,6 +213,15 @@ struct command_result *command_success(struct command *cmd UNNEEDED,
 				       struct json_stream *response)
 
 { fprintf(stderr, "command_success called!\n"); abort(); }
+/* Generated stub for command_success_batched_ */
+struct command_result *command_success_batched_(struct command *cmd UNNEEDED,
+						struct json_stream *response UNNEEDED,
+						bool (*batch)(struct command * UNNEEDED,
+							      struct json_stream * UNNEEDED,
+							      void *) UNNEEDED,
+						void *arg UNNEEDED)
+
+{ fprintf(stderr, "command_success_batched_ called!\n"); abort(); }
 /* Generated stub for commit_tx_boost */
 void commit_tx_boost(struct channel *channel UNNEEDED,
 		     struct anchor_details *adet UNNEEDED,
@@ -371,6 +380,13 @@ size_t hash_htlc_key(const struct htlc_key *htlc_key UNNEEDED)
 /* Generated stub for hsm_capable */
 bool hsm_capable(struct lightningd *ld UNNEEDED, u32 msgtype UNNEEDED)
 { fprintf(stderr, "hsm_capable called!\n"); abort(); }
+/* Generated stub for hsm_req_ */
+void hsm_req_(const tal_t *ctx UNNEEDED,
+	      struct lightningd *ld UNNEEDED,
+	      const u8 *msg TAKES UNNEEDED,
+	      void (*cb)(struct lightningd *ld UNNEEDED, const u8 *reply UNNEEDED, void *arg) UNNEEDED,
+	      void *arg UNNEEDED)
+{ fprintf(stderr, "hsm_req_ called!\n"); abort(); }
 /* Generated stub for hsm_sync_req */
 const u8 *hsm_sync_req(const tal_t *ctx UNNEEDED,
 		       struct lightningd *ld UNNEEDED,
@@ -395,6 +411,9 @@ void htlc_set_fail_(struct htlc_set *set UNNEEDED, const u8 *failmsg TAKES UNNEE
 /* Generated stub for htlc_set_fulfill */
 void htlc_set_fulfill(struct htlc_set *set UNNEEDED, const struct preimage *preimage UNNEEDED)
 { fprintf(stderr, "htlc_set_fulfill called!\n"); abort(); }
+/* Generated stub for htlcs_index_deadlines */
+void htlcs_index_deadlines(struct lightningd *ld UNNEEDED)
+{ fprintf(stderr, "htlcs_index_deadlines called!\n"); abort(); }
 /* Generated stub for invoice_decode */
 struct tlv_invoice *invoice_decode(const tal_t *ctx UNNEEDED,
 				   const char *b12 UNNEEDED, size_t b12len UNNEEDED,
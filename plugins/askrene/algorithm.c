@@ -106,7 +106,7 @@ bool dijkstra_path(const tal_t *ctx, const struct graph *graph,
 		prev[i].idx = INVALID_INDEX;
 
 	struct priorityqueue *q;
-	q = priorityqueue_new(this_ctx, max_num_nodes);
+	q = priorityqueue_new_monotone(this_ctx, max_num_nodes);
 	const s64 *const dijkstra_distance = priorityqueue_value(q);
 
 	priorityqueue_init(q);
@@ -400,7 +400,7 @@ static struct node dijkstra_nearest_sink(const tal_t *ctx,
 #endif
 
 	struct priorityqueue *q;
-	q = priorityqueue_new(this_ctx, max_num_nodes);
+	q = priorityqueue_new_monotone(this_ctx, max_num_nodes);
 	const s64 *const dijkstra_distance = priorityqueue_value(q);
 
 	priorityqueue_init(q);
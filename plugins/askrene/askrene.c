@@ -8,14 +8,20 @@
  */
 #include "config.h"
 #include <ccan/array_size/array_size.h>
+#include <ccan/io/io.h>
+#include <ccan/json_escape/json_escape.h>
+#include <ccan/json_out/json_out.h>
+#include <ccan/read_write_all/read_write_all.h>
 #include <ccan/tal/str/str.h>
 #include <common/dijkstra.h>
 #include <common/gossmap.h>
 #include <common/gossmods_listpeerchannels.h>
 #include <common/json_param.h>
 #include <common/json_stream.h>
+#include <common/memleak.h>
 #include <common/route.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <math.h>
 #include <plugins/askrene/askrene.h>
 #include <plugins/askrene/explain_failure.h>
@@ -24,6 +30,16 @@
 #include <plugins/askrene/mcf.h>
 #include <plugins/askrene/refine.h>
 #include <plugins/askrene/reserve.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Beyond this many getroutes in parallel, we do them in-process
+ * (unless dev-askrene-max-children says otherwise) */
+#define ASKRENE_MAX_CHILDREN 8
+
+/* Not everything which changes our channels has a notification (e.g.
+ * setchannel, or the peer's channel_update), so refresh this often anyway */
+#define ASKRENE_LOCALCHANS_RECONCILE_SECS 60
 
 /* "spendable" for a channel assumes a single HTLC: for additional HTLCs,
  * the need to pay for fees (if we're the owner) reduces it */
@@ -171,6 +187,37 @@ static fp16_t *get_capacities(const tal_t *ctx,
 	return caps;
 }
 
+/* Indexes are preserved across gossmap_refresh_changes(), so we only
+ * need to touch the channels which came or went. */
+static void update_capacities(const struct gossmap *gossmap,
+			      fp16_t **caps,
+			      const struct gossmap_changes *changes)
+{
+	size_t oldmax = tal_count(*caps);
+
+	if (gossmap_max_chan_idx(gossmap) > oldmax) {
+		tal_resize(caps, gossmap_max_chan_idx(gossmap));
+		memset(*caps + oldmax, 0,
+		       (tal_count(*caps) - oldmax) * sizeof(**caps));
+	}
+
+	for (size_t i = 0; i < tal_count(changes->chans_added); i++) {
+		u32 idx = changes->chans_added[i];
+		struct gossmap_chan *c = gossmap_chan_byidx(gossmap, idx);
+		struct amount_msat cap;
+
+		/* Added and removed in same refresh? */
+		if (!c)
+			continue;
+		cap = gossmap_chan_get_capacity(gossmap, c);
+		/* Pessimistic: round down! */
+		(*caps)[idx] = u64_to_fp16(cap.millisatoshis/1000, false); /* Raw: fp16 */
+	}
+
+	for (size_t i = 0; i < tal_count(changes->chans_removed); i++)
+		(*caps)[changes->chans_removed[i]] = 0;
+}
+
 /* If we're the payer, we don't add delay or fee to our own outgoing
  * channels.  This wouldn't be right if we looped back through ourselves,
  * but we won't. */
@@ -259,6 +306,43 @@ struct amount_msat get_additional_per_htlc_cost(const struct route_query *rq,
 		return AMOUNT_MSAT(0);
 }
 
+/* Logs in a getroutes child's reply: @plugin_log if it was a plugin_log()
+ * rather than a message for the command. */
+static void child_add_log(struct json_stream *js,
+			  enum log_level level,
+			  const char *msg,
+			  bool plugin_log)
+{
+	json_object_start(js, NULL);
+	json_add_string(js, "level", log_level_name(level));
+	json_add_string(js, "message", msg);
+	if (plugin_log)
+		json_add_bool(js, "plugin_log", true);
+	json_object_end(js);
+}
+
+static void cmd_log(struct command *cmd,
+		    enum log_level level,
+		    const char *msg)
+{
+	struct askrene *askrene = get_askrene(cmd->plugin);
+
+	/* A child can't talk to lightningd: hand it back to the parent */
+	if (askrene->child_js) {
+		child_add_log(askrene->child_js, level, msg, false);
+		return;
+	}
+
+	plugin_notify_message(cmd, level, "%s", msg);
+
+	/* Notifications already get logged at debug. Otherwise reduce
+	 * severity. */
+	if (level != LOG_DBG)
+		plugin_log(cmd->plugin,
+			   level == LOG_BROKEN ? level : level - 1,
+			   "%s: %s", cmd->id, msg);
+}
+
 const char *rq_log(const tal_t *ctx,
 		   const struct route_query *rq,
 		   enum log_level level,
@@ -272,14 +356,7 @@ const char *rq_log(const tal_t *ctx,
 	msg = tal_vfmt(ctx, fmt, args);
 	va_end(args);
 
-	plugin_notify_message(rq->cmd, level, "%s", msg);
-
-	/* Notifications already get logged at debug. Otherwise reduce
-	 * severity. */
-	if (level != LOG_DBG)
-		plugin_log(rq->plugin,
-			   level == LOG_BROKEN ? level : level - 1,
-			   "%s: %s", rq->cmd->id, msg);
+	cmd_log(rq->cmd, level, msg);
 	return msg;
 }
 
@@ -348,37 +425,27 @@ static struct amount_msat linear_flows_cost(struct flow **flows,
 	return total;
 }
 
-/* Returns an error message, or sets *routes */
-static const char *get_routes(const tal_t *ctx,
-			      struct command *cmd,
-			      const struct node_id *source,
-			      const struct node_id *dest,
-			      struct amount_msat amount,
-			      struct amount_msat maxfee,
-			      u32 finalcltv,
-			      u32 maxdelay,
-			      const char **layers,
-			      struct gossmap_localmods *localmods,
-			      const struct layer *local_layer,
-			      bool single_path,
-			      struct route ***routes,
-			      struct amount_msat **amounts,
-			      const struct additional_cost_htable *additional_costs,
-			      double *probability)
+struct getroutes_info {
+	struct command *cmd;
+	struct node_id *source, *dest;
+	struct amount_msat *amount, *maxfee;
+	u32 *finalcltv, *maxdelay;
+	const char **layers;
+	struct additional_cost_htable *additional_costs;
+	/* Non-NULL if we are told to use "auto.localchans" */
+	struct layer *local_layer;
+};
+
+/* Sets up the route_query for this getroutes, and applies @localmods
+ * to the gossmap: caller must gossmap_remove_localmods() when done. */
+static struct route_query *new_route_query(const tal_t *ctx,
+					   struct command *cmd,
+					   const struct getroutes_info *info,
+					   struct gossmap_localmods *localmods)
 {
 	struct askrene *askrene = get_askrene(cmd->plugin);
 	struct route_query *rq = tal(ctx, struct route_query);
-	struct flow **flows;
-	const struct gossmap_node *srcnode, *dstnode;
-	double delay_feefactor;
-	u32 mu;
-	const char *ret;
-
-	if (gossmap_refresh(askrene->gossmap)) {
-		/* FIXME: gossmap_refresh callbacks to we can update in place */
-		tal_free(askrene->capacities);
-		askrene->capacities = get_capacities(askrene, askrene->plugin, askrene->gossmap);
-	}
+	const char **layers = info->layers;
 
 	rq->cmd = cmd;
 	rq->plugin = cmd->plugin;
@@ -386,7 +453,7 @@ static const char *get_routes(const tal_t *ctx,
 	rq->reserved = askrene->reserved;
 	rq->layers = tal_arr(rq, const struct layer *, 0);
 	rq->capacities = tal_dup_talarr(rq, fp16_t, askrene->capacities);
-	rq->additional_costs = additional_costs;
+	rq->additional_costs = info->additional_costs;
 
 	/* Layers must exist, but might be special ones! */
 	for (size_t i = 0; i < tal_count(layers); i++) {
@@ -394,14 +461,14 @@ static const char *get_routes(const tal_t *ctx,
 		if (!l) {
 			if (streq(layers[i], "auto.localchans")) {
 				plugin_log(rq->plugin, LOG_DBG, "Adding auto.localchans");
-				l = local_layer;
+				l = info->local_layer;
 			} else if (streq(layers[i], "auto.no_mpp_support")) {
 				plugin_log(rq->plugin, LOG_DBG, "Adding auto.no_mpp_support, sorry");
-				l = remove_small_channel_layer(layers, askrene, amount, localmods);
+				l = remove_small_channel_layer(rq, askrene, *info->amount, localmods);
 			} else {
 				assert(streq(layers[i], "auto.sourcefree"));
 				plugin_log(rq->plugin, LOG_DBG, "Adding auto.sourcefree");
-				l = source_free_layer(layers, askrene, source, localmods);
+				l = source_free_layer(rq, askrene, info->source, localmods);
 			}
 		}
 
@@ -427,6 +494,30 @@ static const char *get_routes(const tal_t *ctx,
 	for (size_t i = 0; i < tal_count(rq->layers); i++)
 		layer_apply_biases(rq->layers[i], askrene->gossmap, rq->biases);
 
+	return rq;
+}
+
+/* Returns an error message, or sets *routes */
+static const char *get_routes(const tal_t *ctx,
+			      struct route_query *rq,
+			      const struct getroutes_info *info,
+			      struct route ***routes,
+			      struct amount_msat **amounts,
+			      double *probability)
+{
+	struct askrene *askrene = get_askrene(rq->plugin);
+	const struct node_id *source = info->source, *dest = info->dest;
+	struct amount_msat amount = *info->amount, maxfee = *info->maxfee;
+	u32 finalcltv = *info->finalcltv, maxdelay = *info->maxdelay;
+	bool single_path = have_layer(info->layers, "auto.no_mpp_support");
+	struct flow **flows;
+	const struct gossmap_node *srcnode, *dstnode;
+	/* The caller prepared this for rq */
+	struct minflow_cache *mcache = askrene->minflow_cache;
+	double delay_feefactor;
+	u32 mu;
+	const char *ret;
+
 	srcnode = gossmap_find_node(askrene->gossmap, source);
 	if (!srcnode) {
 		ret = rq_log(ctx, rq, LOG_INFORM,
@@ -448,7 +539,7 @@ static const char *get_routes(const tal_t *ctx,
 	/* First up, don't care about fees (well, just enough to tiebreak!) */
 	mu = 1;
 	flows = minflow(rq, rq, srcnode, dstnode, amount,
-			mu, delay_feefactor, single_path);
+			mu, delay_feefactor, single_path, mcache);
 	if (!flows) {
 		ret = explain_failure(ctx, rq, srcnode, dstnode, amount);
 		goto fail;
@@ -461,7 +552,7 @@ static const char *get_routes(const tal_t *ctx,
 		       "The worst flow delay is %"PRIu64" (> %i), retrying with delay_feefactor %f...",
 		       flows_worst_delay(flows), maxdelay - finalcltv, delay_feefactor);
 		flows = minflow(rq, rq, srcnode, dstnode, amount,
-				mu, delay_feefactor, single_path);
+				mu, delay_feefactor, single_path, mcache);
 		if (!flows || delay_feefactor > 10) {
 			ret = rq_log(ctx, rq, LOG_UNUSUAL,
 				     "Could not find route without excessive delays");
@@ -484,7 +575,8 @@ too_expensive:
 		       fmt_amount_msat(tmpctx, maxfee),
 		       mu);
 		new_flows = minflow(rq, rq, srcnode, dstnode, amount,
-				    mu > 100 ? 100 : mu, delay_feefactor, single_path);
+				    mu > 100 ? 100 : mu, delay_feefactor, single_path,
+				    mcache);
 		if (!flows || mu >= 100) {
 			ret = rq_log(ctx, rq, LOG_UNUSUAL,
 				     "Could not find route without excessive cost");
@@ -541,6 +633,9 @@ too_expensive:
 	if (amount_msat_greater(flowset_fee(rq->plugin, flows), maxfee)) {
 		rq_log(tmpctx, rq, LOG_UNUSUAL,
 		       "After final refinement, fee was excessive: retrying");
+		/* Refinement zeroed some rq->capacities, so the cached
+		 * linearization no longer matches rq. */
+		minflow_cache_prepare(mcache, rq, amount);
 		goto too_expensive;
 	}
 
@@ -585,15 +680,12 @@ too_expensive:
 		       fmt_route(tmpctx, r, (*amounts)[i], finalcltv));
 	}
 
-	gossmap_remove_localmods(askrene->gossmap, localmods);
-
 	return NULL;
 
 	/* Explicit failure path keeps the compiler (gcc version 12.3.0 -O3) from
 	 * warning about uninitialized variables in the caller */
 fail:
 	assert(ret != NULL);
-	gossmap_remove_localmods(askrene->gossmap, localmods);
 	return ret;
 }
 
@@ -633,61 +725,308 @@ void get_constraints(const struct route_query *rq,
 	reserve_sub(rq->reserved, &scidd, max);
 }
 
-struct getroutes_info {
+/* Adds the routes to a getroutes response */
+static void json_add_routes(struct json_stream *js,
+			    struct route **routes,
+			    const struct amount_msat *amounts,
+			    double probability,
+			    u32 finalcltv)
+{
+	json_add_u64(js, "probability_ppm", (u64)(probability * 1000000));
+	json_array_start(js, "routes");
+	for (size_t i = 0; i < tal_count(routes); i++) {
+		json_object_start(js, NULL);
+		json_add_u64(js, "probability_ppm", (u64)(routes[i]->success_prob * 1000000));
+		json_add_amount_msat(js, "amount_msat", amounts[i]);
+		json_add_u32(js, "final_cltv", finalcltv);
+		json_array_start(js, "path");
+		for (size_t j = 0; j < tal_count(routes[i]->hops); j++) {
+			struct short_channel_id_dir scidd;
+			const struct route_hop *r = &routes[i]->hops[j];
+			json_object_start(js, NULL);
+			scidd.scid = r->scid;
+			scidd.dir = r->direction;
+			json_add_short_channel_id_dir(js, "short_channel_id_dir", scidd);
+			json_add_node_id(js, "next_node_id", &r->node_id);
+			json_add_amount_msat(js, "amount_msat", r->amount);
+			json_add_u32(js, "delay", r->delay);
+			json_object_end(js);
+		}
+		json_array_end(js);
+		json_object_end(js);
+	}
+	json_array_end(js);
+}
+
+/* A child process doing the work for a getroutes command */
+struct getroutes_child {
 	struct command *cmd;
-	struct node_id *source, *dest;
-	struct amount_msat *amount, *maxfee;
-	u32 *finalcltv, *maxdelay;
-	const char **layers;
-	struct additional_cost_htable *additional_costs;
-	/* Non-NULL if we are told to use "auto.localchans" */
-	struct layer *local_layer;
+	pid_t pid;
+	char *output;
+	size_t output_bytes, new_output;
 };
 
+static struct io_plan *child_read_more(struct io_conn *conn,
+				       struct getroutes_child *child)
+{
+	child->output_bytes += child->new_output;
+	if (child->output_bytes == tal_count(child->output))
+		tal_resize(&child->output, child->output_bytes * 2);
+	return io_read_partial(conn, child->output + child->output_bytes,
+			       tal_count(child->output) - child->output_bytes,
+			       &child->new_output, child_read_more, child);
+}
+
+static struct io_plan *child_output_init(struct io_conn *conn,
+					 struct getroutes_child *child)
+{
+	child->output_bytes = child->new_output = 0;
+	child->output = tal_arr(child, char, 4096);
+	return child_read_more(conn, child);
+}
+
+/* Strings from the child are JSON-escaped. */
+static const char *child_str(const tal_t *ctx,
+			     const char *buffer, const jsmntok_t *tok)
+{
+	struct json_escape *esc;
+	const char *str;
+
+	esc = json_escape_string_(tmpctx, buffer + tok->start,
+				  tok->end - tok->start);
+	str = json_escape_unescape(ctx, esc);
+	/* Only fails on \u, which we never produce */
+	if (!str)
+		str = json_strdup(ctx, buffer, tok);
+	return str;
+}
+
+/* Child wrote {"logs":[...],"error":...}, {"logs":[...],"fatal":...}
+ * or {"logs":[...],<routes>} */
+static struct command_result *child_done(struct getroutes_child *child,
+					 int status)
+{
+	struct command *cmd = child->cmd;
+	const char *buf = child->output;
+	const jsmntok_t *toks, *logs, *t, *err;
+	const char *msg;
+	struct json_stream *response;
+	size_t i;
+
+	toks = json_parse_simple(tmpctx, buf, child->output_bytes);
+	if (!toks)
+		return command_fail(cmd, LIGHTNINGD,
+				    "getroutes child failed (status %i): '%.*s'",
+				    status, (int)child->output_bytes, buf);
+
+	logs = json_get_member(buf, toks, "logs");
+	json_for_each_arr(i, t, logs) {
+		enum log_level level;
+		const jsmntok_t *ltok = json_get_member(buf, t, "level");
+
+		if (!log_level_parse(buf + ltok->start,
+				     ltok->end - ltok->start, &level))
+			level = LOG_BROKEN;
+		msg = child_str(tmpctx, buf, json_get_member(buf, t, "message"));
+		if (json_get_member(buf, t, "plugin_log"))
+			plugin_log(cmd->plugin, level, "%s", msg);
+		else
+			cmd_log(cmd, level, msg);
+	}
+
+	/* plugin_err() would have killed us: it only kills the child. */
+	err = json_get_member(buf, toks, "fatal");
+	if (err) {
+		msg = child_str(tmpctx, buf, err);
+		plugin_log(cmd->plugin, LOG_BROKEN,
+			   "getroutes child for %s failed: %s", cmd->id, msg);
+		return command_fail(cmd, LIGHTNINGD,
+				    "getroutes failed: %s", msg);
+	}
+
+	err = json_get_member(buf, toks, "error");
+	if (err)
+		return command_fail(cmd, PAY_ROUTE_NOT_FOUND, "%s",
+				    child_str(tmpctx, buf, err));
+
+	response = jsonrpc_stream_success(cmd);
+	json_add_tok(response, "probability_ppm",
+		     json_get_member(buf, toks, "probability_ppm"), buf);
+	json_add_tok(response, "routes",
+		     json_get_member(buf, toks, "routes"), buf);
+	return command_finished(cmd, response);
+}
+
+/* Hack to suppress warnings when we finish from an io callback */
+static void discard_result(struct command_result *ret)
+{
+}
+
+static void child_finished(struct io_conn *conn UNUSED,
+			   struct getroutes_child *child)
+{
+	struct askrene *askrene = get_askrene(child->cmd->plugin);
+	int status = -1;
+
+	while (waitpid(child->pid, &status, 0) < 0 && errno == EINTR);
+	askrene->num_children--;
+
+	discard_result(child_done(child, status));
+}
+
+/* Finish the reply to the parent, and go. */
+static void NORETURN child_exit(struct askrene *askrene, int status)
+{
+	const char *p;
+	size_t len;
+
+	json_object_end(askrene->child_js);
+	p = json_out_contents(askrene->child_js->jout, &len);
+	if (!write_all(askrene->child_fd, p, len))
+		_exit(1);
+	_exit(status);
+}
+
+/* plugin_log() in a child: pass it to the parent. */
+static void child_plugin_log(struct plugin *plugin,
+			     enum log_level level,
+			     const char *msg)
+{
+	child_add_log(get_askrene(plugin)->child_js, level, msg, true);
+}
+
+/* plugin_err() in a child: tell the parent why, instead of dying silently. */
+static void child_plugin_err(struct plugin *plugin, const char *msg)
+{
+	struct askrene *askrene = get_askrene(plugin);
+
+	json_array_end(askrene->child_js);
+	json_add_string(askrene->child_js, "fatal", msg);
+	child_exit(askrene, 1);
+}
+
+/* The child has a copy-on-write snapshot of everything, so it can
+ * calculate routes while we keep serving other requests. */
+static void NORETURN getroutes_child(struct command *cmd,
+				     struct route_query *rq,
+				     const struct getroutes_info *info,
+				     int outfd)
+{
+	struct askrene *askrene = get_askrene(cmd->plugin);
+	const char *err;
+	double probability;
+	struct amount_msat *amounts;
+	struct route **routes;
+	struct json_stream *js;
+	int devnull;
+
+	/* Don't let anything write to lightningd! */
+	devnull = open("/dev/null", O_WRONLY);
+	dup2(devnull, STDOUT_FILENO);
+
+	js = askrene->child_js = new_json_stream(cmd, NULL, NULL);
+	askrene->child_fd = outfd;
+	json_object_start(js, NULL);
+	json_array_start(js, "logs");
+	plugin_set_child_handlers(cmd->plugin,
+				  child_plugin_log, child_plugin_err);
+
+	err = get_routes(cmd, rq, info, &routes, &amounts, &probability);
+	json_array_end(js);
+	if (err)
+		json_add_string(js, "error", err);
+	else
+		json_add_routes(js, routes, amounts, probability,
+				*info->finalcltv);
+	child_exit(askrene, 0);
+}
+
+/* Returns false if we couldn't start a child, so we should do it ourselves. */
+static bool start_getroutes_child(struct command *cmd,
+				  struct route_query *rq,
+				  const struct getroutes_info *info)
+{
+	struct askrene *askrene = get_askrene(cmd->plugin);
+	struct getroutes_child *child;
+	struct io_conn *conn;
+	int fds[2];
+
+	if (pipe(fds) != 0) {
+		plugin_log(cmd->plugin, LOG_UNUSUAL,
+			   "getroutes: pipe failed (%s), solving in-process",
+			   strerror(errno));
+		return false;
+	}
+
+	child = tal(cmd, struct getroutes_child);
+	child->cmd = cmd;
+	child->pid = fork();
+	if (child->pid < 0) {
+		plugin_log(cmd->plugin, LOG_UNUSUAL,
+			   "getroutes: fork failed (%s), solving in-process",
+			   strerror(errno));
+		close(fds[0]);
+		close(fds[1]);
+		tal_free(child);
+		return false;
+	}
+	if (child->pid == 0) {
+		close(fds[0]);
+		getroutes_child(cmd, rq, info, fds[1]);
+	}
+	close(fds[1]);
+	askrene->num_children++;
+
+	/* We don't keep a pointer to this, but it's not a leak */
+	conn = notleak(io_new_conn(child, fds[0], child_output_init, child));
+	io_set_finish(conn, child_finished, child);
+	return true;
+}
+
 static struct command_result *do_getroutes(struct command *cmd,
 					   struct gossmap_localmods *localmods,
 					   const struct getroutes_info *info)
 {
+	struct askrene *askrene = get_askrene(cmd->plugin);
 	const char *err;
 	double probability;
 	struct amount_msat *amounts;
 	struct route **routes;
+	struct route_query *rq;
 	struct json_stream *response;
+	struct gossmap_changes *changes;
+
+	/* Do this before forking, so we (and future children) keep it. */
+	if (gossmap_refresh_changes(askrene->gossmap, tmpctx, &changes)) {
+		update_capacities(askrene->gossmap, &askrene->capacities,
+				  changes);
+		minflow_cache_gossmap_changed(askrene->minflow_cache, changes);
+	}
+
+	rq = new_route_query(cmd, cmd, info, localmods);
+	/* Also before forking: the child starts from this, and we keep it
+	 * up to date for next time. */
+	minflow_cache_prepare(askrene->minflow_cache, rq, *info->amount);
+
+	if (askrene->num_children < askrene->max_children) {
+		if (start_getroutes_child(cmd, rq, info)) {
+			gossmap_remove_localmods(askrene->gossmap, localmods);
+			return command_still_pending(cmd);
+		}
+	} else {
+		plugin_log(cmd->plugin, LOG_DBG,
+			   "getroutes: %zu children busy, solving in-process",
+			   askrene->num_children);
+	}
 
-	err = get_routes(cmd, cmd,
-			 info->source, info->dest,
-			 *info->amount, *info->maxfee, *info->finalcltv,
-			 *info->maxdelay, info->layers, localmods, info->local_layer,
-			 have_layer(info->layers, "auto.no_mpp_support"),
-			 &routes, &amounts, info->additional_costs, &probability);
+	err = get_routes(cmd, rq, info, &routes, &amounts, &probability);
+	gossmap_remove_localmods(askrene->gossmap, localmods);
 	if (err)
 		return command_fail(cmd, PAY_ROUTE_NOT_FOUND, "%s", err);
 
 	response = jsonrpc_stream_success(cmd);
-	json_add_u64(response, "probability_ppm", (u64)(probability * 1000000));
-	json_array_start(response, "routes");
-	for (size_t i = 0; i < tal_count(routes); i++) {
-		json_object_start(response, NULL);
-		json_add_u64(response, "probability_ppm", (u64)(routes[i]->success_prob * 1000000));
-		json_add_amount_msat(response, "amount_msat", amounts[i]);
-		json_add_u32(response, "final_cltv", *info->finalcltv);
-		json_array_start(response, "path");
-		for (size_t j = 0; j < tal_count(routes[i]->hops); j++) {
-			struct short_channel_id_dir scidd;
-			const struct route_hop *r = &routes[i]->hops[j];
-			json_object_start(response, NULL);
-			scidd.scid = r->scid;
-			scidd.dir = r->direction;
-			json_add_short_channel_id_dir(response, "short_channel_id_dir", scidd);
-			json_add_node_id(response, "next_node_id", &r->node_id);
-			json_add_amount_msat(response, "amount_msat", r->amount);
-			json_add_u32(response, "delay", r->delay);
-			json_object_end(response);
-		}
-		json_array_end(response);
-		json_object_end(response);
-	}
-	json_array_end(response);
+	json_add_routes(response, routes, amounts, probability,
+			*info->finalcltv);
 	return command_finished(cmd, response);
 }
 
@@ -706,17 +1045,17 @@ static void add_localchan(struct gossmap_localmods *mods,
 			  bool enabled,
 			  const char *buf,
 			  const jsmntok_t *chantok,
-			  struct getroutes_info *info)
+			  struct askrene *askrene)
 {
 	u32 feerate;
 	const char *opener;
 	const char *err;
 
 	/* We get called twice, once in each direction: only create once. */
-	if (!layer_find_local_channel(info->local_layer, scidd->scid))
-		layer_add_local_channel(info->local_layer,
+	if (!layer_find_local_channel(askrene->local_layer, scidd->scid))
+		layer_add_local_channel(askrene->local_layer,
 					self, peer, scidd->scid, capacity_msat);
-	layer_add_update_channel(info->local_layer, scidd,
+	layer_add_update_channel(askrene->local_layer, scidd,
 				 &enabled,
 				 &htlcmin, &htlcmax,
 				 &fee_base, &fee_proportional, &cltv_delta);
@@ -728,7 +1067,7 @@ static void add_localchan(struct gossmap_localmods *mods,
 			JSON_SCAN(json_to_u32, &feerate),
 			JSON_SCAN_TAL(tmpctx, json_strdup, &opener));
 	if (err) {
-		plugin_log(info->cmd->plugin, LOG_BROKEN,
+		plugin_log(askrene->plugin, LOG_BROKEN,
 			   "Cannot scan channel for feerate and owner (%s): %.*s",
 			   err, json_tok_full_len(chantok), json_tok_full(buf, chantok));
 		return;
@@ -744,7 +1083,7 @@ static void add_localchan(struct gossmap_localmods *mods,
 		 *     3. Multiply `feerate_per_kw` by `weight`, divide by 1000 (rounding down).
 		 */
 		struct per_htlc_cost *phc
-			= tal(info->additional_costs, struct per_htlc_cost);
+			= tal(askrene->local_costs, struct per_htlc_cost);
 
 		phc->scidd = *scidd;
 		if (!amount_sat_to_msat(&phc->per_htlc_cost,
@@ -753,38 +1092,120 @@ static void add_localchan(struct gossmap_localmods *mods,
 			abort();
 		}
 
-		plugin_log(info->cmd->plugin, LOG_DBG, "Per-htlc cost for %s = %s (%u x 172)",
+		plugin_log(askrene->plugin, LOG_DBG, "Per-htlc cost for %s = %s (%u x 172)",
 			   fmt_short_channel_id_dir(tmpctx, scidd),
 			   fmt_amount_msat(tmpctx, phc->per_htlc_cost),
 			   feerate);
-		additional_cost_htable_add(info->additional_costs, phc);
+		additional_cost_htable_add(askrene->local_costs, phc);
 	}
 
 	/* can't send more than expendable and no more than max_total_htlc */
 	struct amount_msat max_msat = amount_msat_min(spendable, max_total_htlc);
 	/* Known capacity on local channels (ts = max) */
-	layer_add_constraint(info->local_layer, scidd, UINT64_MAX, &max_msat, &max_msat);
+	layer_add_constraint(askrene->local_layer, scidd, UINT64_MAX, &max_msat, &max_msat);
+}
+
+/* Mark the cached "auto.localchans" layer stale: next getroutes refreshes it */
+static void localchans_invalidate(struct askrene *askrene)
+{
+	if (askrene->localchans_waiting)
+		askrene->localchans_changed = true;
+	askrene->local_layer = tal_free(askrene->local_layer);
+	askrene->local_costs = NULL;
 }
 
 static struct command_result *
-listpeerchannels_done(struct command *cmd,
+listpeerchannels_done(struct command *aux_cmd,
 		      const char *method UNUSED,
 		      const char *buffer,
 		      const jsmntok_t *toks,
-		      struct getroutes_info *info)
+		      struct askrene *askrene)
+{
+	struct getroutes_info **waiting;
+
+	tal_free(askrene->local_layer);
+	askrene->local_layer = new_temp_layer(askrene, askrene, "auto.localchans");
+	askrene->local_costs = tal(askrene->local_layer,
+				   struct additional_cost_htable);
+	additional_cost_htable_init(askrene->local_costs);
+	/* add_localchan puts everything into the layer, not the localmods */
+	gossmods_from_listpeerchannels(tmpctx,
+				       &askrene->my_id,
+				       buffer, toks,
+				       false,
+				       add_localchan,
+				       askrene);
+
+	waiting = tal_steal(tmpctx, askrene->localchans_waiting);
+	askrene->localchans_waiting = NULL;
+	for (size_t i = 0; i < tal_count(waiting); i++) {
+		struct getroutes_info *info = waiting[i];
+
+		info->local_layer = askrene->local_layer;
+		info->additional_costs = askrene->local_costs;
+		discard_result(do_getroutes(info->cmd,
+					    gossmap_localmods_new(info->cmd),
+					    info));
+	}
+
+	/* Those callers asked around the time of the change, so this
+	 * is as good as they'd have got before: but don't keep it. */
+	if (askrene->localchans_changed) {
+		askrene->localchans_changed = false;
+		localchans_invalidate(askrene);
+	}
+	return aux_command_done(aux_cmd);
+}
+
+static struct command_result *
+listpeerchannels_failed(struct command *aux_cmd,
+			const char *method,
+			const char *buffer,
+			const jsmntok_t *toks,
+			struct askrene *askrene)
+{
+	struct getroutes_info **waiting;
+
+	waiting = tal_steal(tmpctx, askrene->localchans_waiting);
+	askrene->localchans_waiting = NULL;
+	askrene->localchans_changed = false;
+	for (size_t i = 0; i < tal_count(waiting); i++)
+		discard_result(forward_error(waiting[i]->cmd, method,
+					     buffer, toks, waiting[i]));
+	return aux_command_done(aux_cmd);
+}
+
+/* Use the cached local channels layer, refreshing it if necessary. */
+static struct command_result *getroutes_with_localchans(struct command *cmd,
+							struct getroutes_info *info)
 {
 	struct askrene *askrene = get_askrene(cmd->plugin);
-	struct gossmap_localmods *localmods;
+	struct out_req *req;
+	struct command *aux_cmd;
 
-	info->local_layer = new_temp_layer(info, askrene, "auto.localchans");
-	localmods = gossmods_from_listpeerchannels(cmd,
-						   &askrene->my_id,
-						   buffer, toks,
-						   false,
-						   add_localchan,
-						   info);
+	if (askrene->local_layer) {
+		info->local_layer = askrene->local_layer;
+		info->additional_costs = askrene->local_costs;
+		return do_getroutes(cmd, gossmap_localmods_new(cmd), info);
+	}
 
-	return do_getroutes(cmd, localmods, info);
+	/* Someone else already asked? */
+	if (askrene->localchans_waiting) {
+		tal_arr_expand(&askrene->localchans_waiting, info);
+		return command_still_pending(cmd);
+	}
+
+	askrene->localchans_waiting = tal_arr(askrene,
+					      struct getroutes_info *, 1);
+	askrene->localchans_waiting[0] = info;
+
+	aux_cmd = aux_command(cmd);
+	req = jsonrpc_request_start(aux_cmd,
+				    "listpeerchannels",
+				    listpeerchannels_done,
+				    listpeerchannels_failed, askrene);
+	send_outreq(req);
+	return command_still_pending(cmd);
 }
 
 static struct command_result *json_getroutes(struct command *cmd,
@@ -830,19 +1251,12 @@ static struct command_result *json_getroutes(struct command *cmd,
 	}
 
 	info->cmd = cmd;
+	if (have_layer(info->layers, "auto.localchans"))
+		return getroutes_with_localchans(cmd, info);
+
 	info->additional_costs = tal(info, struct additional_cost_htable);
 	additional_cost_htable_init(info->additional_costs);
-
-	if (have_layer(info->layers, "auto.localchans")) {
-		struct out_req *req;
-
-		req = jsonrpc_request_start(cmd,
-					    "listpeerchannels",
-					    listpeerchannels_done,
-					    forward_error, info);
-		return send_outreq(req);
-	} else
-		info->local_layer = NULL;
+	info->local_layer = NULL;
 
 	return do_getroutes(cmd, gossmap_localmods_new(cmd), info);
 }
@@ -1304,19 +1718,78 @@ static const struct plugin_command commands[] = {
 	},
 };
 
+/* Anything which changes our channels' state or balances */
+static struct command_result *localchans_notification(struct command *cmd,
+						      const char *buf UNUSED,
+						      const jsmntok_t *params UNUSED)
+{
+	localchans_invalidate(get_askrene(cmd->plugin));
+	return notification_handled(cmd);
+}
+
+static const struct plugin_notification notifications[] = {
+	{
+		"connect",
+		localchans_notification,
+	},
+	{
+		"disconnect",
+		localchans_notification,
+	},
+	{
+		"channel_state_changed",
+		localchans_notification,
+	},
+	{
+		"forward_event",
+		localchans_notification,
+	},
+	{
+		"sendpay_success",
+		localchans_notification,
+	},
+	{
+		"sendpay_failure",
+		localchans_notification,
+	},
+	{
+		"invoice_payment",
+		localchans_notification,
+	},
+};
+
+static struct command_result *localchans_reconcile(struct command *timer_cmd,
+						   struct askrene *askrene)
+{
+	localchans_invalidate(askrene);
+	global_timer(askrene->plugin,
+		     time_from_sec(ASKRENE_LOCALCHANS_RECONCILE_SECS),
+		     localchans_reconcile, askrene);
+	return timer_complete(timer_cmd);
+}
+
 static void askrene_markmem(struct plugin *plugin, struct htable *memtable)
 {
 	struct askrene *askrene = get_askrene(plugin);
 	layer_memleak_mark(askrene, memtable);
 	reserve_memleak_mark(askrene, memtable);
+	if (askrene->local_costs)
+		memleak_scan_htable(memtable, &askrene->local_costs->raw);
 }
 
 static const char *init(struct command *init_cmd,
 			const char *buf UNUSED, const jsmntok_t *config UNUSED)
 {
 	struct plugin *plugin = init_cmd->plugin;
-	struct askrene *askrene = tal(plugin, struct askrene);
+	struct askrene *askrene = get_askrene(plugin);
 	askrene->plugin = plugin;
+	askrene->num_children = 0;
+	askrene->child_js = NULL;
+	askrene->child_fd = -1;
+	askrene->local_layer = NULL;
+	askrene->local_costs = NULL;
+	askrene->localchans_waiting = NULL;
+	askrene->localchans_changed = false;
 	list_head_init(&askrene->layers);
 	askrene->reserved = new_reserve_htable(askrene);
 	askrene->gossmap = gossmap_load(askrene, GOSSIP_STORE_FILENAME,
@@ -1326,22 +1799,33 @@ static const char *init(struct command *init_cmd,
 		plugin_err(plugin, "Could not load gossmap %s: %s",
 			   GOSSIP_STORE_FILENAME, strerror(errno));
 	askrene->capacities = get_capacities(askrene, askrene->plugin, askrene->gossmap);
+	askrene->minflow_cache = minflow_cache_new(askrene);
 	rpc_scan(init_cmd, "getinfo", take(json_out_obj(NULL, NULL, NULL)),
 		 "{id:%}", JSON_SCAN(json_to_node_id, &askrene->my_id));
 
-	plugin_set_data(plugin, askrene);
 	plugin_set_memleak_handler(plugin, askrene_markmem);
 
 	load_layers(askrene, init_cmd);
 
 	/* Layer needs its own command to write to the datastore */
 	askrene->layer_cmd = aux_command(init_cmd);
+
+	global_timer(plugin, time_from_sec(ASKRENE_LOCALCHANS_RECONCILE_SECS),
+		     localchans_reconcile, askrene);
 	return NULL;
 }
 
 int main(int argc, char *argv[])
 {
+	struct askrene *askrene;
+
 	setup_locale();
-	plugin_main(argv, init, NULL, PLUGIN_RESTARTABLE, true, NULL, commands, ARRAY_SIZE(commands),
-	            NULL, 0, NULL, 0, NULL, 0, NULL);
+	askrene = tal(NULL, struct askrene);
+	askrene->max_children = ASKRENE_MAX_CHILDREN;
+	plugin_main(argv, init, take(askrene), PLUGIN_RESTARTABLE, true, NULL, commands, ARRAY_SIZE(commands),
+	            notifications, ARRAY_SIZE(notifications), NULL, 0, NULL, 0,
+		    plugin_option_dev("dev-askrene-max-children", "int",
+				      "Most getroutes to calculate in child processes at once",
+				      u32_option, u32_jsonfmt, &askrene->max_children),
+		    NULL);
 }
@@ -9,7 +9,10 @@
 #include <common/node_id.h>
 #include <plugins/libplugin.h>
 
+struct additional_cost_htable;
+struct getroutes_info;
 struct gossmap_chan;
+struct minflow_cache;
 
 /* A single route. */
 struct route {
@@ -29,10 +32,28 @@ struct askrene {
 	struct reserve_htable *reserved;
 	/* Compact cache of gossmap capacities */
 	fp16_t *capacities;
+	/* Linearized network from the last getroutes (children inherit it) */
+	struct minflow_cache *minflow_cache;
 	/* My own id */
 	struct node_id my_id;
 	/* Aux command for layer */
 	struct command *layer_cmd;
+	/* How many getroutes child processes are running */
+	size_t num_children;
+	/* How many we're allowed */
+	u32 max_children;
+	/* If we're a getroutes child, we build our output here... */
+	struct json_stream *child_js;
+	/* ...and write it to the parent here. */
+	int child_fd;
+	/* Cached "auto.localchans" layer: NULL if it needs refreshing */
+	struct layer *local_layer;
+	/* Per-htlc costs for local channels (NULL with local_layer) */
+	struct additional_cost_htable *local_costs;
+	/* Non-NULL while we're refreshing: getroutes waiting for it */
+	struct getroutes_info **localchans_waiting;
+	/* Something changed while we were refreshing */
+	bool localchans_changed;
 };
 
 /* Information for a single route query. */
@@ -1163,13 +1163,19 @@ bool layer_disables_node(const struct layer *layer,
 	return false;
 }
 
+static void layer_memleak_scan(const struct layer *l, struct htable *memtable)
+{
+	memleak_scan_htable(memtable, &l->constraints->raw);
+	memleak_scan_htable(memtable, &l->local_channels->raw);
+	memleak_scan_htable(memtable, &l->local_updates->raw);
+	memleak_scan_htable(memtable, &l->biases->raw);
+}
+
 void layer_memleak_mark(struct askrene *askrene, struct htable *memtable)
 {
 	struct layer *l;
-	list_for_each(&askrene->layers, l, list) {
-		memleak_scan_htable(memtable, &l->constraints->raw);
-		memleak_scan_htable(memtable, &l->local_channels->raw);
-		memleak_scan_htable(memtable, &l->local_updates->raw);
-		memleak_scan_htable(memtable, &l->biases->raw);
-	}
+	list_for_each(&askrene->layers, l, list)
+		layer_memleak_scan(l, memtable);
+	if (askrene->local_layer)
+		layer_memleak_scan(askrene->local_layer, memtable);
 }
@@ -328,6 +328,50 @@ struct residual_network {
 	s64 *excess;
 };
 
+/* What we can keep between minflow() calls: the linearized network (the
+ * expensive part), and within one query, the last solution, which is a
+ * feasible flow to start refining from next time.
+ *
+ * Layers, reservations and the payer (auto.sourcefree) only change some
+ * channels, which we re-linearize for each query; only a different
+ * amount or gossmap topology needs a whole new network. */
+struct minflow_cache {
+	/* What linear_network was built for */
+	struct amount_msat amount;
+	double delay_feefactor;
+	/* Channels which may not be as plain gossmap would have them */
+	u32 *patched;
+	/* Channels gossmap_refresh_changes() updated since we looked */
+	u32 *gossmap_updated;
+
+	/* What residual_network is a solution for */
+	const struct gossmap_node *source, *target;
+
+	/* NULL if not built yet */
+	struct linear_network *linear_network;
+	/* NULL if we don't have a previous solution */
+	struct residual_network *residual_network;
+};
+
+struct minflow_cache *minflow_cache_new(const tal_t *ctx)
+{
+	struct minflow_cache *cache = tal(ctx, struct minflow_cache);
+	cache->delay_feefactor = 0;
+	cache->patched = tal_arr(cache, u32, 0);
+	cache->gossmap_updated = tal_arr(cache, u32, 0);
+	cache->linear_network = NULL;
+	cache->residual_network = NULL;
+	return cache;
+}
+
+void minflow_cache_reset(struct minflow_cache *cache)
+{
+	cache->linear_network = tal_free(cache->linear_network);
+	cache->residual_network = tal_free(cache->residual_network);
+	tal_resize(&cache->patched, 0);
+	tal_resize(&cache->gossmap_updated, 0);
+}
+
 /* Helper function.
  * Given an arc of the network (not residual) give me the flow. */
 static s64 get_arc_flow(
@@ -576,6 +620,92 @@ struct amount_msat linear_flow_cost(const struct flow *flow,
 	return msat_cost;
 }
 
+static void set_arc_fee_cost(const struct pay_parameters *params,
+			     struct linear_network *linear_network,
+			     const struct gossmap_chan *c, int chandir,
+			     struct arc arc)
+{
+	/* linear fee_cost per unit of flow */
+	const s64 fee_cost = linear_fee_cost(
+		c->half[chandir].base_fee,
+		c->half[chandir].proportional_fee,
+		c->half[chandir].delay,
+		params->base_fee_penalty,
+		params->delay_feefactor);
+
+	linear_network->arc_fee_cost[arc.idx] = fee_cost;
+	// + the respective dual
+	linear_network->arc_fee_cost[arc_dual(linear_network->graph, arc).idx] = -fee_cost;
+}
+
+/* Fee costs depend on delay_feefactor, so we can redo just these if it
+ * changes. */
+static void set_linear_fee_costs(const struct pay_parameters *params,
+				 struct linear_network *linear_network)
+{
+	const struct gossmap *gossmap = params->rq->gossmap;
+	const struct graph *graph = linear_network->graph;
+	const size_t max_num_arcs = graph_max_num_arcs(graph);
+
+	for (struct arc arc = {.idx = 0}; arc.idx < max_num_arcs; ++arc.idx) {
+		u32 chanidx;
+		int chandir;
+
+		if (arc_is_dual(graph, arc) || !arc_enabled(graph, arc))
+			continue;
+
+		arc_to_parts(arc, &chanidx, &chandir, NULL, NULL);
+		set_arc_fee_cost(params, linear_network,
+				 gossmap_chan_byidx(gossmap, chanidx), chandir,
+				 arc);
+	}
+}
+
+/* Does this direction of the channel get arcs in the linear network? */
+static bool half_in_network(const struct pay_parameters *params,
+			    const struct gossmap_chan *c, int half)
+{
+	const struct gossmap *gossmap = params->rq->gossmap;
+
+	if (!gossmap_chan_set(c, half) || !c->half[half].enabled)
+		return false;
+
+	/* If a channel insists on more than our total, remove it */
+	if (amount_msat_less(params->amount, gossmap_chan_htlc_min(c, half)))
+		return false;
+
+	/* No self-loops */
+	return gossmap_nth_node(gossmap, c, half)
+		!= gossmap_nth_node(gossmap, c, !half);
+}
+
+/* Set capacities and costs of the arcs for this direction of the channel */
+static void set_linear_arcs(const struct pay_parameters *params,
+			    struct linear_network *linear_network,
+			    const struct gossmap_chan *c, u32 chan_id, int half)
+{
+	// `cost` is the word normally used to denote cost per
+	// unit of flow in the context of MCF.
+	double prob_cost[CHANNEL_PARTS];
+	s64 capacity[CHANNEL_PARTS];
+
+	// split this channel direction to obtain the arcs
+	// that are outgoing to `node`
+	linearize_channel(params, c, half, capacity, prob_cost);
+
+	for (size_t k = 0; k < CHANNEL_PARTS; ++k) {
+		struct arc arc = arc_from_parts(chan_id, half, k, false);
+		struct arc dual = arc_dual(linear_network->graph, arc);
+
+		linear_network->capacity[arc.idx] = capacity[k];
+		linear_network->arc_prob_cost[arc.idx] = prob_cost[k];
+
+		// + the respective dual
+		linear_network->capacity[dual.idx] = 0;
+		linear_network->arc_prob_cost[dual.idx] = -prob_cost[k];
+	}
+}
+
 /* FIXME: Instead of mapping one-to-one the indexes in the gossmap, try to
  * reduce the number of nodes and arcs used by taking only those that are
  * enabled. We might save some cpu if the work with a pruned network. */
@@ -590,7 +720,7 @@ init_linear_network(const tal_t *ctx, const struct pay_parameters *params)
 	const size_t max_num_nodes = gossmap_max_node_idx(gossmap);
 
 	linear_network->graph =
-	    graph_new(ctx, max_num_nodes, max_num_arcs, ARC_DUAL_BITOFF);
+	    graph_new(linear_network, max_num_nodes, max_num_arcs, ARC_DUAL_BITOFF);
 
 	linear_network->arc_prob_cost = tal_arr(linear_network,double,max_num_arcs);
 	for(size_t i=0;i<max_num_arcs;++i)
@@ -614,11 +744,7 @@ init_linear_network(const tal_t *ctx, const struct pay_parameters *params)
 			const struct gossmap_chan *c = gossmap_nth_chan(gossmap,
 			                                                node, j, &half);
 
-			if (!gossmap_chan_set(c, half) || !c->half[half].enabled)
-				continue;
-
-			/* If a channel insists on more than our total, remove it */
-			if (amount_msat_less(params->amount, gossmap_chan_htlc_min(c, half)))
+			if (!half_in_network(params, c, half))
 				continue;
 
 			const u32 chan_id = gossmap_chan_idx(gossmap, c);
@@ -628,26 +754,6 @@ init_linear_network(const tal_t *ctx, const struct pay_parameters *params)
 
 			const u32 next_id = gossmap_node_idx(gossmap,next);
 
-			if(node_id==next_id)
-				continue;
-
-			// `cost` is the word normally used to denote cost per
-			// unit of flow in the context of MCF.
-			double prob_cost[CHANNEL_PARTS];
-			s64 capacity[CHANNEL_PARTS];
-
-			// split this channel direction to obtain the arcs
-			// that are outgoing to `node`
-			linearize_channel(params, c, half, capacity, prob_cost);
-
-			/* linear fee_cost per unit of flow */
-			const s64 fee_cost = linear_fee_cost(
-				c->half[half].base_fee,
-				c->half[half].proportional_fee,
-				c->half[half].delay,
-				params->base_fee_penalty,
-				params->delay_feefactor);
-
 			// let's subscribe the 4 parts of the channel direction
 			// (c,half), the dual of these guys will be subscribed
 			// when the `i` hits the `next` node.
@@ -661,24 +767,85 @@ init_linear_network(const tal_t *ctx, const struct pay_parameters *params)
 				graph_add_arc(linear_network->graph, arc,
 					      node_obj(node_id),
 					      node_obj(next_id));
-
-				linear_network->capacity[arc.idx] = capacity[k];
-				linear_network->arc_prob_cost[arc.idx] = prob_cost[k];
-				linear_network->arc_fee_cost[arc.idx] = fee_cost;
-
-				// + the respective dual
-				struct arc dual = arc_dual(linear_network->graph, arc);
-
-				linear_network->capacity[dual.idx] = 0;
-				linear_network->arc_prob_cost[dual.idx] = -prob_cost[k];
-				linear_network->arc_fee_cost[dual.idx] = -fee_cost;
 			}
+			set_linear_arcs(params, linear_network, c, chan_id, half);
 		}
 	}
 
+	set_linear_fee_costs(params, linear_network);
 	return linear_network;
 }
 
+/* Channels where layers, reservations or localmods could make the
+ * linearization differ from plain gossmap. */
+static u32 *touched_channels(const tal_t *ctx, const struct route_query *rq)
+{
+	const struct gossmap *gossmap = rq->gossmap;
+	u32 *touched = tal_arr(ctx, u32, 0);
+
+	for (u32 i = 0; i < gossmap_max_chan_idx(gossmap); i++) {
+		const struct gossmap_chan *c = gossmap_chan_byidx(gossmap, i);
+		if (!c)
+			continue;
+		/* get_constraints() only uses the capacities cache if set */
+		if (i >= tal_count(rq->capacities)
+		    || rq->capacities[i] == 0
+		    || gossmap_chan_has_localmods(gossmap, c))
+			tal_arr_expand(&touched, i);
+	}
+	return touched;
+}
+
+/* Re-linearize this channel in an existing network.  Returns false if
+ * it would gain or lose arcs, so the network needs rebuilding. */
+static bool update_linear_channel(const struct pay_parameters *params,
+				  struct linear_network *linear_network,
+				  u32 chanidx)
+{
+	const struct gossmap *gossmap = params->rq->gossmap;
+	const struct graph *graph = linear_network->graph;
+	const struct gossmap_chan *c = gossmap_chan_byidx(gossmap, chanidx);
+
+	for (int half = 0; half < 2; half++) {
+		const struct arc arc = arc_from_parts(chanidx, half, 0, false);
+		const bool want = c && half_in_network(params, c, half);
+		const struct gossmap_node *from, *to;
+
+		if (want != arc_enabled(graph, arc))
+			return false;
+		if (!want)
+			continue;
+
+		from = gossmap_nth_node(gossmap, c, half);
+		to = gossmap_nth_node(gossmap, c, !half);
+		if (arc_tail(graph, arc).idx != gossmap_node_idx(gossmap, from)
+		    || arc_head(graph, arc).idx != gossmap_node_idx(gossmap, to))
+			return false;
+
+		set_linear_arcs(params, linear_network, c, chanidx, half);
+		for (size_t k = 0; k < CHANNEL_PARTS; ++k)
+			set_arc_fee_cost(params, linear_network, c, half,
+					 arc_from_parts(chanidx, half, k, false));
+	}
+	return true;
+}
+
+/* Re-linearize each of these channels once; false if we need a rebuild. */
+static bool update_linear_channels(const struct pay_parameters *params,
+				   struct linear_network *linear_network,
+				   bitmap *done,
+				   const u32 *chans)
+{
+	for (size_t i = 0; i < tal_count(chans); i++) {
+		if (bitmap_test_bit(done, chans[i]))
+			continue;
+		bitmap_set_bit(done, chans[i]);
+		if (!update_linear_channel(params, linear_network, chans[i]))
+			return false;
+	}
+	return true;
+}
+
 // flow on directed channels
 struct chan_flow
 {
@@ -947,6 +1114,103 @@ get_flow_paths(const tal_t *ctx,
 	return flows;
 }
 
+static void init_pay_parameters(struct pay_parameters *params,
+				const struct route_query *rq,
+				const struct gossmap_node *source,
+				const struct gossmap_node *target,
+				struct amount_msat amount,
+				double delay_feefactor)
+{
+	params->rq = rq;
+	params->source = source;
+	params->target = target;
+	params->amount = amount;
+	params->accuracy = AMOUNT_MSAT(1000);
+	/* FIXME: params->accuracy = amount_msat_max(amount_msat_div(amount,
+	 * 1000), AMOUNT_MSAT(1));
+	 * */
+
+	// template the channel partition into linear arcs
+	params->cap_fraction[0]=0;
+	params->cost_fraction[0]=0;
+	for(size_t i =1;i<CHANNEL_PARTS;++i)
+	{
+		params->cap_fraction[i]=CHANNEL_PIVOTS[i]-CHANNEL_PIVOTS[i-1];
+		params->cost_fraction[i]=
+			log((1-CHANNEL_PIVOTS[i-1])/(1-CHANNEL_PIVOTS[i]))
+			/params->cap_fraction[i];
+	}
+
+	params->delay_feefactor = delay_feefactor;
+	params->base_fee_penalty = base_fee_penalty_estimate(amount);
+}
+
+void minflow_cache_prepare(struct minflow_cache *cache,
+			   const struct route_query *rq,
+			   struct amount_msat amount)
+{
+	const struct gossmap *gossmap = rq->gossmap;
+	struct pay_parameters params;
+	bitmap *done;
+	u32 *touched;
+
+	/* Potentials from another query would make our answer depend on
+	 * what we were asked before. */
+	cache->residual_network = tal_free(cache->residual_network);
+
+	init_pay_parameters(&params, rq, NULL, NULL, amount,
+			    cache->delay_feefactor);
+	touched = touched_channels(cache, rq);
+
+	if (!cache->linear_network
+	    || !amount_msat_eq(cache->amount, amount)
+	    || graph_max_num_nodes(cache->linear_network->graph)
+	       != gossmap_max_node_idx(gossmap)
+	    || graph_max_num_arcs(cache->linear_network->graph)
+	       != gossmap_max_chan_idx(gossmap) * ARCS_PER_CHANNEL)
+		goto rebuild;
+
+	/* Undo what we changed last time, and apply what's changed now. */
+	done = tal_arrz(tmpctx, bitmap,
+			BITMAP_NWORDS(gossmap_max_chan_idx(gossmap)));
+	if (!update_linear_channels(&params, cache->linear_network, done,
+				    cache->patched)
+	    || !update_linear_channels(&params, cache->linear_network, done,
+				       touched)
+	    || !update_linear_channels(&params, cache->linear_network, done,
+				       cache->gossmap_updated))
+		goto rebuild;
+	goto out;
+
+rebuild:
+	tal_free(cache->linear_network);
+	cache->amount = amount;
+	cache->linear_network = init_linear_network(cache, &params);
+out:
+	tal_free(cache->patched);
+	cache->patched = touched;
+	tal_resize(&cache->gossmap_updated, 0);
+}
+
+void minflow_cache_gossmap_changed(struct minflow_cache *cache,
+				   const struct gossmap_changes *changes)
+{
+	/* Indexes are preserved, but the graph would need new arcs */
+	if (tal_count(changes->chans_added)
+	    || tal_count(changes->chans_removed)
+	    || tal_count(changes->nodes_added)
+	    || tal_count(changes->nodes_removed)) {
+		minflow_cache_reset(cache);
+		return;
+	}
+
+	if (!cache->linear_network)
+		return;
+	for (size_t i = 0; i < tal_count(changes->chans_updated); i++)
+		tal_arr_expand(&cache->gossmap_updated,
+			       changes->chans_updated[i]);
+}
+
 // TODO(eduardo): choose some default values for the minflow parameters
 /* eduardo: I think it should be clear that this module deals with linear
  * flows, ie. base fees are not considered. Hence a flow along a path is
@@ -966,61 +1230,76 @@ struct flow **minflow(const tal_t *ctx,
 		      struct amount_msat amount,
 		      u32 mu,
 		      double delay_feefactor,
-		      bool single_part)
+		      bool single_part,
+		      struct minflow_cache *cache)
 {
 	struct flow **flow_paths;
+	struct linear_network *linear_network;
+	struct residual_network *residual_network;
 	/* We allocate everything off this, and free it at the end,
 	 * as we can be called multiple times without cleaning tmpctx! */
 	tal_t *working_ctx = tal(NULL, char);
 	struct pay_parameters *params = tal(working_ctx, struct pay_parameters);
 
-	params->rq = rq;
-	params->source = source;
-	params->target = target;
-	params->amount = amount;
-	params->accuracy = AMOUNT_MSAT(1000);
-	/* FIXME: params->accuracy = amount_msat_max(amount_msat_div(amount,
-	 * 1000), AMOUNT_MSAT(1));
-	 * */
+	init_pay_parameters(params, rq, source, target, amount, delay_feefactor);
 
-	// template the channel partition into linear arcs
-	params->cap_fraction[0]=0;
-	params->cost_fraction[0]=0;
-	for(size_t i =1;i<CHANNEL_PARTS;++i)
-	{
-		params->cap_fraction[i]=CHANNEL_PIVOTS[i]-CHANNEL_PIVOTS[i-1];
-		params->cost_fraction[i]=
-			log((1-CHANNEL_PIVOTS[i-1])/(1-CHANNEL_PIVOTS[i]))
-			/params->cap_fraction[i];
-	}
-
-	params->delay_feefactor = delay_feefactor;
-	params->base_fee_penalty = base_fee_penalty_estimate(amount);
+	/* Throw away cache if it's for a different question. */
+	if (cache && cache->linear_network
+	    && !amount_msat_eq(cache->amount, amount))
+		minflow_cache_reset(cache);
+	if (cache && cache->residual_network
+	    && (cache->source != source || cache->target != target))
+		cache->residual_network = tal_free(cache->residual_network);
 
 	// build the uncertainty network with linearization and residual arcs
-	struct linear_network *linear_network= init_linear_network(working_ctx, params);
+	if (cache && cache->linear_network) {
+		linear_network = cache->linear_network;
+		if (cache->delay_feefactor != delay_feefactor) {
+			set_linear_fee_costs(params, linear_network);
+			cache->delay_feefactor = delay_feefactor;
+		}
+	} else {
+		linear_network = init_linear_network(working_ctx, params);
+		if (cache) {
+			cache->amount = amount;
+			cache->delay_feefactor = delay_feefactor;
+			cache->linear_network = tal_steal(cache, linear_network);
+			tal_free(cache->patched);
+			cache->patched = touched_channels(cache, rq);
+			tal_resize(&cache->gossmap_updated, 0);
+		}
+	}
 	const struct graph *graph = linear_network->graph;
 	const size_t max_num_arcs = graph_max_num_arcs(graph);
 	const size_t max_num_nodes = graph_max_num_nodes(graph);
-	struct residual_network *residual_network =
-	    alloc_residual_network(working_ctx, max_num_nodes, max_num_arcs);
-
-	const struct node dst = {.idx = gossmap_node_idx(rq->gossmap, target)};
-	const struct node src = {.idx = gossmap_node_idx(rq->gossmap, source)};
-
-	init_residual_network(linear_network,residual_network);
 
-	/* Since we have constraint accuracy, ask to find a payment solution
-	 * that can pay a bit more than the actual value rathen than undershoot it.
-	 * That's why we use the ceil function here. */
-	const u64 pay_amount =
-	    amount_msat_ratio_ceil(params->amount, params->accuracy);
-
-	if (!simple_feasibleflow(working_ctx, linear_network->graph, src, dst,
-				 residual_network->cap, pay_amount)) {
-		rq_log(tmpctx, rq, LOG_INFORM,
-		       "%s failed: unable to find a feasible flow.", __func__);
-		goto fail;
+	if (cache && cache->residual_network) {
+		/* The last solution is a feasible flow: refine it for the
+		 * new costs.  We put it back if it works. */
+		residual_network = tal_steal(working_ctx,
+					     cache->residual_network);
+		cache->residual_network = NULL;
+	} else {
+		const struct node dst = {.idx = gossmap_node_idx(rq->gossmap, target)};
+		const struct node src = {.idx = gossmap_node_idx(rq->gossmap, source)};
+
+		residual_network = alloc_residual_network(working_ctx,
+							  max_num_nodes,
+							  max_num_arcs);
+		init_residual_network(linear_network,residual_network);
+
+		/* Since we have constraint accuracy, ask to find a payment solution
+		 * that can pay a bit more than the actual value rathen than undershoot it.
+		 * That's why we use the ceil function here. */
+		const u64 pay_amount =
+			amount_msat_ratio_ceil(params->amount, params->accuracy);
+
+		if (!simple_feasibleflow(working_ctx, linear_network->graph, src, dst,
+					 residual_network->cap, pay_amount)) {
+			rq_log(tmpctx, rq, LOG_INFORM,
+			       "%s failed: unable to find a feasible flow.", __func__);
+			goto fail;
+		}
 	}
 	combine_cost_function(working_ctx, linear_network, residual_network,
 			      rq->biases, mu);
@@ -1048,6 +1327,11 @@ struct flow **minflow(const tal_t *ctx,
 		       __func__);
 		goto fail;
 	}
+	if (cache) {
+		cache->source = source;
+		cache->target = target;
+		cache->residual_network = tal_steal(cache, residual_network);
+	}
 	tal_free(working_ctx);
 
 	/* This is dumb, but if you don't support MPP you don't deserve any
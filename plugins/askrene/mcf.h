@@ -7,6 +7,7 @@
 #include <common/gossmap.h>
 
 struct route_query;
+struct minflow_cache;
 
 /**
  * optimal_payment_flow - API for min cost flow function(s).
@@ -18,6 +19,7 @@ struct route_query;
  * @mu: 0 = corresponds to only probabilities, 100 corresponds to only fee.
  * @delay_feefactor: convert 1 block delay into msat.
  * @single_part: don't do MCF at all, just create a single flow.
+ * @cache: NULL, or cache from minflow_cache_new() to reuse between calls.
  *
  * @delay_feefactor converts 1 block delay into msat, as if it were an additional
  * fee.  So if a CLTV delay on a node is 5 blocks, that's treated as if it
@@ -32,7 +34,29 @@ struct flow **minflow(const tal_t *ctx,
 		      struct amount_msat amount,
 		      u32 mu,
 		      double delay_feefactor,
-		      bool single_part);
+		      bool single_part,
+		      struct minflow_cache *cache);
+
+/* This saves rebuilding the network for every minflow() call.  If you
+ * call minflow() repeatedly for the same @rq, @source, @target and
+ * @amount (e.g. varying @mu), it also starts from the previous solution. */
+struct minflow_cache *minflow_cache_new(const tal_t *ctx);
+
+/* Call this before minflow() calls for a new @rq (with its localmods
+ * applied), or if @rq changes (e.g. its capacities).  It re-linearizes
+ * the channels which layers and reservations touch (now, or last time),
+ * and only rebuilds everything if @amount or the gossmap topology
+ * changed. */
+void minflow_cache_prepare(struct minflow_cache *cache,
+			   const struct route_query *rq,
+			   struct amount_msat amount);
+
+/* Tell the cache what gossmap_refresh_changes() did. */
+void minflow_cache_gossmap_changed(struct minflow_cache *cache,
+				   const struct gossmap_changes *changes);
+
+/* Throw it all away: the next minflow() starts from scratch. */
+void minflow_cache_reset(struct minflow_cache *cache);
 
 /* To sanity check: this is the approximation mcf uses for the cost
  * of each channel. */
@@ -1,16 +1,39 @@
 #define NDEBUG 1
 #include "config.h"
+#include <ccan/ilog/ilog.h>
 #include <plugins/askrene/priorityqueue.h>
 
+/* Number of buckets of the radix heap: one for values equal to the last
+ * popped value, and one for each bit position where non-negative s64 can
+ * differ. */
+#define RADIX_BUCKETS 64
+#define RADIX_NONE UINT32_MAX
+
 /* priorityqueue: a data structure for pairs (key, value) with
  * 0<=key<max_num_elements, with easy access to elements by key and the pair
  * with the smallest value. */
 struct priorityqueue {
 	s64 *value;
+	size_t heapsize;
+
+	/* Monotone queues use a radix heap, the rest use gheap. */
+	bool monotone;
+
+	/* gheap */
 	u32 *base;
 	u32 **heapptr;
-	size_t heapsize;
 	struct gheap_ctx gheap_ctx;
+
+	/* Radix heap: element key lives in bucket[key], which is a doubly
+	 * linked list through next[] and prev[]. Bucket 0 holds the elements
+	 * whose value is equal to last (the last value popped), bucket b>0
+	 * those whose value first differs from last at bit b-1. top is the
+	 * key with the smallest value. */
+	s64 last;
+	u32 top;
+	u32 bucket_head[RADIX_BUCKETS];
+	u8 *bucket;
+	u32 *next, *prev;
 };
 
 static const s64 INFINITE = INT64_MAX;
@@ -58,12 +81,50 @@ struct priorityqueue *priorityqueue_new(const tal_t *ctx,
 	q->gheap_ctx.less_comparer = priorityqueue_less_comparer;
 	q->gheap_ctx.less_comparer_ctx = NULL;
 	q->gheap_ctx.item_mover = priorityqueue_item_mover;
+	q->monotone = false;
+	return q;
+}
+
+struct priorityqueue *priorityqueue_new_monotone(const tal_t *ctx,
+						 size_t max_num_nodes) {
+	struct priorityqueue *q = tal(ctx, struct priorityqueue);
+	/* check allocation */
+	if (!q) return NULL;
+
+	q->value = tal_arr(q, s64, max_num_nodes);
+	q->bucket = tal_arr(q, u8, max_num_nodes);
+	q->next = tal_arr(q, u32, max_num_nodes);
+	q->prev = tal_arr(q, u32, max_num_nodes);
+
+	/* check allocation */
+	if (!q->value || !q->bucket || !q->next || !q->prev)
+		return tal_free(q);
+
+	q->base = NULL;
+	q->heapptr = NULL;
+	q->monotone = true;
+	q->heapsize = 0;
+	q->last = 0;
+	q->top = RADIX_NONE;
+	for (size_t b = 0; b < RADIX_BUCKETS; b++)
+		q->bucket_head[b] = RADIX_NONE;
 	return q;
 }
 
 void priorityqueue_init(struct priorityqueue *q) {
 	const size_t max_num_nodes = tal_count(q->value);
 	q->heapsize = 0;
+	if (q->monotone) {
+		q->last = 0;
+		q->top = RADIX_NONE;
+		for (size_t b = 0; b < RADIX_BUCKETS; b++)
+			q->bucket_head[b] = RADIX_NONE;
+		for (size_t i = 0; i < max_num_nodes; ++i) {
+			q->value[i] = INFINITE;
+			q->bucket[i] = RADIX_BUCKETS;
+		}
+		return;
+	}
 	for (size_t i = 0; i < max_num_nodes; ++i) {
 		q->value[i] = INFINITE;
 		q->heapptr[i] = NULL;
@@ -87,9 +148,101 @@ static void priorityqueue_append(struct priorityqueue *q, u32 key, s64 value) {
 	q->heapsize++;
 }
 
+/* Which radix bucket does value belong to? */
+static size_t radix_bucket(const struct priorityqueue *q, s64 value) {
+	if (value == q->last)
+		return 0;
+	return ilog64_nz(value ^ q->last);
+}
+
+static void radix_link(struct priorityqueue *q, u32 key) {
+	const size_t b = radix_bucket(q, q->value[key]);
+
+	q->bucket[key] = b;
+	q->prev[key] = RADIX_NONE;
+	q->next[key] = q->bucket_head[b];
+	if (q->bucket_head[b] != RADIX_NONE)
+		q->prev[q->bucket_head[b]] = key;
+	q->bucket_head[b] = key;
+}
+
+static void radix_unlink(struct priorityqueue *q, u32 key) {
+	if (q->prev[key] != RADIX_NONE)
+		q->next[q->prev[key]] = q->next[key];
+	else
+		q->bucket_head[q->bucket[key]] = q->next[key];
+	if (q->next[key] != RADIX_NONE)
+		q->prev[q->next[key]] = q->prev[key];
+	q->bucket[key] = RADIX_BUCKETS;
+}
+
+/* Key with the smallest value: all of bucket 0 if there is any, otherwise
+ * we have to look through the first non-empty bucket. */
+static u32 radix_find_top(const struct priorityqueue *q) {
+	size_t b;
+	u32 top;
+
+	if (q->heapsize == 0)
+		return RADIX_NONE;
+	if (q->bucket_head[0] != RADIX_NONE)
+		return q->bucket_head[0];
+
+	for (b = 1; q->bucket_head[b] == RADIX_NONE; b++)
+		assert(b + 1 < RADIX_BUCKETS);
+
+	top = q->bucket_head[b];
+	for (u32 key = q->next[top]; key != RADIX_NONE; key = q->next[key])
+		if (q->value[key] < q->value[top])
+			top = key;
+	return top;
+}
+
+static void radix_update(struct priorityqueue *q, u32 key, s64 value) {
+	/* Values cannot go below what we already popped. */
+	assert(value >= q->last);
+
+	if (q->bucket[key] != RADIX_BUCKETS)
+		radix_unlink(q, key);
+	else
+		q->heapsize++;
+	q->value[key] = value;
+	radix_link(q, key);
+
+	if (q->heapsize == 1 || value < q->value[q->top])
+		q->top = key;
+	else if (key == q->top)
+		q->top = radix_find_top(q);
+}
+
+/* Move last up to the value we pop: that empties the top's bucket, whose
+ * elements all land in lower buckets. */
+static void radix_pop(struct priorityqueue *q) {
+	const u32 top = q->top;
+	const size_t b = q->bucket[top];
+	u32 key, next;
+
+	q->last = q->value[top];
+	if (b != 0) {
+		key = q->bucket_head[b];
+		q->bucket_head[b] = RADIX_NONE;
+		for (; key != RADIX_NONE; key = next) {
+			next = q->next[key];
+			radix_link(q, key);
+		}
+	}
+	radix_unlink(q, top);
+	q->heapsize--;
+	q->top = radix_find_top(q);
+}
+
 void priorityqueue_update(struct priorityqueue *q, u32 key, s64 value) {
 	assert(key < priorityqueue_maxsize(q));
 
+	if (q->monotone) {
+		radix_update(q, key, value);
+		return;
+	}
+
 	if (!q->heapptr[key]) {
 		/* not in the heap */
 		priorityqueue_append(q, key, value);
@@ -127,6 +280,8 @@ void priorityqueue_update(struct priorityqueue *q, u32 key, s64 value) {
 
 u32 priorityqueue_top(const struct priorityqueue *q) {
 	assert(!priorityqueue_empty(q));
+	if (q->monotone)
+		return q->top;
 	return q->base[0];
 }
 
@@ -138,6 +293,10 @@ void priorityqueue_pop(struct priorityqueue *q) {
 	if (q->heapsize == 0) return;
 
 	const u32 top = priorityqueue_top(q);
+	if (q->monotone) {
+		radix_pop(q);
+		return;
+	}
 	assert(q->heapptr[top] == q->base);
 
 	global_priorityqueue = q;
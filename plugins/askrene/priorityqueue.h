@@ -1,7 +1,8 @@
 #ifndef LIGHTNING_PLUGINS_ASKRENE_PRIORITYQUEUE_H
 #define LIGHTNING_PLUGINS_ASKRENE_PRIORITYQUEUE_H
 
-/* Defines a priority queue using gheap. */
+/* Defines a priority queue using gheap, or a radix heap for monotone
+ * queues. */
 
 #include "config.h"
 #include <ccan/short_types/short_types.h>
@@ -12,6 +13,12 @@
 struct priorityqueue *priorityqueue_new(const tal_t *ctx,
 					size_t max_num_elements);
 
+/* Allocation of a monotone queue, eg. for Dijkstra: values must be
+ * non-negative and never smaller than the last value popped. This is
+ * implemented as a radix heap, which is much cheaper than gheap. */
+struct priorityqueue *priorityqueue_new_monotone(const tal_t *ctx,
+						 size_t max_num_elements);
+
 /* Initialization of the heap for a new priorityqueue search. */
 void priorityqueue_init(struct priorityqueue *priorityqueue);
 
@@ -0,0 +1,245 @@
+/* Test that minflow_cache gives the same answers as starting from scratch */
+#include "config.h"
+
+#include "../mcf.c"
+
+#include <ccan/read_write_all/read_write_all.h>
+#include <common/fp16.h>
+#include <common/setup.h>
+#include <common/utils.h>
+#include <stdio.h>
+
+/* AUTOGENERATED MOCKS START */
+/* Generated stub for rq_log */
+const char *rq_log(const tal_t *ctx UNNEEDED,
+		   const struct route_query *rq UNNEEDED,
+		   enum log_level level UNNEEDED,
+		   const char *fmt UNNEEDED,
+		   ...)
+{ fprintf(stderr, "rq_log called!\n"); abort(); }
+/* Generated stub for sciddir_or_pubkey_from_node_id */
+bool sciddir_or_pubkey_from_node_id(struct sciddir_or_pubkey *sciddpk UNNEEDED,
+				    const struct node_id *node_id UNNEEDED)
+{ fprintf(stderr, "sciddir_or_pubkey_from_node_id called!\n"); abort(); }
+/* AUTOGENERATED MOCKS END */
+
+/* Simplified: no layers or reservations, just the capacities cache */
+void get_constraints(const struct route_query *rq,
+		     const struct gossmap_chan *chan,
+		     int dir,
+		     struct amount_msat *min,
+		     struct amount_msat *max)
+{
+	size_t idx = gossmap_chan_idx(rq->gossmap, chan);
+
+	*min = AMOUNT_MSAT(0);
+	if (idx < tal_count(rq->capacities) && rq->capacities[idx] != 0)
+		*max = amount_msat(fp16_to_u64(rq->capacities[idx]) * 1000);
+	else
+		*max = gossmap_chan_get_capacity(rq->gossmap, chan);
+}
+
+static u8 empty_map[] = {
+	0
+};
+
+static void remove_file(char *fname) { assert(!remove(fname)); }
+
+static bool flows_eq(struct flow **a, struct flow **b)
+{
+	if (tal_count(a) != tal_count(b))
+		return false;
+	for (size_t i = 0; i < tal_count(a); i++) {
+		if (!amount_msat_eq(a[i]->delivers, b[i]->delivers))
+			return false;
+		if (tal_count(a[i]->path) != tal_count(b[i]->path))
+			return false;
+		for (size_t j = 0; j < tal_count(a[i]->path); j++) {
+			if (a[i]->path[j] != b[i]->path[j]
+			    || a[i]->dirs[j] != b[i]->dirs[j])
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool linear_network_eq(const struct linear_network *a,
+			      const struct linear_network *b)
+{
+	const size_t max_num_arcs = graph_max_num_arcs(a->graph);
+
+	if (max_num_arcs != graph_max_num_arcs(b->graph)
+	    || graph_max_num_nodes(a->graph) != graph_max_num_nodes(b->graph))
+		return false;
+
+	for (struct arc arc = {.idx = 0}; arc.idx < max_num_arcs; ++arc.idx) {
+		if (arc_enabled(a->graph, arc) != arc_enabled(b->graph, arc))
+			return false;
+		if (!arc_enabled(a->graph, arc))
+			continue;
+		if (arc_tail(a->graph, arc).idx != arc_tail(b->graph, arc).idx
+		    || a->capacity[arc.idx] != b->capacity[arc.idx]
+		    || a->arc_prob_cost[arc.idx] != b->arc_prob_cost[arc.idx]
+		    || a->arc_fee_cost[arc.idx] != b->arc_fee_cost[arc.idx])
+			return false;
+	}
+	return true;
+}
+
+/* What init_linear_network() would give now, without the cache */
+static bool cache_matches_cold(const struct minflow_cache *cache,
+			       const struct route_query *rq,
+			       struct amount_msat amount)
+{
+	struct pay_parameters params;
+
+	init_pay_parameters(&params, rq, NULL, NULL, amount,
+			    cache->delay_feefactor);
+	return linear_network_eq(cache->linear_network,
+				 init_linear_network(tmpctx, &params));
+}
+
+int main(int argc, char *argv[])
+{
+	int fd;
+	char *gossfile;
+	struct gossmap *gossmap;
+	struct node_id l1, l2, l3, l4;
+	struct short_channel_id scid12, scid13, scid24, scid34;
+	struct gossmap_localmods *mods;
+	const struct gossmap_node *src, *dst;
+	struct route_query *rq;
+	struct minflow_cache *cache;
+	struct linear_network *warm_network;
+	struct gossmap_changes *changes;
+	struct flow **flows, **warm, **cold;
+	const struct amount_msat amount = AMOUNT_MSAT(8000000);
+	u32 idx13;
+
+	common_setup(argv[0]);
+
+	fd = tmpdir_mkstemp(tmpctx, "run-minflow-cache.XXXXXX", &gossfile);
+	tal_add_destructor(gossfile, remove_file);
+	assert(write_all(fd, empty_map, sizeof(empty_map)));
+
+	gossmap = gossmap_load(tmpctx, gossfile, NULL, NULL);
+	assert(gossmap);
+
+	/* These are in ascending order, for easy direction setting */
+	assert(node_id_from_hexstr("022d223620a359a47ff7f7ac447c85c46c923da53389221a0054c11c1e3ca31d59", 66, &l1));
+	assert(node_id_from_hexstr("0266e4598d1d3c415f572a8488830b60f7e744ed9235eb0b1ba93283b315c03518", 66, &l2));
+	assert(node_id_from_hexstr("035d2b1192dfba134e10e540875d366ebc8bc353d5aa766b80c090b39c3a5d885d", 66, &l3));
+	assert(node_id_from_hexstr("0382ce59ebf18be7d84677c2e35f23294b9992ceca95491fcf8a56c6cb2d9de199", 66, &l4));
+	assert(short_channel_id_from_str("1x2x0", 5, &scid12));
+	assert(short_channel_id_from_str("1x3x0", 5, &scid13));
+	assert(short_channel_id_from_str("2x4x0", 5, &scid24));
+	assert(short_channel_id_from_str("3x4x0", 5, &scid34));
+
+	mods = gossmap_localmods_new(tmpctx);
+
+	/* 1->2->4 has capacity 10k sat, 1->3->4 has capacity 5k sat (lower fee, longer delay!) */
+	assert(gossmap_local_addchan(mods, &l1, &l2, scid12, AMOUNT_MSAT(10000000), NULL));
+	assert(gossmap_local_setchan(mods, scid12,
+				     AMOUNT_MSAT(0), AMOUNT_MSAT(10000000),
+				     AMOUNT_MSAT(0), 1001, 5, true, 0));
+	assert(gossmap_local_addchan(mods, &l2, &l4, scid24, AMOUNT_MSAT(10000000), NULL));
+	assert(gossmap_local_setchan(mods, scid24,
+				     AMOUNT_MSAT(0), AMOUNT_MSAT(10000000),
+				     AMOUNT_MSAT(0), 1002, 5, true, 0));
+	assert(gossmap_local_addchan(mods, &l1, &l3, scid13, AMOUNT_MSAT(5000000), NULL));
+	assert(gossmap_local_setchan(mods, scid13,
+				     AMOUNT_MSAT(0), AMOUNT_MSAT(5000000),
+				     AMOUNT_MSAT(0), 503, 50, true, 0));
+	assert(gossmap_local_addchan(mods, &l3, &l4, scid34, AMOUNT_MSAT(5000000), NULL));
+	assert(gossmap_local_setchan(mods, scid34,
+				     AMOUNT_MSAT(0), AMOUNT_MSAT(5000000),
+				     AMOUNT_MSAT(0), 504, 50, true, 0));
+
+	gossmap_apply_localmods(gossmap, mods);
+	src = gossmap_find_node(gossmap, &l1);
+	dst = gossmap_find_node(gossmap, &l4);
+	idx13 = gossmap_chan_idx(gossmap, gossmap_find_chan(gossmap, &scid13));
+
+	rq = tal(tmpctx, struct route_query);
+	rq->cmd = NULL;
+	rq->plugin = NULL;
+	rq->gossmap = gossmap;
+	rq->reserved = NULL;
+	rq->layers = tal_arr(rq, const struct layer *, 0);
+	rq->capacities = tal_arrz(rq, fp16_t, gossmap_max_chan_idx(gossmap));
+	rq->biases = tal_arrz(rq, s8, gossmap_max_chan_idx(gossmap) * 2);
+	rq->additional_costs = NULL;
+
+	cache = minflow_cache_new(tmpctx);
+	minflow_cache_prepare(cache, rq, amount);
+	assert(cache->linear_network);
+	assert(cache_matches_cold(cache, rq, amount));
+
+	/* Solve once: cache keeps the solution to start from next time. */
+	flows = minflow(tmpctx, rq, src, dst, amount, 1, 1.0/1000000,
+			false, cache);
+	assert(flows);
+	assert(cache->residual_network);
+	warm_network = cache->linear_network;
+
+	/* Now warm start with new mu and delay_feefactor: the residual
+	 * network goes straight to mcf_refinement(). */
+	warm = minflow(tmpctx, rq, src, dst, amount, 50, 2.0/1000000,
+		       false, cache);
+	assert(warm);
+	assert(cache->linear_network == warm_network);
+	cold = minflow(tmpctx, rq, src, dst, amount, 50, 2.0/1000000,
+		       false, NULL);
+	assert(flows_eq(warm, cold));
+
+	/* Same again, but a different mu only. */
+	warm = minflow(tmpctx, rq, src, dst, amount, 90, 2.0/1000000,
+		       false, cache);
+	cold = minflow(tmpctx, rq, src, dst, amount, 90, 2.0/1000000,
+		       false, NULL);
+	assert(flows_eq(warm, cold));
+
+	/* Capacity shrinks (e.g. a reservation): prepare must update the
+	 * network and throw away the old solution, which no longer fits. */
+	rq->capacities[idx13] = u64_to_fp16(1000, false);
+	minflow_cache_prepare(cache, rq, amount);
+	assert(!cache->residual_network);
+	assert(cache_matches_cold(cache, rq, amount));
+	warm = minflow(tmpctx, rq, src, dst, amount, 50, 2.0/1000000,
+		       false, cache);
+	cold = minflow(tmpctx, rq, src, dst, amount, 50, 2.0/1000000,
+		       false, NULL);
+	assert(flows_eq(warm, cold));
+
+	/* refine zeroes capacities, so get_constraints looks elsewhere. */
+	rq->capacities[idx13] = 0;
+	minflow_cache_prepare(cache, rq, amount);
+	assert(cache_matches_cold(cache, rq, amount));
+	warm = minflow(tmpctx, rq, src, dst, amount, 50, 2.0/1000000,
+		       false, cache);
+	cold = minflow(tmpctx, rq, src, dst, amount, 50, 2.0/1000000,
+		       false, NULL);
+	assert(flows_eq(warm, cold));
+
+	/* A different amount needs a new network. */
+	minflow_cache_prepare(cache, rq, AMOUNT_MSAT(4000000));
+	assert(cache_matches_cold(cache, rq, AMOUNT_MSAT(4000000)));
+	warm = minflow(tmpctx, rq, src, dst, AMOUNT_MSAT(4000000), 50,
+		       2.0/1000000, false, cache);
+	cold = minflow(tmpctx, rq, src, dst, AMOUNT_MSAT(4000000), 50,
+		       2.0/1000000, false, NULL);
+	assert(flows_eq(warm, cold));
+
+	/* So does a gossmap which gained or lost channels. */
+	changes = talz(tmpctx, struct gossmap_changes);
+	changes->chans_added = tal_arr(changes, u32, 1);
+	changes->chans_added[0] = idx13;
+	minflow_cache_gossmap_changed(cache, changes);
+	assert(!cache->linear_network);
+	assert(!cache->residual_network);
+	minflow_cache_prepare(cache, rq, amount);
+	assert(cache_matches_cold(cache, rq, amount));
+
+	gossmap_remove_localmods(gossmap, mods);
+	common_shutdown();
+}
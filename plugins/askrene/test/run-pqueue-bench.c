@@ -0,0 +1,167 @@
+/* Check the gheap and radix heap priorityqueues agree running Dijkstra.
+ * Run with --bench to time them too. */
+#include "config.h"
+#include <assert.h>
+#include <ccan/str/str.h>
+#include <ccan/tal/tal.h>
+#include <ccan/time/time.h>
+#include <common/setup.h>
+#include <inttypes.h>
+#include <plugins/askrene/graph.h>
+#include <stdio.h>
+
+#define ASKRENE_UNITTEST
+#include "../priorityqueue.c"
+
+#define CHECK(arg) if(!(arg)){fprintf(stderr, "failed CHECK at line %d: %s\n", __LINE__, #arg); abort();}
+
+/* Roughly the size of the public network. */
+#define BENCH_NODES 16000
+#define BENCH_CHANNELS 48000
+#define BENCH_RUNS 20
+
+static int next_bit(s64 x)
+{
+	int b;
+	for (b = 0; (1LL << b) <= x; b++)
+		;
+	return b;
+}
+
+/* Deterministic, so both runs see the same graph. */
+static u64 bench_rand(u64 *state)
+{
+	*state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return *state >> 33;
+}
+
+/* Plain Dijkstra from source, using queue q. */
+static void dijkstra(const struct graph *graph, struct node source,
+		     const s64 *capacity, const s64 *cost,
+		     struct priorityqueue *q, s64 *distance)
+{
+	const size_t max_num_nodes = graph_max_num_nodes(graph);
+	const s64 *const dijkstra_distance = priorityqueue_value(q);
+
+	priorityqueue_init(q);
+	priorityqueue_update(q, source.idx, 0);
+
+	while (!priorityqueue_empty(q)) {
+		const struct node cur = {.idx = priorityqueue_top(q)};
+		priorityqueue_pop(q);
+
+		for (struct arc arc = node_adjacency_begin(graph, cur);
+		     !node_adjacency_end(arc);
+		     arc = node_adjacency_next(graph, arc)) {
+			if (capacity[arc.idx] <= 0)
+				continue;
+
+			const struct node next = arc_head(graph, arc);
+			if (dijkstra_distance[next.idx] <=
+			    dijkstra_distance[cur.idx] + cost[arc.idx])
+				continue;
+
+			priorityqueue_update(q, next.idx,
+					     dijkstra_distance[cur.idx]
+					     + cost[arc.idx]);
+		}
+	}
+	for (size_t i = 0; i < max_num_nodes; i++)
+		distance[i] = dijkstra_distance[i];
+}
+
+/* A preferential attachment graph, a la Barabasi-Albert, which has the
+ * hub-and-spoke shape of the Lightning Network. Costs look like fees. */
+static struct graph *make_graph(const tal_t *ctx, s64 **capacity, s64 **cost)
+{
+	const int DUAL_BIT = next_bit(2 * BENCH_CHANNELS - 1);
+	const size_t MAX_ARCS = 1ULL << (DUAL_BIT + 1);
+	struct graph *graph = graph_new(ctx, BENCH_NODES, MAX_ARCS, DUAL_BIT);
+	u32 *endpoints = tal_arr(ctx, u32, 2 * BENCH_CHANNELS);
+	size_t num_endpoints = 0;
+	u64 state = 42;
+	u32 arcidx = 0;
+
+	CHECK(graph);
+	*capacity = tal_arrz(ctx, s64, MAX_ARCS);
+	*cost = tal_arrz(ctx, s64, MAX_ARCS);
+
+	for (size_t i = 0; i < BENCH_CHANNELS; i++) {
+		u32 from, to;
+
+		/* Every node gets at least one channel. */
+		if (i + 1 < BENCH_NODES) {
+			from = i + 1;
+			to = num_endpoints ? endpoints[bench_rand(&state)
+						      % num_endpoints] : 0;
+		} else {
+			from = bench_rand(&state) % BENCH_NODES;
+			to = endpoints[bench_rand(&state) % num_endpoints];
+		}
+		if (from == to)
+			continue;
+		endpoints[num_endpoints++] = from;
+		endpoints[num_endpoints++] = to;
+
+		/* One arc in each direction. */
+		for (int dir = 0; dir < 2; dir++) {
+			struct arc arc = {.idx = arcidx++};
+			graph_add_arc(graph, arc,
+				      node_obj(dir ? to : from),
+				      node_obj(dir ? from : to));
+			(*capacity)[arc.idx] = 1;
+			(*cost)[arc.idx] = 1000 + bench_rand(&state) % 5000;
+		}
+	}
+	return graph;
+}
+
+static double bench(const struct graph *graph,
+		    const s64 *capacity, const s64 *cost,
+		    struct priorityqueue *q, s64 *distance)
+{
+	struct timemono start = time_mono();
+
+	for (size_t i = 0; i < BENCH_RUNS; i++)
+		dijkstra(graph, node_obj(i), capacity, cost, q, distance);
+
+	return time_to_usec(timemono_since(start)) / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+	common_setup(argv[0]);
+	const tal_t *ctx = tal(NULL, tal_t);
+	s64 *capacity, *cost;
+	struct graph *graph = make_graph(ctx, &capacity, &cost);
+	const size_t max_num_nodes = graph_max_num_nodes(graph);
+	s64 *dist_gheap = tal_arr(ctx, s64, max_num_nodes);
+	s64 *dist_radix = tal_arr(ctx, s64, max_num_nodes);
+	struct priorityqueue *gheap = priorityqueue_new(ctx, max_num_nodes);
+	struct priorityqueue *radix = priorityqueue_new_monotone(ctx,
+								 max_num_nodes);
+
+	/* Both must agree on every distance. */
+	for (size_t i = 0; i < BENCH_RUNS; i++) {
+		dijkstra(graph, node_obj(i), capacity, cost, gheap, dist_gheap);
+		dijkstra(graph, node_obj(i), capacity, cost, radix, dist_radix);
+		for (size_t n = 0; n < max_num_nodes; n++)
+			CHECK(dist_gheap[n] == dist_radix[n]);
+	}
+
+	/* Timing is too slow (and noisy) for make check. */
+	if (!argv[1] || !streq(argv[1], "--bench"))
+		goto out;
+
+	printf("%d nodes, %d channels, %d runs\n",
+	       BENCH_NODES, BENCH_CHANNELS, BENCH_RUNS);
+	printf("gheap: %.3f msec\n",
+	       bench(graph, capacity, cost, gheap, dist_gheap));
+	printf("radix: %.3f msec\n",
+	       bench(graph, capacity, cost, radix, dist_radix));
+
+out:
+	ctx = tal_free(ctx);
+	common_shutdown();
+	return 0;
+}
@@ -98,6 +98,42 @@ int main(int argc, char *argv[])
 	CHECK(priorityqueue_size(q)==2);
 	CHECK(priorityqueue_top(q)==1);
 
+	printf("Allocating a monotone priorityqueue\n");
+	q = priorityqueue_new_monotone(ctx, 5);
+	CHECK(q);
+
+	priorityqueue_init(q);
+	CHECK(priorityqueue_empty(q));
+
+	priorityqueue_update(q, 0, 10);
+	priorityqueue_update(q, 1, 1000);
+	priorityqueue_update(q, 2, 7);
+	priorityqueue_show(q);
+	CHECK(priorityqueue_size(q)==3);
+	CHECK(priorityqueue_top(q)==2);
+
+	priorityqueue_pop(q);
+	CHECK(priorityqueue_size(q)==2);
+	CHECK(priorityqueue_top(q)==0);
+
+	/* Decrease down to the last value popped, increase the top. */
+	priorityqueue_update(q, 1, 7);
+	CHECK(priorityqueue_top(q)==1);
+	priorityqueue_update(q, 1, 11);
+	CHECK(priorityqueue_top(q)==0);
+	priorityqueue_update(q, 3, 8);
+	priorityqueue_show(q);
+	CHECK(priorityqueue_size(q)==3);
+	CHECK(priorityqueue_top(q)==3);
+
+	priorityqueue_pop(q);
+	CHECK(priorityqueue_top(q)==0);
+	priorityqueue_pop(q);
+	CHECK(priorityqueue_top(q)==1);
+	priorityqueue_pop(q);
+	CHECK(priorityqueue_empty(q));
+	CHECK(priorityqueue_value(q)[1]==11);
+
 	printf("Freeing memory\n");
 	ctx = tal_free(ctx);
 	common_shutdown();
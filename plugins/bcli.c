@@ -3,15 +3,21 @@
 #include <ccan/array_size/array_size.h>
 #include <ccan/cast/cast.h>
 #include <ccan/io/io.h>
+#include <ccan/noerr/noerr.h>
 #include <ccan/pipecmd/pipecmd.h>
 #include <ccan/read_write_all/read_write_all.h>
 #include <ccan/tal/grab_file/grab_file.h>
+#include <ccan/tal/path/path.h>
 #include <ccan/tal/str/str.h>
+#include <common/base64.h>
 #include <common/json_param.h>
 #include <common/json_stream.h>
 #include <common/memleak.h>
 #include <errno.h>
+#include <netdb.h>
+#include <plugins/bcli_rpc.h>
 #include <plugins/libplugin.h>
+#include <sys/socket.h>
 
 /* Bitcoind's web server has a default of 4 threads, with queue depth 16.
  * It will *fail* rather than queue beyond that, so we must not stress it!
@@ -21,6 +27,13 @@
 #define BITCOIND_MAX_PARALLEL 4
 #define RPC_TRANSACTION_ALREADY_IN_CHAIN -27
 
+/* With bitcoin-rpc-direct, we keep up to BITCOIND_MAX_PARALLEL connections
+ * open, and put up to this many calls in each request. */
+#define RPC_MAX_BATCH 16
+/* bitcoind's -rpcservertimeout defaults to 30 seconds: after that, an idle
+ * connection may be closed under us, so don't reuse one that old. */
+#define RPC_IDLE_SECS 20
+
 enum bitcoind_prio {
 	BITCOIND_LOW_PRIO,
 	BITCOIND_HIGH_PRIO
@@ -66,6 +79,29 @@ struct bitcoind {
 
 	/* Override in case we're developer mode for testing*/
 	bool dev_no_fake_fees;
+
+	/* Talk JSON-RPC to bitcoind ourselves, instead of using bitcoin-cli? */
+	bool rpc_direct;
+
+	/* For rpc_direct: where bitcoind is, and base64 user:password */
+	struct addrinfo *rpc_addr;
+	char *rpc_host, *rpc_auth;
+
+	/* For rpc_direct: our keep-alive connections (NULL if none). */
+	struct rpc_conn *rpc_conns[BITCOIND_MAX_PARALLEL];
+	u64 next_rpc_id;
+};
+
+/* A keep-alive HTTP connection to bitcoind (for rpc_direct) */
+struct rpc_conn {
+	struct io_conn *conn;
+	/* What we've sent and are awaiting replies to (NULL if idle) */
+	struct bitcoin_cli **batch;
+	char *request;
+	char *response;
+	size_t response_bytes, new_response;
+	/* When we last heard from bitcoind on this connection */
+	struct timemono last_used;
 };
 
 static struct bitcoind *bitcoind;
@@ -85,6 +121,8 @@ struct bitcoin_cli {
 	struct command *cmd;
 	/* Used to stash content between multiple calls */
 	void *stash;
+	/* For rpc_direct: the JSON-RPC id of this call */
+	u64 rpc_id;
 };
 
 /* Add the n'th arg to *args, incrementing n and keeping args of size n+1 */
@@ -242,10 +280,33 @@ static void bcli_failure(struct bitcoin_cli *bcli,
 	command_timer(bcli->cmd, time_from_sec(1), retry_bcli, bcli);
 }
 
+/* We have the output, and what bitcoin-cli exited with (or would have). */
+static void bcli_complete(struct bitcoin_cli *bcli, int exitstatus)
+{
+	struct command_result *res;
+
+	/* Implicit nonzero_exit_ok == false */
+	if (!bcli->exitstatus) {
+		if (exitstatus != 0) {
+			bcli_failure(bcli, exitstatus);
+			return;
+		}
+	} else
+		*bcli->exitstatus = exitstatus;
+
+	if (exitstatus == 0)
+		bitcoind->error_count = 0;
+
+	res = bcli->process(bcli);
+	if (!res)
+		bcli_failure(bcli, exitstatus);
+	else
+		tal_free(bcli);
+}
+
 static void bcli_finished(struct io_conn *conn UNUSED, struct bitcoin_cli *bcli)
 {
 	int ret, status;
-	struct command_result *res;
 	enum bitcoind_prio prio = bcli->prio;
 	u64 msec = time_to_msec(time_between(time_now(), bcli->start));
 
@@ -268,29 +329,284 @@ static void bcli_finished(struct io_conn *conn UNUSED, struct bitcoin_cli *bcli)
 		           bcli_args(tmpctx, bcli),
 		           WTERMSIG(status));
 
-	/* Implicit nonzero_exit_ok == false */
-	if (!bcli->exitstatus) {
-		if (WEXITSTATUS(status) != 0) {
-			bcli_failure(bcli, WEXITSTATUS(status));
-			bitcoind->num_requests[prio]--;
-			goto done;
+	bitcoind->num_requests[prio]--;
+	bcli_complete(bcli, WEXITSTATUS(status));
+	next_bcli(prio);
+}
+
+/* The bitcoind method and its params: skip the bitcoin-cli options. */
+static const char **rpc_method_args(const char **args)
+{
+	size_t i = 1;
+
+	while (args[i][0] == '-')
+		i++;
+	return args + i;
+}
+
+/* Like bitcoin-cli failing to talk to bitcoind: it exits 1. */
+static void rpc_fail_batch(struct rpc_conn *rc, const char *why)
+{
+	struct bitcoin_cli **batch = rc->batch;
+
+	rc->batch = NULL;
+	for (size_t i = 0; i < tal_count(batch); i++) {
+		batch[i]->output = tal_strdup(batch[i], why);
+		batch[i]->output_bytes = strlen(why);
+		bcli_failure(batch[i], 1);
+	}
+	tal_free(batch);
+}
+
+/* Same limit gather_argsv() hands bitcoin-cli (whose own default is 900). */
+static u64 rpc_timeout_secs(void)
+{
+	u64 secs = bitcoind->rpcclienttimeout ? bitcoind->rpcclienttimeout : 900;
+
+	if (bitcoind->retry_timeout > secs)
+		secs = bitcoind->retry_timeout;
+	return secs;
+}
+
+static void rpc_next(void);
+
+/* Like bitcoin-cli hitting -rpcclienttimeout: give up on this connection. */
+static struct command_result *rpc_timed_out(struct command *timer_cmd,
+					    struct rpc_conn *rc)
+{
+	/* So nothing new lands on it while we fail the batch. */
+	for (size_t i = 0; i < ARRAY_SIZE(bitcoind->rpc_conns); i++) {
+		if (bitcoind->rpc_conns[i] == rc)
+			bitcoind->rpc_conns[i] = NULL;
+	}
+
+	/* This frees the timer, too. */
+	rpc_fail_batch(rc, tal_fmt(tmpctx, "bitcoind did not reply within"
+				   " %"PRIu64" seconds", rpc_timeout_secs()));
+	/* rc is freed with conn. */
+	tal_free(rc->conn);
+	rpc_next();
+	return timer_complete(timer_cmd);
+}
+
+/* Move pending requests into a batch on this connection. */
+static bool rpc_fill_batch(struct rpc_conn *rc)
+{
+	char *calls = NULL;
+	struct bitcoin_cli *bcli;
+
+	assert(!rc->batch);
+	rc->batch = tal_arr(rc, struct bitcoin_cli *, 0);
+	for (int prio = BITCOIND_HIGH_PRIO; prio >= BITCOIND_LOW_PRIO; prio--) {
+		while (tal_count(rc->batch) < RPC_MAX_BATCH) {
+			const char **args;
+
+			bcli = list_pop(&bitcoind->pending[prio],
+					struct bitcoin_cli, list);
+			if (!bcli)
+				break;
+
+			args = rpc_method_args(bcli->args);
+			bcli->rpc_id = bitcoind->next_rpc_id++;
+			bcli->start = time_now();
+			bcli_rpc_add_call(&calls, bcli->rpc_id, args[0], args + 1);
+
+			list_add_tail(&bitcoind->current, &bcli->list);
+			tal_add_destructor(bcli, destroy_bcli);
+			tal_arr_expand(&rc->batch, bcli);
 		}
-	} else
-		*bcli->exitstatus = WEXITSTATUS(status);
+	}
 
-	if (WEXITSTATUS(status) == 0)
-		bitcoind->error_count = 0;
+	if (!calls) {
+		rc->batch = tal_free(rc->batch);
+		return false;
+	}
 
-	bitcoind->num_requests[bcli->prio]--;
+	tal_free(rc->request);
+	rc->request = bcli_rpc_http_request(rc, bitcoind->rpc_host,
+					    bitcoind->rpc_auth, calls);
+	tal_free(calls);
+
+	/* Owned by the batch, so it's cancelled once that's answered. */
+	tal_steal(rc->batch,
+		  global_timer(rc->batch[0]->cmd->plugin,
+			       time_from_sec(rpc_timeout_secs()),
+			       rpc_timed_out, rc));
+	return true;
+}
 
-	res = bcli->process(bcli);
-	if (!res)
-		bcli_failure(bcli, WEXITSTATUS(status));
-	else
-		tal_free(bcli);
+static struct io_plan *rpc_send(struct io_conn *conn, struct rpc_conn *rc);
 
-done:
-	next_bcli(prio);
+static struct io_plan *rpc_idle(struct io_conn *conn, struct rpc_conn *rc)
+{
+	if (rpc_fill_batch(rc))
+		return rpc_send(conn, rc);
+	return io_wait(conn, rc, rpc_send, rc);
+}
+
+static struct io_plan *rpc_response(struct io_conn *conn,
+				    struct rpc_conn *rc,
+				    const struct bcli_http_response *resp)
+{
+	const char *body = rc->response + resp->body_off;
+	const jsmntok_t *toks;
+
+	if (resp->status == 401)
+		plugin_err(rc->batch[0]->cmd->plugin,
+			   "bitcoind rejected our RPC credentials:"
+			   " check --bitcoin-rpcuser and --bitcoin-rpcpassword");
+
+	/* 503 means its work queue is full: we'll retry. */
+	if (resp->status != 200) {
+		rpc_fail_batch(rc, tal_fmt(tmpctx, "bitcoind HTTP status %i",
+					   resp->status));
+		return io_close(conn);
+	}
+
+	toks = json_parse_simple(tmpctx, body, resp->body_len);
+	if (!toks) {
+		rpc_fail_batch(rc, "bitcoind sent bad JSON");
+		return io_close(conn);
+	}
+
+	rc->last_used = time_mono();
+
+	/* rc->batch stays set while we do this, so if a callback starts
+	 * another request, it doesn't land on this connection. */
+	for (size_t i = 0; i < tal_count(rc->batch); i++) {
+		struct bitcoin_cli *bcli = rc->batch[i];
+		int exitstatus;
+
+		bcli->output = bcli_rpc_reply(bcli, body, toks, bcli->rpc_id,
+					      &exitstatus);
+		if (!bcli->output) {
+			bcli->output = tal_fmt(bcli, "no reply from bitcoind\n");
+			exitstatus = 1;
+		}
+		bcli->output_bytes = strlen(bcli->output);
+		bcli_complete(bcli, exitstatus);
+	}
+	rc->batch = tal_free(rc->batch);
+
+	if (resp->close) {
+		/* Let rpc_next() replace us immediately. */
+		for (size_t i = 0; i < ARRAY_SIZE(bitcoind->rpc_conns); i++) {
+			if (bitcoind->rpc_conns[i] == rc)
+				bitcoind->rpc_conns[i] = NULL;
+		}
+		rpc_next();
+		return io_close(conn);
+	}
+	return rpc_idle(conn, rc);
+}
+
+static struct io_plan *rpc_read_more(struct io_conn *conn, struct rpc_conn *rc)
+{
+	struct bcli_http_response resp;
+
+	rc->response_bytes += rc->new_response;
+	switch (bcli_http_parse(rc->response, rc->response_bytes, &resp)) {
+	case BCLI_HTTP_COMPLETE:
+		return rpc_response(conn, rc, &resp);
+	case BCLI_HTTP_MALFORMED:
+		rpc_fail_batch(rc, "bitcoind sent bad HTTP");
+		return io_close(conn);
+	case BCLI_HTTP_INCOMPLETE:
+		break;
+	}
+
+	if (rc->response_bytes == tal_count(rc->response))
+		tal_resize(&rc->response, rc->response_bytes * 2);
+	return io_read_partial(conn, rc->response + rc->response_bytes,
+			       tal_count(rc->response) - rc->response_bytes,
+			       &rc->new_response, rpc_read_more, rc);
+}
+
+static struct io_plan *rpc_read_init(struct io_conn *conn, struct rpc_conn *rc)
+{
+	rc->response_bytes = rc->new_response = 0;
+	tal_free(rc->response);
+	rc->response = tal_arr(rc, char, 1000);
+	return rpc_read_more(conn, rc);
+}
+
+static struct io_plan *rpc_send(struct io_conn *conn, struct rpc_conn *rc)
+{
+	return io_write(conn, rc->request, strlen(rc->request),
+			rpc_read_init, rc);
+}
+
+static struct io_plan *rpc_conn_init(struct io_conn *conn, struct rpc_conn *rc)
+{
+	return io_connect(conn, bitcoind->rpc_addr, rpc_send, rc);
+}
+
+static void rpc_conn_finished(struct io_conn *conn UNUSED, struct rpc_conn *rc)
+{
+	/* Connect failed, or bitcoind hung up on us. */
+	if (rc->batch)
+		rpc_fail_batch(rc, tal_fmt(tmpctx, "bitcoind connection: %s",
+					   errno ? strerror(errno)
+					   : "connection closed"));
+
+	/* rc itself is freed along with conn. */
+	for (size_t i = 0; i < ARRAY_SIZE(bitcoind->rpc_conns); i++) {
+		if (bitcoind->rpc_conns[i] == rc)
+			bitcoind->rpc_conns[i] = NULL;
+	}
+}
+
+/* Put pending requests on idle connections, opening them as needed. */
+static void rpc_next(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(bitcoind->rpc_conns); i++) {
+		struct rpc_conn *rc = bitcoind->rpc_conns[i];
+		int fd;
+
+		if (rc) {
+			if (rc->batch)
+				continue;
+
+			if (time_less(timemono_since(rc->last_used),
+				      time_from_sec(RPC_IDLE_SECS))) {
+				if (rpc_fill_batch(rc))
+					io_wake(rc);
+				continue;
+			}
+
+			/* Too old: bitcoind may hang up while we're sending. */
+			tal_free(rc->conn);
+		}
+
+		rc = tal(bitcoind, struct rpc_conn);
+		rc->batch = NULL;
+		rc->request = rc->response = NULL;
+		if (!rpc_fill_batch(rc)) {
+			tal_free(rc);
+			return;
+		}
+
+		fd = socket(bitcoind->rpc_addr->ai_family,
+			    bitcoind->rpc_addr->ai_socktype,
+			    bitcoind->rpc_addr->ai_protocol);
+		if (fd < 0)
+			plugin_err(rc->batch[0]->cmd->plugin,
+				   "Creating socket for bitcoind: %s",
+				   strerror(errno));
+
+		rc->last_used = time_mono();
+		rc->conn = io_new_conn(bitcoind, fd, rpc_conn_init, rc);
+		if (!rc->conn) {
+			/* Connect failed immediately */
+			rpc_fail_batch(rc, tal_fmt(tmpctx, "bitcoind connection: %s",
+						   strerror(errno)));
+			tal_free(rc);
+			continue;
+		}
+		tal_steal(rc->conn, rc);
+		io_set_finish(rc->conn, rpc_conn_finished, rc);
+		bitcoind->rpc_conns[i] = rc;
+	}
 }
 
 static void next_bcli(enum bitcoind_prio prio)
@@ -299,6 +615,11 @@ static void next_bcli(enum bitcoind_prio prio)
 	struct io_conn *conn;
 	int in;
 
+	if (bitcoind->rpc_direct) {
+		rpc_next();
+		return;
+	}
+
 	if (bitcoind->num_requests[prio] >= BITCOIND_MAX_PARALLEL)
 		return;
 
@@ -1042,14 +1363,186 @@ static void parse_getnetworkinfo_result(struct plugin *p, const char *buf)
 	tal_free(result);
 }
 
+/* Where bitcoind puts its .cookie, relative to its datadir. */
+static const char *rpc_cookie_subdir(void)
+{
+	if (!chainparams->cli_args)
+		return "";
+	/* Bitcoin's original testnet lives in "testnet3" */
+	if (streq(chainparams->network_name, "testnet"))
+		return "testnet3";
+	if (strstarts(chainparams->cli_args, "-chain="))
+		return chainparams->cli_args + strlen("-chain=");
+	return chainparams->cli_args + strlen("-");
+}
+
+/* Work out where and how to talk to bitcoind, like bitcoin-cli does. */
+static void rpc_setup(struct plugin *p)
+{
+	struct addrinfo hints, *res;
+	const char *port, *userpass;
+	int gai_err;
+
+	bitcoind->rpc_host = bitcoind->rpcconnect ? bitcoind->rpcconnect
+		: "127.0.0.1";
+	if (bitcoind->rpcport)
+		port = bitcoind->rpcport;
+	else
+		port = tal_fmt(tmpctx, "%u", chainparams->rpc_port);
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	gai_err = getaddrinfo(bitcoind->rpc_host, port, &hints, &res);
+	if (gai_err != 0)
+		plugin_err(p, "Could not resolve bitcoind at %s:%s: %s",
+			   bitcoind->rpc_host, port, gai_strerror(gai_err));
+	/* We only use the first one, and keep it forever. */
+	bitcoind->rpc_addr = res;
+
+	if (bitcoind->rpcuser && bitcoind->rpcpass) {
+		userpass = tal_fmt(tmpctx, "%s:%s",
+				   bitcoind->rpcuser, bitcoind->rpcpass);
+	} else {
+		const char *datadir, *cookiefile;
+		char *cookie;
+
+		if (bitcoind->datadir)
+			datadir = bitcoind->datadir;
+		else
+			datadir = path_join(tmpctx, getenv("HOME"), ".bitcoin");
+		cookiefile = path_join(tmpctx,
+				       path_join(tmpctx, datadir,
+						 rpc_cookie_subdir()),
+				       ".cookie");
+		cookie = grab_file(tmpctx, cookiefile);
+		if (!cookie)
+			plugin_err(p, "No --bitcoin-rpcuser/--bitcoin-rpcpassword"
+				   " and could not read %s: %s",
+				   cookiefile, strerror(errno));
+		/* It's __cookie__:<hex>, maybe with a newline */
+		strip_trailing_whitespace(cookie, strlen(cookie));
+		userpass = cookie;
+	}
+	bitcoind->rpc_auth = b64_encode(bitcoind, userpass, strlen(userpass));
+}
+
+/* For startup: one blocking call, like running bitcoin-cli.  Returns NULL
+ * if we couldn't talk to bitcoind at all. */
+static char *rpc_call_sync(const tal_t *ctx, const char *method,
+			   int *httpstatus, int *exitstatus)
+{
+	const char *noargs[] = { NULL };
+	char *calls = NULL, *request, *buf;
+	struct bcli_http_response resp;
+	enum bcli_http_parse parse;
+	const jsmntok_t *toks;
+	size_t len = 0;
+	int fd;
+
+	fd = socket(bitcoind->rpc_addr->ai_family,
+		    bitcoind->rpc_addr->ai_socktype,
+		    bitcoind->rpc_addr->ai_protocol);
+	if (fd < 0)
+		return NULL;
+	if (connect(fd, bitcoind->rpc_addr->ai_addr,
+		    bitcoind->rpc_addr->ai_addrlen) != 0)
+		goto fail;
+
+	bcli_rpc_add_call(&calls, 0, method, noargs);
+	request = bcli_rpc_http_request(tmpctx, bitcoind->rpc_host,
+					bitcoind->rpc_auth, calls);
+	tal_free(calls);
+	if (!write_all(fd, request, strlen(request)))
+		goto fail;
+
+	buf = tal_arr(tmpctx, char, 1000);
+	while ((parse = bcli_http_parse(buf, len, &resp))
+	       == BCLI_HTTP_INCOMPLETE) {
+		ssize_t r;
+
+		if (len == tal_count(buf))
+			tal_resize(&buf, len * 2);
+		r = read(fd, buf + len, tal_count(buf) - len);
+		if (r <= 0)
+			goto fail;
+		len += r;
+	}
+	close(fd);
+
+	if (parse == BCLI_HTTP_MALFORMED)
+		return NULL;
+
+	*httpstatus = resp.status;
+	if (resp.status != 200)
+		return tal_strndup(ctx, buf + resp.body_off, resp.body_len);
+
+	toks = json_parse_simple(tmpctx, buf + resp.body_off, resp.body_len);
+	if (!toks)
+		return NULL;
+	return bcli_rpc_reply(ctx, buf + resp.body_off, toks, 0, exitstatus);
+
+fail:
+	close_noerr(fd);
+	return NULL;
+}
+
+static void wait_and_check_bitcoind_direct(struct plugin *p)
+{
+	bool printed = false;
+	char *output;
+
+	rpc_setup(p);
+	for (;;) {
+		int httpstatus, exitstatus;
+
+		output = rpc_call_sync(tmpctx, "getnetworkinfo",
+				       &httpstatus, &exitstatus);
+		if (!output)
+			plugin_err(p, "Could not connect to bitcoind at %s."
+				   " Is bitcoind running?",
+				   bitcoind->rpc_host);
+		if (httpstatus == 401)
+			plugin_err(p, "bitcoind rejected our RPC credentials:"
+				   " check --bitcoin-rpcuser and"
+				   " --bitcoin-rpcpassword");
+		if (httpstatus != 200)
+			plugin_err(p, "bitcoind replied HTTP status %i: %s",
+				   httpstatus, output);
+
+		if (exitstatus == 0)
+			break;
+
+		/* RPC_IN_WARMUP, as below. */
+		if (exitstatus != 28)
+			plugin_err(p, "bitcoind getnetworkinfo failed: %s",
+				   output);
+
+		if (!printed) {
+			plugin_log(p, LOG_UNUSUAL,
+				   "Waiting for bitcoind to warm up...");
+			printed = true;
+		}
+		sleep(1);
+	}
+
+	parse_getnetworkinfo_result(p, output);
+}
+
 static void wait_and_check_bitcoind(struct plugin *p)
 {
 	int in, from, status, ret;
 	pid_t child;
-	const char **cmd = gather_args(bitcoind, "getnetworkinfo", NULL);
+	const char **cmd;
 	bool printed = false;
 	char *output = NULL;
 
+	if (bitcoind->rpc_direct) {
+		wait_and_check_bitcoind_direct(p);
+		return;
+	}
+
+	cmd = gather_args(bitcoind, "getnetworkinfo", NULL);
 	for (;;) {
 		tal_free(output);
 
@@ -1121,8 +1614,13 @@ static const char *init(struct command *init_cmd, const char *buffer UNUSED,
 		bitcoind->fake_fees = false;
 
 	plugin_set_memleak_handler(init_cmd->plugin, memleak_mark_bitcoind);
-	plugin_log(init_cmd->plugin, LOG_INFORM,
-		   "bitcoin-cli initialized and connected to bitcoind.");
+	if (bitcoind->rpc_direct)
+		plugin_log(init_cmd->plugin, LOG_INFORM,
+			   "Connected to bitcoind JSON-RPC at %s.",
+			   bitcoind->rpc_host);
+	else
+		plugin_log(init_cmd->plugin, LOG_INFORM,
+			   "bitcoin-cli initialized and connected to bitcoind.");
 
 	return NULL;
 }
@@ -1171,6 +1669,10 @@ static struct bitcoind *new_bitcoind(const tal_t *ctx)
 	   although normal rpcclienttimeout default value is 900. */
 	bitcoind->rpcclienttimeout = 60;
 	bitcoind->dev_no_fake_fees = false;
+	bitcoind->rpc_direct = false;
+	for (size_t i = 0; i < ARRAY_SIZE(bitcoind->rpc_conns); i++)
+		bitcoind->rpc_conns[i] = NULL;
+	bitcoind->next_rpc_id = 0;
 
 	return bitcoind;
 }
@@ -1213,6 +1715,11 @@ int main(int argc, char *argv[])
 				  "int",
 				  "bitcoind RPC timeout in seconds during HTTP requests",
 				  u64_option, u64_jsonfmt, &bitcoind->rpcclienttimeout),
+		    plugin_option("bitcoin-rpc-direct",
+				  "flag",
+				  "Talk JSON-RPC to bitcoind directly, instead"
+				  " of running bitcoin-cli",
+				  flag_option, flag_jsonfmt, &bitcoind->rpc_direct),
 		    plugin_option("bitcoin-retry-timeout",
 				  "int",
 				  "how long to keep retrying to contact bitcoind"
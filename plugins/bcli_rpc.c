@@ -0,0 +1,214 @@
+#include "config.h"
+#include <ccan/json_escape/json_escape.h>
+#include <ccan/mem/mem.h>
+#include <ccan/str/str.h>
+#include <ccan/tal/str/str.h>
+#include <common/utils.h>
+#include <inttypes.h>
+#include <plugins/bcli_rpc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+/* bitcoin-cli knows which parameters of which methods are numbers: we
+ * only use it for heights, counts, peer ids and "0", so this is enough. */
+static bool looks_like_literal(const char *arg)
+{
+	size_t len = strlen(arg);
+
+	if (streq(arg, "true") || streq(arg, "false"))
+		return true;
+
+	/* Hex txids and blocks can be all digits, but they're long! */
+	if (len == 0 || len > 20)
+		return false;
+
+	if (arg[0] == '-')
+		arg++;
+	if (!*arg)
+		return false;
+	for (; *arg; arg++) {
+		if (!cisdigit(*arg))
+			return false;
+	}
+	return true;
+}
+
+void bcli_rpc_add_call(char **batch, u64 id,
+		       const char *method, const char **args)
+{
+	if (*batch)
+		tal_append_fmt(batch, ",");
+	else
+		*batch = tal_strdup(NULL, "");
+
+	tal_append_fmt(batch,
+		       "{\"jsonrpc\":\"1.0\",\"id\":%"PRIu64",\"method\":\"%s\","
+		       "\"params\":[",
+		       id, json_escape(tmpctx, method)->s);
+	for (size_t i = 0; args[i]; i++) {
+		if (looks_like_literal(args[i]))
+			tal_append_fmt(batch, "%s%s", i ? "," : "", args[i]);
+		else
+			tal_append_fmt(batch, "%s\"%s\"", i ? "," : "",
+				       json_escape(tmpctx, args[i])->s);
+	}
+	tal_append_fmt(batch, "]}");
+}
+
+char *bcli_rpc_http_request(const tal_t *ctx,
+			    const char *host,
+			    const char *auth,
+			    const char *batch)
+{
+	/* Batches are always arrays, so responses are too. */
+	return tal_fmt(ctx,
+		       "POST / HTTP/1.1\r\n"
+		       "Host: %s\r\n"
+		       "Connection: keep-alive\r\n"
+		       "Authorization: Basic %s\r\n"
+		       "Content-Type: application/json\r\n"
+		       "Content-Length: %zu\r\n"
+		       "\r\n"
+		       "[%s]",
+		       host, auth, strlen(batch) + 2, batch);
+}
+
+/* Does this header line start with name: ?  If so, return the value. */
+static const char *header_value(const tal_t *ctx,
+				const char *line, size_t len,
+				const char *name)
+{
+	size_t namelen = strlen(name);
+
+	if (len <= namelen || line[namelen] != ':')
+		return NULL;
+	if (strncasecmp(line, name, namelen) != 0)
+		return NULL;
+
+	line += namelen + 1;
+	len -= namelen + 1;
+	while (len && cisspace(*line)) {
+		line++;
+		len--;
+	}
+	return tal_strndup(ctx, line, len);
+}
+
+enum bcli_http_parse bcli_http_parse(const char *buf, size_t len,
+				     struct bcli_http_response *resp)
+{
+	const char *end, *line, *eol;
+	bool have_len = false;
+	unsigned long long content_len;
+	int minor;
+
+	end = memmem(buf, len, "\r\n\r\n", 4);
+	if (!end) {
+		/* No headers are this big! */
+		if (len > 65536)
+			return BCLI_HTTP_MALFORMED;
+		return BCLI_HTTP_INCOMPLETE;
+	}
+
+	/* HTTP/1.1 200 OK */
+	if (sscanf(buf, "HTTP/1.%d %d", &minor, &resp->status) != 2)
+		return BCLI_HTTP_MALFORMED;
+	/* HTTP/1.0 closes unless told otherwise */
+	resp->close = (minor == 0);
+
+	line = memmem(buf, end - buf + 2, "\r\n", 2) + 2;
+	for (; line < end + 2; line = eol + 2) {
+		const char *v;
+
+		eol = memmem(line, end + 2 - line, "\r\n", 2);
+		v = header_value(tmpctx, line, eol - line, "Content-Length");
+		if (v) {
+			char *endp;
+			content_len = strtoull(v, &endp, 10);
+			if (*endp || endp == v)
+				return BCLI_HTTP_MALFORMED;
+			have_len = true;
+			continue;
+		}
+		v = header_value(tmpctx, line, eol - line, "Connection");
+		if (v) {
+			if (strcasecmp(v, "close") == 0)
+				resp->close = true;
+			else if (strcasecmp(v, "keep-alive") == 0)
+				resp->close = false;
+		}
+	}
+
+	/* bitcoind doesn't do chunked encoding, so we don't either */
+	if (!have_len)
+		return BCLI_HTTP_MALFORMED;
+
+	resp->body_off = end + 4 - buf;
+	if (len - resp->body_off < content_len)
+		return BCLI_HTTP_INCOMPLETE;
+	resp->body_len = content_len;
+	return BCLI_HTTP_COMPLETE;
+}
+
+char *bcli_rpc_reply(const tal_t *ctx,
+		     const char *buf, const jsmntok_t *toks,
+		     u64 id, int *exitstatus)
+{
+	const jsmntok_t *t;
+	size_t i;
+
+	if (toks->type != JSMN_ARRAY)
+		return NULL;
+
+	json_for_each_arr(i, t, toks) {
+		const jsmntok_t *idtok, *result, *error;
+		u64 reply_id;
+
+		idtok = json_get_member(buf, t, "id");
+		if (!idtok || !json_to_u64(buf, idtok, &reply_id)
+		    || reply_id != id)
+			continue;
+
+		error = json_get_member(buf, t, "error");
+		if (error && !json_tok_is_null(buf, error)) {
+			const jsmntok_t *code, *message;
+			s64 c;
+
+			code = json_get_member(buf, error, "code");
+			message = json_get_member(buf, error, "message");
+			if (!code || !json_to_s64(buf, code, &c) || !message)
+				return NULL;
+			/* bitcoin-cli exits with abs(code) */
+			*exitstatus = llabs(c) & 0xFF;
+			return tal_fmt(ctx, "error code: %"PRIi64"\n"
+				       "error message:\n%.*s\n",
+				       c,
+				       message->end - message->start,
+				       buf + message->start);
+		}
+
+		result = json_get_member(buf, t, "result");
+		if (!result)
+			return NULL;
+
+		*exitstatus = 0;
+		if (json_tok_is_null(buf, result))
+			return tal_strdup(ctx, "");
+		if (result->type == JSMN_STRING) {
+			struct json_escape *esc;
+			const char *str;
+
+			esc = json_escape_string_(tmpctx, buf + result->start,
+						  result->end - result->start);
+			str = json_escape_unescape(tmpctx, esc);
+			if (!str)
+				return NULL;
+			return tal_fmt(ctx, "%s\n", str);
+		}
+		return tal_fmt(ctx, "%.*s\n",
+			       json_tok_full_len(result),
+			       json_tok_full(buf, result));
+	}
+	return NULL;
+}
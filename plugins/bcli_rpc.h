@@ -0,0 +1,80 @@
+#ifndef LIGHTNING_PLUGINS_BCLI_RPC_H
+#define LIGHTNING_PLUGINS_BCLI_RPC_H
+/* Talking to bitcoind's JSON-RPC over HTTP, instead of via bitcoin-cli. */
+#include "config.h"
+#include <ccan/short_types/short_types.h>
+#include <ccan/tal/tal.h>
+#include <common/json_parse_simple.h>
+
+enum bcli_http_parse {
+	/* Need to read more. */
+	BCLI_HTTP_INCOMPLETE,
+	/* We have the whole thing (and maybe more). */
+	BCLI_HTTP_COMPLETE,
+	/* Not something we understand. */
+	BCLI_HTTP_MALFORMED,
+};
+
+struct bcli_http_response {
+	/* e.g. 200, or 401 if bitcoind didn't like our credentials */
+	int status;
+	/* Where the body is in the buffer. */
+	size_t body_off, body_len;
+	/* Server is going to close the connection after this. */
+	bool close;
+};
+
+/**
+ * bcli_rpc_add_call - append a JSON-RPC call to a batch.
+ * @batch: the tal string to append to (NULL for the first call).
+ * @id: the id for this call.
+ * @method: the bitcoind method.
+ * @args: NULL-terminated arguments, as we'd hand them to bitcoin-cli.
+ *
+ * Like bitcoin-cli, arguments which look like numbers (or booleans)
+ * are sent as JSON literals, and everything else as strings.
+ */
+void bcli_rpc_add_call(char **batch, u64 id,
+		       const char *method, const char **args);
+
+/**
+ * bcli_rpc_http_request - wrap a batch of calls in an HTTP POST.
+ * @ctx: context to allocate the return from.
+ * @host: the value for the Host header.
+ * @auth: base64 of "user:password".
+ * @batch: the calls, from bcli_rpc_add_call().
+ */
+char *bcli_rpc_http_request(const tal_t *ctx,
+			    const char *host,
+			    const char *auth,
+			    const char *batch);
+
+/**
+ * bcli_http_parse - have we read an entire HTTP response?
+ * @buf: what we've read so far.
+ * @len: the length of @buf.
+ * @resp: filled in if we return BCLI_HTTP_COMPLETE.
+ *
+ * We only handle responses with a Content-Length, which is all
+ * bitcoind sends.
+ */
+enum bcli_http_parse bcli_http_parse(const char *buf, size_t len,
+				     struct bcli_http_response *resp);
+
+/**
+ * bcli_rpc_reply - make one reply in a batch look like bitcoin-cli output.
+ * @ctx: context to allocate the return from.
+ * @buf: the response body.
+ * @toks: the parsed response body.
+ * @id: the id of the call we want.
+ * @exitstatus: set to what bitcoin-cli would have exited with.
+ *
+ * Strings come out bare, null comes out empty, and errors come out
+ * the way bitcoin-cli prints them.  Returns NULL if there's no valid
+ * reply for @id.
+ */
+char *bcli_rpc_reply(const tal_t *ctx,
+		     const char *buf, const jsmntok_t *toks,
+		     u64 id, int *exitstatus);
+
+#endif /* LIGHTNING_PLUGINS_BCLI_RPC_H */
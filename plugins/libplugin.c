@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <unistd.h>
 
 #define READ_CHUNKSIZE 4096
 
@@ -150,6 +151,11 @@ struct plugin {
 
 	/* Lets them remove ptrs from leak detection. */
 	void (*mark_mem)(struct plugin *plugin, struct htable *memtable);
+
+	/* In a forked child, logs and fatal errors go here instead. */
+	void (*child_log)(struct plugin *plugin, enum log_level level,
+			  const char *msg);
+	void (*child_err)(struct plugin *plugin, const char *msg);
 };
 
 /* command_result is mainly used as a compile-time check to encourage you
@@ -1827,8 +1833,15 @@ struct plugin_timer *command_timer_(struct command *cmd,
 void plugin_logv(struct plugin *p, enum log_level l,
 		 const char *fmt, va_list ap)
 {
-	struct json_stream *js = new_json_stream(NULL, NULL, NULL);
+	struct json_stream *js;
+
+	/* A child can't talk to lightningd */
+	if (p->child_log) {
+		p->child_log(p, l, tal_vfmt(tmpctx, fmt, ap));
+		return;
+	}
 
+	js = new_json_stream(NULL, NULL, NULL);
 	json_object_start(js, NULL);
 	json_add_string(js, "jsonrpc", "2.0");
 	json_add_string(js, "method", "log");
@@ -1959,6 +1972,12 @@ void NORETURN plugin_errv(struct plugin *p, const char *fmt, va_list ap)
 {
 	va_list ap2;
 
+	/* A child mustn't touch lightningd's connection (or exit()) */
+	if (p->child_err) {
+		p->child_err(p, tal_vfmt(tmpctx, fmt, ap));
+		_exit(1);
+	}
+
 	/* In case it gets consumed, make a copy. */
 	va_copy(ap2, ap);
 
@@ -2028,6 +2047,17 @@ void plugin_set_memleak_handler(struct plugin *plugin,
 		plugin->mark_mem = mark_mem;
 }
 
+void plugin_set_child_handlers(struct plugin *plugin,
+			       void (*log)(struct plugin *plugin,
+					   enum log_level level,
+					   const char *msg),
+			       void (*err)(struct plugin *plugin,
+					   const char *msg))
+{
+	plugin->child_log = log;
+	plugin->child_err = err;
+}
+
 bool command_deprecated_ok_flag(const struct command *cmd)
 {
 	if (cmd->plugin->deprecated_ok_override)
@@ -2453,6 +2483,8 @@ static struct plugin *new_plugin(const tal_t *ctx,
 	}
 
 	p->mark_mem = NULL;
+	p->child_log = NULL;
+	p->child_err = NULL;
 	return p;
 }
 
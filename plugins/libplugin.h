@@ -692,6 +692,15 @@ void plugin_set_memleak_handler(struct plugin *plugin,
 				void (*mark_mem)(struct plugin *plugin,
 						 struct htable *memtable));
 
+/* For a forked child, which must not talk to lightningd: plugin_log()
+ * calls @log instead, and plugin_err() calls @err then _exit(1)s. */
+void plugin_set_child_handlers(struct plugin *plugin,
+			       void (*log)(struct plugin *plugin,
+					   enum log_level level,
+					   const char *msg),
+			       void (*err)(struct plugin *plugin,
+					   const char *msg));
+
 /* Synchronously call a JSON-RPC method and return its contents and
  * the parser token. */
 const jsmntok_t *jsonrpc_request_sync(const tal_t *ctx,
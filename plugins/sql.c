@@ -13,6 +13,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <gossipd/gossip_store_wiregen.h>
+#include <inttypes.h>
 #include <plugins/libplugin.h>
 #include <sqlite3.h>
 #include <stdio.h>
@@ -114,6 +115,10 @@ struct table_desc {
 	struct command_result *(*refresh)(struct command *cmd,
 					  const struct table_desc *td,
 					  struct db_query *dbq);
+	/* For waitable tables: have we loaded it, and what indexes
+	 * have we seen? */
+	bool have_indexes;
+	u64 created_index, updated_index, deleted_index;
 };
 static STRMAP(struct table_desc *) tablemap;
 static size_t max_dbmem = 500000000;
@@ -173,6 +178,25 @@ static const struct index indices[] = {
 	},
 };
 
+/* These list commands have created/updated/deleted indexes (and the
+ * table name is also the subsystem name for lightning-wait(7)), so we
+ * only need to fetch what changed since last time. */
+static const char *waitable_tables[] = {
+	"forwards",
+	"htlcs",
+	"invoices",
+	"sendpays",
+};
+
+static bool is_waitable(const char *tablename)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(waitable_tables); i++) {
+		if (streq(waitable_tables[i], tablename))
+			return true;
+	}
+	return false;
+}
+
 static enum fieldtype find_fieldtype(const jsmntok_t *name)
 {
 	for (size_t i = 0; i < ARRAY_SIZE(fieldtypemap); i++) {
@@ -746,6 +770,205 @@ static struct command_result *default_refresh(struct command *cmd,
 	return send_outreq(req);
 }
 
+/* Raise td->created_index and/or td->updated_index to what's in arr */
+static void note_indexes(struct table_desc *td,
+			 const char *buf,
+			 const jsmntok_t *arr,
+			 bool created, bool updated)
+{
+	size_t i;
+	const jsmntok_t *t;
+
+	json_for_each_arr(i, t, arr) {
+		const jsmntok_t *idxtok;
+		u64 idx;
+
+		idxtok = json_get_member(buf, t, "created_index");
+		if (created && idxtok && json_to_u64(buf, idxtok, &idx)
+		    && idx > td->created_index)
+			td->created_index = idx;
+		idxtok = json_get_member(buf, t, "updated_index");
+		if (updated && idxtok && json_to_u64(buf, idxtok, &idx)
+		    && idx > td->updated_index)
+			td->updated_index = idx;
+	}
+}
+
+/* Remove any rows we already have for these entries, so we can
+ * (re-)insert them. */
+static struct command_result *delete_existing_rows(struct command *cmd,
+						   const struct table_desc *td,
+						   const char *buf,
+						   const jsmntok_t *arr)
+{
+	size_t i;
+	const jsmntok_t *t;
+	int err;
+	sqlite3_stmt *stmt;
+	const char *del;
+
+	del = tal_fmt(tmpctx, "DELETE FROM %s WHERE created_index = ?;",
+		      td->name);
+	err = sqlite3_prepare_v2(db, del, -1, &stmt, NULL);
+	if (err != SQLITE_OK) {
+		return command_fail(cmd, LIGHTNINGD, "preparing '%s' failed: %s",
+				    del, sqlite3_errmsg(db));
+	}
+
+	json_for_each_arr(i, t, arr) {
+		const jsmntok_t *idxtok;
+		u64 idx;
+
+		idxtok = json_get_member(buf, t, "created_index");
+		if (!idxtok || !json_to_u64(buf, idxtok, &idx)) {
+			sqlite3_finalize(stmt);
+			return command_fail(cmd, LIGHTNINGD,
+					    "%s row %zu has no created_index",
+					    td->name, i);
+		}
+		sqlite3_bind_int64(stmt, 1, idx);
+		err = sqlite3_step(stmt);
+		if (err != SQLITE_DONE) {
+			sqlite3_finalize(stmt);
+			return command_fail(cmd, LIGHTNINGD,
+					    "Error executing %s: %s",
+					    del, sqlite3_errmsg(db));
+		}
+		sqlite3_reset(stmt);
+	}
+	sqlite3_finalize(stmt);
+	return NULL;
+}
+
+static struct command_result *waitable_updated_done(struct command *cmd,
+						    const char *method,
+						    const char *buf,
+						    const jsmntok_t *result,
+						    struct db_query *dbq)
+{
+	struct table_desc *td = dbq->tables[0];
+	const jsmntok_t *arr = json_get_member(buf, result, td->arrname);
+	struct command_result *ret;
+
+	ret = delete_existing_rows(cmd, td, buf, arr);
+	if (ret)
+		return ret;
+
+	ret = process_json_result(cmd, buf, result, td);
+	if (ret)
+		return ret;
+
+	note_indexes(td, buf, arr, false, true);
+	return one_refresh_done(cmd, dbq);
+}
+
+static struct command_result *waitable_created_done(struct command *cmd,
+						    const char *method,
+						    const char *buf,
+						    const jsmntok_t *result,
+						    struct db_query *dbq)
+{
+	struct table_desc *td = dbq->tables[0];
+	const jsmntok_t *arr = json_get_member(buf, result, td->arrname);
+	struct command_result *ret;
+	struct out_req *req;
+
+	/* An entry created since we last looked could also have turned
+	 * up last time in the updated list, so replace, don't add. */
+	ret = delete_existing_rows(cmd, td, buf, arr);
+	if (ret)
+		return ret;
+
+	ret = process_json_result(cmd, buf, result, td);
+	if (ret)
+		return ret;
+
+	/* Only the created pass raises created_index: the updated pass
+	 * can see entries created after this, which we'd then skip. */
+	note_indexes(td, buf, arr, true, false);
+
+	req = jsonrpc_request_start(cmd, td->cmdname,
+				    waitable_updated_done, forward_error,
+				    dbq);
+	json_add_string(req->js, "index", "updated");
+	json_add_u64(req->js, "start", td->updated_index + 1);
+	return send_outreq(req);
+}
+
+static struct command_result *waitable_full_done(struct command *cmd,
+						 const char *method,
+						 const char *buf,
+						 const jsmntok_t *result,
+						 struct db_query *dbq)
+{
+	struct table_desc *td = dbq->tables[0];
+
+	td->created_index = td->updated_index = 0;
+	note_indexes(td, buf, json_get_member(buf, result, td->arrname),
+		     true, true);
+	td->have_indexes = true;
+	return default_list_done(cmd, method, buf, result, dbq);
+}
+
+static struct command_result *wait_deleted_done(struct command *cmd,
+						const char *method,
+						const char *buf,
+						const jsmntok_t *result,
+						struct db_query *dbq)
+{
+	struct table_desc *td = dbq->tables[0];
+	struct out_req *req;
+	const char *err;
+	u64 deleted;
+
+	err = json_scan(tmpctx, buf, result, "{deleted:%}",
+			JSON_SCAN(json_to_u64, &deleted));
+	if (err)
+		plugin_err(cmd->plugin, "Failed parsing wait response: (%s): '%.*s'",
+			   err,
+			   json_tok_full_len(result),
+			   json_tok_full(buf, result));
+
+	/* We can't tell what was deleted, so reload if anything was. */
+	if (!td->have_indexes || deleted != td->deleted_index) {
+		plugin_log(cmd->plugin, LOG_DBG, "Reloading %s", td->name);
+		td->deleted_index = deleted;
+		td->have_indexes = false;
+		req = jsonrpc_request_start(cmd, td->cmdname,
+					    waitable_full_done, forward_error,
+					    dbq);
+		return send_outreq(req);
+	}
+
+	plugin_log(cmd->plugin, LOG_DBG,
+		   "Refreshing %s from created %"PRIu64", updated %"PRIu64,
+		   td->name, td->created_index + 1, td->updated_index + 1);
+	req = jsonrpc_request_start(cmd, td->cmdname,
+				    waitable_created_done, forward_error,
+				    dbq);
+	json_add_string(req->js, "index", "created");
+	json_add_u64(req->js, "start", td->created_index + 1);
+	return send_outreq(req);
+}
+
+/* Instead of reloading everything, we only ask for entries created or
+ * updated since last time, unless something was deleted. */
+static struct command_result *waitable_refresh(struct command *cmd,
+					       const struct table_desc *td,
+					       struct db_query *dbq)
+{
+	struct out_req *req;
+
+	/* This returns immediately, with the current value */
+	req = jsonrpc_request_start(cmd, "wait",
+				    wait_deleted_done, forward_error,
+				    dbq);
+	json_add_string(req->js, "subsystem", td->name);
+	json_add_string(req->js, "indexname", "deleted");
+	json_add_u64(req->js, "nextvalue", 0);
+	return send_outreq(req);
+}
+
 static bool extract_scid(int gosstore_fd, size_t off, u16 type,
 			 struct short_channel_id *scid)
 {
@@ -1349,8 +1572,12 @@ static struct table_desc *new_table_desc(const tal_t *ctx,
 		td->refresh = channels_refresh;
 	else if (streq(td->name, "nodes"))
 		td->refresh = nodes_refresh;
+	else if (!parent && is_waitable(td->name))
+		td->refresh = waitable_refresh;
 	else
 		td->refresh = default_refresh;
+	td->have_indexes = false;
+	td->created_index = td->updated_index = td->deleted_index = 0;
 
 	/* sub-objects are a JSON thing, not a real table! */
 	if (!td->is_subobject)
@@ -1540,6 +1767,19 @@ static void init_indices(struct plugin *plugin)
 		if (err != SQLITE_OK)
 			plugin_err(plugin, "Failed '%s': %s", cmd, errmsg);
 	}
+
+	/* We replace rows by created_index when refreshing these */
+	for (size_t i = 0; i < ARRAY_SIZE(waitable_tables); i++) {
+		char *errmsg, *cmd;
+		int err;
+
+		cmd = tal_fmt(tmpctx, "CREATE INDEX %s_created_index_idx"
+			      " ON %s (created_index);",
+			      waitable_tables[i], waitable_tables[i]);
+		err = sqlite3_exec(db, cmd, NULL, NULL, &errmsg);
+		if (err != SQLITE_OK)
+			plugin_err(plugin, "Failed '%s': %s", cmd, errmsg);
+	}
 }
 
 static void memleak_mark_tablemap(struct plugin *p, struct htable *memtable)
@@ -0,0 +1,224 @@
+/* Test bcli's direct JSON-RPC against a stub bitcoind. */
+#include "config.h"
+#include "../bcli_rpc.c"
+#include "../../common/json_parse_simple.c"
+#include <assert.h>
+#include <ccan/read_write_all/read_write_all.h>
+#include <common/setup.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* AUTOGENERATED MOCKS START */
+/* AUTOGENERATED MOCKS END */
+
+/* What bitcoind says to the first request: headers and body arrive in
+ * separate writes, and the replies are out of order. */
+static const char *reply1_hdr =
+	"HTTP/1.1 200 OK\r\n"
+	"Content-Type: application/json\r\n"
+	"content-length: %zu\r\n"
+	"\r\n";
+static const char *reply1_body =
+	"[{\"result\":null,\"error\":{\"code\":-8,\"message\":\"Block height out of range\"},\"id\":1},"
+	"{\"result\":\"00112233\",\"error\":null,\"id\":0},"
+	"{\"result\":{\"blocks\":102},\"error\":null,\"id\":2},"
+	"{\"result\":null,\"error\":null,\"id\":3}]";
+
+/* Second request, same connection: and now it hangs up. */
+static const char *reply2 =
+	"HTTP/1.1 200 OK\r\n"
+	"Connection: close\r\n"
+	"Content-Length: 40\r\n"
+	"\r\n"
+	"[{\"result\":\"a\\\"b\",\"error\":null,\"id\":4}]\n";
+
+/* Read one whole request, check it's a POST, return the body. */
+static char *read_request(const tal_t *ctx, int fd)
+{
+	char *buf = tal_arr(ctx, char, 10000);
+	size_t len = 0;
+	const char *body, *clen;
+
+	for (;;) {
+		ssize_t r = read(fd, buf + len, tal_count(buf) - len - 1);
+		assert(r > 0);
+		len += r;
+		buf[len] = '\0';
+		body = strstr(buf, "\r\n\r\n");
+		if (!body)
+			continue;
+		body += 4;
+		clen = strstr(buf, "Content-Length: ");
+		assert(clen);
+		if (buf + len - body == atoi(clen + strlen("Content-Length: ")))
+			break;
+	}
+	assert(strstarts(buf, "POST / HTTP/1.1\r\n"));
+	assert(strstr(buf, "Authorization: Basic dXNlcjpwYXNz\r\n"));
+	return tal_strdup(ctx, body);
+}
+
+static void stub_bitcoind(int fd)
+{
+	char *body;
+	char *hdr;
+
+	body = read_request(tmpctx, fd);
+	assert(streq(body,
+		     "[{\"jsonrpc\":\"1.0\",\"id\":0,\"method\":\"getblockhash\",\"params\":[101]},"
+		     "{\"jsonrpc\":\"1.0\",\"id\":1,\"method\":\"getblockhash\",\"params\":[-1]},"
+		     "{\"jsonrpc\":\"1.0\",\"id\":2,\"method\":\"getblockchaininfo\",\"params\":[]},"
+		     "{\"jsonrpc\":\"1.0\",\"id\":3,\"method\":\"estimatesmartfee\",\"params\":[2,\"CONSERVATIVE\"]}]"));
+	hdr = tal_fmt(tmpctx, reply1_hdr, strlen(reply1_body));
+	assert(write_all(fd, hdr, strlen(hdr)));
+	/* Give the client a chance to see a partial response. */
+	usleep(1000);
+	assert(write_all(fd, reply1_body, 10));
+	usleep(1000);
+	assert(write_all(fd, reply1_body + 10, strlen(reply1_body + 10)));
+
+	body = read_request(tmpctx, fd);
+	assert(streq(body,
+		     "[{\"jsonrpc\":\"1.0\",\"id\":4,\"method\":\"getblock\",\"params\":"
+		     "[\"0000000000000000000000000000000000000000000000000000000000000000\",0]}]"));
+	assert(write_all(fd, reply2, strlen(reply2)));
+	close(fd);
+	exit(0);
+}
+
+/* Read until we have a whole response. */
+static char *read_response(const tal_t *ctx, int fd,
+			   struct bcli_http_response *resp)
+{
+	char *buf = tal_arr(ctx, char, 10);
+	size_t len = 0;
+	enum bcli_http_parse parse;
+
+	while ((parse = bcli_http_parse(buf, len, resp))
+	       == BCLI_HTTP_INCOMPLETE) {
+		ssize_t r;
+
+		if (len == tal_count(buf))
+			tal_resize(&buf, len * 2);
+		r = read(fd, buf + len, tal_count(buf) - len);
+		assert(r > 0);
+		len += r;
+	}
+	assert(parse == BCLI_HTTP_COMPLETE);
+	return buf;
+}
+
+static void test_parse(void)
+{
+	struct bcli_http_response resp;
+	const char *msg;
+
+	msg = "HTTP/1.1 200 OK\r\nContent-Length: 2";
+	assert(bcli_http_parse(msg, strlen(msg), &resp) == BCLI_HTTP_INCOMPLETE);
+	msg = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n[";
+	assert(bcli_http_parse(msg, strlen(msg), &resp) == BCLI_HTTP_INCOMPLETE);
+	msg = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n[]";
+	assert(bcli_http_parse(msg, strlen(msg), &resp) == BCLI_HTTP_COMPLETE);
+	assert(resp.status == 200);
+	assert(!resp.close);
+	assert(resp.body_len == 2);
+	assert(memeq(msg + resp.body_off, resp.body_len, "[]", 2));
+
+	/* HTTP/1.0 closes by default */
+	msg = "HTTP/1.0 401 Unauthorized\r\nContent-Length: 0\r\n\r\n";
+	assert(bcli_http_parse(msg, strlen(msg), &resp) == BCLI_HTTP_COMPLETE);
+	assert(resp.status == 401);
+	assert(resp.close);
+	assert(resp.body_len == 0);
+
+	/* We don't do chunked. */
+	msg = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\n[]\r\n";
+	assert(bcli_http_parse(msg, strlen(msg), &resp) == BCLI_HTTP_MALFORMED);
+	msg = "SSH-2.0-OpenSSH_9.6\r\n\r\n";
+	assert(bcli_http_parse(msg, strlen(msg), &resp) == BCLI_HTTP_MALFORMED);
+}
+
+static char *reply(const tal_t *ctx, const char *buf,
+		   const struct bcli_http_response *resp,
+		   u64 id, int *exitstatus)
+{
+	const char *body = buf + resp->body_off;
+	const jsmntok_t *toks = json_parse_simple(tmpctx, body, resp->body_len);
+
+	assert(toks);
+	return bcli_rpc_reply(ctx, body, toks, id, exitstatus);
+}
+
+int main(int argc, char *argv[])
+{
+	int fds[2], status, exitstatus;
+	pid_t pid;
+	char *calls = NULL, *req, *buf, *out;
+	struct bcli_http_response resp;
+	const char *args0[] = { "101", NULL };
+	const char *args1[] = { "-1", NULL };
+	const char *args2[] = { NULL };
+	const char *args3[] = { "2", "CONSERVATIVE", NULL };
+	const char *args4[] = { "0000000000000000000000000000000000000000000000000000000000000000", "0", NULL };
+
+	common_setup(argv[0]);
+
+	test_parse();
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	pid = fork();
+	assert(pid >= 0);
+	if (pid == 0) {
+		close(fds[0]);
+		stub_bitcoind(fds[1]);
+	}
+	close(fds[1]);
+
+	/* Four calls in one request */
+	bcli_rpc_add_call(&calls, 0, "getblockhash", args0);
+	bcli_rpc_add_call(&calls, 1, "getblockhash", args1);
+	bcli_rpc_add_call(&calls, 2, "getblockchaininfo", args2);
+	bcli_rpc_add_call(&calls, 3, "estimatesmartfee", args3);
+	req = bcli_rpc_http_request(tmpctx, "127.0.0.1", "dXNlcjpwYXNz", calls);
+	calls = tal_free(calls);
+	assert(write_all(fds[0], req, strlen(req)));
+
+	buf = read_response(tmpctx, fds[0], &resp);
+	assert(resp.status == 200);
+	assert(!resp.close);
+
+	/* Each looks like what bitcoin-cli would have printed. */
+	out = reply(tmpctx, buf, &resp, 0, &exitstatus);
+	assert(exitstatus == 0);
+	assert(streq(out, "00112233\n"));
+	out = reply(tmpctx, buf, &resp, 1, &exitstatus);
+	assert(exitstatus == 8);
+	assert(streq(out, "error code: -8\nerror message:\nBlock height out of range\n"));
+	out = reply(tmpctx, buf, &resp, 2, &exitstatus);
+	assert(exitstatus == 0);
+	assert(streq(out, "{\"blocks\":102}\n"));
+	out = reply(tmpctx, buf, &resp, 3, &exitstatus);
+	assert(exitstatus == 0);
+	assert(streq(out, ""));
+	assert(!reply(tmpctx, buf, &resp, 4, &exitstatus));
+
+	/* Same connection again: long hex stays a string. */
+	bcli_rpc_add_call(&calls, 4, "getblock", args4);
+	req = bcli_rpc_http_request(tmpctx, "127.0.0.1", "dXNlcjpwYXNz", calls);
+	calls = tal_free(calls);
+	assert(write_all(fds[0], req, strlen(req)));
+
+	buf = read_response(tmpctx, fds[0], &resp);
+	assert(resp.status == 200);
+	assert(resp.close);
+	out = reply(tmpctx, buf, &resp, 4, &exitstatus);
+	assert(exitstatus == 0);
+	assert(streq(out, "a\"b\n"));
+
+	assert(waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	close(fds[0]);
+
+	common_shutdown();
+}
@@ -811,6 +811,80 @@ def test_getroutes_auto_localchans(node_factory):
                                  {'short_channel_id_dir': '1x2x1/1', 'amount_msat': 101000, 'delay': 99 + 6}]])
 
 
+def test_getroutes_auto_localchans_refresh(node_factory):
+    """auto.localchans is cached, but must notice payments and disconnects"""
+    l1, l2 = node_factory.line_graph(2, wait_for_announce=False)
+
+    spendable = only_one(l1.rpc.listpeerchannels()['channels'])['spendable_msat']
+    l1.rpc.getroutes(source=l1.info['id'],
+                     destination=l2.info['id'],
+                     amount_msat=spendable,
+                     layers=['auto.localchans'],
+                     maxfee_msat=1000,
+                     final_cltv=99)
+
+    # Spend some: that has to be reflected next time.
+    inv = l2.rpc.invoice(spendable // 2, 'test_getroutes_auto_localchans_refresh', 'desc')
+    l1.rpc.xpay(inv['bolt11'])
+    with pytest.raises(RpcError):
+        l1.rpc.getroutes(source=l1.info['id'],
+                         destination=l2.info['id'],
+                         amount_msat=spendable,
+                         layers=['auto.localchans'],
+                         maxfee_msat=1000,
+                         final_cltv=99)
+
+    spendable = only_one(l1.rpc.listpeerchannels()['channels'])['spendable_msat']
+    l1.rpc.getroutes(source=l1.info['id'],
+                     destination=l2.info['id'],
+                     amount_msat=spendable,
+                     layers=['auto.localchans'],
+                     maxfee_msat=1000,
+                     final_cltv=99)
+
+    # Once peer is gone, so is the route.
+    l1.rpc.disconnect(l2.info['id'], force=True)
+    wait_for(lambda: not only_one(l1.rpc.listpeerchannels()['channels'])['peer_connected'])
+    with pytest.raises(RpcError):
+        l1.rpc.getroutes(source=l1.info['id'],
+                         destination=l2.info['id'],
+                         amount_msat=1000,
+                         layers=['auto.localchans'],
+                         maxfee_msat=1000,
+                         final_cltv=99)
+
+
+def test_getroutes_concurrent(node_factory, executor):
+    """getroutes runs in child processes, or in-process when too many are running"""
+    gsfile, nodemap = generate_gossip_store([GenChannel(0, 1, capacity_sats=100_000),
+                                             GenChannel(1, 3, capacity_sats=100_000),
+                                             GenChannel(0, 2, capacity_sats=100_000),
+                                             GenChannel(2, 3, capacity_sats=100_000)])
+    args = {'source': nodemap[0],
+            'destination': nodemap[3],
+            'amount_msat': 150_000_000,
+            'layers': [],
+            'maxfee_msat': 1_000_000,
+            'final_cltv': 99}
+
+    # l2 never forks, so gives us the in-process answer.
+    l1 = node_factory.get_node(gossip_store_file=gsfile.name)
+    l2 = node_factory.get_node(gossip_store_file=gsfile.name,
+                               options={'dev-askrene-max-children': 0})
+    expected = l2.rpc.getroutes(**args)
+    assert len(expected['routes']) == 2
+    l2.daemon.wait_for_log('0 children busy, solving in-process')
+
+    # More than ASKRENE_MAX_CHILDREN (8) at once.
+    futs = [executor.submit(l1.rpc.getroutes, **args) for _ in range(16)]
+    for f in futs:
+        assert f.result(TIMEOUT) == expected
+
+    # Children's logs make it back to us.
+    l1.daemon.wait_for_logs([r'Flow 1/2: '] * 16)
+    assert not l1.daemon.is_in_log('getroutes child')
+
+
 def test_fees_dont_exceed_constraints(node_factory):
     msat = 100000000
     max_msat = int(msat * 0.45)
@@ -445,6 +445,27 @@ def test_sqlite3_builtin_backup(bitcoind, node_factory):
     assert(len(l1.rpc.listfunds()['outputs']) == 1)
 
 
+@unittest.skipIf(os.getenv('TEST_DB_PROVIDER', 'sqlite3') != 'sqlite3', "Only sqlite3 caches prepared statements")
+def test_sqlite3_stmt_cache(node_factory):
+    l1 = node_factory.get_node()
+
+    before = l1.rpc.dev_dbstats()
+    assert before['driver'] == 'sqlite3'
+
+    # Same query, over and over: it should only be compiled once.
+    for i in range(10):
+        l1.rpc.invoice(1000, 'lbl{}'.format(i), 'desc')
+        l1.rpc.listinvoices('lbl{}'.format(i))
+
+    after = l1.rpc.dev_dbstats()
+    assert after['stmt_cache_hits'] >= before['stmt_cache_hits'] + 9 * 2
+    assert after['stmt_cache_misses'] - before['stmt_cache_misses'] < 10
+
+    # Cached statements must not get in the way of a clean shutdown.
+    l1.restart()
+    assert only_one(l1.rpc.listinvoices('lbl9')['invoices'])['label'] == 'lbl9'
+
+
 @unittest.skipIf(os.getenv('TEST_DB_PROVIDER', 'sqlite3') != 'sqlite3', "Don't know how to swap dbs in Postgres")
 def test_db_sanity_checks(bitcoind, node_factory):
     l1, l2 = node_factory.get_nodes(2, opts=[{'may_fail': True, 'broken_log': 'Wallet node_id does not match HSM|Wallet blockchain hash does not match network blockchain hash'}, {}])
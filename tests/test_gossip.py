@@ -1207,7 +1207,7 @@ def test_gossip_store_load(node_factory):
 
     l1.start()
     # May preceed the Started msg waited for in 'start'.
-    wait_for(lambda: l1.daemon.is_in_log('Read 1/1/1/0 cannounce/cupdate/nannounce/delete from store in 800 bytes, now 778 bytes'))
+    wait_for(lambda: l1.daemon.is_in_log('Read 1/1/1/0 cannounce/cupdate/nannounce/delete from store in 800 bytes, now 824 bytes'))
     assert not l1.daemon.is_in_log('gossip_store.*truncating')
 
 
@@ -1275,7 +1275,7 @@ def test_gossip_store_load_announce_before_update(node_factory):
 
     l1.start()
     # May preceed the Started msg waited for in 'start'.
-    wait_for(lambda: l1.daemon.is_in_log('Read 1/1/1/1 cannounce/cupdate/nannounce/delete from store in 950 bytes, now 778 bytes'))
+    wait_for(lambda: l1.daemon.is_in_log('Read 1/1/1/1 cannounce/cupdate/nannounce/delete from store in 950 bytes, now 824 bytes'))
     assert not l1.daemon.is_in_log('gossip_store.*truncating')
 
 
@@ -1294,7 +1294,7 @@ def test_gossip_store_load_amount_truncated(node_factory):
     # May preceed the Started msg waited for in 'start'.
     wait_for(lambda: l1.daemon.is_in_log(r'\*\*BROKEN\*\* gossipd: gossip_store only processed 1 bytes of 445 \(expected 445\)'))
     wait_for(lambda: l1.daemon.is_in_log(r'\*\*BROKEN\*\* gossipd: gossip_store: Moving to gossip_store.corrupt'))
-    wait_for(lambda: l1.daemon.is_in_log(r'gossip_store: Read 0/0/0/0 cannounce/cupdate/nannounce/delete from store in 0 bytes, now 1 bytes \(populated=false\)'))
+    wait_for(lambda: l1.daemon.is_in_log(r'gossip_store: Read 0/0/0/0 cannounce/cupdate/nannounce/delete from store in 0 bytes, now 47 bytes \(populated=false\)'))
     assert os.path.exists(os.path.join(l1.daemon.lightning_dir, TEST_NETWORK, 'gossip_store.corrupt'))
 
 
@@ -1656,7 +1656,7 @@ def test_gossip_store_load_no_channel_update(node_factory):
     l1.start()
 
     # May preceed the Started msg waited for in 'start'.
-    wait_for(lambda: l1.daemon.is_in_log('Read 1/0/1/0 cannounce/cupdate/nannounce/delete from store in 650 bytes, now 628 bytes'))
+    wait_for(lambda: l1.daemon.is_in_log('Read 1/0/1/0 cannounce/cupdate/nannounce/delete from store in 650 bytes, now 674 bytes'))
     assert not os.path.exists(os.path.join(l1.daemon.lightning_dir, TEST_NETWORK, 'gossip_store.corrupt'))
 
 
@@ -1674,6 +1674,30 @@ def test_gossip_store_compact_on_load(node_factory, bitcoind):
     assert l2.daemon.is_in_log('gossip_store: Read 2/4/3/2 cannounce/cupdate/nannounce/delete from store')
 
 
+def test_gossip_store_compact_online(node_factory, bitcoind):
+    l2 = setup_gossip_store_test(node_factory, bitcoind)
+
+    gs_path = os.path.join(l2.daemon.lightning_dir, TEST_NETWORK, 'gossip_store')
+    before = os.path.getsize(gs_path)
+    l2.rpc.call('dev-compact-gossip-store')
+    l2.daemon.wait_for_log('gossip_store: compacted {} bytes'.format(before))
+    assert os.path.getsize(gs_path) < before
+
+    # Plugins switched over to the new store.
+    assert sorted([c['fee_per_millionth'] for c in l2.rpc.listchannels()['channels']]) == [10, 10, 1000, 1001]
+    assert len(l2.rpc.listnodes()['nodes']) == 3
+
+    # So did connectd: a new peer gets all the gossip.
+    l4 = node_factory.get_node()
+    l4.connect(l2)
+    wait_for(lambda: sorted([c['fee_per_millionth'] for c in l4.rpc.listchannels()['channels']]) == [10, 10, 1000, 1001])
+
+    # And we load it as-is on restart.
+    l2.restart()
+    assert l2.daemon.is_in_log('Store load time')
+    assert sorted([c['fee_per_millionth'] for c in l2.rpc.listchannels()['channels']]) == [10, 10, 1000, 1001]
+
+
 def test_gossip_announce_invalid_block(node_factory, bitcoind):
     """bitcoind lags and we might get an announcement for a block we don't have.
 
@@ -862,6 +862,25 @@ def test_listinvoices_index(node_factory, executor):
         assert only_one(l2.rpc.listinvoices(index='updated', start=i, limit=1)['invoices'])['label'] == str(70 + 1 - i)
 
 
+@pytest.mark.slow_test
+def test_listinvoices_batched(node_factory):
+    """listinvoices yields to the event loop every 1000 rows"""
+    l1 = node_factory.get_node()
+
+    for i in range(1, 2101):
+        l1.rpc.invoice(i, str(i), "test_listinvoices_batched")
+
+    assert [inv['label'] for inv in l1.rpc.listinvoices()['invoices']] == [str(i) for i in range(1, 2101)]
+    assert [inv['label'] for inv in l1.rpc.listinvoices(index='created', start=999, limit=1002)['invoices']] == [str(i) for i in range(999, 2001)]
+    assert [inv['label'] for inv in l1.rpc.listinvoices(index='created', start=1001, limit=1000)['invoices']] == [str(i) for i in range(1001, 2001)]
+    assert l1.rpc.listinvoices(index='created', start=2101) == {'invoices': []}
+
+    # A filter still works across batches.
+    invs = l1.rpc.call('listinvoices', {'index': 'created', 'limit': 1500},
+                       filter={'invoices': [{'label': True}]})['invoices']
+    assert invs == [{'label': str(i)} for i in range(1, 1501)]
+
+
 def test_unified_invoices(node_factory, executor, bitcoind):
     l1, l2 = node_factory.line_graph(2, opts={'invoices-onchain-fallback': None})
     amount_sat = 1000
@@ -1923,6 +1923,42 @@ def test_bcli(node_factory, bitcoind, chainparams):
     assert not resp["success"] and "decode failed" in resp["errmsg"]
 
 
+def test_bcli_rpc_direct(node_factory, bitcoind, chainparams):
+    """bcli talking JSON-RPC to bitcoind itself should look the same as bitcoin-cli"""
+    l1, l2 = node_factory.get_nodes(2, opts={'bitcoin-rpc-direct': None})
+    assert l1.daemon.is_in_log('Connected to bitcoind JSON-RPC at')
+
+    estimates = l1.rpc.call("estimatefees")
+    assert [f['blocks'] for f in estimates['feerates']] == [2, 6, 12, 100]
+
+    resp = l1.rpc.call("getchaininfo", {"last_height": 0})
+    assert resp["chain"] == chainparams['name']
+
+    resp = l1.rpc.call("getrawblockbyheight", {"height": 500})
+    assert resp["blockhash"] is resp["block"] is None
+    resp = l1.rpc.call("getrawblockbyheight", {"height": 50})
+    assert resp["blockhash"] == bitcoind.rpc.getblockhash(50)
+    assert resp["block"] == bitcoind.rpc.getblock(resp["blockhash"], 0)
+
+    # Blocks keep coming through.
+    bitcoind.generate_block(5)
+    sync_blockheight(bitcoind, [l1, l2])
+
+    l1.fundwallet(10**5)
+    l1.connect(l2)
+    fc = l1.rpc.fundchannel(l2.info["id"], 10**4 * 3)
+    txo = l1.rpc.call("getutxout", {"txid": fc['txid'], "vout": fc['outnum']})
+    assert Millisatoshi(txo["amount"]) == Millisatoshi(10**4 * 3 * 10**3)
+    l1.rpc.close(l2.info["id"])
+    wait_for(lambda: l1.rpc.call("getutxout", {
+        "txid": fc['txid'],
+        "vout": fc['outnum']
+    })['amount'] is None)
+
+    resp = l1.rpc.call("sendrawtransaction", {"tx": "dummy", "allowhighfees": False})
+    assert not resp["success"] and "decode failed" in resp["errmsg"]
+
+
 @unittest.skipIf(TEST_NETWORK != 'regtest', 'p2tr addresses not supported by elementsd')
 def test_hook_crash(node_factory, executor, bitcoind):
     """Verify that we fail over if a plugin crashes while handling a hook.
@@ -4281,6 +4317,29 @@ def test_sql_deprecated(node_factory, bitcoind):
     assert ret == {'rows': [[1]]}
 
 
+def test_sql_incremental(node_factory, bitcoind):
+    """invoices are refreshed using the created/updated/deleted indexes"""
+    l1, l2 = node_factory.line_graph(2)
+
+    inv1 = l2.rpc.invoice(1000, 'inv1', 'inv1')
+    l2.rpc.invoice(2000, 'inv2', 'inv2')
+    assert l2.rpc.sql("SELECT label, status FROM invoices ORDER BY label;") == {'rows': [['inv1', 'unpaid'], ['inv2', 'unpaid']]}
+
+    # New one, and updated one.
+    l2.rpc.invoice(3000, 'inv3', 'inv3')
+    l1.rpc.xpay(inv1['bolt11'])
+    assert l2.rpc.sql("SELECT label, status FROM invoices ORDER BY label;") == {'rows': [['inv1', 'paid'], ['inv2', 'unpaid'], ['inv3', 'unpaid']]}
+    l2.daemon.wait_for_log("Refreshing invoices from created")
+
+    # Deleted one.
+    l2.rpc.delinvoice('inv2', 'unpaid')
+    assert l2.rpc.sql("SELECT label, status FROM invoices ORDER BY label;") == {'rows': [['inv1', 'paid'], ['inv3', 'unpaid']]}
+    l2.daemon.wait_for_log("Reloading invoices")
+
+    # Nothing changed.
+    assert l2.rpc.sql("SELECT COUNT(*) FROM invoices;") == {'rows': [[2]]}
+
+
 def test_plugin_persist_option(node_factory):
     """test that options from config file get remembered across plugin stop/start"""
     plugin_path = os.path.join(os.getcwd(), 'contrib/plugins/helloworld.py')
@@ -180,6 +180,15 @@ struct command_result *command_success(struct command *cmd UNNEEDED,
 				       struct json_stream *response)
 
 { fprintf(stderr, "command_success called!\n"); abort(); }
+/* Generated stub for command_success_batched_ */
+struct command_result *command_success_batched_(struct command *cmd UNNEEDED,
+						struct json_stream *response UNNEEDED,
+						bool (*batch)(struct command * UNNEEDED,
+							      struct json_stream * UNNEEDED,
+							      void *) UNNEEDED,
+						void *arg UNNEEDED)
+
+{ fprintf(stderr, "command_success_batched_ called!\n"); abort(); }
 /* Generated stub for commit_tx_boost */
 void commit_tx_boost(struct channel *channel UNNEEDED,
 		     struct anchor_details *adet UNNEEDED,
@@ -231,6 +240,21 @@ struct onionreply *create_onionreply(const tal_t *ctx UNNEEDED,
 				     const struct secret *shared_secret UNNEEDED,
 				     const u8 *failure_msg UNNEEDED)
 { fprintf(stderr, "create_onionreply called!\n"); abort(); }
+/* Generated stub for daemon_conn_new_ */
+struct daemon_conn *daemon_conn_new_(const tal_t *ctx UNNEEDED, int fd UNNEEDED,
+				     struct io_plan *(*recv)(struct io_conn * UNNEEDED,
+							     const u8 * UNNEEDED,
+							     void *) UNNEEDED,
+				     void (*outq_empty)(void *) UNNEEDED,
+				     void *arg UNNEEDED)
+{ fprintf(stderr, "daemon_conn_new_ called!\n"); abort(); }
+/* Generated stub for daemon_conn_read_next */
+struct io_plan *daemon_conn_read_next(struct io_conn *conn UNNEEDED,
+				      struct daemon_conn *dc UNNEEDED)
+{ fprintf(stderr, "daemon_conn_read_next called!\n"); abort(); }
+/* Generated stub for daemon_conn_send */
+void daemon_conn_send(struct daemon_conn *dc UNNEEDED, const u8 *msg UNNEEDED)
+{ fprintf(stderr, "daemon_conn_send called!\n"); abort(); }
 /* Generated stub for depthcb_update_scid */
 bool depthcb_update_scid(struct channel *channel UNNEEDED,
 			 const struct bitcoin_txid *txid UNNEEDED,
@@ -12,6 +12,7 @@
 #include <common/key_derive.h>
 #include <common/psbt_keypath.h>
 #include <common/psbt_open.h>
+#include <db/common.h>
 #include <db/exec.h>
 #include <errno.h>
 #include <hsmd/hsmd_wiregen.h>
@@ -552,6 +553,31 @@ static const struct json_command dev_rescan_output_command = {
 };
 AUTODATA(json_command, &dev_rescan_output_command);
 
+static struct command_result *json_dev_dbstats(struct command *cmd,
+					       const char *buffer,
+					       const jsmntok_t *obj UNNEEDED,
+					       const jsmntok_t *params)
+{
+	struct json_stream *response;
+	const struct db *db = cmd->ld->wallet->db;
+
+	if (!param(cmd, buffer, params, NULL))
+		return command_param_failed();
+
+	response = json_stream_success(cmd);
+	json_add_string(response, "driver", db->config->name);
+	json_add_u64(response, "stmt_cache_hits", db->stmt_cache_hits);
+	json_add_u64(response, "stmt_cache_misses", db->stmt_cache_misses);
+	return command_success(cmd, response);
+}
+
+static const struct json_command dev_dbstats_command = {
+	"dev-dbstats",
+	json_dev_dbstats,
+	.dev_only = true,
+};
+AUTODATA(json_command, &dev_dbstats_command);
+
 struct {
 	enum wallet_tx_type t;
 	const char *name;